@@ -158,6 +158,14 @@ namespace rtxgi
         // Probe variability tracks the change in probes between updates as a proxy for convergence
         bool            probeVariabilityEnabled = false;
 
+        // Adaptive hysteresis gives each probe an 8-bit history of its recent irradiance updates (stored in the fractional part
+        // of the probe data W channel). A probe whose mean texel coefficient of variation exceeds the threshold in an update
+        // is changing. Changing probes blend irradiance with probeAdaptiveHysteresisMin, probes that have been stable for the
+        // whole history window blend with probeHysteresis, and probes in between are interpolated.
+        bool            probeAdaptiveHysteresisEnabled = false;
+        float           probeAdaptiveHysteresisMin = 0.7f;
+        float           probeAdaptiveHysteresisThreshold = 0.03f;
+
         // The type of movement the volume supports
         EDDGIVolumeMovementType movementType = EDDGIVolumeMovementType::Default;
 
@@ -300,6 +308,13 @@ namespace rtxgi
 
         void SetVolumeAverageVariability(float value) { m_averageVariability = value; };
 
+        // Adaptive Hysteresis Setters
+        void SetProbeAdaptiveHysteresisEnabled(bool value) { m_desc.probeAdaptiveHysteresisEnabled = value; }
+
+        void SetProbeAdaptiveHysteresisMin(float value) { m_desc.probeAdaptiveHysteresisMin = value; }
+
+        void SetProbeAdaptiveHysteresisThreshold(float value) { m_desc.probeAdaptiveHysteresisThreshold = value; }
+
         //------------------------------------------------------------------------
         // Getters
         //------------------------------------------------------------------------
@@ -387,6 +402,13 @@ namespace rtxgi
 
         float GetVolumeAverageVariability() const { return m_averageVariability; };
 
+        // Adaptive Hysteresis Getters
+        bool GetProbeAdaptiveHysteresisEnabled() const { return m_desc.probeAdaptiveHysteresisEnabled; }
+
+        float GetProbeAdaptiveHysteresisMin() const { return m_desc.probeAdaptiveHysteresisMin; }
+
+        float GetProbeAdaptiveHysteresisThreshold() const { return m_desc.probeAdaptiveHysteresisThreshold; }
+
     protected:
 
         void ComputeRandomRotation();
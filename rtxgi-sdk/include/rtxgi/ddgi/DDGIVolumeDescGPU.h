@@ -82,7 +82,10 @@ struct DDGIVolumeDescGPUPacked
                             // probeScrollClear Y-Z plane (1), probeScrollClear X-Z plane (1), probeScrollClear X-Y plane (1)
                             // probeScrollDirection Y-Z plane (1), probeScrollDirection X-Z plane (1), probeScrollDirection X-Y plane (1)
     //------------------------------------------------- 112B
-    uint4    reserved;      // 16B reserved for future use
+    float    probeAdaptiveHysteresisMin;
+    float    probeAdaptiveHysteresisThreshold;
+    uint     packed5;       // probeAdaptiveHysteresisEnabled (1), unused (31)
+    uint     reserved;      // 4B reserved for future use
     //------------------------------------------------- 128B
 };
 
@@ -131,6 +134,11 @@ struct DDGIVolumeDescGPU
     bool     probeRelocationEnabled;             // whether probe relocation is enabled for this volume
     bool     probeClassificationEnabled;         // whether probe classification is enabled for this volume
     bool     probeVariabilityEnabled;            // whether probe variability is enabled for this volume
+
+    // Adaptive Hysteresis
+    bool     probeAdaptiveHysteresisEnabled;     // whether probes blend irradiance with a hysteresis adapted to their variability history
+    float    probeAdaptiveHysteresisMin;         // hysteresis of probes that are changing (probeHysteresis is used by stable probes)
+    float    probeAdaptiveHysteresisThreshold;   // mean coefficient of variation above which a probe update is considered a change
 };
 
 #if !defined(GLSL) && !defined(HLSL) // CPU only
@@ -185,6 +193,11 @@ static inline rtxgi::DDGIVolumeDescGPUPacked PackDDGIVolumeDescGPU(const rtxgi::
     packed.packed4 = (packed.packed4 & ~0x40000000) | (unpacked.probeScrollDirections[1] << 30);
     packed.packed4 = (packed.packed4 & ~0x80000000) | (unpacked.probeScrollDirections[2] << 31);
 
+    // Adaptive Hysteresis
+    packed.probeAdaptiveHysteresisMin = unpacked.probeAdaptiveHysteresisMin;
+    packed.probeAdaptiveHysteresisThreshold = unpacked.probeAdaptiveHysteresisThreshold;
+    packed.packed5 = (uint32_t)unpacked.probeAdaptiveHysteresisEnabled;
+
     return packed;
 }
 #endif // if !defined(GLSL) && !defined(HLSL)
@@ -248,6 +261,11 @@ DDGIVolumeDescGPU UnpackDDGIVolumeDescGPU(DDGIVolumeDescGPUPacked packed)
     unpacked.probeScrollDirections[1] = bool((packed.packed4 >> 30) & 0x00000001);
     unpacked.probeScrollDirections[2] = bool((packed.packed4 >> 31) & 0x00000001);
 
+    // Adaptive Hysteresis
+    unpacked.probeAdaptiveHysteresisEnabled = bool(packed.packed5 & 0x00000001);
+    unpacked.probeAdaptiveHysteresisMin = packed.probeAdaptiveHysteresisMin;
+    unpacked.probeAdaptiveHysteresisThreshold = packed.probeAdaptiveHysteresisThreshold;
+
     return unpacked;
 }
 
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "../DDGIVolume.h"
+#include "ProbeCommon_CPU.h"
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+
+        //------------------------------------------------------------------------
+        // DDGIVolume
+        //------------------------------------------------------------------------
+
+        /**
+         * DDGIVolume
+         * A CPU implementation of a DDGIVolume. The volume owns in-memory copies of the probe texture arrays
+         * (stored as 32-bit float RGBA, regardless of the texture formats specified in the volume descriptor)
+         * and updates them with the same math as the SDK's compute shaders.
+         *
+         * Use this to bake, validate, or experiment with probe updates without a GPU. Fill the ray data texture
+         * array with probe trace results (RGB: radiance | A: hit distance, negative for backface hits) and
+         * call UpdateDDGIVolumeProbes().
+         */
+        class RTXGI_API DDGIVolume : public DDGIVolumeBase
+        {
+        public:
+            /**
+             * Allocates the volume's texture arrays and initializes the volume
+             */
+            ERTXGIStatus Create(const DDGIVolumeDesc& desc);
+
+            /**
+             * Clears the volume's probe irradiance and distance texture arrays
+             */
+            ERTXGIStatus ClearProbes();
+
+            /**
+             * Releases resources owned by the volume
+             */
+            void Destroy();
+
+            //------------------------------------------------------------------------
+            // Resource Getters
+            //------------------------------------------------------------------------
+
+            // Stats
+            size_t GetMemoryUsedInBytes() const;
+
+            // Probe Update List
+            const std::vector<int>& GetProbeUpdateList() const { return m_probeUpdateList; }
+
+            // Texture Arrays
+            Texture2DArray& GetProbeRayData() { return m_probeRayData; }
+            Texture2DArray& GetProbeIrradiance() { return m_probeIrradiance; }
+            Texture2DArray& GetProbeDistance() { return m_probeDistance; }
+            Texture2DArray& GetProbeData() { return m_probeData; }
+            Texture2DArray& GetProbeVariability() { return m_probeVariability; }
+
+            const Texture2DArray& GetProbeRayData() const { return m_probeRayData; }
+            const Texture2DArray& GetProbeIrradiance() const { return m_probeIrradiance; }
+            const Texture2DArray& GetProbeDistance() const { return m_probeDistance; }
+            const Texture2DArray& GetProbeData() const { return m_probeData; }
+            const Texture2DArray& GetProbeVariability() const { return m_probeVariability; }
+
+            //------------------------------------------------------------------------
+            // Resource Setters
+            //------------------------------------------------------------------------
+
+            /**
+             * Restricts probe updates, relocation, and classification to a list of (scroll adjusted) probe indices,
+             * e.g. the probes re-traced after a local scene edit. Probes not in the list keep their texels. An empty list updates all probes.
+             */
+            void SetProbeUpdateList(const std::vector<int>& probeIndices) { m_probeUpdateList = probeIndices; }
+
+        private:
+
+            Texture2DArray   m_probeRayData;         // Probe ray data texture array - RGB: radiance | A: hit distance
+            Texture2DArray   m_probeIrradiance;      // Probe irradiance texture array - RGB: irradiance, encoded with a high gamma curve
+            Texture2DArray   m_probeDistance;        // Probe distance texture array - R: mean distance | G: mean distance^2
+            Texture2DArray   m_probeData;            // Probe data texture array - XYZ: world-space relocation offsets | W: classification state (+ history)
+            Texture2DArray   m_probeVariability;     // Probe variability texture array - R: coefficient of variation
+
+            std::vector<int> m_probeUpdateList;      // Probes updated by the CPU update functions, empty: all probes
+        };
+
+        //------------------------------------------------------------------------
+        // Public RTXGI CPU namespace DDGIVolume Functions
+        //------------------------------------------------------------------------
+
+        /**
+         * Updates one or more volume's probes using data in the volume's ray data texture array.
+         * Blends irradiance and distance, updates probe variability (and adaptive hysteresis history), and updates probe borders.
+         * Probes are updated on numThreads threads (0 uses the hardware thread count). Results do not depend on the thread count.
+         * Only the probes of a volume's probe update list are updated when the list is not empty.
+         */
+        RTXGI_API ERTXGIStatus UpdateDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads = 0);
+
+        /**
+         * Adjusts one or more volume's probe world-space offsets using the fixed rays in the volume's ray data texture array.
+         * Volumes that need a relocation reset have their offsets reset to zero first. Volumes with relocation disabled are skipped.
+         * Probes are relocated on numThreads threads (0 uses the hardware thread count), only the probes of the probe update list when it is not empty.
+         */
+        RTXGI_API ERTXGIStatus RelocateDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads = 0);
+
+        /**
+         * Classifies one or more volume's probes as active or inactive using the fixed rays in the volume's ray data texture array.
+         * Volumes that need a classification reset have all their probes set to active first. Volumes with classification disabled are skipped.
+         * Probes are classified on numThreads threads (0 uses the hardware thread count), only the probes of the probe update list when it is not empty.
+         */
+        RTXGI_API ERTXGIStatus ClassifyDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads = 0);
+
+        /**
+         * Adjusts probe world-space offsets in a probe data texture array using the fixed rays of a ray data texture array
+         * (RGB: radiance | A: hit distance, backface hits stored as -0.2 * hitT like DDGIStoreProbeRayBackfaceHit()).
+         * Use this to relocate probes of any volume (e.g. from GPU ray data read back to the CPU) during an offline bake.
+         * Only the given (scroll adjusted) probe indices are relocated when a probe list is provided.
+         */
+        RTXGI_API ERTXGIStatus DDGIRelocateProbes(const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData, Texture2DArray& probeData, uint32_t numThreads = 0, const std::vector<int>* probeIndices = nullptr);
+
+        /**
+         * Classifies probes as active or inactive in a probe data texture array using the fixed rays of a ray data texture array.
+         * Probe states are written to the integer part of the probe data W channel, adaptive hysteresis history is preserved.
+         * Use this to classify probes offline and ship static probe states.
+         * Only the given (scroll adjusted) probe indices are classified when a probe list is provided.
+         */
+        RTXGI_API ERTXGIStatus DDGIClassifyProbes(const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData, Texture2DArray& probeData, uint32_t numThreads = 0, const std::vector<int>* probeIndices = nullptr);
+
+    } // namespace cpu
+} // namespace rtxgi
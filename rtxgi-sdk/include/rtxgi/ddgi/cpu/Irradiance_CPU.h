@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "DDGIVolume_CPU.h"
+
+// CPU implementation of shaders/ddgi/Irradiance.hlsl.
+// Use these functions to sample a volume's indirect lighting on the CPU (e.g. for gameplay, audio, or AI systems),
+// from a cpu::DDGIVolume or from probe texture arrays read back from the GPU (converted to 32-bit float RGBA).
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        /**
+         * Precomputed per-cell probe visibility masks (see DDGIBuildProbeVisibilityMasks()).
+         * Each probe grid cell (the region between a base probe and its 7 adjacent probes) is split into
+         * cellSubdivisions^3 cells. Bit i of a cell's mask is set when the adjacent probe with offset
+         * (i & 1, (i >> 1) & 1, (i >> 2) & 1) may be visible from the cell, the same order DDGIGetVolumeIrradiance() iterates.
+         * Masks are stored x-fastest, so they can be uploaded as is to an R8_UINT 3D texture of cellCounts dimensions.
+         */
+        struct DDGIProbeVisibilityMasks
+        {
+            int3 cellCounts = { 0, 0, 0 };                      // Probe counts * cellSubdivisions
+            int  cellSubdivisions = 0;
+            std::vector<uint8_t> masks;
+
+            uint8_t GetMask(const int3& cellCoords) const
+            {
+                return masks[(size_t)(cellCoords.x + (cellCounts.x * (cellCoords.y + (cellCounts.y * cellCoords.z))))];
+            }
+        };
+
+        /**
+         * Describes how probe visibility masks are built.
+         */
+        struct DDGIProbeVisibilityMasksDesc
+        {
+            int   cellSubdivisions = 4;         // Number of cells per probe grid cell, on each axis
+            int   samplesPerAxis = 3;           // Number of test positions per cell, on each axis (positions include the cell boundaries)
+            float visibilityThreshold = 0.05f;  // A probe is visible from a position when its Chebyshev weight is above this threshold
+        };
+
+        /**
+         * The probe texture arrays sampled by DDGIGetVolumeIrradiance().
+         */
+        struct DDGIVolumeResources
+        {
+            const Texture2DArray* probeIrradiance = nullptr;    // Probe irradiance (gamma encoded, see DDGIVolumeDesc::probeIrradianceEncodingGamma)
+            const Texture2DArray* probeDistance = nullptr;      // Probe filtered distance and squared distance
+            const Texture2DArray* probeData = nullptr;          // Probe relocation offsets and classification states
+            const DDGIProbeVisibilityMasks* probeVisibilityMasks = nullptr;  // Optional, probes masked out for a cell are not sampled
+        };
+
+        /**
+         * Returns the resources of a CPU volume.
+         */
+        inline DDGIVolumeResources DDGIGetVolumeResources(const DDGIVolume& volume)
+        {
+            DDGIVolumeResources resources;
+            resources.probeIrradiance = &volume.GetProbeIrradiance();
+            resources.probeDistance = &volume.GetProbeDistance();
+            resources.probeData = &volume.GetProbeData();
+            return resources;
+        }
+
+        /**
+         * Computes the surfaceBias parameter used by DDGIGetVolumeIrradiance().
+         * The surfaceNormal and cameraDirection arguments are expected to be normalized.
+         */
+        inline float3 DDGIGetSurfaceBias(const float3& surfaceNormal, const float3& cameraDirection, const DDGIVolumeDescGPU& volume)
+        {
+            return Sub(Mul(surfaceNormal, volume.probeNormalBias), Mul(cameraDirection, volume.probeViewBias));
+        }
+
+        //------------------------------------------------------------------------
+        // Single Queries
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes a weight value in the range [0, 1] for a world position and volume pair.
+         * All positions inside the given volume recieve a weight of 1. Positions outside the volume receive a
+         * weight in [0, 1] that decreases as the position moves away from the volume.
+         */
+        RTXGI_API float DDGIGetVolumeBlendWeight(const float3& worldPosition, const DDGIVolumeDescGPU& volume);
+
+        /**
+         * Computes irradiance for the given world-position using the given volume, surface bias, sampling direction,
+         * and volume resources. Line for line port of the shader function.
+         */
+        RTXGI_API float3 DDGIGetVolumeIrradiance(
+            const float3& worldPosition,
+            const float3& surfaceBias,
+            const float3& direction,
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources);
+
+        //------------------------------------------------------------------------
+        // Batched Queries
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes the volume blend weight of numQueries world positions.
+         */
+        RTXGI_API ERTXGIStatus DDGIGetVolumeBlendWeight(
+            uint32_t numQueries,
+            const float3* worldPositions,
+            const DDGIVolumeDescGPU& volume,
+            float* weights);
+
+        /**
+         * Computes irradiance for numQueries world positions, vectorized over SIMD width queries at a time.
+         * surfaceBiases may be nullptr, in which case each query is biased along its direction by the volume's probeNormalBias.
+         * Directions are the irradiance sampling directions (typically surface normals) and are expected to be normalized.
+         * Queries are distributed to numThreads threads (0 uses the hardware thread count).
+         * Results match the single query function to within the precision of the vectorized pow() approximation.
+         */
+        RTXGI_API ERTXGIStatus DDGIGetVolumeIrradiance(
+            uint32_t numQueries,
+            const float3* worldPositions,
+            const float3* surfaceBiases,
+            const float3* directions,
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources,
+            float3* irradiance,
+            uint32_t numThreads = 1);
+
+        //------------------------------------------------------------------------
+        // Probe Visibility Masks
+        //------------------------------------------------------------------------
+
+        /**
+         * Builds per-cell probe visibility masks from the volume's probe distance texture and probe positions.
+         * A probe is marked visible from a cell when the Chebyshev visibility test of DDGIGetVolumeIrradiance()
+         * passes from any of the cell's test positions. Inactive probes are never marked visible.
+         * Irradiance queries skip masked probes entirely (no distance or irradiance texture fetches). Cells with an
+         * empty mask fall back to sampling all 8 probes, like the unmasked query does when no probe is visible.
+         * The resources' probeVisibilityMasks are ignored. Masks depend on the probe distance texture and probe data,
+         * so rebuild them after probe updates that change either, and when a scrolling volume moves.
+         * Cells are distributed to numThreads threads (0 uses the hardware thread count).
+         */
+        RTXGI_API ERTXGIStatus DDGIBuildProbeVisibilityMasks(
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources,
+            const DDGIProbeVisibilityMasksDesc& desc,
+            DDGIProbeVisibilityMasks& masks,
+            uint32_t numThreads = 0);
+
+    } // namespace cpu
+} // namespace rtxgi
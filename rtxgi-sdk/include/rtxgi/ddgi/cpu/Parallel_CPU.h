@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "../../Common.h"
+
+#include <cstdint>
+#include <functional>
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        /**
+         * Returns the number of hardware threads available (at least 1).
+         */
+        RTXGI_API uint32_t GetHardwareThreadCount();
+
+        /**
+         * Returns the name ("AVX2", "NEON", or "Scalar") and width (in floats) of the SIMD kernels the library was compiled with.
+         * The library may differ from RTXGI_CPU_SIMD_NAME in application files, which follows the application's compile options.
+         */
+        RTXGI_API const char* GetSIMDName();
+        RTXGI_API uint32_t GetSIMDWidth();
+
+        /**
+         * Splits the range [0, count) into chunks of (at most) chunkSize items and calls func(begin, end) for each chunk.
+         * Chunks are distributed to numThreads threads (0 uses the hardware thread count); the calling thread participates.
+         * func must only write data owned by its chunk, which makes results independent of the thread count.
+         */
+        RTXGI_API void ParallelFor(uint32_t count, uint32_t chunkSize, uint32_t numThreads, const std::function<void(uint32_t begin, uint32_t end)>& func);
+
+    } // namespace cpu
+} // namespace rtxgi
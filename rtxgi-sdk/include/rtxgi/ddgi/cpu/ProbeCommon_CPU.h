@@ -0,0 +1,564 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "../DDGIVolume.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <vector>
+
+// C++ mirrors of the DDGI shader helpers in shaders/ddgi/include/*.hlsl.
+// Keep these in sync with the HLSL versions; the CPU implementation is expected to produce the same results.
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        //------------------------------------------------------------------------
+        // Defines
+        //------------------------------------------------------------------------
+
+        // The number of fixed rays that are used by probe relocation and classification (RTXGI_DDGI_NUM_FIXED_RAYS)
+        static const int DDGI_NUM_FIXED_RAYS = 32;
+
+        // Probe classification states (RTXGI_DDGI_PROBE_STATE_*)
+        static const int DDGI_PROBE_STATE_ACTIVE = 0;
+        static const int DDGI_PROBE_STATE_INACTIVE = 1;
+
+        // Adaptive hysteresis history, packed into the fractional part of the probe data's W channel (see DDGIEncodeProbeData())
+        static const uint32_t DDGI_PROBE_HISTORY_BITS = 8;
+        static const uint32_t DDGI_PROBE_HISTORY_MASK = (1u << DDGI_PROBE_HISTORY_BITS) - 1;
+        static const float    DDGI_PROBE_HISTORY_SCALE = 1.f / 512.f;
+
+        //------------------------------------------------------------------------
+        // Texture Arrays
+        //------------------------------------------------------------------------
+
+        /**
+         * An in-memory Texture2DArray with four 32-bit float channels per texel.
+         * Texels are stored in slice, row, column order.
+         */
+        struct Texture2DArray
+        {
+            uint32_t            width = 0;
+            uint32_t            height = 0;
+            uint32_t            arraySize = 0;
+            std::vector<float4> texels;
+
+            void Allocate(uint32_t w, uint32_t h, uint32_t a)
+            {
+                width = w;
+                height = h;
+                arraySize = a;
+                texels.assign((size_t)w * (size_t)h * (size_t)a, { 0.f, 0.f, 0.f, 0.f });
+            }
+
+            void Clear(const float4& value) { texels.assign(texels.size(), value); }
+
+            void Release()
+            {
+                width = height = arraySize = 0;
+                texels.clear();
+                texels.shrink_to_fit();
+            }
+
+            size_t GetIndex(uint32_t x, uint32_t y, uint32_t z) const { return ((size_t)z * height + y) * width + x; }
+
+            float4& Texel(uint32_t x, uint32_t y, uint32_t z) { return texels[GetIndex(x, y, z)]; }
+            const float4& Texel(uint32_t x, uint32_t y, uint32_t z) const { return texels[GetIndex(x, y, z)]; }
+
+            float4& operator[](const uint3& coords) { return Texel(coords.x, coords.y, coords.z); }
+            const float4& operator[](const uint3& coords) const { return Texel(coords.x, coords.y, coords.z); }
+
+            size_t GetSizeInBytes() const { return texels.size() * sizeof(float4); }
+        };
+
+        //------------------------------------------------------------------------
+        // Math Helpers (shaders/Common.hlsl)
+        //------------------------------------------------------------------------
+
+        inline float3 Add(const float3& a, const float3& b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+        inline float3 Sub(const float3& a, const float3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+        inline float3 Mul(const float3& a, const float3& b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+        inline float3 Mul(const float3& a, float b) { return { a.x * b, a.y * b, a.z * b }; }
+        inline float  Dot3(const float3& a, const float3& b) { return (a.x * b.x) + (a.y * b.y) + (a.z * b.z); }
+        inline float3 Cross3(const float3& a, const float3& b) { return { (a.y * b.z) - (a.z * b.y), (a.z * b.x) - (a.x * b.z), (a.x * b.y) - (a.y * b.x) }; }
+        inline float  Length3(const float3& v) { return sqrtf(Dot3(v, v)); }
+        inline float3 Normalize3(const float3& v) { return Mul(v, 1.f / Length3(v)); }
+        inline float3 ToFloat3(const int3& v) { return { (float)v.x, (float)v.y, (float)v.z }; }
+
+        inline float RTXGIMaxComponent(const float3& a)
+        {
+            return std::fmax(a.x, std::fmax(a.y, a.z));
+        }
+
+        inline float RTXGISignNotZero(float v)
+        {
+            return (v >= 0.f) ? 1.f : -1.f;
+        }
+
+        inline float RTXGILinearRGBToLuminance(const float3& rgb)
+        {
+            return Dot3(rgb, { 0.2126f, 0.7152f, 0.0722f });
+        }
+
+        /**
+         * Computes a low discrepancy spherically distributed direction on the unit sphere,
+         * for the given index in a set of samples.
+         */
+        inline float3 RTXGISphericalFibonacci(float sampleIndex, float numSamples)
+        {
+            const float b = (sqrtf(5.f) * 0.5f + 0.5f) - 1.f;
+            float s = sampleIndex * b;
+            float phi = RTXGI_2PI * (s - floorf(s));
+            float cosTheta = 1.f - (2.f * sampleIndex + 1.f) * (1.f / numSamples);
+            float sinTheta = sqrtf(std::fmin(std::fmax(1.f - (cosTheta * cosTheta), 0.f), 1.f));
+
+            return { (cosf(phi) * sinTheta), (sinf(phi) * sinTheta), cosTheta };
+        }
+
+        inline float3 RTXGIQuaternionRotate(const float3& v, const float4& q)
+        {
+            float3 b = { q.x, q.y, q.z };
+            float b2 = Dot3(b, b);
+            return Add(Add(Mul(v, (q.w * q.w - b2)), Mul(b, (Dot3(v, b) * 2.f))), Mul(Cross3(b, v), (q.w * 2.f)));
+        }
+
+        inline float4 RTXGIQuaternionConjugate(const float4& q)
+        {
+            return { -q.x, -q.y, -q.z, q.w };
+        }
+
+        inline bool IsVolumeMovementScrolling(const DDGIVolumeDescGPU& volume)
+        {
+            return (volume.movementType == (uint)EDDGIVolumeMovementType::Scrolling);
+        }
+
+        //------------------------------------------------------------------------
+        // Probe Indexing (shaders/ddgi/include/ProbeIndexing.hlsl)
+        //------------------------------------------------------------------------
+
+        /**
+         * Get the number of probes on a horizontal plane, in the active coordinate system.
+         */
+        inline int DDGIGetProbesPerPlane(const int3& probeCounts)
+        {
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            return (probeCounts.x * probeCounts.z);
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            return (probeCounts.x * probeCounts.y);
+        #endif
+        }
+
+        /**
+         * Get the index of the horizontal plane, in the active coordinate system.
+         */
+        inline int DDGIGetPlaneIndex(const int3& probeCoords)
+        {
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            return probeCoords.z;
+        #else
+            return probeCoords.y;
+        #endif
+        }
+
+        /**
+         * Get the index of a probe within a horizontal plane that the probe coordinates map to, in the active coordinate system.
+         */
+        inline int DDGIGetProbeIndexInPlane(const int3& probeCoords, const int3& probeCounts)
+        {
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            return probeCoords.x + (probeCounts.x * probeCoords.z);
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP
+            return probeCoords.y + (probeCounts.y * probeCoords.x);
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            return probeCoords.x + (probeCounts.x * probeCoords.y);
+        #endif
+        }
+
+        /**
+         * Computes the probe index from 3D grid coordinates.
+         * The opposite of DDGIGetProbeCoords(probeIndex,...).
+         */
+        inline int DDGIGetProbeIndex(const int3& probeCoords, const DDGIVolumeDescGPU& volume)
+        {
+            int probesPerPlane = DDGIGetProbesPerPlane(volume.probeCounts);
+            int planeIndex = DDGIGetPlaneIndex(probeCoords);
+            int probeIndexInPlane = DDGIGetProbeIndexInPlane(probeCoords, volume.probeCounts);
+
+            return (planeIndex * probesPerPlane) + probeIndexInPlane;
+        }
+
+        /**
+         * Computes the 3D grid-space coordinates for the probe at the given probe index in the range [0, numProbes-1].
+         * The opposite of DDGIGetProbeIndex(probeCoords,...).
+         */
+        inline int3 DDGIGetProbeCoords(int probeIndex, const DDGIVolumeDescGPU& volume)
+        {
+            int3 probeCoords;
+
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            probeCoords.x = probeIndex % volume.probeCounts.x;
+            probeCoords.y = probeIndex / (volume.probeCounts.x * volume.probeCounts.z);
+            probeCoords.z = (probeIndex / volume.probeCounts.x) % volume.probeCounts.z;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP
+            probeCoords.x = (probeIndex / volume.probeCounts.y) % volume.probeCounts.x;
+            probeCoords.y = probeIndex % volume.probeCounts.y;
+            probeCoords.z = probeIndex / (volume.probeCounts.x * volume.probeCounts.y);
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            probeCoords.x = probeIndex % volume.probeCounts.x;
+            probeCoords.y = (probeIndex / volume.probeCounts.x) % volume.probeCounts.y;
+            probeCoords.z = probeIndex / (volume.probeCounts.y * volume.probeCounts.x);
+        #endif
+
+            return probeCoords;
+        }
+
+        /**
+         * Computes the 3D grid-space coordinates of the "base" probe (i.e. floor of xyz) of the 8-probe
+         * cube that surrounds the given world space position. Accounts for scroll offsets.
+         */
+        inline int3 DDGIGetBaseProbeGridCoords(const float3& worldPosition, const DDGIVolumeDescGPU& volume)
+        {
+            // Get the vector from the volume origin to the surface point
+            float3 position = Sub(worldPosition, Add(volume.origin, Mul(ToFloat3(volume.probeScrollOffsets), volume.probeSpacing)));
+
+            // Rotate the world position into the volume's space
+            if (!IsVolumeMovementScrolling(volume)) position = RTXGIQuaternionRotate(position, RTXGIQuaternionConjugate(volume.rotation));
+
+            // Shift from [-n/2, n/2] to [0, n] (grid space)
+            float3 counts = { (float)(volume.probeCounts.x - 1), (float)(volume.probeCounts.y - 1), (float)(volume.probeCounts.z - 1) };
+            position = Add(position, Mul(Mul(volume.probeSpacing, counts), 0.5f));
+
+            // Quantize the position to grid space and clamp to [0, probeCounts - 1]
+            int3 probeCoords;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                int coord = (int)(position[(size_t)axis] / volume.probeSpacing[(size_t)axis]);
+                probeCoords[(size_t)axis] = std::max(0, std::min(coord, volume.probeCounts[(size_t)axis] - 1));
+            }
+
+            return probeCoords;
+        }
+
+        /**
+         * Computes the RayData Texture2DArray coordinates of the probe at the given probe index.
+         */
+        inline uint3 DDGIGetRayDataTexelCoords(int rayIndex, int probeIndex, const DDGIVolumeDescGPU& volume)
+        {
+            int probesPerPlane = DDGIGetProbesPerPlane(volume.probeCounts);
+
+            uint3 coords;
+            coords.x = (uint)rayIndex;
+            coords.z = (uint)(probeIndex / probesPerPlane);
+            coords.y = (uint)(probeIndex - ((int)coords.z * probesPerPlane));
+
+            return coords;
+        }
+
+        /**
+         * Computes the Texture2DArray coordinates of the probe at the given probe index.
+         */
+        inline uint3 DDGIGetProbeTexelCoords(int probeIndex, const DDGIVolumeDescGPU& volume)
+        {
+            // Find the probe's plane index
+            int probesPerPlane = DDGIGetProbesPerPlane(volume.probeCounts);
+            int planeIndex = int(probeIndex / probesPerPlane);
+
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            int x = (probeIndex % volume.probeCounts.x);
+            int y = (probeIndex / volume.probeCounts.x) % volume.probeCounts.z;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP
+            int x = (probeIndex % volume.probeCounts.y);
+            int y = (probeIndex / volume.probeCounts.y) % volume.probeCounts.x;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            int x = (probeIndex % volume.probeCounts.x);
+            int y = (probeIndex / volume.probeCounts.x) % volume.probeCounts.y;
+        #endif
+
+            return { (uint)x, (uint)y, (uint)planeIndex };
+        }
+
+        /**
+         * Computes the normalized texture UVs within the Probe Irradiance and Probe Distance texture arrays
+         * given the probe index and 2D normalized octant coordinates [-1, 1].
+         */
+        inline float3 DDGIGetProbeUV(int probeIndex, const float2& octantCoordinates, int numProbeInteriorTexels, const DDGIVolumeDescGPU& volume)
+        {
+            // Get the probe's texel coordinates, assuming one texel per probe
+            uint3 coords = DDGIGetProbeTexelCoords(probeIndex, volume);
+
+            // Add the border texels to get the total texels per probe
+            float numProbeTexels = ((float)numProbeInteriorTexels + 2.f);
+
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.x;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.z;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.y;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.x;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.x;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.y;
+        #endif
+
+            // Move to the center of the probe and move to the octant texel before normalizing
+            float u = ((float)coords.x * numProbeTexels) + (numProbeTexels * 0.5f);
+            float v = ((float)coords.y * numProbeTexels) + (numProbeTexels * 0.5f);
+            u += octantCoordinates.x * ((float)numProbeInteriorTexels * 0.5f);
+            v += octantCoordinates.y * ((float)numProbeInteriorTexels * 0.5f);
+            return { u / textureWidth, v / textureHeight, (float)coords.z };
+        }
+
+        /**
+         * Adjusts the probe index for when infinite scrolling is enabled.
+         */
+        inline int DDGIGetScrollingProbeIndex(const int3& probeCoords, const DDGIVolumeDescGPU& volume)
+        {
+            int3 coords;
+            coords.x = (probeCoords.x + volume.probeScrollOffsets.x + volume.probeCounts.x) % volume.probeCounts.x;
+            coords.y = (probeCoords.y + volume.probeScrollOffsets.y + volume.probeCounts.y) % volume.probeCounts.y;
+            coords.z = (probeCoords.z + volume.probeScrollOffsets.z + volume.probeCounts.z) % volume.probeCounts.z;
+            return DDGIGetProbeIndex(coords, volume);
+        }
+
+        /**
+         * Returns true if the probe belongs to a plane of probes that has been scrolled to new positions and needs to be cleared.
+         */
+        inline bool DDGIClearScrolledPlane(const int3& probeCoords, int planeIndex, const DDGIVolumeDescGPU& volume)
+        {
+            if (volume.probeScrollClear[planeIndex])
+            {
+                int offset = volume.probeScrollOffsets[(size_t)planeIndex];
+                int probeCount = volume.probeCounts[(size_t)planeIndex];
+                bool direction = volume.probeScrollDirections[planeIndex];
+
+                int coord = 0;
+                if (direction) coord = (probeCount + (offset - 1)) % probeCount; // scrolling in positive direction
+                else coord = (probeCount + (offset % probeCount)) % probeCount;  // scrolling in negative direction
+
+                // Probe has scrolled and needs to be cleared
+                if (probeCoords[(size_t)planeIndex] == coord) return true;
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------
+        // Probe Octahedral Indexing (shaders/ddgi/include/ProbeOctahedral.hlsl)
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes normalized octahedral coordinates for the given texel coordinates.
+         * Maps the top left texel to (-1,-1).
+         */
+        inline float2 DDGIGetNormalizedOctahedralCoordinates(int texCoordX, int texCoordY, int numTexels)
+        {
+            float2 octahedralTexelCoord = { (float)(texCoordX % numTexels), (float)(texCoordY % numTexels) };
+
+            // Move to the center of a texel, normalize, and shift to [-1, 1)
+            octahedralTexelCoord.x = (((octahedralTexelCoord.x + 0.5f) / (float)numTexels) * 2.f) - 1.f;
+            octahedralTexelCoord.y = (((octahedralTexelCoord.y + 0.5f) / (float)numTexels) * 2.f) - 1.f;
+
+            return octahedralTexelCoord;
+        }
+
+        /**
+         * Computes the normalized octahedral direction that corresponds to the
+         * given normalized coordinates on the [-1, 1] square.
+         */
+        inline float3 DDGIGetOctahedralDirection(const float2& coords)
+        {
+            float3 direction = { coords.x, coords.y, 1.f - fabsf(coords.x) - fabsf(coords.y) };
+            if (direction.z < 0.f)
+            {
+                float x = (1.f - fabsf(direction.y)) * RTXGISignNotZero(direction.x);
+                float y = (1.f - fabsf(direction.x)) * RTXGISignNotZero(direction.y);
+                direction.x = x;
+                direction.y = y;
+            }
+            return Normalize3(direction);
+        }
+
+        /**
+         * Computes the octant coordinates in the normalized [-1, 1] square, for the given a unit direction vector.
+         */
+        inline float2 DDGIGetOctahedralCoordinates(const float3& direction)
+        {
+            float l1norm = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+            float2 uv = { direction.x * (1.f / l1norm), direction.y * (1.f / l1norm) };
+            if (direction.z < 0.f)
+            {
+                float u = (1.f - fabsf(uv.y)) * RTXGISignNotZero(uv.x);
+                float v = (1.f - fabsf(uv.x)) * RTXGISignNotZero(uv.y);
+                uv = { u, v };
+            }
+            return uv;
+        }
+
+        //------------------------------------------------------------------------
+        // Probe Rays (shaders/ddgi/include/ProbeRayCommon.hlsl)
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes a spherically distributed, normalized ray direction for the given ray index in a set of ray samples.
+         * Applies the volume's random probe ray rotation transformation to "non-fixed" ray direction samples.
+         */
+        inline float3 DDGIGetProbeRayDirection(int rayIndex, const DDGIVolumeDescGPU& volume)
+        {
+            bool isFixedRay = false;
+            int sampleIndex = rayIndex;
+            int numRays = volume.probeNumRays;
+
+            if (volume.probeRelocationEnabled || volume.probeClassificationEnabled)
+            {
+                isFixedRay = (rayIndex < DDGI_NUM_FIXED_RAYS);
+                sampleIndex = isFixedRay ? rayIndex : (rayIndex - DDGI_NUM_FIXED_RAYS);
+                numRays = isFixedRay ? DDGI_NUM_FIXED_RAYS : (numRays - DDGI_NUM_FIXED_RAYS);
+            }
+
+            // Get a ray direction on the sphere
+            float3 direction = RTXGISphericalFibonacci((float)sampleIndex, (float)numRays);
+
+            // Don't rotate fixed rays so relocation/classification are temporally stable
+            if (isFixedRay) return Normalize3(direction);
+
+            // Apply a random rotation and normalize the direction
+            return Normalize3(RTXGIQuaternionRotate(direction, RTXGIQuaternionConjugate(volume.probeRayRotation)));
+        }
+
+        //------------------------------------------------------------------------
+        // Probe World Position (shaders/ddgi/include/ProbeCommon.hlsl)
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes the world-space position of a probe from the probe's 3D grid-space coordinates.
+         * Probe relocation is not considered.
+         */
+        inline float3 DDGIGetProbeWorldPosition(const int3& probeCoords, const DDGIVolumeDescGPU& volume)
+        {
+            // Multiply the grid coordinates by the probe spacing
+            float3 probeGridWorldPosition = Mul(ToFloat3(probeCoords), volume.probeSpacing);
+
+            // Shift the grid of probes by half of each axis extent to center the volume about its origin
+            float3 counts = { (float)(volume.probeCounts.x - 1), (float)(volume.probeCounts.y - 1), (float)(volume.probeCounts.z - 1) };
+            float3 probeGridShift = Mul(Mul(volume.probeSpacing, counts), 0.5f);
+
+            // Center the probe grid about the origin
+            float3 probeWorldPosition = Sub(probeGridWorldPosition, probeGridShift);
+
+            // Rotate the probe grid if infinite scrolling is not enabled
+            if (!IsVolumeMovementScrolling(volume)) probeWorldPosition = RTXGIQuaternionRotate(probeWorldPosition, volume.rotation);
+
+            // Translate the grid to the volume's center
+            return Add(probeWorldPosition, Add(volume.origin, Mul(ToFloat3(volume.probeScrollOffsets), volume.probeSpacing)));
+        }
+
+        /**
+         * Computes the world-space position of a probe from the probe's 3D grid-space coordinates.
+         * When probe relocation is enabled, offsets are loaded from the probe data texture array.
+         */
+        inline float3 DDGIGetProbeWorldPosition(const int3& probeCoords, const DDGIVolumeDescGPU& volume, const Texture2DArray& probeData)
+        {
+            float3 probeWorldPosition = DDGIGetProbeWorldPosition(probeCoords, volume);
+            if (volume.probeRelocationEnabled)
+            {
+                int probeIndex = DDGIGetScrollingProbeIndex(probeCoords, volume);
+                const float4& offset = probeData[DDGIGetProbeTexelCoords(probeIndex, volume)];
+                probeWorldPosition = Add(probeWorldPosition, Mul({ offset.x, offset.y, offset.z }, volume.probeSpacing));
+            }
+            return probeWorldPosition;
+        }
+
+        //------------------------------------------------------------------------
+        // Probe Data (shaders/ddgi/include/ProbeDataCommon.hlsl)
+        //------------------------------------------------------------------------
+
+        /**
+         * The probe data W channel stores the probe's classification state in its integer part. With adaptive hysteresis,
+         * the fractional part stores the probe's 8-bit variability history (in steps of 1/512, exactly representable in
+         * the F16x4 probe data format). The most recent irradiance update is stored in bit 0 of the history.
+         */
+        inline int DDGIDecodeProbeState(float w)
+        {
+            return (int)floorf(w);
+        }
+
+        inline uint32_t DDGIDecodeProbeHistory(float w)
+        {
+            float history = (w - floorf(w)) / DDGI_PROBE_HISTORY_SCALE;
+            return (uint32_t)(history + 0.5f) & DDGI_PROBE_HISTORY_MASK;
+        }
+
+        inline float DDGIEncodeProbeData(int state, uint32_t history)
+        {
+            return (float)state + ((float)(history & DDGI_PROBE_HISTORY_MASK) * DDGI_PROBE_HISTORY_SCALE);
+        }
+
+        /**
+         * Computes the irradiance hysteresis of a probe from its adaptive hysteresis history.
+         */
+        inline float DDGIGetAdaptiveProbeHysteresis(uint32_t history, const DDGIVolumeDescGPU& volume)
+        {
+            // The probe changed in the last update, react quickly
+            if (history & 1) return volume.probeAdaptiveHysteresisMin;
+
+            // Otherwise, steer toward the volume's hysteresis as the changes age out of the history window
+            float changing = (float)std::bitset<DDGI_PROBE_HISTORY_BITS>(history).count() / (float)DDGI_PROBE_HISTORY_BITS;
+            return volume.probeAdaptiveHysteresisMin + ((volume.probeHysteresis - volume.probeAdaptiveHysteresisMin) * (1.f - changing));
+        }
+
+        /**
+         * Reads the probe's position offset and converts it to a world-space offset.
+         */
+        inline float3 DDGILoadProbeDataOffset(const Texture2DArray& probeData, const uint3& coords, const DDGIVolumeDescGPU& volume)
+        {
+            const float4& texel = probeData[coords];
+            return Mul({ texel.x, texel.y, texel.z }, volume.probeSpacing);
+        }
+
+        /**
+         * Normalizes the world-space offset and writes it to the probe data texture. The W channel is not modified.
+         * Probe Relocation limits this range to [0.f, 0.45f).
+         */
+        inline void DDGIStoreProbeDataOffset(Texture2DArray& probeData, const uint3& coords, const float3& wsOffset, const DDGIVolumeDescGPU& volume)
+        {
+            float4& texel = probeData[coords];
+            texel.x = wsOffset.x / volume.probeSpacing.x;
+            texel.y = wsOffset.y / volume.probeSpacing.y;
+            texel.z = wsOffset.z / volume.probeSpacing.z;
+        }
+
+        /**
+         * Writes the probe's classification state, keeping its adaptive hysteresis history.
+         */
+        inline void DDGIStoreProbeState(Texture2DArray& probeData, const uint3& coords, int state)
+        {
+            float4& texel = probeData[coords];
+            texel.w = DDGIEncodeProbeData(state, DDGIDecodeProbeHistory(texel.w));
+        }
+
+        /**
+         * Loads and returns the probe's classification state.
+         */
+        inline int DDGILoadProbeState(int probeIndex, const Texture2DArray& probeData, const DDGIVolumeDescGPU& volume)
+        {
+            int state = DDGI_PROBE_STATE_ACTIVE;
+            if (volume.probeClassificationEnabled)
+            {
+                state = DDGIDecodeProbeState(probeData[DDGIGetProbeTexelCoords(probeIndex, volume)].w);
+            }
+            return state;
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Thin wrappers over the SIMD instruction set selected at compile time.
+// AVX2 (x86-64, enable with RTXGI_CPU_SIMD_AVX2) operates on 8 floats, NEON (AArch64) on 4 floats.
+// The scalar fallback operates on 1 float. Every wrapper performs the same IEEE operations in the same order on each
+// lane (no fused multiply-add), so results are identical regardless of the SIMD width.
+// The instruction set follows the compile options of the including file, not of the RTXGI library (which compiles with AVX2
+// privately). The wrappers live in an inline namespace named after the instruction set, so files compiled with different
+// options never share a wrapper definition. Use GetSIMDName() to query the library's kernels.
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define RTXGI_CPU_SIMD_WIDTH 8
+    #define RTXGI_CPU_SIMD_NAME "AVX2"
+    #define RTXGI_CPU_SIMD_NAMESPACE avx2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+    #define RTXGI_CPU_SIMD_WIDTH 4
+    #define RTXGI_CPU_SIMD_NAME "NEON"
+    #define RTXGI_CPU_SIMD_NAMESPACE neon
+#else
+    #define RTXGI_CPU_SIMD_WIDTH 1
+    #define RTXGI_CPU_SIMD_NAME "Scalar"
+    #define RTXGI_CPU_SIMD_NAMESPACE scalar
+#endif
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        namespace simd
+        {
+        inline namespace RTXGI_CPU_SIMD_NAMESPACE
+        {
+            static const int Width = RTXGI_CPU_SIMD_WIDTH;
+
+            // Exp() returns zero for inputs below this value
+            static const float ExpUnderflow = -87.3f;
+
+            // Rounds count up to a multiple of the SIMD width
+            inline int AlignToWidth(int count) { return ((count + Width - 1) / Width) * Width; }
+
+        #if defined(__AVX2__)
+
+            typedef __m256  vfloat;
+            typedef __m256i vint;
+            typedef __m256  vmask;
+
+            inline vfloat Set1(float value) { return _mm256_set1_ps(value); }
+            inline vfloat Load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+            inline void   Store(float* ptr, vfloat v) { _mm256_storeu_ps(ptr, v); }
+            inline vfloat Add(vfloat a, vfloat b) { return _mm256_add_ps(a, b); }
+            inline vfloat Sub(vfloat a, vfloat b) { return _mm256_sub_ps(a, b); }
+            inline vfloat Mul(vfloat a, vfloat b) { return _mm256_mul_ps(a, b); }
+            inline vfloat Div(vfloat a, vfloat b) { return _mm256_div_ps(a, b); }
+            inline vfloat Min(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+            inline vfloat Max(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+            inline vfloat Floor(vfloat a) { return _mm256_floor_ps(a); }
+            inline vfloat Sqrt(vfloat a) { return _mm256_sqrt_ps(a); }
+            inline vfloat Abs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+
+            inline vmask  Less(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            inline vmask  LessEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+            inline vmask  Greater(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            inline vmask  GreaterEqual(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+            inline vmask  Equal(vfloat a, vfloat b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+            inline vmask  And(vmask a, vmask b) { return _mm256_and_ps(a, b); }
+            inline vmask  Or(vmask a, vmask b) { return _mm256_or_ps(a, b); }
+            inline vfloat Select(vmask mask, vfloat a, vfloat b) { return _mm256_blendv_ps(b, a, mask); }
+            inline int    MoveMask(vmask mask) { return _mm256_movemask_ps(mask); }
+
+            inline vint   AsInt(vfloat a) { return _mm256_castps_si256(a); }
+            inline vfloat AsFloat(vint a) { return _mm256_castsi256_ps(a); }
+            inline vint   Set1i(int32_t value) { return _mm256_set1_epi32(value); }
+            inline vint   Addi(vint a, vint b) { return _mm256_add_epi32(a, b); }
+            inline vint   Subi(vint a, vint b) { return _mm256_sub_epi32(a, b); }
+            inline vint   Andi(vint a, vint b) { return _mm256_and_si256(a, b); }
+            inline vint   Ori(vint a, vint b) { return _mm256_or_si256(a, b); }
+            inline vint   Muli(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+            inline vint   ShiftLeft23(vint a) { return _mm256_slli_epi32(a, 23); }
+            inline vint   ShiftRight23(vint a) { return _mm256_srli_epi32(a, 23); }
+            inline vfloat ToFloat(vint a) { return _mm256_cvtepi32_ps(a); }
+            inline vint   ToIntTruncate(vfloat a) { return _mm256_cvttps_epi32(a); }
+
+            // Loads base[indices[lane]] into each lane
+            inline vfloat Gather(const float* base, vint indices) { return _mm256_i32gather_ps(base, indices, 4); }
+
+        #elif defined(__ARM_NEON) && defined(__aarch64__)
+
+            typedef float32x4_t vfloat;
+            typedef int32x4_t   vint;
+            typedef uint32x4_t  vmask;
+
+            inline vfloat Set1(float value) { return vdupq_n_f32(value); }
+            inline vfloat Load(const float* ptr) { return vld1q_f32(ptr); }
+            inline void   Store(float* ptr, vfloat v) { vst1q_f32(ptr, v); }
+            inline vfloat Add(vfloat a, vfloat b) { return vaddq_f32(a, b); }
+            inline vfloat Sub(vfloat a, vfloat b) { return vsubq_f32(a, b); }
+            inline vfloat Mul(vfloat a, vfloat b) { return vmulq_f32(a, b); }
+            inline vfloat Div(vfloat a, vfloat b) { return vdivq_f32(a, b); }
+            inline vfloat Min(vfloat a, vfloat b) { return vminnmq_f32(a, b); }
+            inline vfloat Max(vfloat a, vfloat b) { return vmaxnmq_f32(a, b); }
+            inline vfloat Floor(vfloat a) { return vrndmq_f32(a); }
+            inline vfloat Sqrt(vfloat a) { return vsqrtq_f32(a); }
+            inline vfloat Abs(vfloat a) { return vabsq_f32(a); }
+
+            inline vmask  Less(vfloat a, vfloat b) { return vcltq_f32(a, b); }
+            inline vmask  LessEqual(vfloat a, vfloat b) { return vcleq_f32(a, b); }
+            inline vmask  Greater(vfloat a, vfloat b) { return vcgtq_f32(a, b); }
+            inline vmask  GreaterEqual(vfloat a, vfloat b) { return vcgeq_f32(a, b); }
+            inline vmask  Equal(vfloat a, vfloat b) { return vceqq_f32(a, b); }
+            inline vmask  And(vmask a, vmask b) { return vandq_u32(a, b); }
+            inline vmask  Or(vmask a, vmask b) { return vorrq_u32(a, b); }
+            inline vfloat Select(vmask mask, vfloat a, vfloat b) { return vbslq_f32(mask, a, b); }
+            inline int    MoveMask(vmask mask)
+            {
+                static const int32_t shifts[4] = { 0, 1, 2, 3 };
+                uint32x4_t bits = vshlq_u32(vshrq_n_u32(mask, 31), vld1q_s32(shifts));
+                return (int)vaddvq_u32(bits);
+            }
+
+            inline vint   AsInt(vfloat a) { return vreinterpretq_s32_f32(a); }
+            inline vfloat AsFloat(vint a) { return vreinterpretq_f32_s32(a); }
+            inline vint   Set1i(int32_t value) { return vdupq_n_s32(value); }
+            inline vint   Addi(vint a, vint b) { return vaddq_s32(a, b); }
+            inline vint   Subi(vint a, vint b) { return vsubq_s32(a, b); }
+            inline vint   Andi(vint a, vint b) { return vandq_s32(a, b); }
+            inline vint   Ori(vint a, vint b) { return vorrq_s32(a, b); }
+            inline vint   Muli(vint a, vint b) { return vmulq_s32(a, b); }
+            inline vint   ShiftLeft23(vint a) { return vshlq_n_s32(a, 23); }
+            inline vint   ShiftRight23(vint a) { return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), 23)); }
+            inline vfloat ToFloat(vint a) { return vcvtq_f32_s32(a); }
+            inline vint   ToIntTruncate(vfloat a) { return vcvtq_s32_f32(a); }
+
+            // Loads base[indices[lane]] into each lane
+            inline vfloat Gather(const float* base, vint indices)
+            {
+                int32_t lanes[4];
+                vst1q_s32(lanes, indices);
+                float values[4] = { base[lanes[0]], base[lanes[1]], base[lanes[2]], base[lanes[3]] };
+                return vld1q_f32(values);
+            }
+
+        #else
+
+            typedef float    vfloat;
+            typedef int32_t  vint;
+            typedef bool     vmask;
+
+            inline vfloat Set1(float value) { return value; }
+            inline vfloat Load(const float* ptr) { return *ptr; }
+            inline void   Store(float* ptr, vfloat v) { *ptr = v; }
+            inline vfloat Add(vfloat a, vfloat b) { return a + b; }
+            inline vfloat Sub(vfloat a, vfloat b) { return a - b; }
+            inline vfloat Mul(vfloat a, vfloat b) { return a * b; }
+            inline vfloat Div(vfloat a, vfloat b) { return a / b; }
+            inline vfloat Min(vfloat a, vfloat b) { return (a < b) ? a : b; }
+            inline vfloat Max(vfloat a, vfloat b) { return (a > b) ? a : b; }
+            inline vfloat Floor(vfloat a) { return std::floor(a); }
+            inline vfloat Sqrt(vfloat a) { return std::sqrt(a); }
+            inline vfloat Abs(vfloat a) { return std::fabs(a); }
+
+            inline vmask  Less(vfloat a, vfloat b) { return a < b; }
+            inline vmask  LessEqual(vfloat a, vfloat b) { return a <= b; }
+            inline vmask  Greater(vfloat a, vfloat b) { return a > b; }
+            inline vmask  GreaterEqual(vfloat a, vfloat b) { return a >= b; }
+            inline vmask  Equal(vfloat a, vfloat b) { return a == b; }
+            inline vmask  And(vmask a, vmask b) { return a && b; }
+            inline vmask  Or(vmask a, vmask b) { return a || b; }
+            inline vfloat Select(vmask mask, vfloat a, vfloat b) { return mask ? a : b; }
+            inline int    MoveMask(vmask mask) { return mask ? 1 : 0; }
+
+            inline vint   AsInt(vfloat a) { vint result; memcpy(&result, &a, sizeof(result)); return result; }
+            inline vfloat AsFloat(vint a) { vfloat result; memcpy(&result, &a, sizeof(result)); return result; }
+            inline vint   Set1i(int32_t value) { return value; }
+            inline vint   Addi(vint a, vint b) { return a + b; }
+            inline vint   Subi(vint a, vint b) { return a - b; }
+            inline vint   Andi(vint a, vint b) { return a & b; }
+            inline vint   Ori(vint a, vint b) { return a | b; }
+            inline vint   Muli(vint a, vint b) { return a * b; }
+            inline vint   ShiftLeft23(vint a) { return (vint)((uint32_t)a << 23); }
+            inline vint   ShiftRight23(vint a) { return (vint)((uint32_t)a >> 23); }
+            inline vfloat ToFloat(vint a) { return (float)a; }
+            inline vint   ToIntTruncate(vfloat a) { return (vint)a; }
+
+            // Loads base[indices[lane]] into each lane
+            inline vfloat Gather(const float* base, vint indices) { return base[indices]; }
+
+        #endif
+
+            //------------------------------------------------------------------------
+            // Math Functions
+            //------------------------------------------------------------------------
+
+            /**
+             * Natural logarithm for positive, normalized inputs (Cephes polynomial approximation).
+             */
+            inline vfloat Log(vfloat x)
+            {
+                // Split x into a mantissa in [0.5, 1) and an exponent
+                vint bits = AsInt(x);
+                vfloat e = ToFloat(Subi(Andi(ShiftRight23(bits), Set1i(0xFF)), Set1i(126)));
+                vfloat m = AsFloat(Ori(Andi(bits, Set1i(0x007FFFFF)), Set1i(0x3F000000)));
+
+                // Shift the mantissa to [sqrt(0.5), sqrt(2)) to improve the approximation's accuracy
+                vmask small = Less(m, Set1(0.707106781186547524f));
+                e = Select(small, Sub(e, Set1(1.f)), e);
+                m = Select(small, Sub(Add(m, m), Set1(1.f)), Sub(m, Set1(1.f)));
+
+                vfloat z = Mul(m, m);
+                vfloat y = Set1(7.0376836292e-2f);
+                y = Add(Mul(y, m), Set1(-1.1514610310e-1f));
+                y = Add(Mul(y, m), Set1(1.1676998740e-1f));
+                y = Add(Mul(y, m), Set1(-1.2420140846e-1f));
+                y = Add(Mul(y, m), Set1(1.4249322787e-1f));
+                y = Add(Mul(y, m), Set1(-1.6668057665e-1f));
+                y = Add(Mul(y, m), Set1(2.0000714765e-1f));
+                y = Add(Mul(y, m), Set1(-2.4999993993e-1f));
+                y = Add(Mul(y, m), Set1(3.3333331174e-1f));
+                y = Mul(Mul(y, m), z);
+                y = Add(y, Mul(e, Set1(-2.12194440e-4f)));
+                y = Sub(y, Mul(z, Set1(0.5f)));
+                return Add(Add(m, y), Mul(e, Set1(0.693359375f)));
+            }
+
+            /**
+             * Exponential function (Cephes polynomial approximation). Returns zero when the result underflows.
+             */
+            inline vfloat Exp(vfloat x)
+            {
+                vmask underflow = Less(x, Set1(ExpUnderflow));
+                x = Min(x, Set1(88.3f));
+                x = Max(x, Set1(ExpUnderflow));
+
+                // Express exp(x) as 2^n * exp(r)
+                vfloat n = Floor(Add(Mul(x, Set1(1.44269504088896341f)), Set1(0.5f)));
+                x = Sub(x, Mul(n, Set1(0.693359375f)));
+                x = Sub(x, Mul(n, Set1(-2.12194440e-4f)));
+
+                vfloat z = Mul(x, x);
+                vfloat y = Set1(1.9875691500e-4f);
+                y = Add(Mul(y, x), Set1(1.3981999507e-3f));
+                y = Add(Mul(y, x), Set1(8.3334519073e-3f));
+                y = Add(Mul(y, x), Set1(4.1665795894e-2f));
+                y = Add(Mul(y, x), Set1(1.6666665459e-1f));
+                y = Add(Mul(y, x), Set1(5.0000001201e-1f));
+                y = Add(Add(Mul(y, z), x), Set1(1.f));
+
+                // Scale by 2^n
+                vfloat scale = AsFloat(ShiftLeft23(Addi(ToIntTruncate(n), Set1i(127))));
+                return Select(underflow, Set1(0.f), Mul(y, scale));
+            }
+
+            /**
+             * Computes base^exponent for non-negative bases. Returns zero for zero (or denormal) bases.
+             */
+            inline vfloat Pow(vfloat base, vfloat exponent)
+            {
+                vmask zero = LessEqual(base, Set1(1.17549435e-38f));
+                return Select(zero, Set1(0.f), Exp(Mul(exponent, Log(base))));
+            }
+
+        } // namespace RTXGI_CPU_SIMD_NAMESPACE
+        } // namespace simd
+    } // namespace cpu
+} // namespace rtxgi
@@ -13,12 +13,22 @@
 
 #include "include/ProbeCommon.hlsl"
 
+// Define RTXGI_DDGI_PROBE_VISIBILITY_MASKS 1 to skip probes using precomputed per-cell probe visibility masks
+// (see DDGIBuildProbeVisibilityMasks() in rtxgi/ddgi/cpu/Irradiance_CPU.h)
+#ifndef RTXGI_DDGI_PROBE_VISIBILITY_MASKS
+#define RTXGI_DDGI_PROBE_VISIBILITY_MASKS 0
+#endif
+
 struct DDGIVolumeResources
 {
     Texture2DArray<float4> probeIrradiance;
     Texture2DArray<float4> probeDistance;
     Texture2DArray<float4> probeData;
     SamplerState bilinearSampler;
+#if RTXGI_DDGI_PROBE_VISIBILITY_MASKS
+    Texture3D<uint> probeVisibilityMasks;       // R8_UINT, one 8-bit mask per cell
+    int probeVisibilityMaskSubdivisions;        // Cells per probe grid cell, on each axis
+#endif
 };
 
 /**
@@ -86,6 +96,14 @@ float3 DDGIGetVolumeIrradiance(
     if(!IsVolumeMovementScrolling(volume)) gridSpaceDistance = RTXGIQuaternionRotate(gridSpaceDistance, RTXGIQuaternionConjugate(volume.rotation));
     float3 alpha = clamp((gridSpaceDistance / volume.probeSpacing), float3(0.f, 0.f, 0.f), float3(1.f, 1.f, 1.f));
 
+#if RTXGI_DDGI_PROBE_VISIBILITY_MASKS
+    // Get the probe visibility mask of the cell, sample all probes when none are visible
+    int  subdivisions = resources.probeVisibilityMaskSubdivisions;
+    int3 cellCoords = (baseProbeCoords * subdivisions) + min(int3(alpha * subdivisions), subdivisions - 1);
+    uint cellMask = resources.probeVisibilityMasks.Load(int4(cellCoords, 0));
+    if (cellMask == 0) cellMask = 0xFF;
+#endif
+
     // Iterate over the 8 closest probes and accumulate their contributions
     for(int probeIndex = 0; probeIndex < 8; probeIndex++)
     {
@@ -93,6 +111,11 @@ float3 DDGIGetVolumeIrradiance(
         // sourcing the offsets from the bits of the loop index: x = bit 0, y = bit 1, z = bit 2
         int3 adjacentProbeOffset = int3(probeIndex, probeIndex >> 1, probeIndex >> 2) & int3(1, 1, 1);
 
+    #if RTXGI_DDGI_PROBE_VISIBILITY_MASKS
+        // Early Out: skip probes that are not visible from the cell
+        if ((cellMask & (1u << probeIndex)) == 0) continue;
+    #endif
+
         // Get the 3D grid coordinates of the adjacent probe by adding the offset to 
         // the base probe and clamping to the grid boundaries
         int3 adjacentProbeCoords = clamp(baseProbeCoords + adjacentProbeOffset, int3(0, 0, 0), volume.probeCounts - int3(1, 1, 1));
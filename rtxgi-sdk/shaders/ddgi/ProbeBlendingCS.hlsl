@@ -138,6 +138,15 @@
     groupshared bool scrollClear;
 #endif // RTXGI_DDGI_BLEND_SCROLL_SHARED_MEMORY
 
+#if RTXGI_DDGI_BLEND_RADIANCE
+    // Adaptive hysteresis: the coefficient of variation of each interior texel (or why the probe's texels weren't blended)
+    groupshared float ProbeTexelChanges[RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS * RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS];
+
+    // Recorded in ProbeTexelChanges instead of a coefficient of variation
+    #define PROBE_TEXEL_NOT_BLENDED -1.f    // The probe is inactive or inside geometry, its history is kept
+    #define PROBE_TEXEL_CLEARED -2.f        // The probe's texels were cleared, its history restarts as changing
+#endif // RTXGI_DDGI_BLEND_RADIANCE
+
 // -------- VISUALIZATION FUNCTIONS ---------------------------------------------------------------
 
 #if RTXGI_DDGI_BLEND_RADIANCE && RTXGI_DDGI_DEBUG_PROBE_INDEXING
@@ -228,6 +237,41 @@
     }
 #endif // RTXGI_DDGI_BLEND_SCROLL_SHARED_MEMORY
 
+#if RTXGI_DDGI_BLEND_RADIANCE
+    // Records an interior texel's coefficient of variation (or why the probe's texels weren't blended) for the probe's history update
+    void StoreProbeTexelChange(uint3 GroupThreadID, float change)
+    {
+        ProbeTexelChanges[((GroupThreadID.y - 1) * RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS) + (GroupThreadID.x - 1)] = change;
+    }
+
+    // Records whether the irradiance update changed the probe in its adaptive hysteresis history (bit 0 is the most recent update).
+    // Called by one thread of the group, after the interior texel threads recorded their changes.
+    void UpdateProbeHistory(int probeIndex, RWTexture2DArray<float4> ProbeData, DDGIVolumeDescGPU volume)
+    {
+        bool cleared = false;
+        float coefficientOfVariationSum = 0.f;
+        for (int texelIndex = 0; texelIndex < (RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS * RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS); texelIndex++)
+        {
+            float change = ProbeTexelChanges[texelIndex];
+            if (change == PROBE_TEXEL_NOT_BLENDED) return; // Early out: the probe's irradiance wasn't updated
+            if (change == PROBE_TEXEL_CLEARED) cleared = true;
+            else coefficientOfVariationSum += change;
+        }
+
+        uint3 probeDataCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
+        float probeDataW = ProbeData[probeDataCoords].w;
+
+        // The probe's lighting was unknown, restart its history as "changing"
+        uint history = RTXGI_DDGI_PROBE_HISTORY_MASK;
+        if (!cleared)
+        {
+            uint changed = (coefficientOfVariationSum / float(RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS * RTXGI_DDGI_PROBE_NUM_INTERIOR_TEXELS)) > volume.probeAdaptiveHysteresisThreshold;
+            history = ((DDGIDecodeProbeHistory(probeDataW) << 1) | changed) & RTXGI_DDGI_PROBE_HISTORY_MASK;
+        }
+        ProbeData[probeDataCoords].w = DDGIEncodeProbeData(DDGIDecodeProbeState(probeDataW), history);
+    }
+#endif // RTXGI_DDGI_BLEND_RADIANCE
+
 // When the thread maps to a border texel, update it with the latest blended information for later use in bilinear filtering
 void UpdateBorderTexel(uint3 DispatchThreadID, uint3 GroupThreadID, uint3 GroupID, RWTexture2DArray<float4> Output, DDGIVolumeDescGPU volume)
 {
@@ -355,6 +399,7 @@ void DDGIProbeBlendingCS(
         // Visualize the probe's octahedral indexing
     #if RTXGI_DDGI_BLEND_RADIANCE && RTXGI_DDGI_DEBUG_OCTAHEDRAL_INDEXING
         DebugOctahedralIndexing(int2(threadCoords.xy), DispatchThreadID, Output, volume);
+        StoreProbeTexelChange(GroupThreadID, PROBE_TEXEL_NOT_BLENDED);
         return;
     #endif
 
@@ -365,6 +410,9 @@ void DDGIProbeBlendingCS(
         if(scrollClear)
         {
             Output[DispatchThreadID] = float4(0.f, 0.f, 0.f, 1.f);
+        #if RTXGI_DDGI_BLEND_RADIANCE
+            StoreProbeTexelChange(GroupThreadID, PROBE_TEXEL_CLEARED);
+        #endif
             return; // Early out: this probe has been scrolled and cleared, don't blend
         }
     #else
@@ -381,6 +429,9 @@ void DDGIProbeBlendingCS(
             if(scrollClear)
             {
                 Output[DispatchThreadID] = float4(0.f, 0.f, 0.f, 1.f);
+            #if RTXGI_DDGI_BLEND_RADIANCE
+                StoreProbeTexelChange(GroupThreadID, PROBE_TEXEL_CLEARED);
+            #endif
                 return; // Early out: this probe has been scrolled and cleared, don't blend
             }
         }
@@ -392,6 +443,7 @@ void DDGIProbeBlendingCS(
         {
         #if RTXGI_DDGI_BLEND_RADIANCE
             ProbeVariability[DispatchThreadID].r = 0.f;
+            StoreProbeTexelChange(GroupThreadID, PROBE_TEXEL_NOT_BLENDED);
         #endif
             return;
         }
@@ -453,7 +505,11 @@ void DDGIProbeBlendingCS(
                 backfaces++;
 
                 // Early out: only blend ray radiance into the probe if the backface threshold hasn't been exceeded
-                if (backfaces >= maxBackfaces) return;
+                if (backfaces >= maxBackfaces)
+                {
+                    StoreProbeTexelChange(GroupThreadID, PROBE_TEXEL_NOT_BLENDED);
+                    return;
+                }
 
                 continue;
             }
@@ -506,9 +562,19 @@ void DDGIProbeBlendingCS(
         float3 probeIrradianceMean = Output[DispatchThreadID].rgb;
 
         // Get the history weight (hysteresis) to use for the probe texel's previous value
-        // If the probe was previously cleared to completely black, set the hysteresis to zero
         float  hysteresis = volume.probeHysteresis;
-        if (dot(probeIrradianceMean, probeIrradianceMean) == 0) hysteresis = 0.f;
+
+    #if RTXGI_DDGI_BLEND_RADIANCE
+        // With adaptive hysteresis, the irradiance hysteresis follows the probe's variability history
+        if (volume.probeAdaptiveHysteresisEnabled)
+        {
+            hysteresis = DDGIGetAdaptiveProbeHysteresis(DDGIDecodeProbeHistory(ProbeData[DDGIGetProbeTexelCoords(probeIndex, volume)].w), volume);
+        }
+    #endif
+
+        // If the probe was previously cleared to completely black, set the hysteresis to zero
+        bool cleared = (dot(probeIrradianceMean, probeIrradianceMean) == 0);
+        if (cleared) hysteresis = 0.f;
 
     #if RTXGI_DDGI_BLEND_RADIANCE
         // Tone-mapping gamma adjustment
@@ -549,16 +615,17 @@ void DDGIProbeBlendingCS(
         }
         result = float4(probeIrradianceMean.rgb + lerpDelta, 1.f);
 
-        if (volume.probeVariabilityEnabled)
+        if (volume.probeVariabilityEnabled || volume.probeAdaptiveHysteresisEnabled)
         {
             // Compute the coefficient of variation
             float3 irradianceMean = result.rgb;
             float3 irradianceSigma2 = (irradianceSample - probeIrradianceMean) * (irradianceSample - irradianceMean);
             float  luminanceSigma2 = RTXGILinearRGBToLuminance(irradianceSigma2);
             float  luminanceMean = RTXGILinearRGBToLuminance(irradianceMean);
-            float  coefficientOfVariation = (luminanceMean <= c_threshold) ? 0.f : sqrt(luminanceSigma2) / luminanceMean;
+            float  coefficientOfVariation = (luminanceMean <= c_threshold) ? 0.f : sqrt(max(luminanceSigma2, 0.f)) / luminanceMean;
 
-            ProbeVariability[threadCoords].r = coefficientOfVariation;
+            if (volume.probeVariabilityEnabled) ProbeVariability[threadCoords].r = coefficientOfVariation;
+            StoreProbeTexelChange(GroupThreadID, cleared ? PROBE_TEXEL_CLEARED : coefficientOfVariation);
         }
     #else
 
@@ -576,4 +643,9 @@ void DDGIProbeBlendingCS(
 
     // Update the texel with the latest blended data
     UpdateBorderTexel(DispatchThreadID, GroupThreadID, GroupID, Output, volume);
+
+#if RTXGI_DDGI_BLEND_RADIANCE
+    // Update the probe's adaptive hysteresis history (GroupIndex 0 is a border texel thread)
+    if (GroupIndex == 0 && volume.probeAdaptiveHysteresisEnabled) UpdateProbeHistory(probeIndex, ProbeData, volume);
+#endif
 }
@@ -157,7 +157,7 @@ void DDGIProbeClassificationCS(uint3 DispatchThreadID : SV_DispatchThreadID)
     // Early out: number of backface hits has been exceeded. The probe is probably inside geometry.
     if(((float)backfaceCount / (float)RTXGI_DDGI_NUM_FIXED_RAYS) > volume.probeFixedRayBackfaceThreshold)
     {
-        ProbeData[outputCoords].w = RTXGI_DDGI_PROBE_STATE_INACTIVE;
+        DDGIStoreProbeState(ProbeData, outputCoords, RTXGI_DDGI_PROBE_STATE_INACTIVE);
         return;
     }
 
@@ -206,12 +206,12 @@ void DDGIProbeClassificationCS(uint3 DispatchThreadID : SV_DispatchThreadID)
         // If the hit distance is less than the closest plane intersection, the probe should be active
         if(hitDistances[rayIndex] <= maxDistance)
         {
-            ProbeData[outputCoords].w = RTXGI_DDGI_PROBE_STATE_ACTIVE;
+            DDGIStoreProbeState(ProbeData, outputCoords, RTXGI_DDGI_PROBE_STATE_ACTIVE);
             return;
         }
     }
 
-    ProbeData[outputCoords].w = RTXGI_DDGI_PROBE_STATE_INACTIVE;
+    DDGIStoreProbeState(ProbeData, outputCoords, RTXGI_DDGI_PROBE_STATE_INACTIVE);
 }
 
 
@@ -252,6 +252,6 @@ void DDGIProbeClassificationResetCS(uint3 DispatchThreadID : SV_DispatchThreadID
     // Get the probe's texel coordinates in the Probe Data texture
     uint3 outputCoords = DDGIGetProbeTexelCoords(DispatchThreadID.x, volume);
 
-    // Set all probes to active
-    ProbeData[outputCoords].w = RTXGI_DDGI_PROBE_STATE_ACTIVE;
+    // Set all probes to active (keeping their adaptive hysteresis history)
+    DDGIStoreProbeState(ProbeData, outputCoords, RTXGI_DDGI_PROBE_STATE_ACTIVE);
 }
@@ -42,6 +42,11 @@
 #define RTXGI_DDGI_PROBE_STATE_ACTIVE 0     // probe shoots rays and may be sampled by a front facing surface or another probe (recursive irradiance)
 #define RTXGI_DDGI_PROBE_STATE_INACTIVE 1   // probe doesn't need to shoot rays, it isn't near a front facing surface
 
+// Adaptive hysteresis history, stored in the fractional part of the probe data W channel (see ProbeDataCommon)
+#define RTXGI_DDGI_PROBE_HISTORY_BITS 8
+#define RTXGI_DDGI_PROBE_HISTORY_MASK 0xFF
+#define RTXGI_DDGI_PROBE_HISTORY_SCALE (1.f / 512.f)
+
 // Volume movement types
 #define RTXGI_DDGI_VOLUME_MOVEMENT_TYPE_DEFAULT 0
 #define RTXGI_DDGI_VOLUME_MOVEMENT_TYPE_SCROLLING 1
@@ -13,6 +13,43 @@
 
 #include "Common.hlsl"
 
+//------------------------------------------------------------------------
+// Probe Data W Channel
+//------------------------------------------------------------------------
+
+/**
+ * The probe data W channel stores the probe's classification state in its integer part. With adaptive hysteresis,
+ * the fractional part stores the probe's 8-bit variability history (in steps of 1/512, exactly representable in
+ * the F16x4 probe data format). The most recent irradiance update is stored in bit 0 of the history.
+ */
+int DDGIDecodeProbeState(float w)
+{
+    return int(floor(w));
+}
+
+uint DDGIDecodeProbeHistory(float w)
+{
+    return uint(((w - floor(w)) / RTXGI_DDGI_PROBE_HISTORY_SCALE) + 0.5f) & RTXGI_DDGI_PROBE_HISTORY_MASK;
+}
+
+float DDGIEncodeProbeData(int state, uint history)
+{
+    return float(state) + (float(history & RTXGI_DDGI_PROBE_HISTORY_MASK) * RTXGI_DDGI_PROBE_HISTORY_SCALE);
+}
+
+/**
+ * Computes the irradiance hysteresis of a probe from its adaptive hysteresis history.
+ */
+float DDGIGetAdaptiveProbeHysteresis(uint history, DDGIVolumeDescGPU volume)
+{
+    // The probe changed in the last update, react quickly
+    if (history & 1) return volume.probeAdaptiveHysteresisMin;
+
+    // Otherwise, steer toward the volume's hysteresis as the changes age out of the history window
+    float changing = float(countbits(history)) / float(RTXGI_DDGI_PROBE_HISTORY_BITS);
+    return volume.probeAdaptiveHysteresisMin + ((volume.probeHysteresis - volume.probeAdaptiveHysteresisMin) * (1.f - changing));
+}
+
 //------------------------------------------------------------------------
 // Probe Data Texture Write Helpers
 //------------------------------------------------------------------------
@@ -26,6 +63,14 @@ void DDGIStoreProbeDataOffset(RWTexture2DArray<float4> probeData, uint3 coords,
     probeData[coords].xyz = wsOffset / volume.probeSpacing;
 }
 
+/**
+ * Writes the probe's classification state to the probe data texture, keeping its adaptive hysteresis history.
+ */
+void DDGIStoreProbeState(RWTexture2DArray<float4> probeData, uint3 coords, int state)
+{
+    probeData[coords].w = DDGIEncodeProbeData(state, DDGIDecodeProbeHistory(probeData[coords].w));
+}
+
 //------------------------------------------------------------------------
 // Probe Data Texture Read Helpers
 //------------------------------------------------------------------------
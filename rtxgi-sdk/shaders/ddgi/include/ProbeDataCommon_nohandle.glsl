@@ -5,6 +5,38 @@
 
 #include "rtxgi-sdk/shaders/ddgi/include/Common.glsl"
 
+//------------------------------------------------------------------------
+// Probe Data W Channel
+//------------------------------------------------------------------------
+
+/**
+ * The probe data W channel stores the probe's classification state in its integer part. With adaptive hysteresis,
+ * the fractional part stores the probe's 8-bit variability history (see ProbeDataCommon.hlsl).
+ */
+int DDGIDecodeProbeState(float w) {
+    return int(floor(w));
+}
+
+uint DDGIDecodeProbeHistory(float w) {
+    return uint(((w - floor(w)) / RTXGI_DDGI_PROBE_HISTORY_SCALE) + 0.5) & RTXGI_DDGI_PROBE_HISTORY_MASK;
+}
+
+float DDGIEncodeProbeData(int state, uint history) {
+    return float(state) + (float(history & RTXGI_DDGI_PROBE_HISTORY_MASK) * RTXGI_DDGI_PROBE_HISTORY_SCALE);
+}
+
+/**
+ * Computes the irradiance hysteresis of a probe from its adaptive hysteresis history.
+ */
+float DDGIGetAdaptiveProbeHysteresis(uint history, DDGIVolumeDescGPU volume) {
+    // The probe changed in the last update, react quickly
+    if ((history & 1u) != 0u) return volume.probeAdaptiveHysteresisMin;
+
+    // Otherwise, steer toward the volume's hysteresis as the changes age out of the history window
+    float changing = float(bitCount(history)) / float(RTXGI_DDGI_PROBE_HISTORY_BITS);
+    return volume.probeAdaptiveHysteresisMin + ((volume.probeHysteresis - volume.probeAdaptiveHysteresisMin) * (1.0 - changing));
+}
+
 //------------------------------------------------------------------------
 // Probe Data Texture Write Helpers
 //------------------------------------------------------------------------
@@ -13,9 +45,10 @@
  * Normalizes the world-space offset and writes it to the probe data texture.
  * Probe Relocation limits this range to [0.f, 0.45f).
  */
-// Assume that all probeData is Image2DArray_rgba32f in config
+// Assume that all probeData is Image2DArray_rgba32f in config. The W channel (state and history) is kept.
 void DDGIStoreProbeDataOffset(uint probeDataIdx, uvec3 coords, vec3 wsOffset, DDGIVolumeDescGPU volume) {
-    imageStore(Image2DArray_rgba32f[probeDataIdx], ivec3(coords), vec4(wsOffset / volume.probeSpacing, 0.f));
+    float w = imageLoad(Image2DArray_rgba32f[probeDataIdx], ivec3(coords)).w;
+    imageStore(Image2DArray_rgba32f[probeDataIdx], ivec3(coords), vec4(wsOffset / volume.probeSpacing, w));
 }
 
 //------------------------------------------------------------------------
@@ -242,7 +242,7 @@ vec3 DDGIGetProbeUV(int probeIndex, vec2 octantCoordinates, int numProbeInterior
 //         ivec3 probeDataCoords = ivec3(DDGIGetProbeTexelCoords(probeIndex, volume));
 
 //         // Get the probe's classification state
-//         state = ImageLoad(probeData, probeDataCoords).w;
+//         state = floor(ImageLoad(probeData, probeDataCoords).w);
 //     }
 
 //     return state;
@@ -259,8 +259,8 @@ float DDGILoadProbeState(int probeIndex, Image2DArray_rgba32f probeData, DDGIVol
         // Get the probe's texel coordinates in the Probe Data texture
         ivec3 probeDataCoords = ivec3(DDGIGetProbeTexelCoords(probeIndex, volume));
 
-        // Get the probe's classification state
-        state = ImageLoad(probeData, probeDataCoords).w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(ImageLoad(probeData, probeDataCoords).w);
     }
 
     return state;
@@ -277,8 +277,8 @@ float DDGILoadProbeState(int probeIndex, uint probeDataIdx, DDGIVolumeDescGPU vo
         // Get the probe's texel coordinates in the Probe Data texture
         ivec3 probeDataCoords = ivec3(DDGIGetProbeTexelCoords(probeIndex, volume));
 
-        // Get the probe's classification state
-        state = texelFetch(GetTex2DArray(probeDataIdx), probeDataCoords, 0).w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(texelFetch(GetTex2DArray(probeDataIdx), probeDataCoords, 0).w);
     }
 
     return state;
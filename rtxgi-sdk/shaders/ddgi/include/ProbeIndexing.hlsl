@@ -250,8 +250,8 @@ float DDGILoadProbeState(int probeIndex, RWTexture2DArray<float4> probeData, DDG
         // Get the probe's texel coordinates in the Probe Data texture
         int3 probeDataCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
 
-        // Get the probe's classification state
-        state = probeData[probeDataCoords].w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(probeData[probeDataCoords].w);
     }
 
     return state;
@@ -268,8 +268,8 @@ float DDGILoadProbeState(int probeIndex, Texture2DArray<float4> probeData, DDGIV
         // Get the probe's texel coordinates in the Probe Data texture
         int3 probeDataCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
 
-        // Get the probe's classification state
-        state = probeData.Load(int4(probeDataCoords, 0)).w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(probeData.Load(int4(probeDataCoords, 0)).w);
     }
 
     return state;
@@ -241,8 +241,8 @@ float DDGILoadProbeStateFromImage(int probeIndex, uint probeDataImageIndex, DDGI
         // Get the probe's texel coordinates in the Probe Data texture
         ivec3 probeDataCoords = ivec3(DDGIGetProbeTexelCoords(probeIndex, volume));
 
-        // Get the probe's classification state
-        state = imageLoad(Image2DArray_rgba32f[probeDataImageIndex], probeDataCoords).w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(imageLoad(Image2DArray_rgba32f[probeDataImageIndex], probeDataCoords).w);
     }
 
     return state;
@@ -259,8 +259,8 @@ float DDGILoadProbeStateFromTex(int probeIndex, uint probeDataTexIdx, DDGIVolume
         // Get the probe's texel coordinates in the Probe Data texture
         ivec3 probeDataCoords = ivec3(DDGIGetProbeTexelCoords(probeIndex, volume));
 
-        // Get the probe's classification state
-        state = texelFetch(GetTex2DArray(probeDataTexIdx), probeDataCoords, 0).w;
+        // Get the probe's classification state (the fractional part stores the adaptive hysteresis history)
+        state = floor(texelFetch(GetTex2DArray(probeDataTexIdx), probeDataCoords, 0).w);
     }
 
     return state;
@@ -147,6 +147,9 @@ namespace rtxgi
         assert(l.probeScrollDirections[0] == r.probeScrollDirections[0]);
         assert(l.probeScrollDirections[1] == r.probeScrollDirections[1]);
         assert(l.probeScrollDirections[2] == r.probeScrollDirections[2]);
+
+        // Packed5
+        assert(l.probeAdaptiveHysteresisEnabled == r.probeAdaptiveHysteresisEnabled);
     }
 #endif
 
@@ -198,6 +201,10 @@ namespace rtxgi
         descGPU.probeScrollDirections[1] = (m_probeScrollDirections[1] > 0);
         descGPU.probeScrollDirections[2] = (m_probeScrollDirections[2] > 0);
 
+        descGPU.probeAdaptiveHysteresisEnabled = m_desc.probeAdaptiveHysteresisEnabled;
+        descGPU.probeAdaptiveHysteresisMin = std::clamp(m_desc.probeAdaptiveHysteresisMin, 0.f, 1.f);
+        descGPU.probeAdaptiveHysteresisThreshold = m_desc.probeAdaptiveHysteresisThreshold;
+
         return descGPU;
     }
 
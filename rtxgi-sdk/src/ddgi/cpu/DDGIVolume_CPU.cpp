@@ -0,0 +1,125 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/DDGIVolume_CPU.h"
+
+#include <random>
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        //------------------------------------------------------------------------
+        // Public DDGIVolume Functions
+        //------------------------------------------------------------------------
+
+        ERTXGIStatus DDGIVolume::Create(const DDGIVolumeDesc& desc)
+        {
+            // Validate the probe counts
+            if (desc.probeCounts.x <= 0 || desc.probeCounts.y <= 0 || desc.probeCounts.z <= 0) return ERTXGIStatus::ERROR_DDGI_INVALID_PROBE_COUNTS;
+
+            // Validate the probe texel counts
+            if (desc.probeNumRays <= 0) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+            if (desc.probeNumIrradianceInteriorTexels <= 0 || desc.probeNumIrradianceTexels != (desc.probeNumIrradianceInteriorTexels + 2)) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+            if (desc.probeNumDistanceInteriorTexels <= 0 || desc.probeNumDistanceTexels != (desc.probeNumDistanceInteriorTexels + 2)) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+
+            // Store the new volume descriptor
+            m_desc = desc;
+
+            // Allocate the texture arrays
+            uint32_t width, height, arraySize;
+            GetDDGIVolumeTextureDimensions(m_desc, EDDGIVolumeTextureType::RayData, width, height, arraySize);
+            m_probeRayData.Allocate(width, height, arraySize);
+
+            GetDDGIVolumeTextureDimensions(m_desc, EDDGIVolumeTextureType::Irradiance, width, height, arraySize);
+            m_probeIrradiance.Allocate(width, height, arraySize);
+
+            GetDDGIVolumeTextureDimensions(m_desc, EDDGIVolumeTextureType::Distance, width, height, arraySize);
+            m_probeDistance.Allocate(width, height, arraySize);
+
+            GetDDGIVolumeTextureDimensions(m_desc, EDDGIVolumeTextureType::Data, width, height, arraySize);
+            m_probeData.Allocate(width, height, arraySize);
+
+            GetDDGIVolumeTextureDimensions(m_desc, EDDGIVolumeTextureType::Variability, width, height, arraySize);
+            m_probeVariability.Allocate(width, height, arraySize);
+
+            // Memory is zero initialized, relocation and classification don't need a reset.
+            // The first update finds the probes cleared and restarts their adaptive hysteresis history as "changing".
+            m_desc.probeRelocationNeedsReset = false;
+            m_desc.probeClassificationNeedsReset = false;
+
+            // Store the volume rotation
+            m_rotationMatrix = EulerAnglesToRotationMatrix(desc.eulerAngles);
+            m_rotationQuaternion = RotationMatrixToQuaternion(m_rotationMatrix);
+
+            // Set the default scroll anchor to the origin
+            m_probeScrollAnchor = m_desc.origin;
+
+            // Initialize the random number generator if a seed is provided,
+            // otherwise the RNG uses the default std::random_device().
+            if (desc.rngSeed != 0)
+            {
+                SeedRNG((int)desc.rngSeed);
+            }
+            else
+            {
+                std::random_device rd;
+                SeedRNG((int)rd());
+            }
+
+            return ERTXGIStatus::OK;
+        }
+
+        ERTXGIStatus DDGIVolume::ClearProbes()
+        {
+            m_probeIrradiance.Clear({ 0.f, 0.f, 0.f, 1.f });
+            m_probeDistance.Clear({ 0.f, 0.f, 0.f, 1.f });
+            return ERTXGIStatus::OK;
+        }
+
+        void DDGIVolume::Destroy()
+        {
+            m_desc = {};
+
+            m_rotationQuaternion = { 0.f, 0.f, 0.f, 1.f };
+            m_rotationMatrix = {
+                { 1.f, 0.f, 0.f },
+                { 0.f, 1.f, 0.f },
+                { 0.f, 0.f, 1.f }
+            };
+            m_probeRayRotationQuaternion = { 0.f, 0.f, 0.f, 1.f };
+            m_probeRayRotationMatrix = {
+                { 1.f, 0.f, 0.f },
+                { 0.f, 1.f, 0.f },
+                { 0.f, 0.f, 1.f },
+            };
+
+            m_probeScrollOffsets = {};
+
+            m_probeRayData.Release();
+            m_probeIrradiance.Release();
+            m_probeDistance.Release();
+            m_probeData.Release();
+            m_probeVariability.Release();
+
+            m_probeUpdateList.clear();
+        }
+
+        size_t DDGIVolume::GetMemoryUsedInBytes() const
+        {
+            return m_probeRayData.GetSizeInBytes()
+                + m_probeIrradiance.GetSizeInBytes()
+                + m_probeDistance.GetSizeInBytes()
+                + m_probeData.GetSizeInBytes()
+                + m_probeVariability.GetSizeInBytes();
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
@@ -0,0 +1,969 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/Irradiance_CPU.h"
+#include "rtxgi/ddgi/cpu/Parallel_CPU.h"
+#include "rtxgi/ddgi/cpu/SIMD_CPU.h"
+
+// CPU implementation of shaders/ddgi/Irradiance.hlsl.
+// The batched functions process SIMD width queries at a time. Per-probe data (scroll adjusted indices, states, relocated
+// positions, texel coordinates) is computed once per volume into a table that the vectorized queries gather from.
+// With probe visibility masks, the queries of each chunk are sampled in the order of their cell's mask, so the lanes of
+// a SIMD batch skip the same probes.
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        // Number of queries each thread processes at a time
+        static const uint32_t c_queriesPerChunk = 1024;
+
+        // Number of probe grid cells each thread processes at a time when building visibility masks
+        static const uint32_t c_probeCellsPerChunk = 16;
+
+        // Tiny weights are crushed below this threshold (see DDGIGetVolumeIrradiance() in Irradiance.hlsl)
+        static const float c_crushThreshold = 0.2f;
+
+        // Energy loss adjustment for the R10G10B10A2 irradiance texture format
+        static const float c_irradianceFormatU32Scale = 1.0989f;
+
+        //------------------------------------------------------------------------
+        // Private Helper Functions
+        //------------------------------------------------------------------------
+
+        inline float Lerp(float a, float b, float t)
+        {
+            return a + (t * (b - a));
+        }
+
+        inline float Saturate(float v)
+        {
+            return std::fmin(std::fmax(v, 0.f), 1.f);
+        }
+
+        /**
+         * Samples a texture array with bilinear filtering and clamped addressing (SampleLevel() with a bilinear sampler).
+         * uv.z is the array slice.
+         */
+        float4 SampleBilinear(const Texture2DArray& texture, const float3& uv)
+        {
+            float x = (uv.x * (float)texture.width) - 0.5f;
+            float y = (uv.y * (float)texture.height) - 0.5f;
+            float fx = floorf(x);
+            float fy = floorf(y);
+            float ax = x - fx;
+            float ay = y - fy;
+
+            int maxX = (int)texture.width - 1;
+            int maxY = (int)texture.height - 1;
+            uint32_t x0 = (uint32_t)std::max(0, std::min((int)fx, maxX));
+            uint32_t x1 = (uint32_t)std::max(0, std::min((int)fx + 1, maxX));
+            uint32_t y0 = (uint32_t)std::max(0, std::min((int)fy, maxY));
+            uint32_t y1 = (uint32_t)std::max(0, std::min((int)fy + 1, maxY));
+            uint32_t z = (uint32_t)uv.z;
+
+            const float4& t00 = texture.Texel(x0, y0, z);
+            const float4& t10 = texture.Texel(x1, y0, z);
+            const float4& t01 = texture.Texel(x0, y1, z);
+            const float4& t11 = texture.Texel(x1, y1, z);
+
+            float4 result;
+            for (size_t c = 0; c < 4; c++)
+            {
+                float row0 = Lerp(t00[c], t10[c], ax);
+                float row1 = Lerp(t01[c], t11[c], ax);
+                result[c] = Lerp(row0, row1, ay);
+            }
+            return result;
+        }
+
+        /**
+         * Returns the Chebyshev visibility weight of a probe from a (biased) world position, the occlusion test of DDGIGetVolumeIrradiance().
+         */
+        float GetProbeVisibilityWeight(
+            const float3& biasedWorldPosition,
+            const float3& probeWorldPosition,
+            int probeIndex,
+            const DDGIVolumeDescGPU& volume,
+            const Texture2DArray& probeDistance)
+        {
+            // Compute the distance and direction from the biased shading point and the probe
+            float3 biasedPosToProbe = Normalize3(Sub(probeWorldPosition, biasedWorldPosition));
+            float  biasedPosToProbeDist = Length3(Sub(probeWorldPosition, biasedWorldPosition));
+
+            // Compute the octahedral coordinates of the probe
+            float2 octantCoords = DDGIGetOctahedralCoordinates(Mul(biasedPosToProbe, -1.f));
+
+            // Get the texture array coordinates for the octant of the probe
+            float3 probeTextureUV = DDGIGetProbeUV(probeIndex, octantCoords, volume.probeNumDistanceInteriorTexels, volume);
+
+            // Sample the probe's distance texture to get the mean distance to nearby surfaces
+            float4 distanceSample = SampleBilinear(probeDistance, probeTextureUV);
+            float2 filteredDistance = { 2.f * distanceSample.x, 2.f * distanceSample.y };
+
+            // Find the variance of the mean distance
+            float variance = fabsf((filteredDistance.x * filteredDistance.x) - filteredDistance.y);
+
+            // Occlusion test
+            float chebyshevWeight = 1.f;
+            if (biasedPosToProbeDist > filteredDistance.x) // occluded
+            {
+                // v must be greater than 0, which is guaranteed by the if condition above.
+                float v = biasedPosToProbeDist - filteredDistance.x;
+                chebyshevWeight = variance / (variance + (v * v));
+
+                // Increase the contrast in the weight
+                chebyshevWeight = std::fmax((chebyshevWeight * chebyshevWeight * chebyshevWeight), 0.f);
+            }
+            return chebyshevWeight;
+        }
+
+        /**
+         * Returns the coordinates of the visibility mask cell that contains a position, given its base probe
+         * and its grid space distance to the base probe (alpha, in [0, 1] on each axis).
+         */
+        inline int3 GetVisibilityMaskCellCoords(const int3& baseProbeCoords, const float3& alpha, int cellSubdivisions)
+        {
+            int3 cellCoords;
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                int subdivision = std::min((int)(alpha[axis] * (float)cellSubdivisions), cellSubdivisions - 1);
+                cellCoords[axis] = (baseProbeCoords[axis] * cellSubdivisions) + subdivision;
+            }
+            return cellCoords;
+        }
+
+        //------------------------------------------------------------------------
+        // SIMD Helpers
+        //------------------------------------------------------------------------
+
+        struct vfloat3
+        {
+            simd::vfloat x;
+            simd::vfloat y;
+            simd::vfloat z;
+        };
+
+        inline vfloat3 Set1(const float3& v) { return { simd::Set1(v.x), simd::Set1(v.y), simd::Set1(v.z) }; }
+        inline vfloat3 Add(const vfloat3& a, const vfloat3& b) { return { simd::Add(a.x, b.x), simd::Add(a.y, b.y), simd::Add(a.z, b.z) }; }
+        inline vfloat3 Sub(const vfloat3& a, const vfloat3& b) { return { simd::Sub(a.x, b.x), simd::Sub(a.y, b.y), simd::Sub(a.z, b.z) }; }
+        inline vfloat3 Mul(const vfloat3& a, const simd::vfloat& b) { return { simd::Mul(a.x, b), simd::Mul(a.y, b), simd::Mul(a.z, b) }; }
+        inline simd::vfloat Dot3(const vfloat3& a, const vfloat3& b) { return simd::Add(simd::Add(simd::Mul(a.x, b.x), simd::Mul(a.y, b.y)), simd::Mul(a.z, b.z)); }
+
+        inline vfloat3 Cross3(const vfloat3& a, const vfloat3& b)
+        {
+            return {
+                simd::Sub(simd::Mul(a.y, b.z), simd::Mul(a.z, b.y)),
+                simd::Sub(simd::Mul(a.z, b.x), simd::Mul(a.x, b.z)),
+                simd::Sub(simd::Mul(a.x, b.y), simd::Mul(a.y, b.x)) };
+        }
+
+        inline vfloat3 QuaternionRotate(const vfloat3& v, const float4& q)
+        {
+            vfloat3 b = Set1({ q.x, q.y, q.z });
+            float b2 = (q.x * q.x) + (q.y * q.y) + (q.z * q.z);
+            vfloat3 result = Mul(v, simd::Set1(q.w * q.w - b2));
+            result = Add(result, Mul(b, simd::Mul(Dot3(v, b), simd::Set1(2.f))));
+            return Add(result, Mul(Cross3(b, v), simd::Set1(q.w * 2.f)));
+        }
+
+        inline simd::vfloat SignNotZero(const simd::vfloat& v)
+        {
+            return simd::Select(simd::GreaterEqual(v, simd::Set1(0.f)), simd::Set1(1.f), simd::Set1(-1.f));
+        }
+
+        /**
+         * Vectorized DDGIGetOctahedralCoordinates().
+         */
+        inline void GetOctahedralCoordinates(const vfloat3& direction, simd::vfloat& u, simd::vfloat& v)
+        {
+            simd::vfloat l1norm = simd::Add(simd::Add(simd::Abs(direction.x), simd::Abs(direction.y)), simd::Abs(direction.z));
+            simd::vfloat rcp = simd::Div(simd::Set1(1.f), l1norm);
+            u = simd::Mul(direction.x, rcp);
+            v = simd::Mul(direction.y, rcp);
+
+            simd::vmask lower = simd::Less(direction.z, simd::Set1(0.f));
+            simd::vfloat lowerU = simd::Mul(simd::Sub(simd::Set1(1.f), simd::Abs(v)), SignNotZero(u));
+            simd::vfloat lowerV = simd::Mul(simd::Sub(simd::Set1(1.f), simd::Abs(u)), SignNotZero(v));
+            u = simd::Select(lower, lowerU, u);
+            v = simd::Select(lower, lowerV, v);
+        }
+
+        /**
+         * Per-volume probe lookup table for batched queries, indexed by unscrolled probe grid coordinates.
+         * Stores the results of the per-probe scalar functions (scroll adjusted probe index, state, relocated world position,
+         * and texel coordinates) so queries can gather them instead of recomputing them.
+         */
+        struct ProbeTable
+        {
+            std::vector<float> positionX;
+            std::vector<float> positionY;
+            std::vector<float> positionZ;
+            std::vector<float> active;                      // 1 if the probe is active, 0 otherwise
+            std::vector<float> texelX;                      // Probe texel coordinates (one texel per probe)
+            std::vector<float> texelY;
+            std::vector<float> slice;
+
+            void Build(const DDGIVolumeDescGPU& volume, const DDGIVolumeResources& resources)
+            {
+                size_t numProbes = (size_t)(volume.probeCounts.x * volume.probeCounts.y * volume.probeCounts.z);
+                for (std::vector<float>* v : { &positionX, &positionY, &positionZ, &active, &texelX, &texelY, &slice }) v->resize(numProbes);
+
+                size_t index = 0;
+                for (int z = 0; z < volume.probeCounts.z; z++)
+                {
+                    for (int y = 0; y < volume.probeCounts.y; y++)
+                    {
+                        for (int x = 0; x < volume.probeCounts.x; x++, index++)
+                        {
+                            int3 probeCoords = { x, y, z };
+                            int probeIndex = DDGIGetScrollingProbeIndex(probeCoords, volume);
+                            float3 probeWorldPosition = DDGIGetProbeWorldPosition(probeCoords, volume, *resources.probeData);
+                            uint3 probeTexelCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
+
+                            positionX[index] = probeWorldPosition.x;
+                            positionY[index] = probeWorldPosition.y;
+                            positionZ[index] = probeWorldPosition.z;
+                            active[index] = (DDGILoadProbeState(probeIndex, *resources.probeData, volume) == DDGI_PROBE_STATE_INACTIVE) ? 0.f : 1.f;
+                            texelX[index] = (float)probeTexelCoords.x;
+                            texelY[index] = (float)probeTexelCoords.y;
+                            slice[index] = (float)probeTexelCoords.z;
+                        }
+                    }
+                }
+            }
+        };
+
+        /**
+         * Vectorized SampleBilinear(DDGIGetProbeUV()) of a texture array, for the probes and octant coordinates of each lane.
+         * Fetches numChannels channels, mirroring the sampling in DDGIGetVolumeIrradiance().
+         */
+        void SampleProbes(
+            const Texture2DArray& texture,
+            int numProbeInteriorTexels,
+            const DDGIVolumeDescGPU& volume,
+            const simd::vfloat& probeTexelX,
+            const simd::vfloat& probeTexelY,
+            const simd::vfloat& probeSlice,
+            const simd::vfloat& octantU,
+            const simd::vfloat& octantV,
+            int numChannels,
+            simd::vfloat* result)
+        {
+            // DDGIGetProbeUV()
+            float numProbeTexels = ((float)numProbeInteriorTexels + 2.f);
+        #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.x;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.z;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.y;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.x;
+        #elif RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+            float textureWidth = numProbeTexels * (float)volume.probeCounts.x;
+            float textureHeight = numProbeTexels * (float)volume.probeCounts.y;
+        #endif
+
+            simd::vfloat u = simd::Add(simd::Mul(probeTexelX, simd::Set1(numProbeTexels)), simd::Set1(numProbeTexels * 0.5f));
+            simd::vfloat v = simd::Add(simd::Mul(probeTexelY, simd::Set1(numProbeTexels)), simd::Set1(numProbeTexels * 0.5f));
+            u = simd::Add(u, simd::Mul(octantU, simd::Set1((float)numProbeInteriorTexels * 0.5f)));
+            v = simd::Add(v, simd::Mul(octantV, simd::Set1((float)numProbeInteriorTexels * 0.5f)));
+            u = simd::Div(u, simd::Set1(textureWidth));
+            v = simd::Div(v, simd::Set1(textureHeight));
+
+            // SampleBilinear()
+            simd::vfloat x = simd::Sub(simd::Mul(u, simd::Set1((float)texture.width)), simd::Set1(0.5f));
+            simd::vfloat y = simd::Sub(simd::Mul(v, simd::Set1((float)texture.height)), simd::Set1(0.5f));
+            simd::vfloat fx = simd::Floor(x);
+            simd::vfloat fy = simd::Floor(y);
+            simd::vfloat ax = simd::Sub(x, fx);
+            simd::vfloat ay = simd::Sub(y, fy);
+
+            // Clamp the bilinear footprint to the texture (the coordinates are integers, so clamping as floats is exact)
+            simd::vfloat maxX = simd::Set1((float)texture.width - 1.f);
+            simd::vfloat maxY = simd::Set1((float)texture.height - 1.f);
+            simd::vint x0 = simd::ToIntTruncate(simd::Max(simd::Set1(0.f), simd::Min(fx, maxX)));
+            simd::vint x1 = simd::ToIntTruncate(simd::Max(simd::Set1(0.f), simd::Min(simd::Add(fx, simd::Set1(1.f)), maxX)));
+            simd::vint y0 = simd::ToIntTruncate(simd::Max(simd::Set1(0.f), simd::Min(fy, maxY)));
+            simd::vint y1 = simd::ToIntTruncate(simd::Max(simd::Set1(0.f), simd::Min(simd::Add(fy, simd::Set1(1.f)), maxY)));
+
+            // Texel indices (in floats) of the bilinear footprint
+            simd::vint width = simd::Set1i((int32_t)texture.width);
+            simd::vint channels = simd::Set1i(4);
+            simd::vint sliceRow = simd::Muli(simd::ToIntTruncate(probeSlice), simd::Set1i((int32_t)texture.height));
+            simd::vint row0 = simd::Muli(simd::Addi(sliceRow, y0), width);
+            simd::vint row1 = simd::Muli(simd::Addi(sliceRow, y1), width);
+            simd::vint i00 = simd::Muli(simd::Addi(row0, x0), channels);
+            simd::vint i10 = simd::Muli(simd::Addi(row0, x1), channels);
+            simd::vint i01 = simd::Muli(simd::Addi(row1, x0), channels);
+            simd::vint i11 = simd::Muli(simd::Addi(row1, x1), channels);
+
+            const float* texels = &texture.texels[0].x;
+            for (int c = 0; c < numChannels; c++)
+            {
+                simd::vfloat t00 = simd::Gather(texels + c, i00);
+                simd::vfloat t10 = simd::Gather(texels + c, i10);
+                simd::vfloat t01 = simd::Gather(texels + c, i01);
+                simd::vfloat t11 = simd::Gather(texels + c, i11);
+
+                simd::vfloat filtered0 = simd::Add(t00, simd::Mul(ax, simd::Sub(t10, t00)));
+                simd::vfloat filtered1 = simd::Add(t01, simd::Mul(ax, simd::Sub(t11, t01)));
+                result[c] = simd::Add(filtered0, simd::Mul(ay, simd::Sub(filtered1, filtered0)));
+            }
+        }
+
+        /**
+         * Vectorized DDGIGetProbeWorldPosition() (without relocation) from float grid coordinates.
+         */
+        inline vfloat3 GetProbeWorldPosition(const vfloat3& probeCoords, const DDGIVolumeDescGPU& volume, const float3& probeGridShift, const float3& origin)
+        {
+            vfloat3 probeWorldPosition =
+            {
+                simd::Sub(simd::Mul(probeCoords.x, simd::Set1(volume.probeSpacing.x)), simd::Set1(probeGridShift.x)),
+                simd::Sub(simd::Mul(probeCoords.y, simd::Set1(volume.probeSpacing.y)), simd::Set1(probeGridShift.y)),
+                simd::Sub(simd::Mul(probeCoords.z, simd::Set1(volume.probeSpacing.z)), simd::Set1(probeGridShift.z)),
+            };
+            if (!IsVolumeMovementScrolling(volume)) probeWorldPosition = QuaternionRotate(probeWorldPosition, volume.rotation);
+            return Add(probeWorldPosition, Set1(origin));
+        }
+
+        /**
+         * The per-lane state of SIMD width queries, computed once before sampling the probes.
+         */
+        struct QueryLanes
+        {
+            vfloat3 worldPosition;
+            vfloat3 biasedWorldPosition;
+            vfloat3 direction;
+            vfloat3 baseProbeCoords;
+            vfloat3 alpha;                                  // Grid space distance to the base probe, in [0, 1] on each axis
+            simd::vfloat directionU;                        // Octahedral coordinates of the sampling direction
+            simd::vfloat directionV;
+            simd::vfloat cellMask;                          // Probe visibility mask of the lane's cell (0xFF: sample all probes)
+
+            // The members are contiguous vfloats
+            static const int c_numFields = 18;
+            simd::vfloat* Fields() { return &worldPosition.x; }
+        };
+
+        /**
+         * Per-chunk storage of the query lanes, in structures of arrays, so the queries can be sampled in any order.
+         */
+        struct QueryScratch
+        {
+            std::vector<float> fields;                      // c_numFields arrays of numQueries (SIMD width aligned) floats
+            uint32_t numQueries = 0;
+
+            void Allocate(uint32_t count)
+            {
+                numQueries = (uint32_t)simd::AlignToWidth((int)count);
+                fields.resize((size_t)QueryLanes::c_numFields * numQueries);
+            }
+
+            float* GetField(int field) { return &fields[(size_t)field * numQueries]; }
+
+            void Store(uint32_t index, QueryLanes& lanes)
+            {
+                for (int field = 0; field < QueryLanes::c_numFields; field++) simd::Store(GetField(field) + index, lanes.Fields()[field]);
+            }
+
+            // Gathers the lanes of SIMD width queries (indices stored as floats, like the probe table)
+            void Load(const float* queries, QueryLanes& lanes)
+            {
+                simd::vint indices = simd::ToIntTruncate(simd::Load(queries));
+                for (int field = 0; field < QueryLanes::c_numFields; field++) lanes.Fields()[field] = simd::Gather(GetField(field), indices);
+            }
+        };
+
+        /**
+         * Computes the lane state of SIMD width queries, mirroring the start of DDGIGetVolumeIrradiance() for each lane.
+         */
+        void SetupQueries(
+            const float3* worldPositions,
+            const float3* surfaceBiases,
+            const float3* directions,
+            const DDGIVolumeDescGPU& volume,
+            QueryLanes& lanes)
+        {
+            // Load the queries into structures of arrays
+            float laneData[9][simd::Width];
+            for (int lane = 0; lane < simd::Width; lane++)
+            {
+                laneData[0][lane] = worldPositions[lane].x;
+                laneData[1][lane] = worldPositions[lane].y;
+                laneData[2][lane] = worldPositions[lane].z;
+                laneData[3][lane] = surfaceBiases[lane].x;
+                laneData[4][lane] = surfaceBiases[lane].y;
+                laneData[5][lane] = surfaceBiases[lane].z;
+                laneData[6][lane] = directions[lane].x;
+                laneData[7][lane] = directions[lane].y;
+                laneData[8][lane] = directions[lane].z;
+            }
+            lanes.worldPosition = { simd::Load(laneData[0]), simd::Load(laneData[1]), simd::Load(laneData[2]) };
+            vfloat3 surfaceBias = { simd::Load(laneData[3]), simd::Load(laneData[4]), simd::Load(laneData[5]) };
+            lanes.direction = { simd::Load(laneData[6]), simd::Load(laneData[7]), simd::Load(laneData[8]) };
+
+            // Bias the world space position
+            lanes.biasedWorldPosition = Add(lanes.worldPosition, surfaceBias);
+
+            // Get the 3D grid coordinates of the probe nearest the biased world position (DDGIGetBaseProbeGridCoords())
+            float3 counts = { (float)(volume.probeCounts.x - 1), (float)(volume.probeCounts.y - 1), (float)(volume.probeCounts.z - 1) };
+            float3 probeGridShift = Mul(Mul(volume.probeSpacing, counts), 0.5f);
+            float3 origin = Add(volume.origin, Mul(ToFloat3(volume.probeScrollOffsets), volume.probeSpacing));
+
+            vfloat3 position = Sub(lanes.biasedWorldPosition, Set1(origin));
+            if (!IsVolumeMovementScrolling(volume)) position = QuaternionRotate(position, RTXGIQuaternionConjugate(volume.rotation));
+            position = Add(position, Set1(probeGridShift));
+
+            simd::vfloat* baseProbeCoord = &lanes.baseProbeCoords.x;
+            const simd::vfloat* gridPosition = &position.x;
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                // Clamp before truncating to avoid integer overflow, then clamp to [0, probeCounts - 1]
+                simd::vfloat coord = simd::Div(gridPosition[axis], simd::Set1(volume.probeSpacing[axis]));
+                coord = simd::Max(simd::Set1(-1.f), simd::Min(coord, simd::Set1(counts[axis])));
+                coord = simd::ToFloat(simd::ToIntTruncate(coord));
+                baseProbeCoord[axis] = simd::Max(simd::Set1(0.f), coord);
+            }
+
+            // Get the world-space position of the base probe (ignore relocation)
+            vfloat3 baseProbeWorldPosition = GetProbeWorldPosition(lanes.baseProbeCoords, volume, probeGridShift, origin);
+
+            // Clamp the distance (in grid space) between the given point and the base probe's world position (on each axis) to [0, 1]
+            vfloat3 gridSpaceDistance = Sub(lanes.biasedWorldPosition, baseProbeWorldPosition);
+            if (!IsVolumeMovementScrolling(volume)) gridSpaceDistance = QuaternionRotate(gridSpaceDistance, RTXGIQuaternionConjugate(volume.rotation));
+            lanes.alpha =
+            {
+                simd::Min(simd::Max(simd::Div(gridSpaceDistance.x, simd::Set1(volume.probeSpacing.x)), simd::Set1(0.f)), simd::Set1(1.f)),
+                simd::Min(simd::Max(simd::Div(gridSpaceDistance.y, simd::Set1(volume.probeSpacing.y)), simd::Set1(0.f)), simd::Set1(1.f)),
+                simd::Min(simd::Max(simd::Div(gridSpaceDistance.z, simd::Set1(volume.probeSpacing.z)), simd::Set1(0.f)), simd::Set1(1.f)),
+            };
+
+            // The octahedral coordinates of the sampling direction are the same for every probe
+            GetOctahedralCoordinates(lanes.direction, lanes.directionU, lanes.directionV);
+
+            // Sample all probes, see GetCellIndices()
+            lanes.cellMask = simd::Set1(255.f);
+        }
+
+        /**
+         * Gets the index of the visibility mask cell of SIMD width queries (see GetVisibilityMaskCellCoords()).
+         */
+        void GetCellIndices(const QueryLanes& lanes, const DDGIProbeVisibilityMasks& masks, uint32_t* cellIndices)
+        {
+            // Cell coordinates are small integers, exact as floats
+            float cellCoords[3][simd::Width];
+            const simd::vfloat* baseProbeCoord = &lanes.baseProbeCoords.x;
+            const simd::vfloat* alpha = &lanes.alpha.x;
+            simd::vfloat subdivisions = simd::Set1((float)masks.cellSubdivisions);
+            for (size_t axis = 0; axis < 3; axis++)
+            {
+                simd::vfloat subdivision = simd::Min(simd::ToFloat(simd::ToIntTruncate(simd::Mul(alpha[axis], subdivisions))), simd::Set1((float)(masks.cellSubdivisions - 1)));
+                simd::Store(cellCoords[axis], simd::Add(simd::Mul(baseProbeCoord[axis], subdivisions), subdivision));
+            }
+            for (int lane = 0; lane < simd::Width; lane++)
+            {
+                uint32_t x = (uint32_t)cellCoords[0][lane];
+                uint32_t y = (uint32_t)cellCoords[1][lane];
+                uint32_t z = (uint32_t)cellCoords[2][lane];
+                cellIndices[lane] = x + ((uint32_t)masks.cellCounts.x * (y + ((uint32_t)masks.cellCounts.y * z)));
+            }
+        }
+
+        /**
+         * Computes irradiance for SIMD width queries. Mirrors DDGIGetVolumeIrradiance() for each lane.
+         * Probes that are inactive or masked out for every lane are skipped.
+         */
+        void GetVolumeIrradiance(
+            const QueryLanes& lanes,
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources,
+            const ProbeTable& probes,
+            float3* irradiance)
+        {
+            const vfloat3& worldPosition = lanes.worldPosition;
+            const vfloat3& biasedWorldPosition = lanes.biasedWorldPosition;
+            const vfloat3& direction = lanes.direction;
+            const vfloat3& baseProbeCoords = lanes.baseProbeCoords;
+            const simd::vfloat* alpha = &lanes.alpha.x;
+            const simd::vfloat& directionU = lanes.directionU;
+            const simd::vfloat& directionV = lanes.directionV;
+            simd::vint cellMask = simd::ToIntTruncate(lanes.cellMask);
+
+            float3 counts = { (float)(volume.probeCounts.x - 1), (float)(volume.probeCounts.y - 1), (float)(volume.probeCounts.z - 1) };
+
+            vfloat3 result = Set1({ 0.f, 0.f, 0.f });
+            simd::vfloat accumulatedWeights = simd::Set1(0.f);
+            simd::vfloat exponent = simd::Set1(volume.probeIrradianceEncodingGamma * 0.5f);
+
+            // Iterate over the 8 closest probes and accumulate their contributions
+            for (int probeIndex = 0; probeIndex < 8; probeIndex++)
+            {
+                int3 adjacentProbeOffset = { probeIndex & 1, (probeIndex >> 1) & 1, (probeIndex >> 2) & 1 };
+
+                // Get the 3D grid coordinates of the adjacent probe and its index in the probe table
+                simd::vfloat adjacentX = simd::Min(simd::Add(baseProbeCoords.x, simd::Set1((float)adjacentProbeOffset.x)), simd::Set1(counts.x));
+                simd::vfloat adjacentY = simd::Min(simd::Add(baseProbeCoords.y, simd::Set1((float)adjacentProbeOffset.y)), simd::Set1(counts.y));
+                simd::vfloat adjacentZ = simd::Min(simd::Add(baseProbeCoords.z, simd::Set1((float)adjacentProbeOffset.z)), simd::Set1(counts.z));
+                simd::vint tableIndex = simd::ToIntTruncate(adjacentX);
+                tableIndex = simd::Addi(tableIndex, simd::Muli(simd::ToIntTruncate(adjacentY), simd::Set1i(volume.probeCounts.x)));
+                tableIndex = simd::Addi(tableIndex, simd::Muli(simd::ToIntTruncate(adjacentZ), simd::Set1i(volume.probeCounts.x * volume.probeCounts.y)));
+
+                // Skip the probe when it is inactive or masked out for every lane
+                simd::vmask active = simd::Greater(simd::Gather(probes.active.data(), tableIndex), simd::Set1(0.f));
+                simd::vmask visible = simd::Greater(simd::ToFloat(simd::Andi(cellMask, simd::Set1i(1 << probeIndex))), simd::Set1(0.f));
+                simd::vmask sampled = simd::And(active, visible);
+                if (simd::MoveMask(sampled) == 0) continue;
+
+                // Get the adjacent probe's world position
+                vfloat3 adjacentProbeWorldPosition =
+                {
+                    simd::Gather(probes.positionX.data(), tableIndex),
+                    simd::Gather(probes.positionY.data(), tableIndex),
+                    simd::Gather(probes.positionZ.data(), tableIndex),
+                };
+                simd::vfloat probeTexelX = simd::Gather(probes.texelX.data(), tableIndex);
+                simd::vfloat probeTexelY = simd::Gather(probes.texelY.data(), tableIndex);
+                simd::vfloat probeSlice = simd::Gather(probes.slice.data(), tableIndex);
+
+                // Compute the distance and direction from the (biased and non-biased) shading point and the adjacent probe
+                vfloat3 worldPosToAdjProbe = Sub(adjacentProbeWorldPosition, worldPosition);
+                worldPosToAdjProbe = Mul(worldPosToAdjProbe, simd::Div(simd::Set1(1.f), simd::Sqrt(Dot3(worldPosToAdjProbe, worldPosToAdjProbe))));
+                vfloat3 biasedPosToAdjProbe = Sub(adjacentProbeWorldPosition, biasedWorldPosition);
+                simd::vfloat biasedPosToAdjProbeDist = simd::Sqrt(Dot3(biasedPosToAdjProbe, biasedPosToAdjProbe));
+                biasedPosToAdjProbe = Mul(biasedPosToAdjProbe, simd::Div(simd::Set1(1.f), biasedPosToAdjProbeDist));
+
+                // Compute trilinear weights based on the distance to each adjacent probe
+                simd::vfloat trilinearWeight = simd::Set1(1.f);
+                for (size_t axis = 0; axis < 3; axis++)
+                {
+                    simd::vfloat oneMinusAlpha = simd::Sub(simd::Set1(1.f), alpha[axis]);
+                    simd::vfloat trilinear = simd::Add(oneMinusAlpha, simd::Mul(simd::Set1((float)adjacentProbeOffset[axis]), simd::Sub(alpha[axis], oneMinusAlpha)));
+                    trilinearWeight = simd::Mul(trilinearWeight, simd::Max(simd::Set1(0.001f), trilinear));
+                }
+
+                // "Wrap shading" soft backface weight
+                simd::vfloat wrapShading = simd::Mul(simd::Add(Dot3(worldPosToAdjProbe, direction), simd::Set1(1.f)), simd::Set1(0.5f));
+                simd::vfloat weight = simd::Add(simd::Mul(wrapShading, wrapShading), simd::Set1(0.2f));
+
+                // Sample the probe's distance texture to get the mean distance to nearby surfaces
+                simd::vfloat octantU, octantV;
+                GetOctahedralCoordinates(Mul(biasedPosToAdjProbe, simd::Set1(-1.f)), octantU, octantV);
+
+                simd::vfloat filteredDistance[2];
+                SampleProbes(*resources.probeDistance, volume.probeNumDistanceInteriorTexels, volume, probeTexelX, probeTexelY, probeSlice, octantU, octantV, 2, filteredDistance);
+                filteredDistance[0] = simd::Mul(filteredDistance[0], simd::Set1(2.f));
+                filteredDistance[1] = simd::Mul(filteredDistance[1], simd::Set1(2.f));
+
+                // Find the variance of the mean distance
+                simd::vfloat variance = simd::Abs(simd::Sub(simd::Mul(filteredDistance[0], filteredDistance[0]), filteredDistance[1]));
+
+                // Occlusion test (Chebyshev)
+                simd::vfloat v = simd::Sub(biasedPosToAdjProbeDist, filteredDistance[0]);
+                simd::vfloat chebyshevWeight = simd::Div(variance, simd::Add(variance, simd::Mul(v, v)));
+                chebyshevWeight = simd::Max(simd::Mul(simd::Mul(chebyshevWeight, chebyshevWeight), chebyshevWeight), simd::Set1(0.f));
+                chebyshevWeight = simd::Select(simd::Greater(biasedPosToAdjProbeDist, filteredDistance[0]), chebyshevWeight, simd::Set1(1.f));
+
+                // Avoid visibility weights ever going all the way to zero, and avoid a weight of zero
+                weight = simd::Mul(weight, simd::Max(simd::Set1(0.05f), chebyshevWeight));
+                weight = simd::Max(simd::Set1(0.000001f), weight);
+
+                // Crush tiny weights but keep the curve continuous
+                simd::vfloat crushed = simd::Mul(weight, simd::Mul(simd::Mul(weight, weight), simd::Set1(1.f / (c_crushThreshold * c_crushThreshold))));
+                weight = simd::Select(simd::Less(weight, simd::Set1(c_crushThreshold)), crushed, weight);
+
+                // Apply the trilinear weights, inactive and masked probes don't contribute
+                weight = simd::Mul(weight, trilinearWeight);
+                weight = simd::Select(sampled, weight, simd::Set1(0.f));
+
+                // Sample the probe's irradiance and decode the tone curve, but leave a gamma = 2 curve to approximate sRGB blending
+                simd::vfloat probeIrradiance[3];
+                SampleProbes(*resources.probeIrradiance, volume.probeNumIrradianceInteriorTexels, volume, probeTexelX, probeTexelY, probeSlice, directionU, directionV, 3, probeIrradiance);
+
+                // Accumulate the weighted irradiance
+                result.x = simd::Add(result.x, simd::Mul(weight, simd::Pow(probeIrradiance[0], exponent)));
+                result.y = simd::Add(result.y, simd::Mul(weight, simd::Pow(probeIrradiance[1], exponent)));
+                result.z = simd::Add(result.z, simd::Mul(weight, simd::Pow(probeIrradiance[2], exponent)));
+                accumulatedWeights = simd::Add(accumulatedWeights, weight);
+            }
+
+            // Normalize by the accumulated weights and go back to linear irradiance
+            simd::vmask noWeight = simd::Equal(accumulatedWeights, simd::Set1(0.f));
+            result = Mul(result, simd::Div(simd::Set1(1.f), accumulatedWeights));
+            result = { simd::Mul(result.x, result.x), simd::Mul(result.y, result.y), simd::Mul(result.z, result.z) };
+
+            // Multiply by the area of the integration domain (hemisphere) to complete the Monte Carlo Estimator equation
+            float scale = RTXGI_2PI;
+            if (volume.probeIrradianceFormat == (uint)EDDGIVolumeTextureFormat::U32) scale *= c_irradianceFormatU32Scale;
+            result = Mul(result, simd::Set1(scale));
+
+            float resultX[simd::Width], resultY[simd::Width], resultZ[simd::Width];
+            simd::Store(resultX, simd::Select(noWeight, simd::Set1(0.f), result.x));
+            simd::Store(resultY, simd::Select(noWeight, simd::Set1(0.f), result.y));
+            simd::Store(resultZ, simd::Select(noWeight, simd::Set1(0.f), result.z));
+            for (int lane = 0; lane < simd::Width; lane++) irradiance[lane] = { resultX[lane], resultY[lane], resultZ[lane] };
+        }
+
+        //------------------------------------------------------------------------
+        // Public RTXGI CPU namespace Irradiance Functions
+        //------------------------------------------------------------------------
+
+        float DDGIGetVolumeBlendWeight(const float3& worldPosition, const DDGIVolumeDescGPU& volume)
+        {
+            // Get the volume's origin and extent
+            float3 origin = Add(volume.origin, Mul(ToFloat3(volume.probeScrollOffsets), volume.probeSpacing));
+            float3 counts = { (float)(volume.probeCounts.x - 1), (float)(volume.probeCounts.y - 1), (float)(volume.probeCounts.z - 1) };
+            float3 extent = Mul(Mul(volume.probeSpacing, counts), 0.5f);
+
+            // Get the delta between the (rotated volume) and the world-space position
+            float3 position = RTXGIQuaternionRotate(Sub(worldPosition, origin), RTXGIQuaternionConjugate(volume.rotation));
+            float3 delta = Sub({ fabsf(position.x), fabsf(position.y), fabsf(position.z) }, extent);
+            if (delta.x < 0.f && delta.y < 0.f && delta.z < 0.f) return 1.f;
+
+            // Adjust the blend weight for each axis
+            float volumeBlendWeight = 1.f;
+            volumeBlendWeight *= (1.f - Saturate(delta.x / volume.probeSpacing.x));
+            volumeBlendWeight *= (1.f - Saturate(delta.y / volume.probeSpacing.y));
+            volumeBlendWeight *= (1.f - Saturate(delta.z / volume.probeSpacing.z));
+            return volumeBlendWeight;
+        }
+
+        float3 DDGIGetVolumeIrradiance(
+            const float3& worldPosition,
+            const float3& surfaceBias,
+            const float3& direction,
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources)
+        {
+            float3 irradiance = { 0.f, 0.f, 0.f };
+            float  accumulatedWeights = 0.f;
+
+            // Bias the world space position
+            float3 biasedWorldPosition = Add(worldPosition, surfaceBias);
+
+            // Get the 3D grid coordinates of the probe nearest the biased world position (i.e. the "base" probe)
+            int3 baseProbeCoords = DDGIGetBaseProbeGridCoords(biasedWorldPosition, volume);
+
+            // Get the world-space position of the base probe (ignore relocation)
+            float3 baseProbeWorldPosition = DDGIGetProbeWorldPosition(baseProbeCoords, volume);
+
+            // Clamp the distance (in grid space) between the given point and the base probe's world position (on each axis) to [0, 1]
+            float3 gridSpaceDistance = Sub(biasedWorldPosition, baseProbeWorldPosition);
+            if (!IsVolumeMovementScrolling(volume)) gridSpaceDistance = RTXGIQuaternionRotate(gridSpaceDistance, RTXGIQuaternionConjugate(volume.rotation));
+            float3 alpha;
+            for (size_t axis = 0; axis < 3; axis++) alpha[axis] = Saturate(gridSpaceDistance[axis] / volume.probeSpacing[axis]);
+
+            // Get the probe visibility mask of the cell, sample all probes when none are visible
+            uint32_t cellMask = 0xFF;
+            if (resources.probeVisibilityMasks)
+            {
+                const DDGIProbeVisibilityMasks& masks = *resources.probeVisibilityMasks;
+                cellMask = masks.GetMask(GetVisibilityMaskCellCoords(baseProbeCoords, alpha, masks.cellSubdivisions));
+                if (cellMask == 0) cellMask = 0xFF;
+            }
+
+            // Iterate over the 8 closest probes and accumulate their contributions
+            for (int probeIndex = 0; probeIndex < 8; probeIndex++)
+            {
+                // Compute the offset to the adjacent probe in grid coordinates by
+                // sourcing the offsets from the bits of the loop index: x = bit 0, y = bit 1, z = bit 2
+                int3 adjacentProbeOffset = { probeIndex & 1, (probeIndex >> 1) & 1, (probeIndex >> 2) & 1 };
+
+                // Early Out: skip probes that are not visible from the cell
+                if ((cellMask & (1u << probeIndex)) == 0) continue;
+
+                // Get the 3D grid coordinates of the adjacent probe by adding the offset to
+                // the base probe and clamping to the grid boundaries
+                int3 adjacentProbeCoords;
+                for (size_t axis = 0; axis < 3; axis++)
+                {
+                    adjacentProbeCoords[axis] = std::max(0, std::min(baseProbeCoords[axis] + adjacentProbeOffset[axis], volume.probeCounts[axis] - 1));
+                }
+
+                // Get the adjacent probe's index, adjusting the adjacent probe index for scrolling offsets (if present)
+                int adjacentProbeIndex = DDGIGetScrollingProbeIndex(adjacentProbeCoords, volume);
+
+                // Early Out: don't allow inactive probes to contribute to irradiance
+                int probeState = DDGILoadProbeState(adjacentProbeIndex, *resources.probeData, volume);
+                if (probeState == DDGI_PROBE_STATE_INACTIVE) continue;
+
+                // Get the adjacent probe's world position
+                float3 adjacentProbeWorldPosition = DDGIGetProbeWorldPosition(adjacentProbeCoords, volume, *resources.probeData);
+
+                // Compute the direction from the shading point to the adjacent probe
+                float3 worldPosToAdjProbe = Normalize3(Sub(adjacentProbeWorldPosition, worldPosition));
+
+                // Compute trilinear weights based on the distance to each adjacent probe
+                float trilinearWeight = 1.f;
+                for (size_t axis = 0; axis < 3; axis++)
+                {
+                    trilinearWeight *= std::fmax(0.001f, Lerp(1.f - alpha[axis], alpha[axis], (float)adjacentProbeOffset[axis]));
+                }
+                float weight = 1.f;
+
+                // "Wrap shading" soft backface weight. The small offset at the end reduces the "going to zero" impact.
+                float wrapShading = (Dot3(worldPosToAdjProbe, direction) + 1.f) * 0.5f;
+                weight *= (wrapShading * wrapShading) + 0.2f;
+
+                // Occlusion test, using the probe's distance texture from the biased shading point
+                float chebyshevWeight = GetProbeVisibilityWeight(biasedWorldPosition, adjacentProbeWorldPosition, adjacentProbeIndex, volume, *resources.probeDistance);
+
+                // Avoid visibility weights ever going all the way to zero because
+                // when *no* probe has visibility we need a fallback value
+                weight *= std::fmax(0.05f, chebyshevWeight);
+
+                // Avoid a weight of zero
+                weight = std::fmax(0.000001f, weight);
+
+                // A small amount of light is visible due to logarithmic perception, so
+                // crush tiny weights but keep the curve continuous
+                if (weight < c_crushThreshold)
+                {
+                    weight *= (weight * weight) * (1.f / (c_crushThreshold * c_crushThreshold));
+                }
+
+                // Apply the trilinear weights
+                weight *= trilinearWeight;
+
+                // Get the octahedral coordinates for the sample direction
+                float2 octantCoords = DDGIGetOctahedralCoordinates(direction);
+
+                // Get the probe's texture coordinates
+                float3 probeTextureUV = DDGIGetProbeUV(adjacentProbeIndex, octantCoords, volume.probeNumIrradianceInteriorTexels, volume);
+
+                // Sample the probe's irradiance
+                float4 irradianceSample = SampleBilinear(*resources.probeIrradiance, probeTextureUV);
+
+                // Decode the tone curve, but leave a gamma = 2 curve to approximate sRGB blending
+                float exponent = volume.probeIrradianceEncodingGamma * 0.5f;
+                float3 probeIrradiance = { powf(irradianceSample.x, exponent), powf(irradianceSample.y, exponent), powf(irradianceSample.z, exponent) };
+
+                // Accumulate the weighted irradiance
+                irradiance = Add(irradiance, Mul(probeIrradiance, weight));
+                accumulatedWeights += weight;
+            }
+
+            if (accumulatedWeights == 0.f) return { 0.f, 0.f, 0.f };
+
+            irradiance = Mul(irradiance, (1.f / accumulatedWeights));   // Normalize by the accumulated weights
+            irradiance = Mul(irradiance, irradiance);                   // Go back to linear irradiance
+            irradiance = Mul(irradiance, RTXGI_2PI);                    // Multiply by the area of the integration domain (hemisphere) to complete the Monte Carlo Estimator equation
+
+            // Adjust for energy loss due to reduced precision in the R10G10B10A2 irradiance texture format
+            if (volume.probeIrradianceFormat == (uint)EDDGIVolumeTextureFormat::U32)
+            {
+                irradiance = Mul(irradiance, c_irradianceFormatU32Scale);
+            }
+
+            return irradiance;
+        }
+
+        ERTXGIStatus DDGIGetVolumeBlendWeight(uint32_t numQueries, const float3* worldPositions, const DDGIVolumeDescGPU& volume, float* weights)
+        {
+            for (uint32_t queryIndex = 0; queryIndex < numQueries; queryIndex++)
+            {
+                weights[queryIndex] = DDGIGetVolumeBlendWeight(worldPositions[queryIndex], volume);
+            }
+            return ERTXGIStatus::OK;
+        }
+
+        ERTXGIStatus DDGIGetVolumeIrradiance(
+            uint32_t numQueries,
+            const float3* worldPositions,
+            const float3* surfaceBiases,
+            const float3* directions,
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources,
+            float3* irradiance,
+            uint32_t numThreads)
+        {
+            if (resources.probeIrradiance == nullptr || resources.probeDistance == nullptr || resources.probeData == nullptr) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+            if (numQueries == 0) return ERTXGIStatus::OK;
+
+            ProbeTable probes;
+            probes.Build(volume, resources);
+
+            ParallelFor(numQueries, c_queriesPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                uint32_t numChunkQueries = end - begin;
+                float3 positions[simd::Width];
+                float3 biases[simd::Width];
+                float3 sampleDirections[simd::Width];
+                float3 results[simd::Width];
+
+                // Masked lanes still pay for the probes other lanes sample, so with visibility masks the lanes of the chunk are
+                // set up first, then sampled in the order of their cell's mask to skip the masked out probes entirely
+                const DDGIProbeVisibilityMasks* masks = resources.probeVisibilityMasks;
+                QueryScratch scratch;
+                uint32_t cellIndices[c_queriesPerChunk];
+                if (masks) scratch.Allocate(numChunkQueries);
+
+                QueryLanes lanes;
+                for (uint32_t index = 0; index < numChunkQueries; index += simd::Width)
+                {
+                    uint32_t numLanes = std::min((uint32_t)simd::Width, numChunkQueries - index);
+
+                    // Pad the last (partial) set of queries by repeating the last query
+                    for (uint32_t lane = 0; lane < (uint32_t)simd::Width; lane++)
+                    {
+                        uint32_t query = begin + index + std::min(lane, numLanes - 1);
+                        positions[lane] = worldPositions[query];
+                        biases[lane] = surfaceBiases ? surfaceBiases[query] : Mul(directions[query], volume.probeNormalBias);
+                        sampleDirections[lane] = directions[query];
+                    }
+
+                    SetupQueries(positions, biases, sampleDirections, volume, lanes);
+                    if (masks)
+                    {
+                        GetCellIndices(lanes, *masks, &cellIndices[index]);
+                        scratch.Store(index, lanes);
+                        continue;
+                    }
+
+                    GetVolumeIrradiance(lanes, volume, resources, probes, results);
+                    for (uint32_t lane = 0; lane < numLanes; lane++) irradiance[begin + index + lane] = results[lane];
+                }
+                if (!masks) return;
+
+                // Look up the masks in a separate pass (so the cache misses overlap), empty masks sample all probes
+                float* cellMasks = scratch.GetField(QueryLanes::c_numFields - 1);
+                uint32_t offsets[256] = {};
+                for (uint32_t index = 0; index < numChunkQueries; index++)
+                {
+                    uint32_t mask = masks->masks[cellIndices[index]];
+                    mask = mask ? mask : 0xFF;
+                    cellMasks[index] = (float)mask;
+                    offsets[mask]++;
+                }
+
+                // Sort the queries by mask (stable counting sort), so the lanes of a SIMD batch skip the same probes
+                for (uint32_t mask = 0, offset = 0; mask < 256; mask++)
+                {
+                    uint32_t count = offsets[mask];
+                    offsets[mask] = offset;
+                    offset += count;
+                }
+
+                float order[c_queriesPerChunk];
+                for (uint32_t index = 0; index < numChunkQueries; index++) order[offsets[(uint32_t)cellMasks[index]]++] = (float)index;
+                for (uint32_t index = numChunkQueries; index < scratch.numQueries; index++) order[index] = order[numChunkQueries - 1];
+
+                for (uint32_t index = 0; index < numChunkQueries; index += simd::Width)
+                {
+                    uint32_t numLanes = std::min((uint32_t)simd::Width, numChunkQueries - index);
+                    scratch.Load(&order[index], lanes);
+                    GetVolumeIrradiance(lanes, volume, resources, probes, results);
+                    for (uint32_t lane = 0; lane < numLanes; lane++) irradiance[begin + (uint32_t)order[index + lane]] = results[lane];
+                }
+            });
+
+            return ERTXGIStatus::OK;
+        }
+
+        ERTXGIStatus DDGIBuildProbeVisibilityMasks(
+            const DDGIVolumeDescGPU& volume,
+            const DDGIVolumeResources& resources,
+            const DDGIProbeVisibilityMasksDesc& desc,
+            DDGIProbeVisibilityMasks& masks,
+            uint32_t numThreads)
+        {
+            if (resources.probeDistance == nullptr || resources.probeData == nullptr) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+            if (desc.cellSubdivisions <= 0 || desc.samplesPerAxis < 2) return ERTXGIStatus::ERROR_DDGI_INVALID_RESOURCES_DESC;
+
+            int subdivisions = desc.cellSubdivisions;
+            masks.cellSubdivisions = subdivisions;
+            masks.cellCounts = { volume.probeCounts.x * subdivisions, volume.probeCounts.y * subdivisions, volume.probeCounts.z * subdivisions };
+            masks.masks.assign((size_t)(masks.cellCounts.x * masks.cellCounts.y * masks.cellCounts.z), 0);
+
+            // Test positions, in grid space relative to the base probe of a cell (includes the cell boundaries)
+            std::vector<float3> samples;
+            for (int z = 0; z < desc.samplesPerAxis; z++)
+            {
+                for (int y = 0; y < desc.samplesPerAxis; y++)
+                {
+                    for (int x = 0; x < desc.samplesPerAxis; x++)
+                    {
+                        float3 sample = { (float)x, (float)y, (float)z };
+                        samples.push_back(Mul(sample, 1.f / (float)(desc.samplesPerAxis - 1)));
+                    }
+                }
+            }
+
+            uint32_t numProbes = (uint32_t)(volume.probeCounts.x * volume.probeCounts.y * volume.probeCounts.z);
+            ParallelFor(numProbes, c_probeCellsPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t probeCell = begin; probeCell < end; probeCell++)
+                {
+                    int3 baseProbeCoords =
+                    {
+                        (int)probeCell % volume.probeCounts.x,
+                        ((int)probeCell / volume.probeCounts.x) % volume.probeCounts.y,
+                        (int)probeCell / (volume.probeCounts.x * volume.probeCounts.y)
+                    };
+                    float3 baseProbeWorldPosition = DDGIGetProbeWorldPosition(baseProbeCoords, volume);
+
+                    // Get the 8 probes of the probe grid cell
+                    int    adjacentProbeIndices[8];
+                    bool   adjacentProbeActive[8];
+                    float3 adjacentProbeWorldPositions[8];
+                    for (int probeIndex = 0; probeIndex < 8; probeIndex++)
+                    {
+                        int3 adjacentProbeOffset = { probeIndex & 1, (probeIndex >> 1) & 1, (probeIndex >> 2) & 1 };
+                        int3 adjacentProbeCoords;
+                        for (size_t axis = 0; axis < 3; axis++)
+                        {
+                            adjacentProbeCoords[axis] = std::min(baseProbeCoords[axis] + adjacentProbeOffset[axis], volume.probeCounts[axis] - 1);
+                        }
+                        adjacentProbeIndices[probeIndex] = DDGIGetScrollingProbeIndex(adjacentProbeCoords, volume);
+                        adjacentProbeActive[probeIndex] = (DDGILoadProbeState(adjacentProbeIndices[probeIndex], *resources.probeData, volume) != DDGI_PROBE_STATE_INACTIVE);
+                        adjacentProbeWorldPositions[probeIndex] = DDGIGetProbeWorldPosition(adjacentProbeCoords, volume, *resources.probeData);
+                    }
+
+                    // Test the visibility of each probe from the test positions of each (subdivided) cell
+                    for (int cz = 0; cz < subdivisions; cz++)
+                    {
+                        for (int cy = 0; cy < subdivisions; cy++)
+                        {
+                            for (int cx = 0; cx < subdivisions; cx++)
+                            {
+                                float3 cellOffset = { (float)cx, (float)cy, (float)cz };
+                                int3 cellCoords = { (baseProbeCoords.x * subdivisions) + cx, (baseProbeCoords.y * subdivisions) + cy, (baseProbeCoords.z * subdivisions) + cz };
+
+                                uint8_t mask = 0;
+                                for (int probeIndex = 0; probeIndex < 8; probeIndex++)
+                                {
+                                    if (!adjacentProbeActive[probeIndex]) continue;
+                                    for (const float3& sample : samples)
+                                    {
+                                        // Get the world position of the test position
+                                        float3 alpha = Mul(Add(cellOffset, sample), 1.f / (float)subdivisions);
+                                        float3 offset = Mul(alpha, volume.probeSpacing);
+                                        if (!IsVolumeMovementScrolling(volume)) offset = RTXGIQuaternionRotate(offset, volume.rotation);
+                                        float3 position = Add(baseProbeWorldPosition, offset);
+
+                                        float weight = GetProbeVisibilityWeight(position, adjacentProbeWorldPositions[probeIndex], adjacentProbeIndices[probeIndex], volume, *resources.probeDistance);
+                                        if (weight > desc.visibilityThreshold)
+                                        {
+                                            mask |= (uint8_t)(1 << probeIndex);
+                                            break;
+                                        }
+                                    }
+                                }
+                                masks.masks[(size_t)(cellCoords.x + (masks.cellCounts.x * (cellCoords.y + (masks.cellCounts.y * cellCoords.z))))] = mask;
+                            }
+                        }
+                    }
+                }
+            });
+
+            return ERTXGIStatus::OK;
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/Parallel_CPU.h"
+#include "rtxgi/ddgi/cpu/SIMD_CPU.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        uint32_t GetHardwareThreadCount()
+        {
+            return std::max(1u, std::thread::hardware_concurrency());
+        }
+
+        const char* GetSIMDName()
+        {
+            return RTXGI_CPU_SIMD_NAME;
+        }
+
+        uint32_t GetSIMDWidth()
+        {
+            return (uint32_t)simd::Width;
+        }
+
+        void ParallelFor(uint32_t count, uint32_t chunkSize, uint32_t numThreads, const std::function<void(uint32_t begin, uint32_t end)>& func)
+        {
+            if (count == 0) return;
+
+            chunkSize = std::max(1u, chunkSize);
+            uint32_t numChunks = (count + chunkSize - 1) / chunkSize;
+
+            if (numThreads == 0) numThreads = GetHardwareThreadCount();
+            numThreads = std::min(numThreads, numChunks);
+
+            // Threads pull chunks from a shared counter until all chunks are processed
+            std::atomic<uint32_t> nextChunk(0);
+            auto worker = [&]()
+            {
+                for (uint32_t chunk = nextChunk++; chunk < numChunks; chunk = nextChunk++)
+                {
+                    uint32_t begin = chunk * chunkSize;
+                    func(begin, std::min(begin + chunkSize, count));
+                }
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads - 1);
+            for (uint32_t threadIndex = 1; threadIndex < numThreads; threadIndex++) threads.emplace_back(worker);
+
+            worker();
+            for (std::thread& thread : threads) thread.join();
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
@@ -0,0 +1,582 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/DDGIVolume_CPU.h"
+#include "rtxgi/ddgi/cpu/Parallel_CPU.h"
+#include "rtxgi/ddgi/cpu/SIMD_CPU.h"
+
+#include <vector>
+
+// CPU implementation of shaders/ddgi/ProbeBlendingCS.hlsl.
+// The GPU dispatches one thread per probe texel; here probes are distributed across threads and each probe is
+// updated in turn: interior texels are blended first, then the border texels are copied (matching the barrier
+// before UpdateBorderTexel()). The ray blending loops are vectorized over texels (SIMD width texels at a time),
+// and each texel accumulates its rays in the same order as the scalar loop, so results do not depend on the
+// SIMD width or the number of threads.
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        // Number of probes each thread updates at a time
+        static const uint32_t c_probesPerChunk = 8;
+
+        /**
+         * Directions stored as structures of arrays, padded to a multiple of the SIMD width with zero vectors.
+         */
+        struct DirectionsSoA
+        {
+            std::vector<float> x;
+            std::vector<float> y;
+            std::vector<float> z;
+
+            void Resize(int numSlots)
+            {
+                size_t size = (size_t)simd::AlignToWidth(numSlots);
+                x.assign(size, 0.f);
+                y.assign(size, 0.f);
+                z.assign(size, 0.f);
+            }
+
+            void Set(uint32_t slot, const float3& direction)
+            {
+                x[slot] = direction.x;
+                y[slot] = direction.y;
+                z[slot] = direction.z;
+            }
+        };
+
+        /**
+         * Octahedral directions of a probe's interior texels, ordered in tiles of SIMD width texels (e.g. 4x2 for AVX2).
+         * Neighboring texels have similar directions, so a tile's texels tend to receive (or not receive) the same rays.
+         */
+        struct TexelDirections : DirectionsSoA
+        {
+            std::vector<uint32_t> slots;                    // The slot of each texel, indexed by (ty * numInteriorTexels) + tx
+        };
+        /**
+         * Per-volume lookup tables shared by all probe updates.
+         */
+        struct BlendingTables
+        {
+            DirectionsSoA rayDirections;                    // Probe ray directions (the same for every probe in the volume)
+            TexelDirections irradianceTexelDirections;      // Octahedral direction of each interior irradiance texel
+            TexelDirections distanceTexelDirections;        // Octahedral direction of each interior distance texel
+        };
+
+        /**
+         * Per-thread scratch memory for a single probe update.
+         */
+        struct BlendingScratch
+        {
+            std::vector<float> rayRadianceR;
+            std::vector<float> rayRadianceG;
+            std::vector<float> rayRadianceB;
+            std::vector<float> rayWeightMask;               // 0 for backface hits, 1 otherwise
+            std::vector<float> rayDistance;
+
+            std::vector<float> resultX;                     // Per texel weighted sums
+            std::vector<float> resultY;
+            std::vector<float> resultZ;
+            std::vector<float> resultW;
+
+            void Allocate(int numRays, size_t numSlots)
+            {
+                rayRadianceR.resize((size_t)numRays);
+                rayRadianceG.resize((size_t)numRays);
+                rayRadianceB.resize((size_t)numRays);
+                rayWeightMask.resize((size_t)numRays);
+                rayDistance.resize((size_t)numRays);
+
+                resultX.resize(numSlots);
+                resultY.resize(numSlots);
+                resultZ.resize(numSlots);
+                resultW.resize(numSlots);
+            }
+        };
+
+        //------------------------------------------------------------------------
+        // Private Helper Functions
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes the octahedral direction of each interior texel of a probe.
+         */
+        void GetTexelDirections(int numInteriorTexels, TexelDirections& directions)
+        {
+            const int tileWidth = (simd::Width >= 8) ? 4 : ((simd::Width >= 4) ? 2 : 1);
+            const int tileHeight = simd::Width / tileWidth;
+            const int numTilesX = (numInteriorTexels + tileWidth - 1) / tileWidth;
+            const int numTilesY = (numInteriorTexels + tileHeight - 1) / tileHeight;
+
+            directions.Resize(numTilesX * numTilesY * simd::Width);
+            directions.slots.resize((size_t)(numInteriorTexels * numInteriorTexels));
+            for (int ty = 0; ty < numInteriorTexels; ty++)
+            {
+                for (int tx = 0; tx < numInteriorTexels; tx++)
+                {
+                    int tileIndex = ((ty / tileHeight) * numTilesX) + (tx / tileWidth);
+                    int lane = ((ty % tileHeight) * tileWidth) + (tx % tileWidth);
+                    uint32_t slot = (uint32_t)((tileIndex * simd::Width) + lane);
+
+                    float2 probeOctantUV = DDGIGetNormalizedOctahedralCoordinates(tx, ty, numInteriorTexels);
+                    directions.Set(slot, DDGIGetOctahedralDirection(probeOctantUV));
+                    directions.slots[(size_t)((ty * numInteriorTexels) + tx)] = slot;
+                }
+            }
+        }
+
+        /**
+         * Computes the cosine weight (clamped to zero) between SIMD width texel directions and a ray direction.
+         */
+        inline simd::vfloat GetRayWeight(const simd::vfloat& texelX, const simd::vfloat& texelY, const simd::vfloat& texelZ, const DirectionsSoA& rayDirections, size_t rayIndex)
+        {
+            simd::vfloat dot = simd::Add(simd::Add(
+                simd::Mul(texelX, simd::Set1(rayDirections.x[rayIndex])),
+                simd::Mul(texelY, simd::Set1(rayDirections.y[rayIndex]))),
+                simd::Mul(texelZ, simd::Set1(rayDirections.z[rayIndex])));
+            return simd::Max(simd::Set1(0.f), dot);
+        }
+
+        /**
+         * Returns true if the probe is on a plane of probes that scrolled this update and needs to be cleared.
+         */
+        bool IsProbeScrollCleared(int probeIndex, const DDGIVolumeDescGPU& volume)
+        {
+            if (!IsVolumeMovementScrolling(volume)) return false;
+
+            int3 probeCoords = DDGIGetProbeCoords(probeIndex, volume);
+
+            bool scrollClear = false;
+            scrollClear |= DDGIClearScrolledPlane(probeCoords, 0, volume);
+            scrollClear |= DDGIClearScrolledPlane(probeCoords, 1, volume);
+            scrollClear |= DDGIClearScrolledPlane(probeCoords, 2, volume);
+            return scrollClear;
+        }
+
+        /**
+         * Returns true if enough of the probe's random rays hit backfaces that the probe is likely inside geometry.
+         * Matches the early out in the radiance blending loop of ProbeBlendingCS.hlsl.
+         */
+        bool IsProbeInsideGeometry(int probeIndex, int rayStart, const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData)
+        {
+            uint32_t backfaces = 0;
+            uint32_t maxBackfaces = (uint32_t)((float)(volume.probeNumRays - rayStart) * volume.probeRandomRayBackfaceThreshold);
+            for (int rayIndex = rayStart; rayIndex < volume.probeNumRays; rayIndex++)
+            {
+                if (rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volume)].w < 0.f)
+                {
+                    backfaces++;
+                    if (backfaces >= maxBackfaces) return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Clears the probe's interior texels to black.
+         */
+        void ClearProbeTexels(Texture2DArray& output, const uint3& probeTexCoords, int numInteriorTexels)
+        {
+            uint32_t numTexels = (uint32_t)numInteriorTexels + 2;
+            for (uint32_t y = 1; y <= (uint32_t)numInteriorTexels; y++)
+            {
+                for (uint32_t x = 1; x <= (uint32_t)numInteriorTexels; x++)
+                {
+                    output.Texel((probeTexCoords.x * numTexels) + x, (probeTexCoords.y * numTexels) + y, probeTexCoords.z) = { 0.f, 0.f, 0.f, 1.f };
+                }
+            }
+        }
+
+        /**
+         * Updates the probe's 1-texel border with the latest blended information for later use in bilinear filtering.
+         * Mirrors UpdateBorderTexel() in ProbeBlendingCS.hlsl.
+         */
+        void UpdateProbeBorderTexels(Texture2DArray& output, const uint3& probeTexCoords, int numInteriorTexels)
+        {
+            uint32_t numTexels = (uint32_t)numInteriorTexels + 2;
+            uint32_t baseX = probeTexCoords.x * numTexels;
+            uint32_t baseY = probeTexCoords.y * numTexels;
+
+            for (uint32_t ty = 0; ty < numTexels; ty++)
+            {
+                for (uint32_t tx = 0; tx < numTexels; tx++)
+                {
+                    bool isBorderTexel = (tx == 0 || tx == (numTexels - 1) || ty == 0 || ty == (numTexels - 1));
+                    if (!isBorderTexel) continue;
+
+                    bool isCornerTexel = (tx == 0 || tx == (numTexels - 1)) && (ty == 0 || ty == (numTexels - 1));
+                    bool isRowTexel = (tx > 0 && tx < (numTexels - 1));
+
+                    uint32_t copyX = baseX;
+                    uint32_t copyY = baseY;
+                    if (isCornerTexel)
+                    {
+                        copyX += (tx > 0) ? 1 : (uint32_t)numInteriorTexels;
+                        copyY += (ty > 0) ? 1 : (uint32_t)numInteriorTexels;
+                    }
+                    else if (isRowTexel)
+                    {
+                        copyX += (numTexels - 1) - tx;
+                        copyY += (ty > 0) ? (ty - 1) : (ty + 1);
+                    }
+                    else // Column Texel
+                    {
+                        copyX += (tx > 0) ? (tx - 1) : (tx + 1);
+                        copyY += (numTexels - 1) - ty;
+                    }
+
+                    output.Texel(baseX + tx, baseY + ty, probeTexCoords.z) = output.Texel(copyX, copyY, probeTexCoords.z);
+                }
+            }
+        }
+
+        /**
+         * Blends the probe's ray radiance into its irradiance texels.
+         * Returns the mean coefficient of variation of the probe's texels.
+         */
+        float BlendProbeIrradiance(
+            int probeIndex,
+            const uint3& probeTexCoords,
+            int rayStart,
+            float probeHysteresis,
+            const BlendingTables& tables,
+            BlendingScratch& scratch,
+            const DDGIVolumeDescGPU& volume,
+            DDGIVolume& ddgiVolume,
+            bool& wasCleared)
+        {
+            const Texture2DArray& rayData = ddgiVolume.GetProbeRayData();
+            Texture2DArray& output = ddgiVolume.GetProbeIrradiance();
+            Texture2DArray& variability = ddgiVolume.GetProbeVariability();
+
+            const int numInteriorTexels = volume.probeNumIrradianceInteriorTexels;
+            const uint32_t numTexels = (uint32_t)numInteriorTexels + 2;
+
+            // When darkening, step at least the minimum value a 10-bit/channel format can represent
+            static const float c_threshold = 1.f / 1024.f;
+
+            float epsilon = (float)(volume.probeNumRays - rayStart) * 1e-9f;
+
+            float coefficientOfVariationSum = 0.f;
+            wasCleared = false;
+
+            // Load the probe's ray radiance. Backface hits are skipped by zeroing their weight.
+            for (int rayIndex = rayStart; rayIndex < volume.probeNumRays; rayIndex++)
+            {
+                const float4& ray = rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volume)];
+                bool backface = (ray.w < 0.f);
+                scratch.rayRadianceR[(size_t)rayIndex] = backface ? 0.f : ray.x;
+                scratch.rayRadianceG[(size_t)rayIndex] = backface ? 0.f : ray.y;
+                scratch.rayRadianceB[(size_t)rayIndex] = backface ? 0.f : ray.z;
+                scratch.rayWeightMask[(size_t)rayIndex] = backface ? 0.f : 1.f;
+            }
+
+            // Blend each ray's radiance into SIMD width texels at a time
+            const TexelDirections& texelDirections = tables.irradianceTexelDirections;
+            for (size_t texelIndex = 0; texelIndex < texelDirections.x.size(); texelIndex += simd::Width)
+            {
+                simd::vfloat texelX = simd::Load(&texelDirections.x[texelIndex]);
+                simd::vfloat texelY = simd::Load(&texelDirections.y[texelIndex]);
+                simd::vfloat texelZ = simd::Load(&texelDirections.z[texelIndex]);
+
+                simd::vfloat resultR = simd::Set1(0.f);
+                simd::vfloat resultG = simd::Set1(0.f);
+                simd::vfloat resultB = simd::Set1(0.f);
+                simd::vfloat resultW = simd::Set1(0.f);
+                for (size_t rayIndex = (size_t)rayStart; rayIndex < (size_t)volume.probeNumRays; rayIndex++)
+                {
+                    simd::vfloat weight = simd::Mul(GetRayWeight(texelX, texelY, texelZ, tables.rayDirections, rayIndex), simd::Set1(scratch.rayWeightMask[rayIndex]));
+
+                    // Skip rays facing away from all of the texels (adding zero doesn't change the sums)
+                    if (simd::MoveMask(simd::Greater(weight, simd::Set1(0.f))) == 0) continue;
+
+                    resultR = simd::Add(resultR, simd::Mul(simd::Set1(scratch.rayRadianceR[rayIndex]), weight));
+                    resultG = simd::Add(resultG, simd::Mul(simd::Set1(scratch.rayRadianceG[rayIndex]), weight));
+                    resultB = simd::Add(resultB, simd::Mul(simd::Set1(scratch.rayRadianceB[rayIndex]), weight));
+                    resultW = simd::Add(resultW, weight);
+                }
+
+                simd::Store(&scratch.resultX[texelIndex], resultR);
+                simd::Store(&scratch.resultY[texelIndex], resultG);
+                simd::Store(&scratch.resultZ[texelIndex], resultB);
+                simd::Store(&scratch.resultW[texelIndex], resultW);
+            }
+
+            for (int ty = 0; ty < numInteriorTexels; ty++)
+            {
+                for (int tx = 0; tx < numInteriorTexels; tx++)
+                {
+                    size_t texelIndex = texelDirections.slots[(size_t)((ty * numInteriorTexels) + tx)];
+                    float4 result = { scratch.resultX[texelIndex], scratch.resultY[texelIndex], scratch.resultZ[texelIndex], scratch.resultW[texelIndex] };
+
+                    // Normalize the blended irradiance (see ProbeBlendingCS.hlsl for the factor of 1/2)
+                    float normalization = 1.f / (2.f * std::fmax(result.w, epsilon));
+                    float3 irradiance = { result.x * normalization, result.y * normalization, result.z * normalization };
+
+                    float4& texel = output.Texel((probeTexCoords.x * numTexels) + 1 + (uint32_t)tx, (probeTexCoords.y * numTexels) + 1 + (uint32_t)ty, probeTexCoords.z);
+                    float3 probeIrradianceMean = { texel.x, texel.y, texel.z };
+
+                    // If the probe was previously cleared to completely black, set the hysteresis to zero
+                    float hysteresis = probeHysteresis;
+                    if (Dot3(probeIrradianceMean, probeIrradianceMean) == 0.f)
+                    {
+                        hysteresis = 0.f;
+                        wasCleared = true;
+                    }
+
+                    // Tone-mapping gamma adjustment
+                    float exponent = 1.f / volume.probeIrradianceEncodingGamma;
+                    irradiance = { powf(irradiance.x, exponent), powf(irradiance.y, exponent), powf(irradiance.z, exponent) };
+
+                    // Get the difference between the current irradiance and the irradiance mean stored in the probe
+                    float3 delta = Sub(irradiance, probeIrradianceMean);
+
+                    // Lower the hysteresis when a large lighting change is detected
+                    if (RTXGIMaxComponent(Sub(probeIrradianceMean, irradiance)) > volume.probeIrradianceThreshold)
+                    {
+                        hysteresis = std::fmax(0.f, hysteresis - 0.75f);
+                    }
+
+                    // Clamp the maximum per-update change in irradiance when a large brightness change is detected
+                    if (RTXGILinearRGBToLuminance(delta) > volume.probeBrightnessThreshold)
+                    {
+                        delta = Mul(delta, 0.25f);
+                    }
+
+                    // Interpolate the new blended irradiance with the existing irradiance in the probe
+                    float3 lerpDelta = Mul(delta, (1.f - hysteresis));
+                    if (RTXGIMaxComponent(irradiance) < RTXGIMaxComponent(probeIrradianceMean))
+                    {
+                        for (size_t c = 0; c < 3; c++)
+                        {
+                            float sign = (lerpDelta[c] > 0.f) ? 1.f : ((lerpDelta[c] < 0.f) ? -1.f : 0.f);
+                            lerpDelta[c] = std::fmin(std::fmax(c_threshold, fabsf(lerpDelta[c])), fabsf(delta[c])) * sign;
+                        }
+                    }
+                    float3 irradianceMean = Add(probeIrradianceMean, lerpDelta);
+
+                    // Compute the coefficient of variation
+                    float3 irradianceSigma2 = Mul(Sub(irradiance, probeIrradianceMean), Sub(irradiance, irradianceMean));
+                    float  luminanceSigma2 = RTXGILinearRGBToLuminance(irradianceSigma2);
+                    float  luminanceMean = RTXGILinearRGBToLuminance(irradianceMean);
+                    float  coefficientOfVariation = (luminanceMean <= c_threshold) ? 0.f : sqrtf(std::fmax(luminanceSigma2, 0.f)) / luminanceMean;
+                    coefficientOfVariationSum += coefficientOfVariation;
+
+                    if (volume.probeVariabilityEnabled)
+                    {
+                        variability.Texel((probeTexCoords.x * (uint32_t)numInteriorTexels) + (uint32_t)tx, (probeTexCoords.y * (uint32_t)numInteriorTexels) + (uint32_t)ty, probeTexCoords.z).x = coefficientOfVariation;
+                    }
+
+                    texel = { irradianceMean.x, irradianceMean.y, irradianceMean.z, 1.f };
+                }
+            }
+
+            return coefficientOfVariationSum / (float)(numInteriorTexels * numInteriorTexels);
+        }
+
+        /**
+         * Blends the probe's ray hit distances into its filtered distance texels.
+         */
+        void BlendProbeDistance(
+            int probeIndex,
+            const uint3& probeTexCoords,
+            int rayStart,
+            float probeHysteresis,
+            const BlendingTables& tables,
+            BlendingScratch& scratch,
+            const DDGIVolumeDescGPU& volume,
+            DDGIVolume& ddgiVolume)
+        {
+            const Texture2DArray& rayData = ddgiVolume.GetProbeRayData();
+            Texture2DArray& output = ddgiVolume.GetProbeDistance();
+
+            const int numInteriorTexels = volume.probeNumDistanceInteriorTexels;
+            const uint32_t numTexels = (uint32_t)numInteriorTexels + 2;
+
+            // Initialize the max probe hit distance to 50% larger the maximum distance between probe grid cells
+            float probeMaxRayDistance = Length3(volume.probeSpacing) * 1.5f;
+
+            float epsilon = (float)(volume.probeNumRays - rayStart) * 1e-9f;
+
+            // Load the probe's ray hit distances. Hit distance is negative on backface hits (for probe relocation), so take the absolute value.
+            for (int rayIndex = rayStart; rayIndex < volume.probeNumRays; rayIndex++)
+            {
+                scratch.rayDistance[(size_t)rayIndex] = std::fmin(fabsf(rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volume)].w), probeMaxRayDistance);
+            }
+
+            // Blend each ray's distance into SIMD width texels at a time
+            const TexelDirections& texelDirections = tables.distanceTexelDirections;
+            simd::vfloat exponent = simd::Set1(volume.probeDistanceExponent);
+
+            // Weights below the cutoff are zero after raising them to the exponent (with margin for the approximation error of Pow())
+            float weightCutoff = 0.f;
+            if (volume.probeDistanceExponent > 0.f) weightCutoff = expf(simd::ExpUnderflow / volume.probeDistanceExponent) * 0.999f;
+            for (size_t texelIndex = 0; texelIndex < texelDirections.x.size(); texelIndex += simd::Width)
+            {
+                simd::vfloat texelX = simd::Load(&texelDirections.x[texelIndex]);
+                simd::vfloat texelY = simd::Load(&texelDirections.y[texelIndex]);
+                simd::vfloat texelZ = simd::Load(&texelDirections.z[texelIndex]);
+
+                simd::vfloat resultX = simd::Set1(0.f);
+                simd::vfloat resultY = simd::Set1(0.f);
+                simd::vfloat resultW = simd::Set1(0.f);
+                for (size_t rayIndex = (size_t)rayStart; rayIndex < (size_t)volume.probeNumRays; rayIndex++)
+                {
+                    simd::vfloat weight = GetRayWeight(texelX, texelY, texelZ, tables.rayDirections, rayIndex);
+
+                    // Skip rays with zero weight for all of the texels (adding zero doesn't change the sums)
+                    if (simd::MoveMask(simd::Greater(weight, simd::Set1(weightCutoff))) == 0) continue;
+
+                    // Increase or decrease the filtered distance value's "sharpness"
+                    weight = simd::Pow(weight, exponent);
+
+                    simd::vfloat probeRayDistance = simd::Set1(scratch.rayDistance[rayIndex]);
+                    resultX = simd::Add(resultX, simd::Mul(probeRayDistance, weight));
+                    resultY = simd::Add(resultY, simd::Mul(simd::Mul(probeRayDistance, probeRayDistance), weight));
+                    resultW = simd::Add(resultW, weight);
+                }
+
+                simd::Store(&scratch.resultX[texelIndex], resultX);
+                simd::Store(&scratch.resultY[texelIndex], resultY);
+                simd::Store(&scratch.resultW[texelIndex], resultW);
+            }
+
+            for (int ty = 0; ty < numInteriorTexels; ty++)
+            {
+                for (int tx = 0; tx < numInteriorTexels; tx++)
+                {
+                    size_t texelIndex = texelDirections.slots[(size_t)((ty * numInteriorTexels) + tx)];
+                    float4 result = { scratch.resultX[texelIndex], scratch.resultY[texelIndex], 0.f, scratch.resultW[texelIndex] };
+
+                    float normalization = 1.f / (2.f * std::fmax(result.w, epsilon));
+                    result.x *= normalization;
+                    result.y *= normalization;
+
+                    float4& texel = output.Texel((probeTexCoords.x * numTexels) + 1 + (uint32_t)tx, (probeTexCoords.y * numTexels) + 1 + (uint32_t)ty, probeTexCoords.z);
+
+                    // If the probe was previously cleared to completely black, set the hysteresis to zero
+                    float hysteresis = probeHysteresis;
+                    if ((texel.x * texel.x) + (texel.y * texel.y) + (texel.z * texel.z) == 0.f) hysteresis = 0.f;
+
+                    // Interpolate the new filtered distance with the existing filtered distance in the probe
+                    texel = { result.x + (texel.x - result.x) * hysteresis, result.y + (texel.y - result.y) * hysteresis, 0.f, 1.f };
+                }
+            }
+        }
+
+        /**
+         * Updates a single probe: irradiance, distance, variability, adaptive history, and border texels.
+         */
+        void UpdateProbe(int probeIndex, const BlendingTables& tables, BlendingScratch& scratch, const DDGIVolumeDescGPU& volume, DDGIVolume& ddgiVolume)
+        {
+            uint3 probeTexCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
+
+            float4& probeData = ddgiVolume.GetProbeData()[probeTexCoords];
+            uint32_t history = DDGIDecodeProbeHistory(probeData.w);
+
+            if (IsProbeScrollCleared(probeIndex, volume))
+            {
+                // Early out: this probe has been scrolled and cleared, don't blend
+                ClearProbeTexels(ddgiVolume.GetProbeIrradiance(), probeTexCoords, volume.probeNumIrradianceInteriorTexels);
+                ClearProbeTexels(ddgiVolume.GetProbeDistance(), probeTexCoords, volume.probeNumDistanceInteriorTexels);
+
+                // The probe's lighting is unknown, restart its history as "changing"
+                if (volume.probeAdaptiveHysteresisEnabled) probeData.w = DDGIEncodeProbeData(DDGIDecodeProbeState(probeData.w), DDGI_PROBE_HISTORY_MASK);
+            }
+            else if (DDGILoadProbeState(probeIndex, ddgiVolume.GetProbeData(), volume) == DDGI_PROBE_STATE_INACTIVE)
+            {
+                // Early out: don't blend rays for probes that are inactive
+                Texture2DArray& variability = ddgiVolume.GetProbeVariability();
+                uint32_t numInteriorTexels = (uint32_t)volume.probeNumIrradianceInteriorTexels;
+                for (uint32_t y = 0; y < numInteriorTexels; y++)
+                {
+                    for (uint32_t x = 0; x < numInteriorTexels; x++)
+                    {
+                        variability.Texel((probeTexCoords.x * numInteriorTexels) + x, (probeTexCoords.y * numInteriorTexels) + y, probeTexCoords.z).x = 0.f;
+                    }
+                }
+            }
+            else
+            {
+                // If relocation or classification are enabled, don't blend the fixed rays since they will bias the result
+                int rayStart = 0;
+                if (volume.probeRelocationEnabled || volume.probeClassificationEnabled) rayStart = DDGI_NUM_FIXED_RAYS;
+
+                // With adaptive hysteresis, the irradiance hysteresis follows the probe's variability history
+                float hysteresis = volume.probeHysteresis;
+                if (volume.probeAdaptiveHysteresisEnabled) hysteresis = DDGIGetAdaptiveProbeHysteresis(history, volume);
+
+                // Only blend radiance into the probe if the backface threshold hasn't been exceeded
+                if (!IsProbeInsideGeometry(probeIndex, rayStart, volume, ddgiVolume.GetProbeRayData()))
+                {
+                    bool wasCleared = false;
+                    float coefficientOfVariation = BlendProbeIrradiance(probeIndex, probeTexCoords, rayStart, hysteresis, tables, scratch, volume, ddgiVolume, wasCleared);
+
+                    if (volume.probeAdaptiveHysteresisEnabled)
+                    {
+                        // Record whether this update changed the probe. If the probe's lighting was unknown, restart its history as "changing".
+                        uint32_t changed = (coefficientOfVariation > volume.probeAdaptiveHysteresisThreshold) ? 1 : 0;
+                        history = wasCleared ? DDGI_PROBE_HISTORY_MASK : (((history << 1) | changed) & DDGI_PROBE_HISTORY_MASK);
+                        probeData.w = DDGIEncodeProbeData(DDGIDecodeProbeState(probeData.w), history);
+                    }
+                }
+
+                // Distance blends with the volume's hysteresis. The GPU distance pass runs concurrently with the irradiance pass that updates the history.
+                BlendProbeDistance(probeIndex, probeTexCoords, rayStart, volume.probeHysteresis, tables, scratch, volume, ddgiVolume);
+            }
+
+            // Update the probe's border texels with the latest blended data
+            UpdateProbeBorderTexels(ddgiVolume.GetProbeIrradiance(), probeTexCoords, volume.probeNumIrradianceInteriorTexels);
+            UpdateProbeBorderTexels(ddgiVolume.GetProbeDistance(), probeTexCoords, volume.probeNumDistanceInteriorTexels);
+        }
+
+        //------------------------------------------------------------------------
+        // Public RTXGI CPU namespace DDGIVolume Functions
+        //------------------------------------------------------------------------
+
+        ERTXGIStatus UpdateDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads)
+        {
+            for (uint32_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+            {
+                DDGIVolume* volume = volumes[volumeIndex];
+                DDGIVolumeDescGPU desc = volume->GetDescGPU();
+
+                // Probe ray and texel directions are the same for every probe in the volume
+                BlendingTables tables;
+                tables.rayDirections.Resize(desc.probeNumRays);
+                for (int rayIndex = 0; rayIndex < desc.probeNumRays; rayIndex++)
+                {
+                    tables.rayDirections.Set((uint32_t)rayIndex, DDGIGetProbeRayDirection(rayIndex, desc));
+                }
+                GetTexelDirections(desc.probeNumIrradianceInteriorTexels, tables.irradianceTexelDirections);
+                GetTexelDirections(desc.probeNumDistanceInteriorTexels, tables.distanceTexelDirections);
+
+                size_t numSlots = std::max(tables.irradianceTexelDirections.x.size(), tables.distanceTexelDirections.x.size());
+
+                // Probes only write their own texels, so they can be updated in any order on any thread
+                const std::vector<int>& updateList = volume->GetProbeUpdateList();
+                uint32_t count = updateList.empty() ? (uint32_t)volume->GetNumProbes() : (uint32_t)updateList.size();
+                ParallelFor(count, c_probesPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+                {
+                    BlendingScratch scratch;
+                    scratch.Allocate(desc.probeNumRays, numSlots);
+                    for (uint32_t index = begin; index < end; index++)
+                    {
+                        UpdateProbe(updateList.empty() ? (int)index : updateList[index], tables, scratch, desc, *volume);
+                    }
+                });
+            }
+
+            return ERTXGIStatus::OK;
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
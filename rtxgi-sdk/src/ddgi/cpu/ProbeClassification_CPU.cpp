@@ -0,0 +1,145 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/DDGIVolume_CPU.h"
+#include "rtxgi/ddgi/cpu/Parallel_CPU.h"
+
+#include <algorithm>
+
+// CPU implementation of shaders/ddgi/ProbeClassificationCS.hlsl.
+// Each probe only reads its own fixed rays and writes the state of its own probe data texel, so probes are
+// distributed across threads in any order and results do not depend on the number of threads.
+// Like the shader, probe states are written to the integer part of the W channel only, so the adaptive
+// hysteresis history is preserved.
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        // Number of probes each thread classifies at a time
+        static const uint32_t c_probesPerChunk = 64;
+
+        //------------------------------------------------------------------------
+        // Private Helpers
+        //------------------------------------------------------------------------
+
+        /**
+         * Determines if there is geometry in the probe's voxel from the hit distances of its fixed rays.
+         */
+        int ClassifyProbe(int probeIndex, const float* planeDistances, const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData)
+        {
+            int numRays = std::min(volume.probeNumRays, DDGI_NUM_FIXED_RAYS);
+
+            // Load the hit distances and count the number of backface hits
+            int backfaceCount = 0;
+            float hitDistances[DDGI_NUM_FIXED_RAYS];
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                hitDistances[rayIndex] = rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volume)].w;
+                backfaceCount += (hitDistances[rayIndex] < 0.f) ? 1 : 0;
+            }
+
+            // Early out: number of backface hits has been exceeded. The probe is probably inside geometry.
+            if (((float)backfaceCount / (float)numRays) > volume.probeFixedRayBackfaceThreshold) return DDGI_PROBE_STATE_INACTIVE;
+
+            // If a frontface hit is closer than the closest plane intersection, there is geometry in the probe's voxel
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                if (hitDistances[rayIndex] < 0.f) continue;
+                if (hitDistances[rayIndex] <= planeDistances[rayIndex]) return DDGI_PROBE_STATE_ACTIVE;
+            }
+
+            return DDGI_PROBE_STATE_INACTIVE;
+        }
+
+        /**
+         * Computes the distance along each fixed ray to the closest plane of the probe's voxel.
+         * The shader offsets the planes from the probe's relocated position, which cancels out: distances are the same for every probe.
+         */
+        void GetFixedRayPlaneDistances(const DDGIVolumeDescGPU& volume, float* planeDistances)
+        {
+            for (int rayIndex = 0; rayIndex < DDGI_NUM_FIXED_RAYS; rayIndex++)
+            {
+                float3 direction = DDGIGetProbeRayDirection(rayIndex, volume);
+
+                // The plane normal along each axis points in the direction of the ray
+                float3 distances;
+                for (size_t axis = 0; axis < 3; axis++)
+                {
+                    float normal = direction[axis] / std::max(fabsf(direction[axis]), 0.000001f);
+                    distances[axis] = (volume.probeSpacing[axis] * normal * normal) / std::max(direction[axis] * normal, 0.000001f);
+
+                    // If the ray is parallel to the plane, it will never intersect
+                    if (distances[axis] == 0.f) distances[axis] = 1e27f;
+                }
+
+                planeDistances[rayIndex] = std::min(distances.x, std::min(distances.y, distances.z));
+            }
+        }
+
+        //------------------------------------------------------------------------
+        // Public RTXGI CPU namespace DDGIVolume Functions
+        //------------------------------------------------------------------------
+
+        ERTXGIStatus DDGIClassifyProbes(const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData, Texture2DArray& probeData, uint32_t numThreads, const std::vector<int>* probeIndices)
+        {
+            int numProbes = volume.probeCounts.x * volume.probeCounts.y * volume.probeCounts.z;
+            if (numProbes <= 0 || volume.probeNumRays <= 0) return ERTXGIStatus::ERROR_DDGI_INVALID_PROBE_COUNTS;
+
+            // Probes must have enough ray data and probe data texels
+            uint3 lastRayCoords = DDGIGetRayDataTexelCoords(std::min(volume.probeNumRays, DDGI_NUM_FIXED_RAYS) - 1, numProbes - 1, volume);
+            uint3 lastProbeCoords = DDGIGetProbeTexelCoords(numProbes - 1, volume);
+            if (lastRayCoords.x >= rayData.width || lastRayCoords.y >= rayData.height || lastRayCoords.z >= rayData.arraySize) return ERTXGIStatus::ERROR_DDGI_INVALID_TEXTURE_PROBE_RAY_DATA;
+            if (lastProbeCoords.x >= probeData.width || lastProbeCoords.y >= probeData.height || lastProbeCoords.z >= probeData.arraySize) return ERTXGIStatus::ERROR_DDGI_INVALID_TEXTURE_PROBE_DATA;
+
+            float planeDistances[DDGI_NUM_FIXED_RAYS];
+            GetFixedRayPlaneDistances(volume, planeDistances);
+
+            uint32_t count = probeIndices ? (uint32_t)probeIndices->size() : (uint32_t)numProbes;
+            ParallelFor(count, c_probesPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t index = begin; index < end; index++)
+                {
+                    int probeIndex = probeIndices ? (*probeIndices)[index] : (int)index;
+                    int state = ClassifyProbe(probeIndex, planeDistances, volume, rayData);
+                    DDGIStoreProbeState(probeData, DDGIGetProbeTexelCoords(probeIndex, volume), state);
+                }
+            });
+
+            return ERTXGIStatus::OK;
+        }
+
+        ERTXGIStatus ClassifyDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads)
+        {
+            for (uint32_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+            {
+                DDGIVolume* volume = volumes[volumeIndex];
+                if (!volume->GetProbeClassificationEnabled()) continue;
+
+                if (volume->GetProbeClassificationNeedsReset())
+                {
+                    Texture2DArray& probeData = volume->GetProbeData();
+                    for (float4& texel : probeData.texels)
+                    {
+                        texel.w = DDGIEncodeProbeData(DDGI_PROBE_STATE_ACTIVE, DDGIDecodeProbeHistory(texel.w));
+                    }
+                    volume->SetProbeClassificationNeedsReset(false);
+                }
+
+                const std::vector<int>& updateList = volume->GetProbeUpdateList();
+                ERTXGIStatus status = DDGIClassifyProbes(volume->GetDescGPU(), volume->GetProbeRayData(), volume->GetProbeData(), numThreads, updateList.empty() ? nullptr : &updateList);
+                if (status != ERTXGIStatus::OK) return status;
+            }
+
+            return ERTXGIStatus::OK;
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
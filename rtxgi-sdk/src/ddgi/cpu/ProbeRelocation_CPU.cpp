@@ -0,0 +1,194 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "rtxgi/ddgi/cpu/DDGIVolume_CPU.h"
+#include "rtxgi/ddgi/cpu/Parallel_CPU.h"
+
+#include <algorithm>
+
+// CPU implementation of shaders/ddgi/ProbeRelocationCS.hlsl.
+// Each probe only reads its own fixed rays and writes its own probe data texel, so probes are distributed
+// across threads in any order and results do not depend on the number of threads.
+
+namespace rtxgi
+{
+    namespace cpu
+    {
+        // Number of probes each thread relocates at a time
+        static const uint32_t c_probesPerChunk = 64;
+
+        //------------------------------------------------------------------------
+        // Private Helpers
+        //------------------------------------------------------------------------
+
+        /**
+         * Computes the new world-space offset of a probe from the hit distances of its fixed rays.
+         */
+        float3 RelocateProbe(int probeIndex, const float3* fixedRayDirections, const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData, const Texture2DArray& probeData)
+        {
+            // Read the current world position offset
+            float3 offset = DDGILoadProbeDataOffset(probeData, DDGIGetProbeTexelCoords(probeIndex, volume), volume);
+
+            int   closestBackfaceIndex = -1;
+            int   closestFrontfaceIndex = -1;
+            int   farthestFrontfaceIndex = -1;
+            float closestBackfaceDistance = 1e27f;
+            float closestFrontfaceDistance = 1e27f;
+            float farthestFrontfaceDistance = 0.f;
+            float backfaceCount = 0.f;
+
+            // Iterate over the fixed rays to find the number of backfaces and closest/farthest distances to the probe
+            int numRays = std::min(volume.probeNumRays, DDGI_NUM_FIXED_RAYS);
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                float hitDistance = rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volume)].w;
+                if (hitDistance < 0.f)
+                {
+                    backfaceCount++;
+
+                    // Negate the hit distance on a backface hit and scale back to the full distance
+                    hitDistance = hitDistance * -5.f;
+                    if (hitDistance < closestBackfaceDistance)
+                    {
+                        closestBackfaceDistance = hitDistance;
+                        closestBackfaceIndex = rayIndex;
+                    }
+                }
+                else
+                {
+                    // Matches the shader: the closest frontface is never also considered the farthest
+                    if (hitDistance < closestFrontfaceDistance)
+                    {
+                        closestFrontfaceDistance = hitDistance;
+                        closestFrontfaceIndex = rayIndex;
+                    }
+                    else if (hitDistance > farthestFrontfaceDistance)
+                    {
+                        farthestFrontfaceDistance = hitDistance;
+                        farthestFrontfaceIndex = rayIndex;
+                    }
+                }
+            }
+
+            float3 fullOffset = { 1e27f, 1e27f, 1e27f };
+            if (closestBackfaceIndex != -1 && (backfaceCount / (float)numRays) > volume.probeFixedRayBackfaceThreshold)
+            {
+                // Backfaces are hit by enough probe rays, assume the probe is inside geometry and move it outside
+                float3 closestBackfaceDirection = fixedRayDirections[closestBackfaceIndex];
+                fullOffset = Add(offset, Mul(closestBackfaceDirection, closestBackfaceDistance + (volume.probeMinFrontfaceDistance * 0.5f)));
+            }
+            else if (closestFrontfaceDistance < volume.probeMinFrontfaceDistance)
+            {
+                // Don't move the probe if moving towards the farthest frontface will also bring us closer to the nearest frontface.
+                // The shader reads an undefined direction when there is no farthest frontface, the probe is not moved instead.
+                if (farthestFrontfaceIndex != -1)
+                {
+                    float3 closestFrontfaceDirection = fixedRayDirections[closestFrontfaceIndex];
+                    float3 farthestFrontfaceDirection = fixedRayDirections[farthestFrontfaceIndex];
+                    if (Dot3(closestFrontfaceDirection, farthestFrontfaceDirection) <= 0.f)
+                    {
+                        // Ensures the probe never moves through the farthest frontface
+                        fullOffset = Add(offset, Mul(farthestFrontfaceDirection, std::min(farthestFrontfaceDistance, 1.f)));
+                    }
+                }
+            }
+            else if (closestFrontfaceDistance > volume.probeMinFrontfaceDistance)
+            {
+                // Probe isn't near anything, try to move it back towards zero offset.
+                // A zero offset has no direction (NaN in the shader, which rejects the offset below), so it stays at zero.
+                float offsetLength = Length3(offset);
+                if (offsetLength > 0.f)
+                {
+                    float moveBackMargin = std::min(closestFrontfaceDistance - volume.probeMinFrontfaceDistance, offsetLength);
+                    fullOffset = Add(offset, Mul(offset, -moveBackMargin / offsetLength));
+                }
+            }
+
+            // Absolute maximum distance that probe could be moved should satisfy ellipsoid equation:
+            // x^2 / probeGridSpacing.x^2 + y^2 / probeGridSpacing.y^2 + z^2 / probeGridSpacing.y^2 < (0.5)^2
+            // Clamp to less than maximum distance to avoid degenerate cases
+            float3 normalizedOffset = { fullOffset.x / volume.probeSpacing.x, fullOffset.y / volume.probeSpacing.y, fullOffset.z / volume.probeSpacing.z };
+            if (Dot3(normalizedOffset, normalizedOffset) < 0.2025f) // 0.45 * 0.45 == 0.2025
+            {
+                offset = fullOffset;
+            }
+            return offset;
+        }
+
+        /**
+         * Resets the world-space offsets of all probes to zero. Probe states and history are not modified.
+         */
+        void ResetProbeOffsets(Texture2DArray& probeData)
+        {
+            for (float4& texel : probeData.texels)
+            {
+                texel.x = texel.y = texel.z = 0.f;
+            }
+        }
+
+        //------------------------------------------------------------------------
+        // Public RTXGI CPU namespace DDGIVolume Functions
+        //------------------------------------------------------------------------
+
+        ERTXGIStatus DDGIRelocateProbes(const DDGIVolumeDescGPU& volume, const Texture2DArray& rayData, Texture2DArray& probeData, uint32_t numThreads, const std::vector<int>* probeIndices)
+        {
+            int numProbes = volume.probeCounts.x * volume.probeCounts.y * volume.probeCounts.z;
+            if (numProbes <= 0 || volume.probeNumRays <= 0) return ERTXGIStatus::ERROR_DDGI_INVALID_PROBE_COUNTS;
+
+            // Probes must have enough ray data and probe data texels
+            uint3 lastRayCoords = DDGIGetRayDataTexelCoords(std::min(volume.probeNumRays, DDGI_NUM_FIXED_RAYS) - 1, numProbes - 1, volume);
+            uint3 lastProbeCoords = DDGIGetProbeTexelCoords(numProbes - 1, volume);
+            if (lastRayCoords.x >= rayData.width || lastRayCoords.y >= rayData.height || lastRayCoords.z >= rayData.arraySize) return ERTXGIStatus::ERROR_DDGI_INVALID_TEXTURE_PROBE_RAY_DATA;
+            if (lastProbeCoords.x >= probeData.width || lastProbeCoords.y >= probeData.height || lastProbeCoords.z >= probeData.arraySize) return ERTXGIStatus::ERROR_DDGI_INVALID_TEXTURE_PROBE_DATA;
+
+            // Fixed ray directions are not rotated, so they are the same for every probe and frame
+            float3 fixedRayDirections[DDGI_NUM_FIXED_RAYS];
+            for (int rayIndex = 0; rayIndex < DDGI_NUM_FIXED_RAYS; rayIndex++)
+            {
+                fixedRayDirections[rayIndex] = DDGIGetProbeRayDirection(rayIndex, volume);
+            }
+
+            uint32_t count = probeIndices ? (uint32_t)probeIndices->size() : (uint32_t)numProbes;
+            ParallelFor(count, c_probesPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t index = begin; index < end; index++)
+                {
+                    int probeIndex = probeIndices ? (*probeIndices)[index] : (int)index;
+                    float3 offset = RelocateProbe(probeIndex, fixedRayDirections, volume, rayData, probeData);
+                    DDGIStoreProbeDataOffset(probeData, DDGIGetProbeTexelCoords(probeIndex, volume), offset, volume);
+                }
+            });
+
+            return ERTXGIStatus::OK;
+        }
+
+        ERTXGIStatus RelocateDDGIVolumeProbes(uint32_t numVolumes, DDGIVolume** volumes, uint32_t numThreads)
+        {
+            for (uint32_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+            {
+                DDGIVolume* volume = volumes[volumeIndex];
+                if (!volume->GetProbeRelocationEnabled()) continue;
+
+                if (volume->GetProbeRelocationNeedsReset())
+                {
+                    ResetProbeOffsets(volume->GetProbeData());
+                    volume->SetProbeRelocationNeedsReset(false);
+                }
+
+                const std::vector<int>& updateList = volume->GetProbeUpdateList();
+                ERTXGIStatus status = DDGIRelocateProbes(volume->GetDescGPU(), volume->GetProbeRayData(), volume->GetProbeData(), numThreads, updateList.empty() ? nullptr : &updateList);
+                if (status != ERTXGIStatus::OK) return status;
+            }
+
+            return ERTXGIStatus::OK;
+        }
+
+    } // namespace cpu
+} // namespace rtxgi
@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "BVH.h"
+#include "Configs.h"
+#include "Samplers.h"
+#include "Scenes.h"
+
+#include <rtxgi/ddgi/cpu/DDGIVolume_CPU.h>
+
+#include <string>
+#include <vector>
+
+// Bakes the DDGIVolumes of a Test Harness scene on the CPU: probe rays are traced against the scene BVH and shaded
+// with the scene's lights and the volume's own irradiance (the same multi-bounce feedback as the harness' ProbeTraceRGS).
+namespace Bake
+{
+    struct Settings
+    {
+        std::string outputPath = "";            // Empty: the scene's screenshot path
+        uint32_t    maxIterations = 256;
+        uint32_t    minIterations = 8;
+        float       variabilityThreshold = -1.f; // Negative: use each volume's configured variability threshold
+        uint32_t    numThreads = 0;             // 0: use all hardware threads
+        bool        probeBVHs = true;           // Trace probe rays with per-probe BVHs instead of per ray scene BVH traversal
+        bool        wavefront = false;          // Trace and shade probe rays in sorted stages instead of ray after ray (see Context::wavefront)
+        float       proxyRatio = -1.f;          // Trace probe rays against proxy meshes with this fraction of the triangles (0: full geometry, negative: the config's scene.proxyRatio)
+        uint32_t    relightUpdates = 0;         // Relight-only probe updates after the bake (a time-of-day sweep of the directional light)
+        int         editInstance = -1;          // Scene instance moved after the bake, only the probes it can change are re-baked (negative: none)
+        rtxgi::float3 editOffset = { 0.f, 0.f, 0.f };
+        bool        editCheck = false;          // Compare the incremental re-bake with a full re-bake of the edited scene
+        uint32_t    numWorkers = 0;             // Worker processes started by a distributed bake
+        std::string workDirectory = "";         // Distributed bake work directory, shared by the coordinator and its workers
+        uint32_t    blockProbes = 0;            // Probes per distributed work unit (0: about two units per worker and update)
+        std::string workerId = "";              // Run as a worker of the distributed bake in the work directory (a name unique among its workers)
+        uint32_t    failWorkers = 0;            // Terminate a local worker every N updates of a distributed bake, to test restarts (0: never)
+        bool        workersCheck = false;       // Compare a distributed bake with a single process bake
+
+        bool IsDistributed() const { return (numWorkers > 0) || !workDirectory.empty(); }
+    };
+
+    /**
+     * The scene data probe rays are traced against and shaded with.
+     */
+    struct Context
+    {
+        const Scenes::Scene* scene = nullptr;
+        BVH::SceneBVH        bvh;
+        std::vector<Samplers::View> textures;          // Views of the scene's textures, views without mips can't be sampled
+        rtxgi::float3        skyRadiance = { 0.f, 0.f, 0.f };
+        float                rayNormalBias = 0.001f;   // Shadow ray biases
+        float                rayViewBias = 0.001f;
+        bool                 wavefront = false;        // Trace probe rays in stages: rays sorted by direction, hits sorted by material, then shadow rays light after light
+    };
+
+    /**
+     * The surface at a probe ray hit (the CPU counterpart of the hit shaders' payload).
+     */
+    struct Surface
+    {
+        rtxgi::float3 worldPosition;
+        rtxgi::float3 normal;
+        rtxgi::float3 albedo;
+        float         hitT = 0.f;
+        bool          frontFace = true;
+    };
+
+    /**
+     * The probe BVHs of a volume, kept across updates. A probe's BVH is rebuilt when the probe moves (relocation, scrolling).
+     */
+    struct ProbeBVHs
+    {
+        std::vector<BVH::ProbeBVH> probes;      // Indexed by (scroll adjusted) probe index
+    };
+
+    /**
+     * The surfaces a volume's probe rays hit, recorded by a trace and reused by relight-only updates.
+     * When only lights change (e.g. DDGIVolume::OnGlobalLightChange), the hits are the same, so probe rays are
+     * re-shaded at the recorded surfaces instead of traced again. Records are only valid for the probe positions and
+     * ray rotation they were traced with: volumes must not be updated (Update() rotates the rays), relocated, or scrolled.
+     */
+    struct HitRecords
+    {
+        rtxgi::float4         probeRayRotation = { 0.f, 0.f, 0.f, 1.f };  // Rotation quaternion of the recorded rays
+        std::vector<uint32_t> numRays;                                    // Recorded rays per (scroll adjusted) probe index
+        std::vector<Surface>  surfaces;                                   // Indexed by (probeIndex * probeNumRays) + rayIndex, negative hitT: the ray missed
+    };
+
+    /**
+     * Per volume results of a bake.
+     */
+    struct Results
+    {
+        std::vector<uint32_t> iterations;
+        std::vector<float>    variability;
+        std::vector<double>   convergeSeconds;     // Negative: not converged, volumes that start converged are not baked
+    };
+
+    struct Stats
+    {
+        uint64_t numProbeRays = 0;
+        uint64_t numShadowRays = 0;
+        uint64_t numProbeBVHBuilds = 0;
+        uint64_t numRelitRays = 0;
+        double   traceSeconds = 0.0;      // Probe ray tracing and shading
+        double   relightSeconds = 0.0;    // Probe ray shading at recorded hits
+        double   updateSeconds = 0.0;     // Probe blending, relocation, and classification
+    };
+
+    // Builds the scene BVH (of the scene's proxy meshes when the config has them), creates views of the scene's textures, and gathers the lighting parameters of the config
+    void CreateContext(const Configs::Config& config, const Scenes::Scene& scene, uint32_t numThreads, Context& context);
+
+    // Populates a DDGIVolumeDesc from configuration data (the same mapping as the harness' GPU volumes)
+    void GetVolumeDesc(const Configs::DDGIVolume& config, rtxgi::DDGIVolumeDesc& desc);
+
+    // Loads the surface attributes and material of a closest hit (hit distances are in world units for normalized ray directions)
+    void GetSurface(const Context& context, const BVH::Hit& hit, Surface& surface);
+
+    // Computes the diffuse reflection of the scene's lights off the surface, with shadow rays
+    rtxgi::float3 DirectDiffuseLighting(const Context& context, const Surface& surface, uint32_t& numShadowRays);
+
+    // Seeds the SDK's random number generator from the volume's seed (or index, when the seed is 0) and the iteration, then updates the volume.
+    // Probe ray rotations then depend only on the volume and its update count, not on the volumes updated before it (the generator is
+    // shared by all volumes) or the process the update runs in.
+    void UpdateVolume(rtxgi::cpu::DDGIVolume& volume, uint32_t iteration);
+
+    // Traces and shades the volume's probe rays and stores the results in its ray data texture (only the probes of the volume's probe update list when it isn't empty).
+    // Rays are traced with the probe BVHs when given (built as needed), or per ray with the scene BVH.
+    // The hit surfaces are recorded for relight-only updates when hit records are given. Results don't depend on the context's wavefront setting.
+    void TraceProbes(const Context& context, rtxgi::cpu::DDGIVolume& volume, ProbeBVHs* probeBVHs, HitRecords* hitRecords, uint32_t numThreads, Stats& stats);
+
+    // Shades the volume's probe rays at the recorded hits with the current lights (only shadow rays are traced) and stores the
+    // results in its ray data texture. Returns false if the records don't match the volume's probes or probe ray rotation.
+    bool RelightProbes(const Context& context, rtxgi::cpu::DDGIVolume& volume, const HitRecords& hitRecords, uint32_t numThreads, Stats& stats);
+
+    // Finds the (scroll adjusted) probes a scene edit can change: probes whose last traced rays, or the shadow rays of their hits,
+    // reach the previous or new bounds of the scene's dirty instances, and probes whose voxel overlaps them. Uses the ray directions and
+    // hit distances in the volume's ray data, so call it before the volume is updated again. Bounce lighting through other probes is not tracked.
+    void FindEditedProbes(const Context& context, const rtxgi::cpu::DDGIVolume& volume, uint32_t numThreads, std::vector<int>& probeIndices);
+
+    // Resets the probes to their state in a new volume: cleared irradiance and distance (the next update blends without hysteresis), active, not relocated
+    void ClearProbes(rtxgi::cpu::DDGIVolume& volume, const std::vector<int>& probeIndices);
+
+    // Returns the mean variability of the volume's active probes, only the probes of the probe update list when it isn't empty (requires probe variability)
+    float GetProbeVariability(const rtxgi::cpu::DDGIVolume& volume);
+
+    // Writes the volume's irradiance, distance, probe data, and variability textures to the directory
+    bool WriteVolume(const rtxgi::cpu::DDGIVolume& volume, const std::string& directory, std::ofstream& log);
+}
@@ -0,0 +1,46 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "Bake.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Bakes DDGIVolumes with worker processes that share a work directory: local processes started by the coordinator, and
+// workers started by hand on other machines that see the same directory (a shared file system).
+//
+// Each update of a volume is split into work units: blocks of probes that a worker traces, blends, relocates, and classifies
+// starting from the volume's textures before the update. An update only reads a probe's own rays and texels (and the
+// irradiance of the previous update), and Bake::UpdateVolume makes ray rotations independent of the process, so the merged
+// textures are bit-identical to a single process bake of the same config.
+//
+// Work directory files (written to temporary names and renamed, so readers never see partial files):
+//   job.txt                                         The volumes of the bake, workers check them against their config
+//   state-v<volume>-i<iteration>.bin                A volume's textures after <iteration> updates (the coordinator's checkpoint)
+//   unit-v<volume>-i<iteration>-p<first>-n<count>   A block of probes to update: .todo, .claim-<worker> while a worker has it, .result when done
+//   stop                                            Workers exit
+namespace Distributed
+{
+    // Bakes the new volumes with worker processes of the executable (and any other workers of the work directory) until they converge,
+    // resuming from the work directory's checkpoints and finished units. Local workers that fail are restarted and units claimed by
+    // workers that stop responding are handed out again. Returns false if the work directory belongs to another bake or workers keep failing.
+    bool Coordinate(const std::string& executable, const std::string& configPath, const Configs::Config& config, const Bake::Settings& settings,
+                    std::vector<std::unique_ptr<rtxgi::cpu::DDGIVolume>>& volumes, const std::vector<float>& thresholds,
+                    Bake::Results& results, Bake::Stats& stats, std::ofstream& log);
+
+    // Claims and runs work units of the work directory until the coordinator stops the bake, or no units arrive for a while.
+    // The volumes must be new volumes of the coordinator's config. Returns false if the work directory belongs to another bake.
+    bool Work(const Bake::Context& context, const Configs::Config& config, const Bake::Settings& settings,
+              std::vector<std::unique_ptr<rtxgi::cpu::DDGIVolume>>& volumes, uint32_t numThreads, std::ofstream& log);
+}
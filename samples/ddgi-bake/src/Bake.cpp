@@ -0,0 +1,973 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Bake.h"
+
+#include <rtxgi/Math.h>
+#include <rtxgi/ddgi/cpu/Irradiance_CPU.h>
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+using namespace rtxgi;
+using namespace rtxgi::cpu;
+
+namespace Bake
+{
+    // Probes traced per task. Probes trace the same number of rays (except inactive probes), so small chunks balance well.
+    static const uint32_t ProbeChunkSize = 16;
+
+    // Maximum albedo of the surfaces probe rays hit, perfectly diffuse reflectors don't exist in the real world (same as ProbeTraceRGS)
+    static const float MaxAlbedo = 0.9f;
+
+    static const float MissDistance = 1e27f;
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    float3 TransformPoint(const float transform[3][4], const float3& p)
+    {
+        return {
+            (transform[0][0] * p.x) + (transform[0][1] * p.y) + (transform[0][2] * p.z) + transform[0][3],
+            (transform[1][0] * p.x) + (transform[1][1] * p.y) + (transform[1][2] * p.z) + transform[1][3],
+            (transform[2][0] * p.x) + (transform[2][1] * p.y) + (transform[2][2] * p.z) + transform[2][3] };
+    }
+
+    float3 TransformVector(const float transform[3][4], const float3& v)
+    {
+        return {
+            (transform[0][0] * v.x) + (transform[0][1] * v.y) + (transform[0][2] * v.z),
+            (transform[1][0] * v.x) + (transform[1][1] * v.y) + (transform[1][2] * v.z),
+            (transform[2][0] * v.x) + (transform[2][1] * v.y) + (transform[2][2] * v.z) };
+    }
+
+    float3 Saturate(const float3& v)
+    {
+        return { std::min(std::max(v.x, 0.f), 1.f), std::min(std::max(v.y, 0.f), 1.f), std::min(std::max(v.z, 0.f), 1.f) };
+    }
+
+    float Saturate(float v)
+    {
+        return std::min(std::max(v, 0.f), 1.f);
+    }
+
+    /**
+     * Spot attenuation function from Frostbite, pg 115 in RTR4.
+     */
+    float SpotAttenuation(const float3& spotDirection, const float3& lightDirection, float umbra, float penumbra)
+    {
+        float cosTheta = Saturate(Dot3(spotDirection, lightDirection));
+        float t = Saturate((cosTheta - cosf(umbra)) / (cosf(penumbra) - cosf(umbra)));
+        return t * t;
+    }
+
+    float LightWindowing(float distanceToLight, float maxDistance)
+    {
+        float ratio = distanceToLight / maxDistance;
+        float window = Saturate(1.f - (ratio * ratio * ratio * ratio));
+        return window * window;
+    }
+
+    float LightFalloff(float distanceToLight)
+    {
+        float distance = std::max(distanceToLight, 1.f);
+        return 1.f / (distance * distance);
+    }
+
+    enum class ELightType
+    {
+        Directional = 0,
+        Spot,
+        Point
+    };
+
+    /**
+     * Calls visit(light, type) for the scene's lights in the order their lighting is summed: the directional light, spot lights, then point lights.
+     */
+    template<typename Visit>
+    void VisitLights(const Scenes::Scene& scene, Visit visit)
+    {
+        // The directional light is always the first light
+        if (scene.hasDirectionalLight) visit(scene.lights[0].data, ELightType::Directional);
+
+        for (uint32_t lightIndex = 0; lightIndex < scene.numSpotLights; lightIndex++) visit(scene.lights[scene.firstSpotLight + lightIndex].data, ELightType::Spot);
+        for (uint32_t lightIndex = 0; lightIndex < scene.numPointLights; lightIndex++) visit(scene.lights[scene.firstPointLight + lightIndex].data, ELightType::Point);
+    }
+
+    /**
+     * Sets up the shadow ray from the surface toward the light. Returns false if the light's energy doesn't reach the surface (no shadow ray is needed).
+     */
+    bool GetShadowRay(const Context& context, const Surface& surface, const Graphics::Light& light, ELightType type, BVH::Ray& ray)
+    {
+        ray.origin = Add(surface.worldPosition, Mul(surface.normal, context.rayNormalBias));
+        ray.tMin = 0.f;
+        if (type == ELightType::Directional)
+        {
+            ray.direction = Normalize3(Mul(Normalize3(light.direction), -1.f));
+            ray.tMax = MissDistance;
+            return true;
+        }
+
+        // Spot and point light energy is windowed by the light's radius
+        float3 lightVector = Sub(light.position, surface.worldPosition);
+        float  lightDistance = Length3(lightVector);
+        if (lightDistance > light.radius) return false;
+
+        ray.direction = Normalize3(lightVector);
+        ray.tMax = lightDistance - context.rayViewBias;
+        return true;
+    }
+
+    /**
+     * Evaluates the lighting of a visible light at the surface. Spot and point lights fall off with distance and are windowed by the light's radius.
+     */
+    float3 GetLightRadiance(const Surface& surface, const Graphics::Light& light, ELightType type)
+    {
+        if (type == ELightType::Directional)
+        {
+            float3 lightDirection = Mul(Normalize3(light.direction), -1.f);
+            float nol = std::max(Dot3(surface.normal, lightDirection), 0.f);
+            return Mul(light.color, light.power * nol);
+        }
+
+        float3 lightVector = Sub(light.position, surface.worldPosition);
+        float  lightDistance = Length3(lightVector);
+        float3 lightDirection = Normalize3(lightVector);
+        float  nol = std::max(Dot3(surface.normal, lightDirection), 0.f);
+        float  attenuation = (type == ELightType::Spot) ? SpotAttenuation(Normalize3(light.direction), Mul(lightDirection, -1.f), light.umbraAngle, light.penumbraAngle) : 1.f;
+        float  falloff = LightFalloff(lightDistance);
+        float  window = LightWindowing(lightDistance, light.radius);
+
+        return Mul(light.color, light.power * nol * attenuation * falloff * window);
+    }
+
+    /**
+     * Stores the ray data of probe rays that are not shaded: misses (the surface is null), backface hits, and fixed rays.
+     * Returns false if the ray must be shaded.
+     */
+    bool GetUnshadedRayData(const Context& context, const DDGIVolumeDescGPU& desc, const Surface* surface, int rayIndex, float4& data)
+    {
+        // The ray missed. Store the miss radiance and a large hit distance.
+        if (!surface)
+        {
+            data = { context.skyRadiance.x, context.skyRadiance.y, context.skyRadiance.z, MissDistance };
+            return true;
+        }
+
+        // The ray hit a surface backface
+        if (!surface->frontFace)
+        {
+            data = { 0.f, 0.f, 0.f, -0.2f * surface->hitT };
+            return true;
+        }
+
+        // A "fixed" ray hit a front facing surface. Fixed rays are not blended, store the hit distance only.
+        if ((desc.probeRelocationEnabled || desc.probeClassificationEnabled) && rayIndex < DDGI_NUM_FIXED_RAYS)
+        {
+            data = { 0.f, 0.f, 0.f, surface->hitT };
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * Combines the direct lighting of a probe ray's front facing hit with the volume's irradiance (the recursive indirect lighting)
+     * in the same way as ProbeTraceRGS, and returns the ray's radiance and hit distance.
+     */
+    float4 ShadeSurface(const DDGIVolumeDescGPU& desc, const DDGIVolumeResources& resources, const float3& rayDirection, const Surface& surface, const float3& diffuse)
+    {
+        // Don't evaluate irradiance when the surface is outside the volume
+        float3 irradiance = { 0.f, 0.f, 0.f };
+        float volumeBlendWeight = DDGIGetVolumeBlendWeight(surface.worldPosition, desc);
+        if (volumeBlendWeight > 0.f)
+        {
+            float3 surfaceBias = DDGIGetSurfaceBias(surface.normal, rayDirection, desc);
+            irradiance = Mul(DDGIGetVolumeIrradiance(surface.worldPosition, surfaceBias, surface.normal, desc, resources), volumeBlendWeight);
+        }
+
+        float3 albedo = { std::min(surface.albedo.x, MaxAlbedo), std::min(surface.albedo.y, MaxAlbedo), std::min(surface.albedo.z, MaxAlbedo) };
+        float3 radiance = Saturate(Add(diffuse, Mul(Mul(albedo, 1.f / RTXGI_PI), irradiance)));
+        return { radiance.x, radiance.y, radiance.z, surface.hitT };
+    }
+
+    /**
+     * Computes the radiance of a probe ray in the same way as ProbeTraceRGS and stores it with the hit distance.
+     * The surface is null when the ray missed.
+     */
+    float4 ShadeProbeRay(
+        const Context& context,
+        const DDGIVolumeDescGPU& desc,
+        const DDGIVolumeResources& resources,
+        const float3& rayDirection,
+        const Surface* surface,
+        int rayIndex,
+        uint32_t& numShadowRays)
+    {
+        float4 data;
+        if (GetUnshadedRayData(context, desc, surface, rayIndex, data)) return data;
+
+        // Direct lighting and shadowing, then indirect lighting
+        float3 diffuse = DirectDiffuseLighting(context, *surface, numShadowRays);
+        return ShadeSurface(desc, resources, rayDirection, *surface, diffuse);
+    }
+
+    /**
+     * Returns true if the segment from the origin along the (normalized) direction, up to the length, intersects the box.
+     */
+    bool SegmentIntersectsBox(const float3& origin, const float3& direction, float length, const AABB& box)
+    {
+        float tMin = 0.f;
+        float tMax = length;
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            if (fabsf(direction[axis]) < 1e-12f)
+            {
+                // The segment is parallel to the slab, it must start inside it
+                if (origin[axis] < box.min[axis] || origin[axis] > box.max[axis]) return false;
+                continue;
+            }
+
+            float t0 = (box.min[axis] - origin[axis]) / direction[axis];
+            float t1 = (box.max[axis] - origin[axis]) / direction[axis];
+            tMin = std::max(tMin, std::min(t0, t1));
+            tMax = std::min(tMax, std::max(t0, t1));
+            if (tMin > tMax) return false;
+        }
+        return true;
+    }
+
+    /**
+     * Returns true if a probe ray, or the shadow rays of its hit, could reach one of the boxes.
+     */
+    bool ProbeRayReachesBoxes(const Context& context, const float3& origin, const float3& direction, float hitDistance, bool shaded, const std::vector<AABB>& boxes)
+    {
+        const Scenes::Scene& scene = *context.scene;
+
+        // Backface hits are stored as -0.2 * hitT, misses with a distance larger than the maximum ray distance
+        bool frontface = (hitDistance >= 0.f);
+        float length = frontface ? hitDistance : (hitDistance * -5.f);
+        for (const AABB& box : boxes)
+        {
+            if (SegmentIntersectsBox(origin, direction, length, box)) return true;
+        }
+
+        // Front facing hits are lit with shadow rays, the edited instances may now (or no longer) block them
+        if (!frontface || !shaded) return false;
+
+        float3 hitPosition = Add(origin, Mul(direction, hitDistance));
+        for (uint32_t lightIndex = 0; lightIndex < (uint32_t)scene.lights.size(); lightIndex++)
+        {
+            const Graphics::Light& light = scene.lights[lightIndex].data;
+
+            float3 lightDirection;
+            float lightDistance = MissDistance;
+            if (scene.hasDirectionalLight && lightIndex == 0)
+            {
+                lightDirection = Mul(Normalize3(light.direction), -1.f);
+            }
+            else
+            {
+                float3 lightVector = Sub(light.position, hitPosition);
+                lightDistance = Length3(lightVector);
+                if (lightDistance > light.radius || lightDistance <= 0.f) continue;
+                lightDirection = Mul(lightVector, 1.f / lightDistance);
+            }
+
+            for (const AABB& box : boxes)
+            {
+                if (SegmentIntersectsBox(hitPosition, lightDirection, lightDistance, box)) return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * The volume, outputs, and options of a probe trace, shared by the tasks that trace chunks of probes.
+     */
+    struct ProbeTrace
+    {
+        const Context*        context = nullptr;
+        DDGIVolumeDescGPU     desc;
+        DDGIVolumeResources   resources;
+        const Texture2DArray* probeData = nullptr;
+        Texture2DArray*       rayData = nullptr;
+        std::vector<uint8_t>  traceProbe;            // Indexed by (scroll adjusted) probe index, empty: all probes are traced
+        ProbeBVHs*            probeBVHs = nullptr;
+        HitRecords*           hitRecords = nullptr;
+        BVH::BuildDesc        probeDesc;             // Probe BVHs are built on the tracing threads, one per probe
+    };
+
+    struct ProbeTraceCounts
+    {
+        uint64_t numProbeRays = 0;
+        uint32_t numShadowRays = 0;
+        uint32_t numProbeBVHBuilds = 0;
+    };
+
+    /**
+     * The queues of a wavefront trace of a chunk of probes. Each thread keeps its queues across chunks and traces, so their memory is only allocated once.
+     */
+    struct WavefrontQueues
+    {
+        // Probe rays, in probe order
+        std::vector<BVH::Ray> rays;
+        std::vector<int>      rayProbes;           // (Scroll adjusted) probe index
+        std::vector<int>      rayIndices;          // Index of the ray in its probe
+
+        // Probe rays sorted by direction octant and their hits
+        std::vector<uint32_t> rayOrder;            // Index of the sorted ray in the probe order
+        std::vector<BVH::Ray> sortedRays;
+        std::vector<BVH::Hit> hits;
+
+        // Hits sorted by material
+        std::vector<uint32_t> hitRays;             // Index of the hit's sorted ray
+        std::vector<uint32_t> hitOrder;
+
+        // Surfaces to shade and their shadow rays, queued light after light
+        std::vector<Surface>  surfaces;
+        std::vector<uint32_t> surfaceRays;         // Index of the surface's sorted ray
+        std::vector<BVH::Ray> shadowRays;
+        std::vector<uint32_t> shadowSurfaces;      // Index of the shadow ray's surface
+        std::vector<uint32_t> lightShadowRays;     // End of each light's shadow rays
+        std::vector<uint8_t>  shadowHits;
+        std::vector<float3>   lighting;
+
+        // Counting sort keys and bucket offsets
+        std::vector<uint32_t> keys;
+        std::vector<uint32_t> offsets;
+    };
+
+    /**
+     * Sorts the items by their keys (less than numKeys) with a counting sort. The sort is stable, order receives the items' indices in sorted order.
+     */
+    void CountingSort(const std::vector<uint32_t>& keys, uint32_t numKeys, std::vector<uint32_t>& offsets, std::vector<uint32_t>& order)
+    {
+        offsets.assign((size_t)numKeys + 1, 0);
+        for (uint32_t key : keys) offsets[(size_t)key + 1]++;
+        for (uint32_t key = 0; key < numKeys; key++) offsets[(size_t)key + 1] += offsets[key];
+
+        order.resize(keys.size());
+        for (uint32_t index = 0; index < (uint32_t)keys.size(); index++) order[offsets[keys[index]]++] = index;
+    }
+
+    /**
+     * Gets the (scroll adjusted) probe index, number of rays, and world position of the probe at a probe coordinates index.
+     * Returns false if the probe isn't traced. The probe's BVH is built when probe BVHs are used and the probe moved.
+     */
+    bool GetTracedProbe(const ProbeTrace& trace, uint32_t index, int& probeIndex, int& numRays, float3& origin, ProbeTraceCounts& counts)
+    {
+        const DDGIVolumeDescGPU& desc = trace.desc;
+
+        // World positions use probe coordinates, ray data and probe data use the scroll adjusted probe index
+        int3 probeCoords = DDGIGetProbeCoords((int)index, desc);
+        probeIndex = DDGIGetScrollingProbeIndex(probeCoords, desc);
+        if (!trace.traceProbe.empty() && trace.traceProbe[(size_t)probeIndex] == 0) return false;
+
+        // Inactive probes only trace the fixed rays used by probe classification
+        numRays = desc.probeNumRays;
+        if (DDGILoadProbeState(probeIndex, *trace.probeData, desc) == DDGI_PROBE_STATE_INACTIVE) numRays = std::min(numRays, DDGI_NUM_FIXED_RAYS);
+
+        origin = DDGIGetProbeWorldPosition(probeCoords, desc, *trace.probeData);
+        if (trace.probeBVHs)
+        {
+            BVH::ProbeBVH& probe = trace.probeBVHs->probes[(size_t)probeIndex];
+            if (probe.radius != desc.probeMaxRayDistance || probe.origin.x != origin.x || probe.origin.y != origin.y || probe.origin.z != origin.z)
+            {
+                BVH::BuildProbe(trace.context->bvh, origin, desc.probeMaxRayDistance, trace.probeDesc, probe);
+                counts.numProbeBVHBuilds++;
+            }
+        }
+
+        if (trace.hitRecords) trace.hitRecords->numRays[(size_t)probeIndex] = (uint32_t)numRays;
+        counts.numProbeRays += (uint64_t)numRays;
+        return true;
+    }
+
+    /**
+     * Traces a chunk of probes one probe after another: all of a probe's rays are traced, then shaded ray after ray.
+     */
+    void TraceProbeChunk(const ProbeTrace& trace, uint32_t begin, uint32_t end, ProbeTraceCounts& counts)
+    {
+        const Context& context = *trace.context;
+        const DDGIVolumeDescGPU& desc = trace.desc;
+
+        std::vector<BVH::Ray> rays((size_t)desc.probeNumRays);
+        std::vector<BVH::Hit> hits((size_t)desc.probeNumRays);
+        for (uint32_t index = begin; index < end; index++)
+        {
+            int probeIndex, numRays;
+            float3 origin;
+            if (!GetTracedProbe(trace, index, probeIndex, numRays, origin, counts)) continue;
+
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                BVH::Ray& ray = rays[(size_t)rayIndex];
+                ray.origin = origin;
+                ray.tMin = 0.f;
+                ray.direction = DDGIGetProbeRayDirection(rayIndex, desc);
+                ray.tMax = desc.probeMaxRayDistance;
+            }
+
+            // Trace all of the probe's rays, then shade them
+            if (trace.probeBVHs)
+            {
+                BVH::TraceClosestHit(context.bvh, trace.probeBVHs->probes[(size_t)probeIndex], (uint32_t)numRays, rays.data(), hits.data());
+            }
+            else
+            {
+                for (int rayIndex = 0; rayIndex < numRays; rayIndex++) BVH::TraceClosestHit(context.bvh, rays[(size_t)rayIndex], hits[(size_t)rayIndex]);
+            }
+
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                const BVH::Hit& hit = hits[(size_t)rayIndex];
+                Surface surface;
+                if (hit.IsValid()) GetSurface(context, hit, surface);
+                else surface.hitT = -1.f;
+
+                if (trace.hitRecords) trace.hitRecords->surfaces[((size_t)probeIndex * (size_t)desc.probeNumRays) + (size_t)rayIndex] = surface;
+                (*trace.rayData)[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, desc)] =
+                    ShadeProbeRay(context, desc, trace.resources, rays[(size_t)rayIndex].direction, hit.IsValid() ? &surface : nullptr, rayIndex, counts.numShadowRays);
+            }
+        }
+    }
+
+    /**
+     * Traces a chunk of probes in stages (a wavefront), each stage runs over all of the chunk's rays:
+     * the probe rays are generated and sorted by direction octant, traced, their hits sorted by material and their surfaces fetched,
+     * then shadow rays are queued light after light and traced, and the surfaces are shaded. Results are the same as TraceProbeChunk().
+     */
+    void TraceProbeChunkWavefront(const ProbeTrace& trace, uint32_t begin, uint32_t end, ProbeTraceCounts& counts)
+    {
+        static thread_local WavefrontQueues queues;
+
+        const Context& context = *trace.context;
+        const DDGIVolumeDescGPU& desc = trace.desc;
+        Texture2DArray& rayData = *trace.rayData;
+
+        // Generate the rays of the chunk's probes
+        queues.rays.clear();
+        queues.rayProbes.clear();
+        queues.rayIndices.clear();
+        for (uint32_t index = begin; index < end; index++)
+        {
+            int probeIndex, numRays;
+            float3 origin;
+            if (!GetTracedProbe(trace, index, probeIndex, numRays, origin, counts)) continue;
+
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                BVH::Ray ray;
+                ray.origin = origin;
+                ray.tMin = 0.f;
+                ray.direction = DDGIGetProbeRayDirection(rayIndex, desc);
+                ray.tMax = desc.probeMaxRayDistance;
+                queues.rays.push_back(ray);
+                queues.rayProbes.push_back(probeIndex);
+                queues.rayIndices.push_back(rayIndex);
+            }
+        }
+        uint32_t numRays = (uint32_t)queues.rays.size();
+
+        // Sort the rays by direction octant. The sort is stable: within an octant, rays stay in probe (origin) order.
+        queues.keys.resize(numRays);
+        for (uint32_t ray = 0; ray < numRays; ray++) queues.keys[ray] = BVH::GetOctant(queues.rays[ray].direction);
+        CountingSort(queues.keys, 8, queues.offsets, queues.rayOrder);
+
+        queues.sortedRays.resize(numRays);
+        for (uint32_t ray = 0; ray < numRays; ray++) queues.sortedRays[ray] = queues.rays[queues.rayOrder[ray]];
+
+        // Trace the sorted rays, runs of rays of the same probe are traced with its BVH
+        queues.hits.resize(numRays);
+        if (trace.probeBVHs)
+        {
+            for (uint32_t first = 0; first < numRays;)
+            {
+                int probeIndex = queues.rayProbes[queues.rayOrder[first]];
+                uint32_t last = first + 1;
+                while (last < numRays && queues.rayProbes[queues.rayOrder[last]] == probeIndex) last++;
+
+                BVH::TraceClosestHit(context.bvh, trace.probeBVHs->probes[(size_t)probeIndex], last - first, &queues.sortedRays[first], &queues.hits[first]);
+                first = last;
+            }
+        }
+        else
+        {
+            for (uint32_t ray = 0; ray < numRays; ray++) BVH::TraceClosestHit(context.bvh, queues.sortedRays[ray], queues.hits[ray]);
+        }
+
+        // Store the misses and sort the hits by material (misses and hits without a material first)
+        const Scenes::Scene& scene = *context.scene;
+        const std::vector<Scenes::Mesh>& meshes = BVH::GetMeshes(scene, context.bvh);
+        queues.hitRays.clear();
+        queues.keys.clear();
+        for (uint32_t ray = 0; ray < numRays; ray++)
+        {
+            const BVH::Hit& hit = queues.hits[ray];
+            if (hit.IsValid())
+            {
+                const Scenes::MeshInstance& instance = scene.instances[hit.instanceIndex];
+                queues.hitRays.push_back(ray);
+                queues.keys.push_back((uint32_t)(meshes[instance.meshIndex].primitives[hit.primitiveIndex].material + 1));
+                continue;
+            }
+
+            uint32_t rayId = queues.rayOrder[ray];
+            int probeIndex = queues.rayProbes[rayId];
+            int rayIndex = queues.rayIndices[rayId];
+            if (trace.hitRecords) trace.hitRecords->surfaces[((size_t)probeIndex * (size_t)desc.probeNumRays) + (size_t)rayIndex].hitT = -1.f;
+            GetUnshadedRayData(context, desc, nullptr, rayIndex, rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, desc)]);
+        }
+        CountingSort(queues.keys, (uint32_t)scene.materials.size() + 1, queues.offsets, queues.hitOrder);
+
+        // Fetch the surfaces material after material, store the rays that aren't shaded, and queue the others for shading
+        queues.surfaces.clear();
+        queues.surfaceRays.clear();
+        for (uint32_t hitIndex : queues.hitOrder)
+        {
+            uint32_t ray = queues.hitRays[hitIndex];
+            uint32_t rayId = queues.rayOrder[ray];
+            int probeIndex = queues.rayProbes[rayId];
+            int rayIndex = queues.rayIndices[rayId];
+
+            Surface surface;
+            GetSurface(context, queues.hits[ray], surface);
+            if (trace.hitRecords) trace.hitRecords->surfaces[((size_t)probeIndex * (size_t)desc.probeNumRays) + (size_t)rayIndex] = surface;
+            if (GetUnshadedRayData(context, desc, &surface, rayIndex, rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, desc)])) continue;
+
+            queues.surfaces.push_back(surface);
+            queues.surfaceRays.push_back(ray);
+        }
+        uint32_t numSurfaces = (uint32_t)queues.surfaces.size();
+
+        // Queue the shadow rays light after light, then trace them
+        queues.shadowRays.clear();
+        queues.shadowSurfaces.clear();
+        queues.lightShadowRays.clear();
+        VisitLights(scene, [&](const Graphics::Light& light, ELightType type)
+        {
+            for (uint32_t surfaceIndex = 0; surfaceIndex < numSurfaces; surfaceIndex++)
+            {
+                BVH::Ray ray;
+                if (!GetShadowRay(context, queues.surfaces[surfaceIndex], light, type, ray)) continue;
+                queues.shadowRays.push_back(ray);
+                queues.shadowSurfaces.push_back(surfaceIndex);
+            }
+            queues.lightShadowRays.push_back((uint32_t)queues.shadowRays.size());
+        });
+
+        uint32_t numShadowRays = (uint32_t)queues.shadowRays.size();
+        queues.shadowHits.resize(numShadowRays);
+        for (uint32_t ray = 0; ray < numShadowRays; ray++) queues.shadowHits[ray] = BVH::TraceAnyHit(context.bvh, queues.shadowRays[ray]) ? 1 : 0;
+        counts.numShadowRays += numShadowRays;
+
+        // Sum the lighting of the visible lights in the same order as DirectDiffuseLighting()
+        queues.lighting.assign(numSurfaces, { 0.f, 0.f, 0.f });
+        uint32_t lightIndex = 0;
+        uint32_t shadowRay = 0;
+        VisitLights(scene, [&](const Graphics::Light& light, ELightType type)
+        {
+            for (; shadowRay < queues.lightShadowRays[lightIndex]; shadowRay++)
+            {
+                if (queues.shadowHits[shadowRay]) continue;
+
+                uint32_t surfaceIndex = queues.shadowSurfaces[shadowRay];
+                queues.lighting[surfaceIndex] = Add(queues.lighting[surfaceIndex], GetLightRadiance(queues.surfaces[surfaceIndex], light, type));
+            }
+            lightIndex++;
+        });
+
+        // Shade the surfaces
+        for (uint32_t surfaceIndex = 0; surfaceIndex < numSurfaces; surfaceIndex++)
+        {
+            const Surface& surface = queues.surfaces[surfaceIndex];
+            uint32_t ray = queues.surfaceRays[surfaceIndex];
+            uint32_t rayId = queues.rayOrder[ray];
+
+            float3 diffuse = Mul(Mul(surface.albedo, 1.f / RTXGI_PI), queues.lighting[surfaceIndex]);
+            rayData[DDGIGetRayDataTexelCoords(queues.rayIndices[rayId], queues.rayProbes[rayId], desc)] = ShadeSurface(desc, trace.resources, queues.sortedRays[ray].direction, surface, diffuse);
+        }
+    }
+
+    bool WriteTexture(const Texture2DArray& texture, const std::string& file)
+    {
+        std::ofstream out(file, std::ios::out | std::ios::binary);
+        if (!out.is_open()) return false;
+
+        // Header: magic, version, dimensions. Texels follow as RGBA32F, x-fastest, one slice after another.
+        const char magic[4] = { 'D', 'D', 'G', 'I' };
+        uint32_t header[4] = { 1, texture.width, texture.height, texture.arraySize };
+        out.write(magic, sizeof(magic));
+        out.write(reinterpret_cast<const char*>(header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(texture.texels.data()), (std::streamsize)(texture.texels.size() * sizeof(float4)));
+        return out.good();
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    void CreateContext(const Configs::Config& config, const Scenes::Scene& scene, uint32_t numThreads, Context& context)
+    {
+        context.scene = &scene;
+        context.skyRadiance = { config.scene.skyColor.x * config.scene.skyIntensity, config.scene.skyColor.y * config.scene.skyIntensity, config.scene.skyColor.z * config.scene.skyIntensity };
+        context.rayNormalBias = config.pathTrace.rayNormalBias;
+        context.rayViewBias = config.pathTrace.rayViewBias;
+
+        BVH::BuildDesc desc;
+        desc.numThreads = numThreads;
+        desc.proxies = (config.scene.proxyRatio > 0.f);
+        BVH::Build(scene, desc, context.bvh);
+
+        context.textures.resize(scene.textures.size());
+        for (size_t textureIndex = 0; textureIndex < scene.textures.size(); textureIndex++) Samplers::CreateView(scene.textures[textureIndex], context.textures[textureIndex]);
+    }
+
+    void GetVolumeDesc(const Configs::DDGIVolume& config, DDGIVolumeDesc& desc)
+    {
+        // The name is not copied, the config must outlive the volume
+        desc.name = const_cast<char*>(config.name.c_str());
+        desc.index = config.index;
+        desc.rngSeed = config.rngSeed;
+        desc.origin = { config.origin.x, config.origin.y, config.origin.z };
+        desc.eulerAngles = { config.eulerAngles.x, config.eulerAngles.y, config.eulerAngles.z };
+        desc.probeSpacing = { config.probeSpacing.x, config.probeSpacing.y, config.probeSpacing.z };
+        desc.probeCounts = { config.probeCounts.x, config.probeCounts.y, config.probeCounts.z };
+        desc.probeNumRays = (int)config.probeNumRays;
+        desc.probeNumIrradianceTexels = (int)config.probeNumIrradianceTexels;
+        desc.probeNumIrradianceInteriorTexels = (int)config.probeNumIrradianceTexels - 2;
+        desc.probeNumDistanceTexels = (int)config.probeNumDistanceTexels;
+        desc.probeNumDistanceInteriorTexels = (int)config.probeNumDistanceTexels - 2;
+        desc.probeHysteresis = config.probeHysteresis;
+        desc.probeNormalBias = config.probeNormalBias;
+        desc.probeViewBias = config.probeViewBias;
+        desc.probeMaxRayDistance = config.probeMaxRayDistance;
+        desc.probeIrradianceThreshold = config.probeIrradianceThreshold;
+        desc.probeBrightnessThreshold = config.probeBrightnessThreshold;
+
+        desc.probeRayDataFormat = config.textureFormats.rayDataFormat;
+        desc.probeIrradianceFormat = config.textureFormats.irradianceFormat;
+        desc.probeDistanceFormat = config.textureFormats.distanceFormat;
+        desc.probeDataFormat = config.textureFormats.dataFormat;
+        desc.probeVariabilityFormat = config.textureFormats.variabilityFormat;
+
+        desc.probeRelocationEnabled = config.probeRelocationEnabled;
+        desc.probeMinFrontfaceDistance = config.probeMinFrontfaceDistance;
+        desc.probeClassificationEnabled = config.probeClassificationEnabled;
+
+        // Convergence is measured with probe variability
+        desc.probeVariabilityEnabled = true;
+
+        if (config.infiniteScrollingEnabled) desc.movementType = EDDGIVolumeMovementType::Scrolling;
+        else desc.movementType = EDDGIVolumeMovementType::Default;
+    }
+
+    void GetSurface(const Context& context, const BVH::Hit& hit, Surface& surface)
+    {
+        const Scenes::MeshInstance& instance = context.scene->instances[hit.instanceIndex];
+        const Scenes::MeshPrimitive& primitive = BVH::GetMeshes(*context.scene, context.bvh)[instance.meshIndex].primitives[hit.primitiveIndex];
+
+        const Graphics::Vertex& v0 = primitive.vertices[primitive.indices[(hit.triangleIndex * 3) + 0]];
+        const Graphics::Vertex& v1 = primitive.vertices[primitive.indices[(hit.triangleIndex * 3) + 1]];
+        const Graphics::Vertex& v2 = primitive.vertices[primitive.indices[(hit.triangleIndex * 3) + 2]];
+
+        // Interpolate the triangle's attributes for the hit location and apply the instance transform
+        float w = 1.f - hit.u - hit.v;
+        float3 position = Add(Add(Mul(v0.position, w), Mul(v1.position, hit.u)), Mul(v2.position, hit.v));
+        float3 normal = Add(Add(Mul(v0.normal, w), Mul(v1.normal, hit.u)), Mul(v2.normal, hit.v));
+
+        surface.worldPosition = TransformPoint(instance.transform, position);
+        surface.normal = Normalize3(TransformVector(instance.transform, normal));
+        surface.hitT = hit.t;
+        surface.frontFace = hit.frontFace;
+
+        surface.albedo = { 1.f, 1.f, 1.f };
+        if (primitive.material < 0) return;
+
+        // The material's albedo factor, modulated by its albedo texture at the lod of CHS_GI (half the texture's mips)
+        const Graphics::Material& material = context.scene->materials[primitive.material].data;
+        surface.albedo = material.albedo;
+        if (material.albedoTexIdx < 0 || material.albedoTexIdx >= (int)context.textures.size()) return;
+
+        const Samplers::View& view = context.textures[material.albedoTexIdx];
+        if (view.mips.empty()) return;
+
+        thread_local Samplers::BlockCache cache;
+        float2 uv = { (v0.uv0.x * w) + (v1.uv0.x * hit.u) + (v2.uv0.x * hit.v), (v0.uv0.y * w) + (v1.uv0.y * hit.u) + (v2.uv0.y * hit.v) };
+        float4 texel = Samplers::SampleLevel(view, uv, (float)view.mips.size() / 2.f, cache);
+        surface.albedo = { surface.albedo.x * texel.x, surface.albedo.y * texel.y, surface.albedo.z * texel.z };
+    }
+
+    float3 DirectDiffuseLighting(const Context& context, const Surface& surface, uint32_t& numShadowRays)
+    {
+        float3 lighting = { 0.f, 0.f, 0.f };
+        VisitLights(*context.scene, [&](const Graphics::Light& light, ELightType type)
+        {
+            // Skip lights whose energy doesn't reach the surface, or that aren't visible from it
+            BVH::Ray ray;
+            if (!GetShadowRay(context, surface, light, type, ray)) return;
+
+            numShadowRays++;
+            if (BVH::TraceAnyHit(context.bvh, ray)) return;
+
+            lighting = Add(lighting, GetLightRadiance(surface, light, type));
+        });
+
+        return Mul(Mul(surface.albedo, 1.f / RTXGI_PI), lighting);
+    }
+
+    void UpdateVolume(DDGIVolume& volume, uint32_t iteration)
+    {
+        // Mix the seed and iteration (SplitMix64 finalizer), so consecutive iterations don't seed the generator with nearby values
+        DDGIVolumeDesc desc = volume.GetDesc();
+        uint64_t seed = (desc.rngSeed != 0) ? (uint64_t)desc.rngSeed : (uint64_t)desc.index + 1;
+        uint64_t bits = (seed << 32) | (uint64_t)iteration;
+        bits = (bits ^ (bits >> 30)) * 0xBF58476D1CE4E5B9ull;
+        bits = (bits ^ (bits >> 27)) * 0x94D049BB133111EBull;
+        bits = bits ^ (bits >> 31);
+
+        volume.SeedRNG((int)(uint32_t)bits);
+        volume.Update();
+    }
+
+    void TraceProbes(const Context& context, DDGIVolume& volume, ProbeBVHs* probeBVHs, HitRecords* hitRecords, uint32_t numThreads, Stats& stats)
+    {
+        ProbeTrace trace;
+        trace.context = &context;
+        trace.desc = volume.GetDescGPU();
+        trace.resources = DDGIGetVolumeResources(volume);
+        trace.probeData = &volume.GetProbeData();
+        trace.rayData = &volume.GetProbeRayData();
+        trace.probeBVHs = probeBVHs;
+        trace.hitRecords = hitRecords;
+        trace.probeDesc.numThreads = 1;
+
+        if (probeBVHs) probeBVHs->probes.resize((size_t)volume.GetNumProbes());
+
+        // Only the probes of the update list are traced when it isn't empty
+        const std::vector<int>& updateList = volume.GetProbeUpdateList();
+        trace.traceProbe.assign(updateList.empty() ? 0 : (size_t)volume.GetNumProbes(), 0);
+        for (int probeIndex : updateList) trace.traceProbe[(size_t)probeIndex] = 1;
+        if (hitRecords)
+        {
+            hitRecords->probeRayRotation = trace.desc.probeRayRotation;
+            hitRecords->numRays.assign((size_t)volume.GetNumProbes(), 0);
+            hitRecords->surfaces.resize((size_t)volume.GetNumProbes() * (size_t)trace.desc.probeNumRays);
+        }
+
+        std::atomic<uint64_t> numProbeRays(0);
+        std::atomic<uint64_t> numShadowRays(0);
+        std::atomic<uint64_t> numProbeBVHBuilds(0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ParallelFor((uint32_t)volume.GetNumProbes(), ProbeChunkSize, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            ProbeTraceCounts counts;
+            if (context.wavefront) TraceProbeChunkWavefront(trace, begin, end, counts);
+            else TraceProbeChunk(trace, begin, end, counts);
+
+            numProbeRays += counts.numProbeRays;
+            numShadowRays += counts.numShadowRays;
+            numProbeBVHBuilds += counts.numProbeBVHBuilds;
+        });
+
+        stats.traceSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        stats.numProbeRays += numProbeRays;
+        stats.numShadowRays += numShadowRays;
+        stats.numProbeBVHBuilds += numProbeBVHBuilds;
+    }
+
+    bool RelightProbes(const Context& context, DDGIVolume& volume, const HitRecords& hitRecords, uint32_t numThreads, Stats& stats)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        DDGIVolumeResources resources = DDGIGetVolumeResources(volume);
+        Texture2DArray& rayData = volume.GetProbeRayData();
+
+        // Recorded hits are only valid for the rays they were traced with
+        if (hitRecords.numRays.size() != (size_t)volume.GetNumProbes()) return false;
+        if (hitRecords.surfaces.size() != (size_t)volume.GetNumProbes() * (size_t)desc.probeNumRays) return false;
+        if (std::memcmp(&hitRecords.probeRayRotation, &desc.probeRayRotation, sizeof(float4)) != 0) return false;
+
+        std::atomic<uint64_t> numRelitRays(0);
+        std::atomic<uint64_t> numShadowRays(0);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ParallelFor((uint32_t)volume.GetNumProbes(), ProbeChunkSize, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            uint64_t relitRays = 0;
+            uint32_t shadowRays = 0;
+            for (uint32_t probeIndex = begin; probeIndex < end; probeIndex++)
+            {
+                int numRays = (int)hitRecords.numRays[probeIndex];
+                const Surface* surfaces = &hitRecords.surfaces[(size_t)probeIndex * (size_t)desc.probeNumRays];
+                for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+                {
+                    const Surface& surface = surfaces[rayIndex];
+                    float3 rayDirection = DDGIGetProbeRayDirection(rayIndex, desc);
+                    rayData[DDGIGetRayDataTexelCoords(rayIndex, (int)probeIndex, desc)] = ShadeProbeRay(context, desc, resources, rayDirection, (surface.hitT >= 0.f) ? &surface : nullptr, rayIndex, shadowRays);
+                }
+                relitRays += (uint64_t)numRays;
+            }
+            numRelitRays += relitRays;
+            numShadowRays += shadowRays;
+        });
+
+        stats.relightSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        stats.numRelitRays += numRelitRays;
+        stats.numShadowRays += numShadowRays;
+        return true;
+    }
+
+    void FindEditedProbes(const Context& context, const DDGIVolume& volume, uint32_t numThreads, std::vector<int>& probeIndices)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        const Texture2DArray& probeData = volume.GetProbeData();
+        const Texture2DArray& rayData = volume.GetProbeRayData();
+
+        // The bounds the edited instances had, and have now
+        std::vector<AABB> boxes;
+        for (const Scenes::MeshInstance& instance : context.scene->instances)
+        {
+            if (!instance.dirty) continue;
+            boxes.push_back(instance.previousBoundingBox);
+            boxes.push_back(instance.boundingBox);
+        }
+
+        probeIndices.clear();
+        if (boxes.empty()) return;
+
+        std::vector<uint8_t> edited((size_t)volume.GetNumProbes(), 0);
+        ParallelFor((uint32_t)volume.GetNumProbes(), ProbeChunkSize, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t index = begin; index < end; index++)
+            {
+                int3 probeCoords = DDGIGetProbeCoords((int)index, desc);
+                int probeIndex = DDGIGetScrollingProbeIndex(probeCoords, desc);
+                float3 origin = DDGIGetProbeWorldPosition(probeCoords, desc, probeData);
+
+                // The probe's voxel overlaps an instance, its classification can change
+                bool probeEdited = false;
+                for (const AABB& box : boxes)
+                {
+                    if (origin.x + desc.probeSpacing.x >= box.min.x && origin.x - desc.probeSpacing.x <= box.max.x &&
+                        origin.y + desc.probeSpacing.y >= box.min.y && origin.y - desc.probeSpacing.y <= box.max.y &&
+                        origin.z + desc.probeSpacing.z >= box.min.z && origin.z - desc.probeSpacing.z <= box.max.z) probeEdited = true;
+                }
+
+                // Inactive probes only traced the fixed rays, fixed rays are not shaded when relocation or classification use them
+                int numRays = desc.probeNumRays;
+                if (DDGILoadProbeState(probeIndex, probeData, desc) == DDGI_PROBE_STATE_INACTIVE) numRays = std::min(numRays, DDGI_NUM_FIXED_RAYS);
+                int firstShadedRay = (desc.probeRelocationEnabled || desc.probeClassificationEnabled) ? DDGI_NUM_FIXED_RAYS : 0;
+
+                for (int rayIndex = 0; rayIndex < numRays && !probeEdited; rayIndex++)
+                {
+                    float hitDistance = rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, desc)].w;
+                    float3 direction = DDGIGetProbeRayDirection(rayIndex, desc);
+                    if (hitDistance >= MissDistance)
+                    {
+                        // Missed rays may now hit an instance within the maximum ray distance
+                        for (const AABB& box : boxes)
+                        {
+                            if (SegmentIntersectsBox(origin, direction, desc.probeMaxRayDistance, box)) probeEdited = true;
+                        }
+                        continue;
+                    }
+                    probeEdited = ProbeRayReachesBoxes(context, origin, direction, hitDistance, rayIndex >= firstShadedRay, boxes);
+                }
+
+                if (probeEdited) edited[(size_t)probeIndex] = 1;
+            }
+        });
+
+        for (int probeIndex = 0; probeIndex < volume.GetNumProbes(); probeIndex++)
+        {
+            if (edited[(size_t)probeIndex]) probeIndices.push_back(probeIndex);
+        }
+    }
+
+    void ClearProbes(DDGIVolume& volume, const std::vector<int>& probeIndices)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        Texture2DArray* textures[] = { &volume.GetProbeIrradiance(), &volume.GetProbeDistance() };
+        uint32_t numTexels[] = { (uint32_t)desc.probeNumIrradianceInteriorTexels + 2, (uint32_t)desc.probeNumDistanceInteriorTexels + 2 };
+        Texture2DArray& probeData = volume.GetProbeData();
+        for (int probeIndex : probeIndices)
+        {
+            uint3 probeTexCoords = DDGIGetProbeTexelCoords(probeIndex, desc);
+
+            // Probes start active and unrelocated, the same as in a new volume (inactive probes blend again before they are classified)
+            float4& data = probeData[probeTexCoords];
+            data = { 0.f, 0.f, 0.f, DDGIEncodeProbeData(DDGI_PROBE_STATE_ACTIVE, DDGIDecodeProbeHistory(data.w)) };
+            for (uint32_t textureIndex = 0; textureIndex < 2; textureIndex++)
+            {
+                for (uint32_t y = 0; y < numTexels[textureIndex]; y++)
+                {
+                    for (uint32_t x = 0; x < numTexels[textureIndex]; x++)
+                    {
+                        textures[textureIndex]->Texel((probeTexCoords.x * numTexels[textureIndex]) + x, (probeTexCoords.y * numTexels[textureIndex]) + y, probeTexCoords.z) = { 0.f, 0.f, 0.f, 1.f };
+                    }
+                }
+            }
+        }
+    }
+
+    float GetProbeVariability(const DDGIVolume& volume)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        const Texture2DArray& probeData = volume.GetProbeData();
+        const Texture2DArray& variability = volume.GetProbeVariability();
+
+        // Inactive probes are not blended and don't contribute
+        double sum = 0.0;
+        uint64_t count = 0;
+        int numTexels = desc.probeNumIrradianceInteriorTexels;
+        const std::vector<int>& updateList = volume.GetProbeUpdateList();
+        int numProbes = updateList.empty() ? volume.GetNumProbes() : (int)updateList.size();
+        for (int index = 0; index < numProbes; index++)
+        {
+            int probeIndex = updateList.empty() ? index : updateList[(size_t)index];
+            if (DDGILoadProbeState(probeIndex, probeData, desc) == DDGI_PROBE_STATE_INACTIVE) continue;
+
+            uint3 probeTexCoords = DDGIGetProbeTexelCoords(probeIndex, desc);
+            for (int ty = 0; ty < numTexels; ty++)
+            {
+                for (int tx = 0; tx < numTexels; tx++)
+                {
+                    sum += (double)variability.Texel((probeTexCoords.x * (uint32_t)numTexels) + (uint32_t)tx, (probeTexCoords.y * (uint32_t)numTexels) + (uint32_t)ty, probeTexCoords.z).x;
+                }
+            }
+            count += (uint64_t)(numTexels * numTexels);
+        }
+        return (count > 0) ? (float)(sum / (double)count) : 0.f;
+    }
+
+    bool WriteVolume(const DDGIVolume& volume, const std::string& directory, std::ofstream& log)
+    {
+        std::filesystem::create_directories(directory);
+
+        std::string baseName = directory + "/DDGIVolume[" + volume.GetName() + "]";
+        const char* names[] = { "-Irradiance", "-Distance", "-ProbeData", "-Variability" };
+        const Texture2DArray* textures[] = { &volume.GetProbeIrradiance(), &volume.GetProbeDistance(), &volume.GetProbeData(), &volume.GetProbeVariability() };
+        for (uint32_t index = 0; index < 4; index++)
+        {
+            std::string file = baseName + names[index] + ".bin";
+            if (!WriteTexture(*textures[index], file))
+            {
+                log << "\nError: failed to write '" << file << "'";
+                return false;
+            }
+        }
+        return true;
+    }
+}
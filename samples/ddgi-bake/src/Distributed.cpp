@@ -0,0 +1,735 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Distributed.h"
+
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <numeric>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+using namespace rtxgi;
+using namespace rtxgi::cpu;
+
+namespace Distributed
+{
+    static const char FileMagic[4] = { 'D', 'D', 'G', 'W' };
+    static const uint32_t FileVersion = 1;
+
+    // Restarts of each local worker after it fails (terminations to test restarts don't count)
+    static const uint32_t MaxWorkerRestarts = 8;
+
+    // Units claimed for longer are handed out again: the worker (e.g. on another machine) may have stopped. Finishing a unit twice is harmless.
+    static const double ClaimTimeoutSeconds = 120.0;
+
+    // Workers exit after waiting this long for units
+    static const double WorkerIdleSeconds = 300.0;
+
+    // Local workers are terminated when they don't stop this long after the bake
+    static const double WorkerStopSeconds = 10.0;
+
+    static const std::chrono::milliseconds PollInterval(2);
+
+    /**
+     * Header of a volume's textures after a number of updates.
+     */
+    struct StateHeader
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t volumeIndex;
+        uint32_t iteration;
+        uint32_t numProbes;
+        uint32_t converged;
+        float    variability;
+        uint32_t padding;
+        double   convergeSeconds;
+    };
+
+    /**
+     * Header of a finished unit's textures (after update 'iteration') and the worker's stats.
+     */
+    struct ResultHeader
+    {
+        char     magic[4];
+        uint32_t version;
+        uint32_t volumeIndex;
+        uint32_t iteration;
+        uint32_t firstProbe;
+        uint32_t numProbes;
+        uint64_t numProbeRays;
+        uint64_t numShadowRays;
+        uint64_t numProbeBVHBuilds;
+        double   traceSeconds;
+        double   updateSeconds;
+    };
+
+    /**
+     * A block of probes of one update of a volume.
+     */
+    struct Unit
+    {
+        uint32_t    volumeIndex = 0;
+        uint32_t    iteration = 0;
+        uint32_t    firstProbe = 0;
+        uint32_t    numProbes = 0;
+        std::string name;
+        bool        done = false;
+    };
+
+    struct Process
+    {
+#if defined(_WIN32)
+        HANDLE handle = nullptr;
+#else
+        pid_t  pid = -1;
+#endif
+    };
+
+    struct Worker
+    {
+        std::string id;
+        Process     process;
+        bool        running = false;
+        bool        terminated = false;   // Terminated to test restarts
+        uint32_t    restarts = 0;
+    };
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    double GetSeconds(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool StartProcess(const std::vector<std::string>& arguments, Process& process)
+    {
+#if defined(_WIN32)
+        std::string commandLine;
+        for (const std::string& argument : arguments) commandLine += "\"" + argument + "\" ";
+
+        STARTUPINFOA startupInfo = {};
+        startupInfo.cb = sizeof(startupInfo);
+        PROCESS_INFORMATION processInfo = {};
+        if (!CreateProcessA(nullptr, &commandLine[0], nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo)) return false;
+        CloseHandle(processInfo.hThread);
+        process.handle = processInfo.hProcess;
+        return true;
+#else
+        std::vector<char*> argv;
+        for (const std::string& argument : arguments) argv.push_back(const_cast<char*>(argument.c_str()));
+        argv.push_back(nullptr);
+        return (posix_spawnp(&process.pid, argv[0], nullptr, nullptr, argv.data(), environ) == 0);
+#endif
+    }
+
+    // Returns true if the process exited, with its exit code (non-zero when it crashed or was terminated)
+    bool HasExited(Process& process, int& exitCode)
+    {
+#if defined(_WIN32)
+        if (WaitForSingleObject(process.handle, 0) != WAIT_OBJECT_0) return false;
+        DWORD code = 1;
+        GetExitCodeProcess(process.handle, &code);
+        CloseHandle(process.handle);
+        process.handle = nullptr;
+        exitCode = (int)code;
+#else
+        int status = 0;
+        if (waitpid(process.pid, &status, WNOHANG) == 0) return false;
+        process.pid = -1;
+        exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+#endif
+        return true;
+    }
+
+    uint32_t GetProcessNumber()
+    {
+#if defined(_WIN32)
+        return (uint32_t)GetCurrentProcessId();
+#else
+        return (uint32_t)getpid();
+#endif
+    }
+
+    void KillProcess(Process& process)
+    {
+#if defined(_WIN32)
+        TerminateProcess(process.handle, 1);
+#else
+        kill(process.pid, SIGKILL);
+#endif
+    }
+
+    /**
+     * Calls visit(textureIndex, x, y, z) for the texels of a range of probes: the irradiance (0), distance (1), probe data (2),
+     * and variability (3) texels of one probe after another. This is the texel order of the work directory's files.
+     */
+    template<typename Visit>
+    void VisitProbeTexels(const DDGIVolumeDescGPU& desc, uint32_t firstProbe, uint32_t numProbes, Visit visit)
+    {
+        uint32_t numTexels[] = { (uint32_t)desc.probeNumIrradianceInteriorTexels + 2, (uint32_t)desc.probeNumDistanceInteriorTexels + 2, 1, (uint32_t)desc.probeNumIrradianceInteriorTexels };
+        for (uint32_t probeIndex = firstProbe; probeIndex < (firstProbe + numProbes); probeIndex++)
+        {
+            uint3 probeTexCoords = DDGIGetProbeTexelCoords((int)probeIndex, desc);
+            for (uint32_t textureIndex = 0; textureIndex < 4; textureIndex++)
+            {
+                for (uint32_t y = 0; y < numTexels[textureIndex]; y++)
+                {
+                    for (uint32_t x = 0; x < numTexels[textureIndex]; x++)
+                    {
+                        visit(textureIndex, (probeTexCoords.x * numTexels[textureIndex]) + x, (probeTexCoords.y * numTexels[textureIndex]) + y, probeTexCoords.z);
+                    }
+                }
+            }
+        }
+    }
+
+    size_t GetNumProbeTexels(const DDGIVolumeDescGPU& desc)
+    {
+        size_t numIrradianceTexels = (size_t)desc.probeNumIrradianceInteriorTexels + 2;
+        size_t numDistanceTexels = (size_t)desc.probeNumDistanceInteriorTexels + 2;
+        size_t numVariabilityTexels = (size_t)desc.probeNumIrradianceInteriorTexels;
+        return (numIrradianceTexels * numIrradianceTexels) + (numDistanceTexels * numDistanceTexels) + 1 + (numVariabilityTexels * numVariabilityTexels);
+    }
+
+    void GetProbeTexels(const DDGIVolume& volume, uint32_t firstProbe, uint32_t numProbes, std::vector<float4>& texels)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        const Texture2DArray* textures[] = { &volume.GetProbeIrradiance(), &volume.GetProbeDistance(), &volume.GetProbeData(), &volume.GetProbeVariability() };
+        texels.resize(GetNumProbeTexels(desc) * (size_t)numProbes);
+
+        size_t index = 0;
+        VisitProbeTexels(desc, firstProbe, numProbes, [&](uint32_t textureIndex, uint32_t x, uint32_t y, uint32_t z) { texels[index++] = textures[textureIndex]->Texel(x, y, z); });
+    }
+
+    void SetProbeTexels(DDGIVolume& volume, uint32_t firstProbe, uint32_t numProbes, const float4* texels)
+    {
+        DDGIVolumeDescGPU desc = volume.GetDescGPU();
+        Texture2DArray* textures[] = { &volume.GetProbeIrradiance(), &volume.GetProbeDistance(), &volume.GetProbeData(), &volume.GetProbeVariability() };
+
+        size_t index = 0;
+        VisitProbeTexels(desc, firstProbe, numProbes, [&](uint32_t textureIndex, uint32_t x, uint32_t y, uint32_t z) { textures[textureIndex]->Texel(x, y, z) = texels[index++]; });
+    }
+
+    // Describes the volumes of a bake, workers and resumed bakes must have the same
+    std::string GetJobDescription(const Configs::Config& config)
+    {
+        std::ostringstream job;
+        job << "DDGIBake work directory " << FileVersion << "\n";
+        for (const Configs::DDGIVolume& volume : config.ddgi.volumes)
+        {
+            job << volume.name << ": origin " << volume.origin.x << " " << volume.origin.y << " " << volume.origin.z
+                << ", spacing " << volume.probeSpacing.x << " " << volume.probeSpacing.y << " " << volume.probeSpacing.z
+                << ", counts " << volume.probeCounts.x << " " << volume.probeCounts.y << " " << volume.probeCounts.z
+                << ", rays " << volume.probeNumRays << ", texels " << volume.probeNumIrradianceTexels << " " << volume.probeNumDistanceTexels
+                << ", seed " << volume.rngSeed << "\n";
+        }
+        if (config.scene.proxyRatio > 0.f) job << "Proxy meshes: ratio " << config.scene.proxyRatio << ", error " << config.scene.proxyMaxError << "\n";
+        return job.str();
+    }
+
+    std::string GetStatePath(const std::string& directory, uint32_t volumeIndex, uint32_t iteration)
+    {
+        return directory + "/state-v" + std::to_string(volumeIndex) + "-i" + std::to_string(iteration) + ".bin";
+    }
+
+    std::string GetUnitName(uint32_t volumeIndex, uint32_t iteration, uint32_t firstProbe, uint32_t numProbes)
+    {
+        return "unit-v" + std::to_string(volumeIndex) + "-i" + std::to_string(iteration) + "-p" + std::to_string(firstProbe) + "-n" + std::to_string(numProbes);
+    }
+
+    bool EndsWith(const std::string& text, const std::string& suffix)
+    {
+        return (text.size() >= suffix.size()) && (text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0);
+    }
+
+    bool ReadText(const std::string& path, std::string& text)
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in.is_open()) return false;
+        std::ostringstream stream;
+        stream << in.rdbuf();
+        text = stream.str();
+        return true;
+    }
+
+    // Writes the file to a temporary name and renames it, so readers see the whole file or none of it
+    bool WriteFile(const std::string& path, const std::string& writerId, const void* header, size_t headerSize, const std::vector<float4>& texels)
+    {
+        std::string temporaryPath = path + "." + writerId + ".tmp";
+        {
+            std::ofstream out(temporaryPath, std::ios::out | std::ios::binary);
+            if (!out.is_open()) return false;
+            out.write(reinterpret_cast<const char*>(header), (std::streamsize)headerSize);
+            out.write(reinterpret_cast<const char*>(texels.data()), (std::streamsize)(texels.size() * sizeof(float4)));
+            if (!out.good()) return false;
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, path, error);
+        if (error) std::filesystem::remove(temporaryPath, error);
+        return !error;
+    }
+
+    template<typename Header>
+    bool ReadFile(const std::string& path, Header& header, size_t numTexelsPerProbe, std::vector<float4>& texels)
+    {
+        std::ifstream in(path, std::ios::in | std::ios::binary);
+        if (!in.is_open()) return false;
+
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!in.good() || std::memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.version != FileVersion) return false;
+
+        texels.resize(numTexelsPerProbe * (size_t)header.numProbes);
+        std::streamsize size = (std::streamsize)(texels.size() * sizeof(float4));
+        in.read(reinterpret_cast<char*>(texels.data()), size);
+        return (in.gcount() == size);
+    }
+
+    bool WriteState(const std::string& directory, uint32_t volumeIndex, const DDGIVolume& volume, const Bake::Results& results, std::vector<float4>& texels)
+    {
+        StateHeader header = {};
+        std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+        header.version = FileVersion;
+        header.volumeIndex = volumeIndex;
+        header.iteration = results.iterations[volumeIndex];
+        header.numProbes = (uint32_t)volume.GetNumProbes();
+        header.converged = (results.convergeSeconds[volumeIndex] >= 0.0) ? 1 : 0;
+        header.variability = results.variability[volumeIndex];
+        header.convergeSeconds = results.convergeSeconds[volumeIndex];
+
+        GetProbeTexels(volume, 0, header.numProbes, texels);
+        return WriteFile(GetStatePath(directory, volumeIndex, header.iteration), "coordinator", &header, sizeof(header), texels);
+    }
+
+    bool ReadState(const std::string& path, const DDGIVolume& volume, uint32_t volumeIndex, StateHeader& header, std::vector<float4>& texels)
+    {
+        if (!ReadFile(path, header, GetNumProbeTexels(volume.GetDescGPU()), texels)) return false;
+        return (header.volumeIndex == volumeIndex) && (header.numProbes == (uint32_t)volume.GetNumProbes());
+    }
+
+    // Hands a unit claimed by a worker out again
+    void Requeue(const std::string& directory, const std::string& claimName)
+    {
+        std::error_code error;
+        std::filesystem::rename(directory + "/" + claimName, directory + "/" + claimName.substr(0, claimName.find(".claim-")) + ".todo", error);
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    bool Coordinate(const std::string& executable, const std::string& configPath, const Configs::Config& config, const Bake::Settings& settings,
+                    std::vector<std::unique_ptr<DDGIVolume>>& volumes, const std::vector<float>& thresholds,
+                    Bake::Results& results, Bake::Stats& stats, std::ofstream& log)
+    {
+        const std::string& directory = settings.workDirectory;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+
+        // A work directory holds one bake, a bake is resumed with the same volumes
+        std::string job = GetJobDescription(config);
+        std::string existingJob;
+        if (ReadText(directory + "/job.txt", existingJob) && existingJob != job)
+        {
+            log << "\nError: the work directory '" << directory << "' belongs to a bake of other volumes";
+            return false;
+        }
+        if (!WriteFile(directory + "/job.txt", "coordinator", job.data(), job.size(), {}))
+        {
+            log << "\nError: failed to write to the work directory '" << directory << "'";
+            return false;
+        }
+        std::filesystem::remove(directory + "/stop", error);
+
+        // Find the checkpoints of a previous run, hand out the units it had claimed again, and remove partial files
+        size_t numVolumes = volumes.size();
+        std::vector<int> checkpoints(numVolumes, -1);
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+        {
+            std::string name = entry.path().filename().string();
+            uint32_t volumeIndex = 0, iteration = 0;
+            if (EndsWith(name, ".tmp")) std::filesystem::remove(entry.path(), error);
+            else if (name.find(".claim-") != std::string::npos) Requeue(directory, name);
+            else if (sscanf(name.c_str(), "state-v%u-i%u.bin", &volumeIndex, &iteration) == 2 && volumeIndex < numVolumes)
+            {
+                checkpoints[volumeIndex] = std::max(checkpoints[volumeIndex], (int)iteration);
+            }
+        }
+
+        results.iterations.assign(numVolumes, 0);
+        results.variability.assign(numVolumes, 0.f);
+        results.convergeSeconds.assign(numVolumes, -1.0);
+
+        std::vector<float4> texels;
+        uint64_t numActiveProbes = 0;
+        for (uint32_t volumeIndex = 0; volumeIndex < (uint32_t)numVolumes; volumeIndex++)
+        {
+            DDGIVolume& volume = *volumes[volumeIndex];
+            if (checkpoints[volumeIndex] >= 0)
+            {
+                StateHeader header;
+                if (!ReadState(GetStatePath(directory, volumeIndex, (uint32_t)checkpoints[volumeIndex]), volume, volumeIndex, header, texels))
+                {
+                    log << "\nError: failed to read the checkpoint of DDGIVolume '" << volume.GetName() << "'";
+                    return false;
+                }
+                SetProbeTexels(volume, 0, header.numProbes, texels.data());
+                results.iterations[volumeIndex] = header.iteration;
+                results.variability[volumeIndex] = header.variability;
+                results.convergeSeconds[volumeIndex] = header.converged ? header.convergeSeconds : -1.0;
+            }
+            else if (!WriteState(directory, volumeIndex, volume, results, texels))
+            {
+                log << "\nError: failed to write the state of DDGIVolume '" << volume.GetName() << "'";
+                return false;
+            }
+
+            if (results.convergeSeconds[volumeIndex] < 0.0) numActiveProbes += (uint64_t)volume.GetNumProbes();
+        }
+
+        // Split updates into about two units per worker, so workers that finish early pick up the remaining units
+        uint64_t numUnitWorkers = std::max(settings.numWorkers, 1u);
+        uint32_t blockProbes = settings.blockProbes;
+        if (blockProbes == 0) blockProbes = (uint32_t)std::max<uint64_t>(1, (numActiveProbes + (2 * numUnitWorkers) - 1) / (2 * numUnitWorkers));
+
+        // Start the local workers, dividing the hardware threads between them. Names include the process id, workers of a previous run may still be finishing a unit.
+        uint32_t workerThreads = settings.numThreads;
+        if (workerThreads == 0) workerThreads = std::max(1u, GetHardwareThreadCount() / (uint32_t)numUnitWorkers);
+
+        std::vector<Worker> workers(settings.numWorkers);
+        auto startWorker = [&](Worker& worker)
+        {
+            std::vector<std::string> arguments = { executable, configPath, "--work-dir", directory, "--worker", worker.id,
+                                                   "--threads", std::to_string(workerThreads), "--probe-bvhs", settings.probeBVHs ? "1" : "0",
+                                                   "--wavefront", settings.wavefront ? "1" : "0" };
+            if (settings.proxyRatio >= 0.f) arguments.insert(arguments.end(), { "--proxy-ratio", std::to_string(settings.proxyRatio) });
+            worker.running = StartProcess(arguments, worker.process);
+            if (!worker.running) log << "\nError: failed to start worker '" << worker.id << "'";
+        };
+        for (uint32_t workerIndex = 0; workerIndex < settings.numWorkers; workerIndex++)
+        {
+            workers[workerIndex].id = "local" + std::to_string(workerIndex) + "-" + std::to_string(GetProcessNumber());
+            startWorker(workers[workerIndex]);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        auto claimScan = start;
+        std::map<std::string, std::chrono::steady_clock::time_point> claims;   // Claims and when they were first seen (the coordinator's clock)
+        bool failed = false;
+        for (uint32_t round = 0; !failed; round++)
+        {
+            // Queue the next update of the volumes that haven't converged, units finished by a previous run are kept
+            std::vector<Unit> units;
+            for (uint32_t volumeIndex = 0; volumeIndex < (uint32_t)numVolumes; volumeIndex++)
+            {
+                if (results.convergeSeconds[volumeIndex] >= 0.0 || results.iterations[volumeIndex] >= settings.maxIterations) continue;
+
+                uint32_t numProbes = (uint32_t)volumes[volumeIndex]->GetNumProbes();
+                for (uint32_t firstProbe = 0; firstProbe < numProbes; firstProbe += blockProbes)
+                {
+                    Unit unit;
+                    unit.volumeIndex = volumeIndex;
+                    unit.iteration = results.iterations[volumeIndex];
+                    unit.firstProbe = firstProbe;
+                    unit.numProbes = std::min(blockProbes, numProbes - firstProbe);
+                    unit.name = GetUnitName(unit.volumeIndex, unit.iteration, unit.firstProbe, unit.numProbes);
+                    units.push_back(unit);
+
+                    std::string path = directory + "/" + unit.name;
+                    if (!std::filesystem::exists(path + ".result", error)) std::ofstream(path + ".todo", std::ios::out | std::ios::binary);
+                }
+            }
+            if (units.empty()) break;
+
+            // Merge the finished units' probes into the volumes
+            size_t numDone = 0;
+            while (!failed)
+            {
+                for (Unit& unit : units)
+                {
+                    if (unit.done) continue;
+
+                    std::string path = directory + "/" + unit.name + ".result";
+                    if (!std::filesystem::exists(path, error)) continue;
+
+                    DDGIVolume& volume = *volumes[unit.volumeIndex];
+                    ResultHeader header;
+                    if (!ReadFile(path, header, GetNumProbeTexels(volume.GetDescGPU()), texels) || header.volumeIndex != unit.volumeIndex || header.iteration != unit.iteration
+                        || header.firstProbe != unit.firstProbe || header.numProbes != unit.numProbes)
+                    {
+                        // Run the unit again
+                        log << "\nInvalid result of unit '" << unit.name << "'";
+                        std::filesystem::rename(path, directory + "/" + unit.name + ".todo", error);
+                        continue;
+                    }
+
+                    SetProbeTexels(volume, unit.firstProbe, unit.numProbes, texels.data());
+                    stats.numProbeRays += header.numProbeRays;
+                    stats.numShadowRays += header.numShadowRays;
+                    stats.numProbeBVHBuilds += header.numProbeBVHBuilds;
+                    stats.traceSeconds += header.traceSeconds;
+                    stats.updateSeconds += header.updateSeconds;
+                    unit.done = true;
+                    numDone++;
+
+                    // Test restarts: terminate a worker while it (likely) holds a unit
+                    if (numDone == 1 && settings.failWorkers > 0 && !workers.empty() && ((round + 1) % settings.failWorkers) == 0)
+                    {
+                        Worker& worker = workers[(round / settings.failWorkers) % workers.size()];
+                        if (worker.running)
+                        {
+                            KillProcess(worker.process);
+                            worker.terminated = true;
+                        }
+                    }
+                }
+                if (numDone == units.size()) break;
+
+                // Restart local workers that exited and hand out their units again
+                bool running = false;
+                for (Worker& worker : workers)
+                {
+                    int exitCode = 0;
+                    if (worker.running && HasExited(worker.process, exitCode))
+                    {
+                        worker.running = false;
+                        log << "\nWorker '" << worker.id << "' exited with code " << exitCode << (worker.terminated ? " (terminated to test restarts)" : "");
+                        for (const Unit& unit : units) Requeue(directory, unit.name + ".claim-" + worker.id);
+
+                        if (worker.terminated || worker.restarts < MaxWorkerRestarts)
+                        {
+                            if (!worker.terminated) worker.restarts++;
+                            worker.terminated = false;
+                            startWorker(worker);
+                        }
+                    }
+                    running |= worker.running;
+                }
+                if (!workers.empty() && !running)
+                {
+                    log << "\nError: all local workers failed, see the worker logs in '" << directory << "'";
+                    failed = true;
+                    break;
+                }
+
+                // Hand out units again that have been claimed for too long (once a second)
+                if (GetSeconds(claimScan) > 1.0)
+                {
+                    claimScan = std::chrono::steady_clock::now();
+                    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+                    {
+                        std::string name = entry.path().filename().string();
+                        if (name.find(".claim-") == std::string::npos || EndsWith(name, ".tmp")) continue;
+
+                        auto claim = claims.emplace(name, claimScan).first;
+                        if (GetSeconds(claim->second) > ClaimTimeoutSeconds)
+                        {
+                            log << "\nUnit '" << name << "' timed out";
+                            Requeue(directory, name);
+                            claims.erase(claim);
+                        }
+                    }
+                }
+
+                std::this_thread::sleep_for(PollInterval);
+            }
+            if (failed) break;
+
+            // Test convergence the same way as a single process bake and checkpoint the updated volumes
+            for (uint32_t volumeIndex = 0; volumeIndex < (uint32_t)numVolumes; volumeIndex++)
+            {
+                if (std::none_of(units.begin(), units.end(), [volumeIndex](const Unit& unit) { return unit.volumeIndex == volumeIndex; })) continue;
+
+                uint32_t iteration = results.iterations[volumeIndex]++;
+                results.variability[volumeIndex] = Bake::GetProbeVariability(*volumes[volumeIndex]);
+                if (results.iterations[volumeIndex] >= settings.minIterations && results.variability[volumeIndex] < thresholds[volumeIndex]) results.convergeSeconds[volumeIndex] = GetSeconds(start);
+
+                if (!WriteState(directory, volumeIndex, *volumes[volumeIndex], results, texels))
+                {
+                    log << "\nError: failed to write the state of DDGIVolume '" << volumes[volumeIndex]->GetName() << "'";
+                    failed = true;
+                    break;
+                }
+                std::filesystem::remove(GetStatePath(directory, volumeIndex, iteration), error);
+            }
+            for (const Unit& unit : units) std::filesystem::remove(directory + "/" + unit.name + ".result", error);
+            claims.clear();
+        }
+
+        // Stop the workers, the final states stay in the work directory (running the bake again only loads them)
+        std::ofstream(directory + "/stop", std::ios::out | std::ios::binary);
+        auto stop = std::chrono::steady_clock::now();
+        for (Worker& worker : workers)
+        {
+            int exitCode = 0;
+            while (worker.running && !HasExited(worker.process, exitCode))
+            {
+                if (GetSeconds(stop) > WorkerStopSeconds) KillProcess(worker.process);
+                std::this_thread::sleep_for(PollInterval);
+            }
+        }
+
+        // Remove the units left by stopped or duplicate workers
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+        {
+            if (entry.path().filename().string().compare(0, 5, "unit-") == 0) std::filesystem::remove(entry.path(), error);
+        }
+        return !failed;
+    }
+
+    bool Work(const Bake::Context& context, const Configs::Config& config, const Bake::Settings& settings,
+              std::vector<std::unique_ptr<DDGIVolume>>& volumes, uint32_t numThreads, std::ofstream& log)
+    {
+        const std::string& directory = settings.workDirectory;
+        std::error_code error;
+
+        // Wait for the coordinator's job, it must bake the same volumes
+        std::string job = GetJobDescription(config);
+        std::string coordinatorJob;
+        auto idleStart = std::chrono::steady_clock::now();
+        while (!ReadText(directory + "/job.txt", coordinatorJob))
+        {
+            if (GetSeconds(idleStart) > WorkerIdleSeconds) return true;
+            std::this_thread::sleep_for(PollInterval);
+        }
+        if (coordinatorJob != job)
+        {
+            log << "\nError: the work directory '" << directory << "' belongs to a bake of other volumes";
+            return false;
+        }
+
+        size_t numVolumes = volumes.size();
+        std::vector<Bake::ProbeBVHs> probeBVHs(numVolumes);
+        std::vector<float4> state, texels;
+        std::set<std::pair<uint32_t, uint32_t>> blocks;   // Volume and first probe of the units the worker updated
+        Unit loaded;
+        loaded.volumeIndex = (uint32_t)numVolumes;
+        while (!std::filesystem::exists(directory + "/stop", error))
+        {
+            // Claim a unit: renames are atomic, so only one worker's rename of a unit succeeds
+            // Units of the blocks the worker updated before are tried first, their probe BVHs are already built
+            std::vector<std::string> queued;
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+            {
+                std::string name = entry.path().filename().string();
+                if (EndsWith(name, ".todo")) queued.push_back(name);
+            }
+            std::sort(queued.begin(), queued.end());
+            std::stable_partition(queued.begin(), queued.end(), [&blocks](const std::string& name)
+            {
+                uint32_t volumeIndex, iteration, firstProbe;
+                return (sscanf(name.c_str(), "unit-v%u-i%u-p%u", &volumeIndex, &iteration, &firstProbe) == 3) && blocks.count({ volumeIndex, firstProbe }) > 0;
+            });
+
+            Unit unit;
+            std::string claimPath;
+            for (const std::string& name : queued)
+            {
+                if (sscanf(name.c_str(), "unit-v%u-i%u-p%u-n%u", &unit.volumeIndex, &unit.iteration, &unit.firstProbe, &unit.numProbes) != 4) continue;
+                if (unit.volumeIndex >= numVolumes || (uint64_t)unit.firstProbe + unit.numProbes > (uint64_t)volumes[unit.volumeIndex]->GetNumProbes()) continue;
+
+                unit.name = name.substr(0, name.size() - 5);
+                std::filesystem::rename(directory + "/" + name, directory + "/" + unit.name + ".claim-" + settings.workerId, error);
+                if (error) continue;
+
+                claimPath = directory + "/" + unit.name + ".claim-" + settings.workerId;
+                break;
+            }
+
+            if (claimPath.empty())
+            {
+                if (GetSeconds(idleStart) > WorkerIdleSeconds) break;
+                std::this_thread::sleep_for(PollInterval);
+                continue;
+            }
+
+            // Start from the volume's textures before the update (the coordinator has moved on when they're gone)
+            DDGIVolume& volume = *volumes[unit.volumeIndex];
+            if (loaded.volumeIndex != unit.volumeIndex || loaded.iteration != unit.iteration)
+            {
+                StateHeader header;
+                if (!ReadState(GetStatePath(directory, unit.volumeIndex, unit.iteration), volume, unit.volumeIndex, header, state) || header.iteration != unit.iteration)
+                {
+                    std::filesystem::remove(claimPath, error);
+                    continue;
+                }
+                SetProbeTexels(volume, 0, header.numProbes, state.data());
+                loaded = unit;
+            }
+
+            // Update the unit's probes
+            Bake::Stats stats;
+            std::vector<int> probeIndices(unit.numProbes);
+            std::iota(probeIndices.begin(), probeIndices.end(), (int)unit.firstProbe);
+            volume.SetProbeUpdateList(probeIndices);
+
+            Bake::UpdateVolume(volume, unit.iteration);
+            Bake::TraceProbes(context, volume, settings.probeBVHs ? &probeBVHs[unit.volumeIndex] : nullptr, nullptr, numThreads, stats);
+
+            auto updateStart = std::chrono::steady_clock::now();
+            DDGIVolume* updated[] = { &volume };
+            UpdateDDGIVolumeProbes(1, updated, numThreads);
+            RelocateDDGIVolumeProbes(1, updated, numThreads);
+            ClassifyDDGIVolumeProbes(1, updated, numThreads);
+            stats.updateSeconds = GetSeconds(updateStart);
+            volume.SetProbeUpdateList({});
+
+            // Write the result and restore the unit's probes, the next unit of the update starts from the same textures
+            ResultHeader header = {};
+            std::memcpy(header.magic, FileMagic, sizeof(FileMagic));
+            header.version = FileVersion;
+            header.volumeIndex = unit.volumeIndex;
+            header.iteration = unit.iteration;
+            header.firstProbe = unit.firstProbe;
+            header.numProbes = unit.numProbes;
+            header.numProbeRays = stats.numProbeRays;
+            header.numShadowRays = stats.numShadowRays;
+            header.numProbeBVHBuilds = stats.numProbeBVHBuilds;
+            header.traceSeconds = stats.traceSeconds;
+            header.updateSeconds = stats.updateSeconds;
+
+            GetProbeTexels(volume, unit.firstProbe, unit.numProbes, texels);
+            SetProbeTexels(volume, unit.firstProbe, unit.numProbes, state.data() + (GetNumProbeTexels(volume.GetDescGPU()) * unit.firstProbe));
+            if (!WriteFile(directory + "/" + unit.name + ".result", settings.workerId, &header, sizeof(header), texels))
+            {
+                log << "\nError: failed to write the result of unit '" << unit.name << "'";
+                return false;
+            }
+            std::filesystem::remove(claimPath, error);
+            blocks.insert({ unit.volumeIndex, unit.firstProbe });
+            idleStart = std::chrono::steady_clock::now();
+        }
+        return true;
+    }
+}
@@ -0,0 +1,30 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "UI.h"
+
+// Console replacements of the Test Harness message boxes used by the scene and texture loaders (there is no window to show them)
+namespace Graphics
+{
+    namespace UI
+    {
+        bool MessageBox(std::string message)
+        {
+            std::cerr << message << "\n";
+            return true;
+        }
+
+        bool MessageRetryBox(std::string message)
+        {
+            std::cerr << message << "\n";
+            return false;
+        }
+    }
+}
@@ -0,0 +1,632 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Bake.h"
+#include "Caches.h"
+#include "Distributed.h"
+
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+
+using namespace rtxgi;
+
+void PrintUsage()
+{
+    std::cout << "Usage: DDGIBake <config.ini> [--option value ...]\n\n";
+    std::cout << "Bakes the DDGIVolumes of a Test Harness scene config on the CPU and writes them to disk.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  --iterations      Maximum number of probe updates (256)\n";
+    std::cout << "  --min-iterations  Minimum number of probe updates before convergence is tested (8)\n";
+    std::cout << "  --threshold       Mean probe variability below which a volume has converged (the volume's config value)\n";
+    std::cout << "  --threads         Number of threads, 0 uses all hardware threads (0)\n";
+    std::cout << "  --output          Output directory (the scene's screenshot path)\n";
+    std::cout << "  --probe-bvhs      Trace probe rays with per-probe BVHs (1) or per ray with the scene BVH (0) (1)\n";
+    std::cout << "  --proxy-ratio     Trace probe rays against simplified proxy meshes with this fraction of the triangles, 0 traces the full geometry (the config's scene.proxyRatio)\n";
+    std::cout << "  --wavefront       Trace probe rays in sorted stages (1) or ray after ray (0) (0)\n";
+    std::cout << "  --relight         Relight-only probe updates at recorded hits after the bake, the directional light turns once about the up axis (0)\n";
+    std::cout << "  --edit-instance   Move a scene instance after the bake and re-bake only the probes it can change (-1)\n";
+    std::cout << "  --edit-offset     Translation of the edited instance, as x,y,z (0,0,0)\n";
+    std::cout << "  --edit-check      Also re-bake the edited scene from scratch and compare (0)\n";
+    std::cout << "  --workers         Bake with worker processes, resuming from the work directory's checkpoints (0)\n";
+    std::cout << "  --work-dir        Work directory of a distributed bake, shared with workers on other machines (DDGIBake-work with --workers)\n";
+    std::cout << "  --block-probes    Probes per work unit of a distributed bake, 0 splits updates into about two units per worker (0)\n";
+    std::cout << "  --worker          Run as a worker with this name (unique per work directory) of the distributed bake in --work-dir\n";
+    std::cout << "  --fail-workers    Terminate a local worker every N updates of a distributed bake, to test restarts (0)\n";
+    std::cout << "  --workers-check   Also bake in a single process and compare with the distributed bake (0)\n";
+}
+
+bool ParseArguments(int argc, char* argv[], std::string& configPath, Bake::Settings& settings)
+{
+    if (argc < 2 || (argc % 2) != 0) return false;
+
+    configPath = argv[1];
+    try
+    {
+        for (int index = 2; index < argc; index += 2)
+        {
+            std::string option = argv[index];
+            std::string value = argv[index + 1];
+            if (option.compare("--iterations") == 0) settings.maxIterations = (uint32_t)std::stoul(value);
+            else if (option.compare("--min-iterations") == 0) settings.minIterations = (uint32_t)std::stoul(value);
+            else if (option.compare("--threshold") == 0) settings.variabilityThreshold = std::stof(value);
+            else if (option.compare("--threads") == 0) settings.numThreads = (uint32_t)std::stoul(value);
+            else if (option.compare("--output") == 0) settings.outputPath = value;
+            else if (option.compare("--probe-bvhs") == 0) settings.probeBVHs = (std::stoul(value) != 0);
+            else if (option.compare("--proxy-ratio") == 0) settings.proxyRatio = std::stof(value);
+            else if (option.compare("--wavefront") == 0) settings.wavefront = (std::stoul(value) != 0);
+            else if (option.compare("--relight") == 0) settings.relightUpdates = (uint32_t)std::stoul(value);
+            else if (option.compare("--edit-instance") == 0) settings.editInstance = std::stoi(value);
+            else if (option.compare("--edit-offset") == 0)
+            {
+                size_t first = value.find(',');
+                size_t second = value.find(',', first + 1);
+                if (first == std::string::npos || second == std::string::npos) return false;
+                settings.editOffset = { std::stof(value.substr(0, first)), std::stof(value.substr(first + 1, second - first - 1)), std::stof(value.substr(second + 1)) };
+            }
+            else if (option.compare("--edit-check") == 0) settings.editCheck = (std::stoul(value) != 0);
+            else if (option.compare("--workers") == 0) settings.numWorkers = (uint32_t)std::stoul(value);
+            else if (option.compare("--work-dir") == 0) settings.workDirectory = value;
+            else if (option.compare("--block-probes") == 0) settings.blockProbes = (uint32_t)std::stoul(value);
+            else if (option.compare("--worker") == 0) settings.workerId = value;
+            else if (option.compare("--fail-workers") == 0) settings.failWorkers = (uint32_t)std::stoul(value);
+            else if (option.compare("--workers-check") == 0) settings.workersCheck = (std::stoul(value) != 0);
+            else return false;
+        }
+    }
+    catch (const std::exception&)
+    {
+        return false;
+    }
+
+    // Distributed bakes only bake (relighting and edits need the baked volumes in one process)
+    if (settings.numWorkers > 0 && settings.workDirectory.empty()) settings.workDirectory = "DDGIBake-work";
+    if (!settings.workerId.empty() && settings.workDirectory.empty()) return false;
+    if (settings.IsDistributed() && (settings.relightUpdates > 0 || settings.editInstance >= 0)) return false;
+    return (settings.maxIterations > 0) && (settings.minIterations <= settings.maxIterations);
+}
+
+double GetSeconds(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+/**
+ * Rotate a direction about the coordinate system's up axis.
+ */
+float3 RotateAboutUpAxis(const float3& direction, float angle)
+{
+    float c = cosf(angle);
+    float s = sinf(angle);
+#if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT || COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT
+    return { (c * direction.x) + (s * direction.z), direction.y, (c * direction.z) - (s * direction.x) };
+#elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP || COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT_Z_UP
+    return { (c * direction.x) - (s * direction.y), (s * direction.x) + (c * direction.y), direction.z };
+#endif
+}
+
+/**
+ * Trace, blend, relocate, and classify the probes (in the same order as the SDK's GPU update) until all volumes converge.
+ * Converged volumes stop updating, the same as the Test Harness does with probe variability.
+ * Only the probes of a volume's probe update list are traced and updated when it isn't empty.
+ */
+void BakeVolumes(const Bake::Context& context, const Bake::Settings& settings, const std::vector<std::unique_ptr<cpu::DDGIVolume>>& volumes,
+                 std::vector<Bake::ProbeBVHs>& probeBVHs, const std::vector<float>& thresholds, uint32_t numThreads, Bake::Stats& stats, Bake::Results& results)
+{
+    size_t numVolumes = volumes.size();
+    results.iterations.resize(numVolumes, 0);
+    results.variability.resize(numVolumes, 0.f);
+    results.convergeSeconds.resize(numVolumes, -1.0);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32_t iteration = 0; iteration < settings.maxIterations; iteration++)
+    {
+        std::vector<cpu::DDGIVolume*> active;
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+        {
+            if (results.convergeSeconds[volumeIndex] < 0.0) active.push_back(volumes[volumeIndex].get());
+        }
+        if (active.empty()) break;
+
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+        {
+            if (results.convergeSeconds[volumeIndex] >= 0.0) continue;
+
+            Bake::UpdateVolume(*volumes[volumeIndex], iteration);
+            Bake::TraceProbes(context, *volumes[volumeIndex], settings.probeBVHs ? &probeBVHs[volumeIndex] : nullptr, nullptr, numThreads, stats);
+        }
+
+        auto updateStart = std::chrono::high_resolution_clock::now();
+        uint32_t numActive = (uint32_t)active.size();
+        cpu::UpdateDDGIVolumeProbes(numActive, active.data(), numThreads);
+        cpu::RelocateDDGIVolumeProbes(numActive, active.data(), numThreads);
+        cpu::ClassifyDDGIVolumeProbes(numActive, active.data(), numThreads);
+        stats.updateSeconds += GetSeconds(updateStart);
+
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+        {
+            if (results.convergeSeconds[volumeIndex] >= 0.0) continue;
+
+            results.iterations[volumeIndex] = iteration + 1;
+            results.variability[volumeIndex] = Bake::GetProbeVariability(*volumes[volumeIndex]);
+            if ((iteration + 1) >= settings.minIterations && results.variability[volumeIndex] < thresholds[volumeIndex]) results.convergeSeconds[volumeIndex] = GetSeconds(start);
+        }
+    }
+}
+
+/**
+ * Computes the mean absolute difference of two volumes' irradiance (RGB), over all probes and of the probe that differs most.
+ */
+void GetIrradianceDifference(const cpu::DDGIVolume& a, const cpu::DDGIVolume& b, double& meanDifference, double& maxProbeDifference)
+{
+    DDGIVolumeDescGPU desc = a.GetDescGPU();
+    uint32_t numInteriorTexels = (uint32_t)desc.probeNumIrradianceInteriorTexels;
+    uint32_t numTexels = numInteriorTexels + 2;
+
+    double sum = 0.0;
+    maxProbeDifference = 0.0;
+    for (int probeIndex = 0; probeIndex < a.GetNumProbes(); probeIndex++)
+    {
+        uint3 probeTexCoords = cpu::DDGIGetProbeTexelCoords(probeIndex, desc);
+        double probeSum = 0.0;
+        for (uint32_t y = 1; y <= numInteriorTexels; y++)
+        {
+            for (uint32_t x = 1; x <= numInteriorTexels; x++)
+            {
+                const float4& texelA = a.GetProbeIrradiance().Texel((probeTexCoords.x * numTexels) + x, (probeTexCoords.y * numTexels) + y, probeTexCoords.z);
+                const float4& texelB = b.GetProbeIrradiance().Texel((probeTexCoords.x * numTexels) + x, (probeTexCoords.y * numTexels) + y, probeTexCoords.z);
+                probeSum += fabs(texelA.x - texelB.x) + fabs(texelA.y - texelB.y) + fabs(texelA.z - texelB.z);
+            }
+        }
+        probeSum /= (3.0 * (double)(numInteriorTexels * numInteriorTexels));
+        maxProbeDifference = std::max(maxProbeDifference, probeSum);
+        sum += probeSum;
+    }
+    meanDifference = sum / (double)a.GetNumProbes();
+}
+
+/**
+ * Move a scene instance after the bake and re-bake only the probes it can change: the probes are found from the last trace's ray data,
+ * cleared, and traced and updated until they converge again. Optionally checks the result against a full re-bake of the edited scene.
+ */
+bool Edit(const Configs::Config& config, Scenes::Scene& scene, Bake::Context& context, const Bake::Settings& settings, std::vector<std::unique_ptr<cpu::DDGIVolume>>& volumes,
+          std::vector<Bake::ProbeBVHs>& probeBVHs, const std::vector<float>& thresholds, uint32_t numThreads)
+{
+    size_t numVolumes = volumes.size();
+    if (settings.editInstance < 0 || settings.editInstance >= (int)scene.instances.size())
+    {
+        std::cerr << "The edited instance " << settings.editInstance << " is not in the scene\n";
+        return false;
+    }
+
+    // Keep the baked volumes to compare with
+    std::vector<cpu::DDGIVolume> baked;
+    if (settings.editCheck)
+    {
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++) baked.push_back(*volumes[volumeIndex]);
+    }
+
+    // Move the instance and rebuild the top level BVH
+    auto start = std::chrono::high_resolution_clock::now();
+    float transform[3][4];
+    memcpy(transform, scene.instances[settings.editInstance].transform, sizeof(transform));
+    transform[0][3] += settings.editOffset.x;
+    transform[1][3] += settings.editOffset.y;
+    transform[2][3] += settings.editOffset.z;
+    Scenes::SetInstanceTransform(scene, (uint32_t)settings.editInstance, transform);
+
+    BVH::BuildDesc desc;
+    desc.numThreads = numThreads;
+    BVH::BuildInstances(scene, desc, context.bvh);
+
+    // Find and clear the probes the edit can change. Volumes without any are not re-baked.
+    Bake::Results results;
+    results.convergeSeconds.resize(numVolumes, -1.0);
+    std::vector<size_t> numEditedProbes(numVolumes);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        std::vector<int> probeIndices;
+        Bake::FindEditedProbes(context, *volumes[volumeIndex], numThreads, probeIndices);
+        Bake::ClearProbes(*volumes[volumeIndex], probeIndices);
+        volumes[volumeIndex]->SetProbeUpdateList(probeIndices);
+        numEditedProbes[volumeIndex] = probeIndices.size();
+        if (probeIndices.empty()) results.convergeSeconds[volumeIndex] = 0.0;
+
+        // Probe BVHs reference the instance transforms
+        probeBVHs[volumeIndex].probes.clear();
+    }
+    Scenes::ClearInstanceEdits(scene);
+
+    Bake::Stats stats;
+    BakeVolumes(context, settings, volumes, probeBVHs, thresholds, numThreads, stats, results);
+    double editSeconds = GetSeconds(start);
+
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++) volumes[volumeIndex]->SetProbeUpdateList({});
+
+    std::cout << "\nMoved instance '" << scene.instances[settings.editInstance].name << "', incremental re-bake: " << editSeconds << " s, "
+              << (double)stats.numProbeRays * 1e-6 << " M probe rays\n";
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        std::cout << std::setw(24) << std::left << config.ddgi.volumes[volumeIndex].name << std::right << std::setw(8) << numEditedProbes[volumeIndex] << " / "
+                  << volumes[volumeIndex]->GetNumProbes() << " probes, " << results.iterations[volumeIndex] << " iterations\n";
+    }
+    if (!settings.editCheck) return true;
+
+    // Re-bake the edited scene from scratch. Ray rotations only depend on the volumes and their update counts, so the full re-bake uses the same ray rotations as the bake.
+    std::vector<std::unique_ptr<cpu::DDGIVolume>> references(numVolumes);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        DDGIVolumeDesc volumeDesc;
+        Bake::GetVolumeDesc(config.ddgi.volumes[volumeIndex], volumeDesc);
+        references[volumeIndex] = std::make_unique<cpu::DDGIVolume>();
+        if (references[volumeIndex]->Create(volumeDesc) != ERTXGIStatus::OK) return false;
+    }
+
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<Bake::ProbeBVHs> referenceProbeBVHs(numVolumes);
+    Bake::Stats referenceStats;
+    Bake::Results referenceResults;
+    BakeVolumes(context, settings, references, referenceProbeBVHs, thresholds, numThreads, referenceStats, referenceResults);
+    double referenceSeconds = GetSeconds(start);
+
+    // The edit's changes must be gone: the probe that differs most from the full re-bake must differ less than before the edit
+    // (converged probes differ by the noise of their bakes, edits that don't change the bake pass)
+    bool passed = true;
+    std::cout << "Full re-bake: " << referenceSeconds << " s, " << (double)referenceStats.numProbeRays * 1e-6 << " M probe rays ("
+              << (referenceSeconds / editSeconds) << "x the incremental time)\n";
+    std::cout << std::setprecision(6);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        double incrementalMean, incrementalMax, bakedMean, bakedMax;
+        GetIrradianceDifference(*volumes[volumeIndex], *references[volumeIndex], incrementalMean, incrementalMax);
+        GetIrradianceDifference(baked[volumeIndex], *references[volumeIndex], bakedMean, bakedMax);
+        bool closer = (bakedMax == 0.0) || (incrementalMax < bakedMax);
+        passed &= closer;
+
+        std::cout << std::setw(24) << std::left << config.ddgi.volumes[volumeIndex].name << std::right << " irradiance difference to the full re-bake (mean, worst probe): "
+                  << incrementalMean << ", " << incrementalMax << " incremental, " << bakedMean << ", " << bakedMax << " before the edit" << (closer ? "" : " (FAILED)") << "\n";
+        references[volumeIndex]->Destroy();
+        baked[volumeIndex].Destroy();
+    }
+    std::cout << std::setprecision(2);
+    return passed;
+}
+
+/**
+ * Relight the baked volumes: record the probe ray hits with one more trace, then re-shade the rays at the recorded hits
+ * while the directional light turns about the up axis (a time-of-day change). Probes don't move and the ray rotation is
+ * kept (volumes are not updated), so only blending runs after relighting. The last relight is checked against a full trace.
+ */
+bool Relight(Scenes::Scene& scene, const Bake::Context& context, const Bake::Settings& settings, std::vector<std::unique_ptr<cpu::DDGIVolume>>& volumes,
+             std::vector<Bake::ProbeBVHs>& probeBVHs, uint32_t numThreads, Bake::Stats& stats, bool& matches)
+{
+    size_t numVolumes = volumes.size();
+    std::vector<cpu::DDGIVolume*> all(numVolumes);
+    std::vector<Bake::HitRecords> hitRecords(numVolumes);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        all[volumeIndex] = volumes[volumeIndex].get();
+        volumes[volumeIndex]->Update();
+        Bake::TraceProbes(context, *volumes[volumeIndex], settings.probeBVHs ? &probeBVHs[volumeIndex] : nullptr, &hitRecords[volumeIndex], numThreads, stats);
+    }
+    cpu::UpdateDDGIVolumeProbes((uint32_t)numVolumes, all.data(), numThreads);
+
+    float3 sunDirection = scene.hasDirectionalLight ? scene.lights[0].data.direction : float3{ 0.f, 0.f, 0.f };
+    matches = true;
+    for (uint32_t update = 0; update < settings.relightUpdates; update++)
+    {
+        if (scene.hasDirectionalLight)
+        {
+            float angle = 2.f * RTXGI_PI * (float)(update + 1) / (float)settings.relightUpdates;
+            scene.lights[0].data.direction = RotateAboutUpAxis(sunDirection, angle);
+        }
+
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+        {
+            if (!Bake::RelightProbes(context, *volumes[volumeIndex], hitRecords[volumeIndex], numThreads, stats)) return false;
+
+            // The last relight must match tracing the same rays with the same lights and irradiance
+            if ((update + 1) == settings.relightUpdates)
+            {
+                std::vector<float4> relit = volumes[volumeIndex]->GetProbeRayData().texels;
+                Bake::Stats traceStats;
+                Bake::TraceProbes(context, *volumes[volumeIndex], settings.probeBVHs ? &probeBVHs[volumeIndex] : nullptr, nullptr, numThreads, traceStats);
+                const std::vector<float4>& traced = volumes[volumeIndex]->GetProbeRayData().texels;
+                if (std::memcmp(relit.data(), traced.data(), relit.size() * sizeof(float4)) != 0) matches = false;
+            }
+        }
+
+        auto updateStart = std::chrono::high_resolution_clock::now();
+        cpu::UpdateDDGIVolumeProbes((uint32_t)numVolumes, all.data(), numThreads);
+        stats.updateSeconds += GetSeconds(updateStart);
+    }
+    return true;
+}
+
+/**
+ * Bake the volumes again in this process and compare them with the distributed bake, they must be bit-identical.
+ */
+bool CheckWorkers(const Configs::Config& config, const Bake::Context& context, const Bake::Settings& settings, const std::vector<std::unique_ptr<cpu::DDGIVolume>>& volumes,
+                  const std::vector<float>& thresholds, const Bake::Results& results, uint32_t numThreads)
+{
+    size_t numVolumes = volumes.size();
+    std::vector<std::unique_ptr<cpu::DDGIVolume>> references(numVolumes);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        DDGIVolumeDesc desc;
+        Bake::GetVolumeDesc(config.ddgi.volumes[volumeIndex], desc);
+        references[volumeIndex] = std::make_unique<cpu::DDGIVolume>();
+        if (references[volumeIndex]->Create(desc) != ERTXGIStatus::OK) return false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Bake::ProbeBVHs> probeBVHs(numVolumes);
+    Bake::Stats stats;
+    Bake::Results referenceResults;
+    BakeVolumes(context, settings, references, probeBVHs, thresholds, numThreads, stats, referenceResults);
+    std::cout << "\nSingle process bake: " << GetSeconds(start) << " s\n";
+
+    bool identical = true;
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        const cpu::DDGIVolume& a = *volumes[volumeIndex];
+        const cpu::DDGIVolume& b = *references[volumeIndex];
+        const cpu::Texture2DArray* texturesA[] = { &a.GetProbeIrradiance(), &a.GetProbeDistance(), &a.GetProbeData(), &a.GetProbeVariability() };
+        const cpu::Texture2DArray* texturesB[] = { &b.GetProbeIrradiance(), &b.GetProbeDistance(), &b.GetProbeData(), &b.GetProbeVariability() };
+
+        bool same = (results.iterations[volumeIndex] == referenceResults.iterations[volumeIndex]);
+        for (uint32_t textureIndex = 0; textureIndex < 4; textureIndex++)
+        {
+            same &= (std::memcmp(texturesA[textureIndex]->texels.data(), texturesB[textureIndex]->texels.data(), texturesA[textureIndex]->texels.size() * sizeof(float4)) == 0);
+        }
+        identical &= same;
+
+        std::cout << std::setw(24) << std::left << config.ddgi.volumes[volumeIndex].name << std::right << " " << referenceResults.iterations[volumeIndex] << " iterations, "
+                  << (same ? "identical to the distributed bake" : "DIFFERS from the distributed bake") << "\n";
+        references[volumeIndex]->Destroy();
+    }
+    return identical;
+}
+
+/**
+ * Run the bake, a distributed bake's coordinator, or one of its workers.
+ */
+int Run(const std::string& executable, const std::string& configPath, const Bake::Settings& settings)
+{
+    bool worker = !settings.workerId.empty();
+    bool coordinator = settings.IsDistributed() && !worker;
+
+    // Workers log to the work directory
+    std::string logPath = "log.txt";
+    if (worker)
+    {
+        std::error_code error;
+        std::filesystem::create_directories(settings.workDirectory, error);
+        logPath = settings.workDirectory + "/log-" + settings.workerId + ".txt";
+    }
+
+    std::ofstream log;
+    log.open(logPath, std::ios::out);
+    if (!log.is_open()) return EXIT_FAILURE;
+
+    Configs::Config config;
+    Scenes::Scene scene;
+
+    // Load and parse the config file
+    log << "Loading config file...";
+    if (!Configs::ParseCommandLine({ configPath }, config, log) || !Configs::Load(config, log))
+    {
+        std::cerr << "Failed to load the config file '" << configPath << "', see " << logPath << "\n";
+        log.close();
+        return EXIT_FAILURE;
+    }
+    if (settings.proxyRatio >= 0.f) config.scene.proxyRatio = settings.proxyRatio;
+    log << "done.\n";
+
+    if (config.ddgi.volumes.empty())
+    {
+        std::cerr << "The config has no DDGIVolumes to bake\n";
+        log.close();
+        return EXIT_FAILURE;
+    }
+
+    uint32_t numThreads = (settings.numThreads == 0) ? cpu::GetHardwareThreadCount() : settings.numThreads;
+
+    // Load the scene (or its cache) and build the scene BVH. The coordinator of a distributed bake doesn't trace rays (unless it checks the bake).
+    Bake::Context context;
+    double sceneSeconds = 0.0;
+    double bvhSeconds = 0.0;
+    bool traces = !coordinator || settings.workersCheck;
+    if (traces)
+    {
+        log << "Initializing the scene...";
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!Scenes::Initialize(config, scene, log))
+        {
+            std::cerr << "Failed to initialize the scene, see " << logPath << "\n";
+            log.close();
+            return EXIT_FAILURE;
+        }
+        sceneSeconds = GetSeconds(start);
+        log << "done.\n";
+
+        log << "Building the scene BVH...";
+        start = std::chrono::high_resolution_clock::now();
+        Bake::CreateContext(config, scene, numThreads, context);
+        context.wavefront = settings.wavefront;
+        bvhSeconds = GetSeconds(start);
+        log << "done.\n";
+    }
+
+    // Create the volumes
+    log << "Creating DDGIVolumes...";
+    size_t numVolumes = config.ddgi.volumes.size();
+    std::vector<std::unique_ptr<cpu::DDGIVolume>> volumes(numVolumes);
+    std::vector<Bake::ProbeBVHs> probeBVHs(numVolumes);
+    std::vector<float> thresholds(numVolumes);
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        DDGIVolumeDesc desc;
+        Bake::GetVolumeDesc(config.ddgi.volumes[volumeIndex], desc);
+
+        volumes[volumeIndex] = std::make_unique<cpu::DDGIVolume>();
+        if (volumes[volumeIndex]->Create(desc) != ERTXGIStatus::OK)
+        {
+            std::cerr << "Failed to create DDGIVolume '" << config.ddgi.volumes[volumeIndex].name << "'\n";
+            log.close();
+            return EXIT_FAILURE;
+        }
+
+        thresholds[volumeIndex] = (settings.variabilityThreshold < 0.f) ? config.ddgi.volumes[volumeIndex].probeVariabilityThreshold : settings.variabilityThreshold;
+    }
+    log << "done.\n";
+
+    // Workers run the coordinator's units until the bake is done
+    if (worker)
+    {
+        bool worked = Distributed::Work(context, config, settings, volumes, numThreads, log);
+        if (!worked) std::cerr << "Worker '" << settings.workerId << "' failed, see " << logPath << "\n";
+        for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++) volumes[volumeIndex]->Destroy();
+        Caches::FinishSerialize(scene, log, true);
+        Scenes::Cleanup(scene);
+        log.close();
+        return worked ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    if (coordinator)
+    {
+        std::cout << "Baking '" << config.scene.name << "': " << numVolumes << " volumes, " << settings.numWorkers << " local workers, work directory '"
+                  << settings.workDirectory << "'\n\n";
+    }
+    else
+    {
+        std::cout << "Baking '" << config.scene.name << "': " << scene.numTriangles << " triangles, " << scene.lights.size() << " lights, "
+                  << numVolumes << " volumes, " << numThreads << " threads\n";
+        std::cout << "Scene load: " << (sceneSeconds * 1000.0) << " ms, BVH build: " << (bvhSeconds * 1000.0) << " ms\n\n";
+    }
+
+    // Bake the volumes
+    Bake::Stats stats;
+    Bake::Results results;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (coordinator)
+    {
+        if (!Distributed::Coordinate(executable, configPath, config, settings, volumes, thresholds, results, stats, log))
+        {
+            std::cerr << "The distributed bake failed, see log.txt\n";
+            log.close();
+            return EXIT_FAILURE;
+        }
+    }
+    else
+    {
+        BakeVolumes(context, settings, volumes, probeBVHs, thresholds, numThreads, stats, results);
+    }
+    double bakeSeconds = GetSeconds(start);
+
+    // Relight-only updates after the bake
+    Bake::Stats relightStats;
+    bool relightMatches = true;
+    if (settings.relightUpdates > 0 && !Relight(scene, context, settings, volumes, probeBVHs, numThreads, relightStats, relightMatches))
+    {
+        std::cerr << "Failed to relight the DDGIVolumes, the hit records don't match the probe rays\n";
+        log.close();
+        return EXIT_FAILURE;
+    }
+
+    // Report
+    double totalRays = (double)(stats.numProbeRays + stats.numShadowRays);
+    std::cout << std::setw(24) << std::left << "Volume" << std::right << std::setw(12) << "Iterations" << std::setw(14) << "Variability" << std::setw(16) << "Converged (s)\n";
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        std::cout << std::setw(24) << std::left << config.ddgi.volumes[volumeIndex].name << std::right << std::setw(12) << results.iterations[volumeIndex]
+                  << std::setw(14) << std::setprecision(4) << results.variability[volumeIndex] << std::setw(15) << std::setprecision(2);
+        if (results.convergeSeconds[volumeIndex] >= 0.0) std::cout << results.convergeSeconds[volumeIndex] << "\n";
+        else std::cout << "no" << "\n";
+    }
+    std::cout << "\nBake time:   " << bakeSeconds << " s (" << stats.traceSeconds << " s tracing, " << stats.updateSeconds << " s probe updates"
+              << (coordinator ? ", summed over the workers" : "") << ")\n";
+    std::cout << "Probe rays:  " << (double)stats.numProbeRays * 1e-6 << " M, " << ((double)stats.numProbeRays / stats.traceSeconds * 1e-6) << " Mrays/s";
+    if (settings.probeBVHs) std::cout << " (" << stats.numProbeBVHBuilds << " probe BVH builds)";
+    std::cout << "\n";
+    std::cout << "All rays:    " << totalRays * 1e-6 << " M (with shadow rays), " << (totalRays / stats.traceSeconds * 1e-6) << " Mrays/s\n";
+    if (context.bvh.proxies)
+    {
+        uint64_t numTriangles = 0;
+        for (const Scenes::Mesh& mesh : scene.meshes) numTriangles += mesh.numIndices / 3;
+        std::cout << "Proxies:     " << scene.numProxyTriangles << " of " << numTriangles << " triangles ("
+                  << (100.0 * scene.numProxyTriangles / std::max(numTriangles, (uint64_t)1)) << "%) traced by probe rays\n";
+    }
+    if (settings.relightUpdates > 0)
+    {
+        double traceRate = (double)stats.numProbeRays / stats.traceSeconds;
+        double relightRate = (double)relightStats.numRelitRays / relightStats.relightSeconds;
+        std::cout << "Relight:     " << settings.relightUpdates << " updates, " << (double)relightStats.numRelitRays * 1e-6 << " M probe rays in " << relightStats.relightSeconds << " s, "
+                  << (relightRate * 1e-6) << " Mrays/s (" << (relightRate / traceRate) << "x the bake's trace rate), "
+                  << (relightMatches ? "matches tracing" : "DIFFERS from tracing") << "\n";
+    }
+
+    // Incremental re-bake after a scene edit
+    bool editPassed = true;
+    if (settings.editInstance >= 0)
+    {
+        editPassed = Edit(config, scene, context, settings, volumes, probeBVHs, thresholds, numThreads);
+        if (!editPassed && !settings.editCheck)
+        {
+            log.close();
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Compare a distributed bake with a single process bake
+    bool workersMatch = true;
+    if (coordinator && settings.workersCheck) workersMatch = CheckWorkers(config, context, settings, volumes, thresholds, results, numThreads);
+    std::cout << std::defaultfloat;
+
+    // Write the volumes
+    std::string directory = settings.outputPath.empty() ? config.scene.screenshotPath : settings.outputPath;
+    log << "Writing DDGIVolumes to '" << directory << "'...";
+    for (size_t volumeIndex = 0; volumeIndex < numVolumes; volumeIndex++)
+    {
+        if (!Bake::WriteVolume(*volumes[volumeIndex], directory, log))
+        {
+            std::cerr << "Failed to write the DDGIVolumes, see log.txt\n";
+            log.close();
+            return EXIT_FAILURE;
+        }
+        volumes[volumeIndex]->Destroy();
+    }
+    log << "done.\n";
+    std::cout << "\nWrote " << numVolumes << " volumes to '" << directory << "'\n";
+
+    Caches::FinishSerialize(scene, log, true);
+    Scenes::Cleanup(scene);
+    log.close();
+    return (editPassed && workersMatch) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string configPath;
+    Bake::Settings settings;
+    if (!ParseArguments(argc, argv, configPath, settings))
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    return Run(argv[0], configPath, settings);
+}
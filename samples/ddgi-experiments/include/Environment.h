@@ -0,0 +1,60 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <rtxgi/ddgi/cpu/DDGIVolume_CPU.h>
+
+namespace Environment
+{
+    /**
+     * An infinite, two-sided wall plane: dot(position, normal) = distance.
+     */
+    struct Wall
+    {
+        rtxgi::float3 normal;
+        float         distance;
+    };
+
+    /**
+     * A synthetic, analytic lighting environment: a sky gradient, a small and bright sun disk, an infinite floor plane, and optional walls.
+     * The small sun is deliberately undersampled by probe rays so probe updates have realistic Monte Carlo noise.
+     */
+    struct Desc
+    {
+        rtxgi::float3 skyHorizonRadiance = { 0.6f, 0.7f, 0.8f };
+        rtxgi::float3 skyZenithRadiance = { 0.2f, 0.3f, 0.6f };
+        rtxgi::float3 sunDirection = { 0.3f, 0.8f, 0.5f };      // Normalized when used
+        rtxgi::float3 sunRadiance = { 30.f, 28.f, 25.f };
+        float         sunCosAngle = 0.995f;                     // Cosine of the sun disk's angular radius
+        rtxgi::float3 floorRadiance = { 0.25f, 0.2f, 0.15f };
+        float         floorHeight = -10.f;                      // Height of the floor along the up axis
+        bool          solidGround = false;                      // When true, rays below the floor hit its backface (the ground is solid)
+        rtxgi::float3 wallRadiance = { 0.3f, 0.3f, 0.35f };
+        std::vector<Wall> walls;
+    };
+
+    // Returns the radiance of the environment (sky and sun) in the given direction
+    rtxgi::float3 GetSkyRadiance(const Desc& desc, const rtxgi::float3& direction);
+
+    // Returns the up axis of the active coordinate system
+    rtxgi::float3 GetUpAxis();
+
+    // Traces every probe ray of the volume against the environment and stores the results in the volume's ray data.
+    // Like the test harness' ProbeTraceRGS, rays start at relocated probe positions and inactive probes only trace their fixed rays.
+    void TraceProbes(const Desc& desc, rtxgi::cpu::DDGIVolume& volume);
+
+    // Computes the reference (converged, noise free) irradiance of every probe's irradiance texel, in linear space.
+    // Uses the same cosine weighted estimator as probe blending with a dense set of ray directions.
+    void ComputeReferenceIrradiance(const Desc& desc, const rtxgi::cpu::DDGIVolume& volume, int numDirections, std::vector<rtxgi::float3>& irradiance);
+
+    // Reads every probe's irradiance texel and decodes it to linear space (same order as ComputeReferenceIrradiance())
+    void ReadProbeIrradiance(const rtxgi::cpu::DDGIVolume& volume, std::vector<rtxgi::float3>& irradiance);
+}
@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace Experiments
+{
+    /**
+     * Command line arguments of an experiment, in "--name value" pairs.
+     */
+    struct Arguments
+    {
+        std::vector<std::string> tokens;
+
+        Arguments(int argc, char* argv[]) : tokens(argv, argv + argc) {}
+
+        const char* Find(const char* name) const
+        {
+            for (size_t index = 0; index + 1 < tokens.size(); index++)
+            {
+                if (tokens[index].compare(name) == 0) return tokens[index + 1].c_str();
+            }
+            return nullptr;
+        }
+
+        int GetInt(const char* name, int defaultValue) const
+        {
+            const char* value = Find(name);
+            return value ? std::atoi(value) : defaultValue;
+        }
+
+        float GetFloat(const char* name, float defaultValue) const
+        {
+            const char* value = Find(name);
+            return value ? (float)std::atof(value) : defaultValue;
+        }
+    };
+
+    namespace Blending
+    {
+        // Benchmarks CPU probe blending throughput and checks results are identical across thread counts
+        bool Run(const Arguments& args);
+    }
+
+    namespace Irradiance
+    {
+        // Benchmarks batched CPU irradiance queries and checks they match single (shader port) queries
+        bool Run(const Arguments& args);
+    }
+
+    namespace Visibility
+    {
+        // Measures per-cell probe visibility masks: sampled probes, query speedup, and error against unmasked queries
+        bool Run(const Arguments& args);
+    }
+
+    namespace Relocation
+    {
+        // Bakes probe relocation offsets and classification states on the CPU, checks results are identical across thread counts
+        bool Run(const Arguments& args);
+    }
+
+    namespace Hysteresis
+    {
+        // Compares fixed and adaptive per-probe hysteresis. Reports time-to-converge and flicker metrics.
+        bool Run(const Arguments& args);
+    }
+}
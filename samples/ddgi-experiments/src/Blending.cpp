@@ -0,0 +1,177 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+
+#include <rtxgi/ddgi/cpu/DDGIVolume_CPU.h>
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+using namespace rtxgi;
+
+namespace Experiments
+{
+    namespace Blending
+    {
+        struct Settings
+        {
+            int numProbes = 16;                 // Probes per axis
+            int numRays = 256;
+            int numTexels = 8;                  // Interior texels (irradiance and distance)
+            int numThreads = 0;
+            int numIterations = 10;
+            int seed = 1;
+        };
+
+        //----------------------------------------------------------------------------------------------------------
+        // Private Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        /**
+         * Fills the volume's ray data with deterministic pseudo-random radiance and hit distances (including backfaces).
+         */
+        void FillRayData(cpu::DDGIVolume& volume, uint32_t seed)
+        {
+            uint32_t state = seed * 747796405u + 2891336453u;
+            auto random = [&state]()
+            {
+                state = (state * 1664525u) + 1013904223u;
+                return (float)(state >> 8) * (1.f / 16777216.f);
+            };
+
+            for (float4& texel : volume.GetProbeRayData().texels)
+            {
+                float distance = 0.1f + (random() * 8.f);
+                if (random() < 0.05f) distance *= -0.2f;
+                texel = { random() * 2.f, random() * 2.f, random() * 2.f, distance };
+            }
+        }
+
+        DDGIVolumeDesc GetVolumeDesc(const Settings& settings)
+        {
+            DDGIVolumeDesc desc;
+            desc.name = (char*)"Blending Benchmark";
+            desc.rngSeed = (uint32_t)settings.seed;
+            desc.origin = { 0.f, 0.f, 0.f };
+            desc.probeSpacing = { 1.f, 1.f, 1.f };
+            desc.probeCounts = { settings.numProbes, settings.numProbes, settings.numProbes };
+            desc.probeNumRays = settings.numRays;
+            desc.probeNumIrradianceInteriorTexels = settings.numTexels;
+            desc.probeNumIrradianceTexels = settings.numTexels + 2;
+            desc.probeNumDistanceInteriorTexels = settings.numTexels;
+            desc.probeNumDistanceTexels = settings.numTexels + 2;
+            desc.probeRayDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeIrradianceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDistanceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeVariabilityFormat = EDDGIVolumeTextureFormat::F32;
+            desc.probeVariabilityEnabled = true;
+            return desc;
+        }
+
+        bool IsEqual(const cpu::Texture2DArray& a, const cpu::Texture2DArray& b)
+        {
+            return a.texels.size() == b.texels.size() && memcmp(a.texels.data(), b.texels.data(), a.GetSizeInBytes()) == 0;
+        }
+
+        /**
+         * Runs the given number of probe updates and returns the average time of an update, in milliseconds.
+         */
+        double Update(cpu::DDGIVolume& volume, const Settings& settings, uint32_t numThreads, int numIterations)
+        {
+            cpu::DDGIVolume* volumes[] = { &volume };
+
+            double milliseconds = 0.0;
+            for (int iteration = 0; iteration < numIterations; iteration++)
+            {
+                volume.Update();
+                FillRayData(volume, (uint32_t)(settings.seed + iteration));
+
+                auto start = std::chrono::high_resolution_clock::now();
+                cpu::UpdateDDGIVolumeProbes(1, volumes, numThreads);
+                auto end = std::chrono::high_resolution_clock::now();
+                milliseconds += std::chrono::duration<double, std::milli>(end - start).count();
+            }
+            return milliseconds / (double)numIterations;
+        }
+
+        //----------------------------------------------------------------------------------------------------------
+        // Public Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        bool Run(const Arguments& args)
+        {
+            Settings settings;
+            settings.numProbes = args.GetInt("--probes", settings.numProbes);
+            settings.numRays = args.GetInt("--rays", settings.numRays);
+            settings.numTexels = args.GetInt("--texels", settings.numTexels);
+            settings.numThreads = args.GetInt("--threads", settings.numThreads);
+            settings.numIterations = args.GetInt("--iterations", settings.numIterations);
+            settings.seed = args.GetInt("--seed", settings.seed);
+
+            if (settings.numProbes <= 0 || settings.numRays <= cpu::DDGI_NUM_FIXED_RAYS || settings.numTexels <= 0 || settings.numThreads < 0 || settings.numIterations <= 0)
+            {
+                std::cerr << "Invalid settings: --probes, --texels, and --iterations must be positive, --rays must be greater than " << cpu::DDGI_NUM_FIXED_RAYS << "\n";
+                return false;
+            }
+
+            uint32_t numThreads = (settings.numThreads > 0) ? (uint32_t)settings.numThreads : cpu::GetHardwareThreadCount();
+
+            DDGIVolumeDesc desc = GetVolumeDesc(settings);
+            int numProbes = desc.probeCounts.x * desc.probeCounts.y * desc.probeCounts.z;
+            std::cout << "Probe blending benchmark: " << numProbes << " probes, " << settings.numRays << " rays per probe, "
+                      << settings.numTexels << "x" << settings.numTexels << " irradiance and distance texels, "
+                      << cpu::GetSIMDName() << " (" << cpu::GetSIMDWidth() << " wide)\n\n";
+
+            // Warm up, then time the single and multi-threaded updates on identical ray data.
+            // Volume creation reseeds the (shared) random number generator, so both volumes see the same ray rotations.
+            cpu::DDGIVolume singleThreaded;
+            if (singleThreaded.Create(desc) != ERTXGIStatus::OK) return false;
+            Update(singleThreaded, settings, 1, 1);
+            double singleThreadedTime = Update(singleThreaded, settings, 1, settings.numIterations);
+
+            cpu::DDGIVolume multiThreaded;
+            if (multiThreaded.Create(desc) != ERTXGIStatus::OK) return false;
+            Update(multiThreaded, settings, numThreads, 1);
+            double multiThreadedTime = Update(multiThreaded, settings, numThreads, settings.numIterations);
+
+            // Both volumes saw the same sequence of updates, so their probe data must match bit for bit
+            bool identical = IsEqual(singleThreaded.GetProbeIrradiance(), multiThreaded.GetProbeIrradiance())
+                          && IsEqual(singleThreaded.GetProbeDistance(), multiThreaded.GetProbeDistance())
+                          && IsEqual(singleThreaded.GetProbeData(), multiThreaded.GetProbeData())
+                          && IsEqual(singleThreaded.GetProbeVariability(), multiThreaded.GetProbeVariability());
+
+            auto report = [&](const char* name, uint32_t threads, double milliseconds)
+            {
+                double probesPerSecond = (double)numProbes / (milliseconds * 1e-3);
+                double texelRaysPerSecond = probesPerSecond * 2.0 * (double)(settings.numTexels * settings.numTexels) * (double)settings.numRays;
+                std::cout << std::left << std::setw(18) << name << std::setw(10) << threads
+                          << std::setw(14) << std::fixed << std::setprecision(3) << milliseconds
+                          << std::setw(16) << std::setprecision(0) << probesPerSecond
+                          << std::setw(16) << std::setprecision(2) << (texelRaysPerSecond * 1e-9) << "\n";
+            };
+
+            std::cout << std::left << std::setw(18) << "update" << std::setw(10) << "threads" << std::setw(14) << "ms/update"
+                      << std::setw(16) << "probes/s" << std::setw(16) << "G texel-rays/s" << "\n";
+            report("single-threaded", 1, singleThreadedTime);
+            report("multi-threaded", numThreads, multiThreadedTime);
+            std::cout << "\nSpeedup: " << std::setprecision(2) << (singleThreadedTime / multiThreadedTime) << "x\n";
+            std::cout << "Results across thread counts: " << (identical ? "bit-identical" : "MISMATCH") << "\n";
+
+            singleThreaded.Destroy();
+            multiThreaded.Destroy();
+            return identical;
+        }
+    }
+}
@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Environment.h"
+
+using namespace rtxgi;
+using namespace rtxgi::cpu;
+
+namespace Environment
+{
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * Traces a single ray from the given origin and returns the radiance (RGB) and hit distance (A).
+     * Backface hits are stored like DDGIStoreProbeRayBackfaceHit(): no radiance and a negative, shortened hit distance.
+     */
+    float4 TraceRay(const Desc& desc, const float3& origin, const float3& direction, const float3& up)
+    {
+        float hitT = 1e27f;
+        float3 radiance = GetSkyRadiance(desc, direction);
+
+        bool backface = false;
+        float cosUp = Dot3(direction, up);
+        float height = Dot3(origin, up) - desc.floorHeight;
+        if (cosUp < 0.f && height > 0.f)
+        {
+            // Intersect the floor plane
+            hitT = height / -cosUp;
+            radiance = desc.floorRadiance;
+        }
+        else if (desc.solidGround && height <= 0.f)
+        {
+            // The origin is inside the ground: upward rays hit the floor's backface, other rays never leave the ground
+            hitT = (cosUp > 0.f) ? (-height / cosUp) : 1e27f;
+            backface = true;
+        }
+
+        // Intersect the walls
+        for (const Wall& wall : desc.walls)
+        {
+            float cosNormal = Dot3(direction, wall.normal);
+            if (cosNormal == 0.f) continue;
+
+            float t = (wall.distance - Dot3(origin, wall.normal)) / cosNormal;
+            if (t > 0.f && t < hitT)
+            {
+                hitT = t;
+                radiance = desc.wallRadiance;
+                backface = false;
+            }
+        }
+
+        if (backface) return { 0.f, 0.f, 0.f, -0.2f * hitT };
+        return { radiance.x, radiance.y, radiance.z, hitT };
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    float3 GetUpAxis()
+    {
+    #if RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_LEFT_Z_UP || RTXGI_COORDINATE_SYSTEM == RTXGI_COORDINATE_SYSTEM_RIGHT_Z_UP
+        return { 0.f, 0.f, 1.f };
+    #else
+        return { 0.f, 1.f, 0.f };
+    #endif
+    }
+
+    float3 GetSkyRadiance(const Desc& desc, const float3& direction)
+    {
+        float t = std::max(0.f, Dot3(direction, GetUpAxis()));
+        float3 sky = Add(Mul(desc.skyHorizonRadiance, 1.f - t), Mul(desc.skyZenithRadiance, t));
+        if (Dot3(direction, Normalize3(desc.sunDirection)) >= desc.sunCosAngle) sky = Add(sky, desc.sunRadiance);
+        return sky;
+    }
+
+    void TraceProbes(const Desc& desc, DDGIVolume& volume)
+    {
+        DDGIVolumeDescGPU volumeDesc = volume.GetDescGPU();
+        const Texture2DArray& probeData = volume.GetProbeData();
+        Texture2DArray& rayData = volume.GetProbeRayData();
+        float3 up = GetUpAxis();
+
+        int numProbes = volume.GetNumProbes();
+        for (int index = 0; index < numProbes; index++)
+        {
+            // World positions use probe coordinates, ray data and probe data use the scroll adjusted probe index
+            int3 probeCoords = DDGIGetProbeCoords(index, volumeDesc);
+            int probeIndex = DDGIGetScrollingProbeIndex(probeCoords, volumeDesc);
+
+            // Inactive probes only trace the fixed rays used by probe classification
+            int numRays = volumeDesc.probeNumRays;
+            if (DDGILoadProbeState(probeIndex, probeData, volumeDesc) == DDGI_PROBE_STATE_INACTIVE) numRays = std::min(numRays, DDGI_NUM_FIXED_RAYS);
+
+            float3 origin = DDGIGetProbeWorldPosition(probeCoords, volumeDesc, probeData);
+            for (int rayIndex = 0; rayIndex < numRays; rayIndex++)
+            {
+                float3 direction = DDGIGetProbeRayDirection(rayIndex, volumeDesc);
+                rayData[DDGIGetRayDataTexelCoords(rayIndex, probeIndex, volumeDesc)] = TraceRay(desc, origin, direction, up);
+            }
+        }
+    }
+
+    void ComputeReferenceIrradiance(const Desc& desc, const DDGIVolume& volume, int numDirections, std::vector<float3>& irradiance)
+    {
+        DDGIVolumeDescGPU volumeDesc = volume.GetDescGPU();
+        int numInteriorTexels = volumeDesc.probeNumIrradianceInteriorTexels;
+        float3 up = GetUpAxis();
+
+        // Trace a dense, fixed set of directions once per probe
+        std::vector<float3> directions((size_t)numDirections);
+        for (int index = 0; index < numDirections; index++) directions[(size_t)index] = RTXGISphericalFibonacci((float)index, (float)numDirections);
+
+        int numProbes = volume.GetNumProbes();
+        irradiance.resize((size_t)(numProbes * numInteriorTexels * numInteriorTexels));
+
+        std::vector<float4> samples((size_t)numDirections);
+        for (int probeIndex = 0; probeIndex < numProbes; probeIndex++)
+        {
+            float3 origin = DDGIGetProbeWorldPosition(DDGIGetProbeCoords(probeIndex, volumeDesc), volumeDesc);
+            for (size_t index = 0; index < directions.size(); index++) samples[index] = TraceRay(desc, origin, directions[index], up);
+
+            for (int ty = 0; ty < numInteriorTexels; ty++)
+            {
+                for (int tx = 0; tx < numInteriorTexels; tx++)
+                {
+                    float3 texelDirection = DDGIGetOctahedralDirection(DDGIGetNormalizedOctahedralCoordinates(tx, ty, numInteriorTexels));
+
+                    float3 sum = { 0.f, 0.f, 0.f };
+                    float weightSum = 0.f;
+                    for (size_t index = 0; index < directions.size(); index++)
+                    {
+                        float weight = std::max(0.f, Dot3(texelDirection, directions[index]));
+                        sum = Add(sum, Mul({ samples[index].x, samples[index].y, samples[index].z }, weight));
+                        weightSum += weight;
+                    }
+
+                    size_t texelIndex = (size_t)((probeIndex * numInteriorTexels + ty) * numInteriorTexels + tx);
+                    irradiance[texelIndex] = Mul(sum, 1.f / (2.f * weightSum));
+                }
+            }
+        }
+    }
+
+    void ReadProbeIrradiance(const DDGIVolume& volume, std::vector<float3>& irradiance)
+    {
+        DDGIVolumeDescGPU volumeDesc = volume.GetDescGPU();
+        const Texture2DArray& probeIrradiance = volume.GetProbeIrradiance();
+        int numInteriorTexels = volumeDesc.probeNumIrradianceInteriorTexels;
+        uint32_t numTexels = (uint32_t)numInteriorTexels + 2;
+        float gamma = volumeDesc.probeIrradianceEncodingGamma;
+
+        int numProbes = volume.GetNumProbes();
+        irradiance.resize((size_t)(numProbes * numInteriorTexels * numInteriorTexels));
+        for (int probeIndex = 0; probeIndex < numProbes; probeIndex++)
+        {
+            uint3 probeTexCoords = DDGIGetProbeTexelCoords(probeIndex, volumeDesc);
+            for (int ty = 0; ty < numInteriorTexels; ty++)
+            {
+                for (int tx = 0; tx < numInteriorTexels; tx++)
+                {
+                    const float4& texel = probeIrradiance.Texel((probeTexCoords.x * numTexels) + 1 + (uint32_t)tx, (probeTexCoords.y * numTexels) + 1 + (uint32_t)ty, probeTexCoords.z);
+
+                    size_t texelIndex = (size_t)((probeIndex * numInteriorTexels + ty) * numInteriorTexels + tx);
+                    irradiance[texelIndex] = { powf(texel.x, gamma), powf(texel.y, gamma), powf(texel.z, gamma) };
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,248 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+#include "Environment.h"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+using namespace rtxgi;
+
+namespace Experiments
+{
+    namespace Hysteresis
+    {
+        static const int NumPhases = 3;
+        static const int NumReferenceDirections = 4096;
+
+        struct Settings
+        {
+            int   numFrames = 360;
+            int   numRays = 256;
+            int   seed = 1;
+            float hysteresis = 0.97f;
+            float hysteresisMin = 0.7f;
+            float variabilityThreshold = 0.03f;
+            float epsilon = 0.05f;               // Relative error below which a probe texel set is considered converged
+        };
+
+        struct Mode
+        {
+            std::string name;
+            float       hysteresis;
+            bool        adaptive;
+        };
+
+        struct Metrics
+        {
+            int   convergeFrames[NumPhases] = { -1, -1, -1 };
+            float flicker[NumPhases] = {};
+            float error[NumPhases] = {};
+        };
+
+        //----------------------------------------------------------------------------------------------------------
+        // Private Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        float GetLuminance(const float3& rgb)
+        {
+            return cpu::RTXGILinearRGBToLuminance(rgb);
+        }
+
+        /**
+         * Mean relative luminance error of the probe texels against the reference.
+         */
+        float ComputeError(const std::vector<float3>& current, const std::vector<float3>& reference)
+        {
+            double sum = 0.0;
+            for (size_t index = 0; index < current.size(); index++)
+            {
+                float ref = std::max(GetLuminance(reference[index]), 1e-4f);
+                sum += std::abs(GetLuminance(current[index]) - ref) / ref;
+            }
+            return (float)(sum / (double)current.size());
+        }
+
+        /**
+         * Mean relative frame-to-frame luminance change of the probe texels.
+         */
+        float ComputeFlicker(const std::vector<float3>& current, const std::vector<float3>& previous, const std::vector<float3>& reference)
+        {
+            double sum = 0.0;
+            for (size_t index = 0; index < current.size(); index++)
+            {
+                float ref = std::max(GetLuminance(reference[index]), 1e-4f);
+                sum += std::abs(GetLuminance(current[index]) - GetLuminance(previous[index])) / ref;
+            }
+            return (float)(sum / (double)current.size());
+        }
+
+        DDGIVolumeDesc GetVolumeDesc(const Settings& settings)
+        {
+            DDGIVolumeDesc desc;
+            desc.name = (char*)"Hysteresis Experiment";
+            desc.rngSeed = (uint32_t)settings.seed;
+            desc.origin = { 0.f, 0.f, 0.f };
+            desc.probeSpacing = { 2.f, 2.f, 2.f };
+            desc.probeCounts = { 4, 4, 4 };
+            desc.probeNumRays = settings.numRays;
+            desc.probeNumIrradianceInteriorTexels = 8;
+            desc.probeNumIrradianceTexels = 10;
+            desc.probeNumDistanceInteriorTexels = 14;
+            desc.probeNumDistanceTexels = 16;
+            desc.probeHysteresis = settings.hysteresis;
+            desc.probeRayDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeIrradianceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDistanceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeVariabilityFormat = EDDGIVolumeTextureFormat::F32;
+            return desc;
+        }
+
+        bool RunMode(const Mode& mode, const Settings& settings, const Environment::Desc (&environments)[NumPhases], const std::vector<float3> (&references)[NumPhases], Metrics& metrics)
+        {
+            DDGIVolumeDesc desc = GetVolumeDesc(settings);
+            desc.probeHysteresis = mode.hysteresis;
+            desc.probeAdaptiveHysteresisEnabled = mode.adaptive;
+            desc.probeAdaptiveHysteresisMin = settings.hysteresisMin;
+            desc.probeAdaptiveHysteresisThreshold = settings.variabilityThreshold;
+
+            cpu::DDGIVolume volume;
+            if (volume.Create(desc) != ERTXGIStatus::OK) return false;
+
+            int phaseLength = settings.numFrames / NumPhases;
+            int flickerWindow = std::max(1, phaseLength / 3);
+
+            std::vector<float3> current, previous;
+            cpu::DDGIVolume* volumes[] = { &volume };
+            for (int frame = 0; frame < (phaseLength * NumPhases); frame++)
+            {
+                int phase = frame / phaseLength;
+                int phaseFrame = frame - (phase * phaseLength);
+
+                volume.Update();
+                Environment::TraceProbes(environments[phase], volume);
+                cpu::UpdateDDGIVolumeProbes(1, volumes);
+
+                previous.swap(current);
+                Environment::ReadProbeIrradiance(volume, current);
+
+                // Time-to-converge: the first frame of the phase where the error drops below epsilon
+                float error = ComputeError(current, references[phase]);
+                if (metrics.convergeFrames[phase] < 0 && error < settings.epsilon)
+                {
+                    metrics.convergeFrames[phase] = phaseFrame + 1;
+                }
+
+                // Flicker: mean frame-to-frame change at the end of the phase, once lighting has settled
+                if (phaseFrame >= (phaseLength - flickerWindow))
+                {
+                    metrics.flicker[phase] += ComputeFlicker(current, previous, references[phase]) / (float)flickerWindow;
+                    metrics.error[phase] += error / (float)flickerWindow;
+                }
+            }
+
+            volume.Destroy();
+            return true;
+        }
+
+        std::string FormatFrames(int frames)
+        {
+            return (frames < 0) ? std::string("never") : std::to_string(frames);
+        }
+
+        //----------------------------------------------------------------------------------------------------------
+        // Public Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        bool Run(const Arguments& args)
+        {
+            Settings settings;
+            settings.numFrames = args.GetInt("--frames", settings.numFrames);
+            settings.numRays = args.GetInt("--rays", settings.numRays);
+            settings.seed = args.GetInt("--seed", settings.seed);
+            settings.hysteresisMin = args.GetFloat("--min", settings.hysteresisMin);
+            settings.variabilityThreshold = args.GetFloat("--threshold", settings.variabilityThreshold);
+            settings.epsilon = args.GetFloat("--epsilon", settings.epsilon);
+
+            if (settings.numFrames < NumPhases || settings.numRays <= cpu::DDGI_NUM_FIXED_RAYS)
+            {
+                std::cerr << "Invalid settings: --frames must be at least " << NumPhases << " and --rays must be greater than " << cpu::DDGI_NUM_FIXED_RAYS << "\n";
+                return false;
+            }
+
+            // Lighting phases: initial, a large darkening step (dim sky, sun moves), and back to the initial lighting
+            Environment::Desc environments[NumPhases];
+            environments[1].skyHorizonRadiance = { 0.15f, 0.15f, 0.2f };
+            environments[1].skyZenithRadiance = { 0.05f, 0.07f, 0.15f };
+            environments[1].sunDirection = { -0.6f, 0.5f, -0.2f };
+            environments[1].sunRadiance = { 12.f, 10.f, 8.f };
+
+            // Compute the noise free reference irradiance of each phase
+            DDGIVolumeDesc desc = GetVolumeDesc(settings);
+            cpu::DDGIVolume referenceVolume;
+            if (referenceVolume.Create(desc) != ERTXGIStatus::OK) return false;
+
+            std::vector<float3> references[NumPhases];
+            for (int phase = 0; phase < NumPhases; phase++)
+            {
+                Environment::ComputeReferenceIrradiance(environments[phase], referenceVolume, NumReferenceDirections, references[phase]);
+            }
+            referenceVolume.Destroy();
+
+            std::stringstream minName;
+            minName << std::fixed << std::setprecision(2) << "fixed (" << settings.hysteresisMin << ")";
+            std::stringstream maxName;
+            maxName << std::fixed << std::setprecision(2) << "fixed (" << settings.hysteresis << ")";
+            std::stringstream adaptiveName;
+            adaptiveName << std::fixed << std::setprecision(2) << "adaptive (" << settings.hysteresisMin << "-" << settings.hysteresis << ")";
+
+            Mode modes[] =
+            {
+                { maxName.str(), settings.hysteresis, false },
+                { minName.str(), settings.hysteresisMin, false },
+                { adaptiveName.str(), settings.hysteresis, true },
+            };
+
+            int phaseLength = settings.numFrames / NumPhases;
+            std::cout << "Hysteresis experiment: " << (desc.probeCounts.x * desc.probeCounts.y * desc.probeCounts.z) << " probes, "
+                      << settings.numRays << " rays per probe, " << (phaseLength * NumPhases) << " frames, lighting changes at frames "
+                      << phaseLength << " and " << (phaseLength * 2) << "\n";
+            std::cout << "Time-to-converge: frames until the mean relative irradiance error is below " << settings.epsilon << "\n";
+            std::cout << "Flicker: mean relative frame-to-frame irradiance change over the last third of each phase\n";
+            std::cout << "Error: mean relative irradiance error over the last third of each phase\n\n";
+
+            std::cout << std::left << std::setw(24) << "mode"
+                      << std::setw(12) << "converge" << std::setw(12) << "converge" << std::setw(12) << "converge"
+                      << std::setw(12) << "flicker" << std::setw(12) << "flicker" << std::setw(12) << "flicker"
+                      << std::setw(12) << "error" << std::setw(12) << "error" << std::setw(12) << "error" << "\n";
+            std::cout << std::left << std::setw(24) << ""
+                      << std::setw(12) << "(initial)" << std::setw(12) << "(darken)" << std::setw(12) << "(brighten)"
+                      << std::setw(12) << "(initial)" << std::setw(12) << "(darken)" << std::setw(12) << "(brighten)"
+                      << std::setw(12) << "(initial)" << std::setw(12) << "(darken)" << std::setw(12) << "(brighten)" << "\n";
+
+            for (const Mode& mode : modes)
+            {
+                Metrics metrics;
+                if (!RunMode(mode, settings, environments, references, metrics)) return false;
+
+                std::cout << std::left << std::setw(24) << mode.name;
+                for (int phase = 0; phase < NumPhases; phase++) std::cout << std::setw(12) << FormatFrames(metrics.convergeFrames[phase]);
+                for (int phase = 0; phase < NumPhases; phase++) std::cout << std::setw(12) << std::fixed << std::setprecision(5) << metrics.flicker[phase];
+                for (int phase = 0; phase < NumPhases; phase++) std::cout << std::setw(12) << std::fixed << std::setprecision(5) << metrics.error[phase];
+                std::cout << "\n";
+            }
+
+            return true;
+        }
+    }
+}
@@ -0,0 +1,226 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+#include "Environment.h"
+
+#include <rtxgi/ddgi/cpu/Irradiance_CPU.h>
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace rtxgi;
+
+namespace Experiments
+{
+    namespace Irradiance
+    {
+        // Maximum relative difference allowed between batched and single queries
+        static const float MaxRelativeError = 1e-3f;
+
+        struct Settings
+        {
+            int numQueries = 1 << 20;
+            int numThreads = 1;
+            int numFrames = 8;
+            int seed = 1;
+        };
+
+        struct Case
+        {
+            const char* name;
+            bool        rotated;
+            bool        scrolling;
+        };
+
+        //----------------------------------------------------------------------------------------------------------
+        // Private Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        /**
+         * A small deterministic random number generator.
+         */
+        struct Random
+        {
+            uint32_t state;
+
+            explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+            float Next()
+            {
+                state = (state * 1664525u) + 1013904223u;
+                return (float)(state >> 8) * (1.f / 16777216.f);
+            }
+
+            float Next(float min, float max) { return min + ((max - min) * Next()); }
+
+            float3 NextDirection()
+            {
+                return cpu::RTXGISphericalFibonacci(Next(0.f, 4095.f), 4096.f);
+            }
+        };
+
+        DDGIVolumeDesc GetVolumeDesc(const Settings& settings, const Case& testCase)
+        {
+            DDGIVolumeDesc desc;
+            desc.name = (char*)"Irradiance Queries";
+            desc.rngSeed = (uint32_t)settings.seed;
+            desc.origin = { 0.f, 0.f, 0.f };
+            desc.probeSpacing = { 2.f, 1.5f, 2.5f };
+            desc.probeCounts = { 12, 6, 10 };
+            desc.probeNumRays = 256;
+            desc.probeNumIrradianceInteriorTexels = 8;
+            desc.probeNumIrradianceTexels = 10;
+            desc.probeNumDistanceInteriorTexels = 14;
+            desc.probeNumDistanceTexels = 16;
+            desc.probeRayDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeIrradianceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDistanceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeVariabilityFormat = EDDGIVolumeTextureFormat::F32;
+            desc.probeRelocationEnabled = true;
+            desc.probeClassificationEnabled = true;
+            if (testCase.rotated) desc.eulerAngles = { 0.3f, 0.8f, -0.2f };
+            if (testCase.scrolling) desc.movementType = EDDGIVolumeMovementType::Scrolling;
+            return desc;
+        }
+
+        /**
+         * Creates a volume and updates its probes for a few frames.
+         * Probes are given random relocation offsets and some are deactivated to exercise all of the query paths.
+         */
+        bool CreateVolume(const Settings& settings, const Case& testCase, cpu::DDGIVolume& volume)
+        {
+            if (volume.Create(GetVolumeDesc(settings, testCase)) != ERTXGIStatus::OK) return false;
+
+            Random random((uint32_t)settings.seed);
+            for (float4& texel : volume.GetProbeData().texels)
+            {
+                int state = (random.Next() < 0.1f) ? cpu::DDGI_PROBE_STATE_INACTIVE : cpu::DDGI_PROBE_STATE_ACTIVE;
+                texel = { random.Next(-0.2f, 0.2f), random.Next(-0.2f, 0.2f), random.Next(-0.2f, 0.2f), cpu::DDGIEncodeProbeData(state, 0) };
+            }
+
+            // Move the scroll anchor a few probes away so the volume has scroll offsets
+            if (testCase.scrolling) volume.SetScrollAnchor({ 5.1f, -3.2f, 7.6f });
+
+            Environment::Desc environment;
+            environment.floorHeight = -2.f;
+            cpu::DDGIVolume* volumes[] = { &volume };
+            for (int frame = 0; frame < settings.numFrames; frame++)
+            {
+                volume.Update();
+                Environment::TraceProbes(environment, volume);
+                cpu::UpdateDDGIVolumeProbes(1, volumes);
+            }
+            return true;
+        }
+
+        //----------------------------------------------------------------------------------------------------------
+        // Public Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        bool Run(const Arguments& args)
+        {
+            Settings settings;
+            settings.numQueries = args.GetInt("--queries", settings.numQueries);
+            settings.numThreads = args.GetInt("--threads", settings.numThreads);
+            settings.numFrames = args.GetInt("--frames", settings.numFrames);
+            settings.seed = args.GetInt("--seed", settings.seed);
+
+            if (settings.numQueries <= 0 || settings.numThreads < 0 || settings.numFrames <= 0)
+            {
+                std::cerr << "Invalid settings: --queries and --frames must be positive, --threads must not be negative\n";
+                return false;
+            }
+
+            Case cases[] =
+            {
+                { "default", false, false },
+                { "rotated", true, false },
+                { "scrolling", false, true },
+            };
+
+            std::cout << "Irradiance query benchmark: " << settings.numQueries << " queries, " << settings.numThreads << " thread(s) (0: all), "
+                      << cpu::GetSIMDName() << " (" << cpu::GetSIMDWidth() << " wide)\n";
+            std::cout << "Error: maximum relative difference between batched and single queries\n\n";
+            std::cout << std::left << std::setw(12) << "volume" << std::setw(18) << "single Mq/s" << std::setw(18) << "batched Mq/s"
+                      << std::setw(12) << "speedup" << std::setw(14) << "max error" << "\n";
+
+            bool result = true;
+            for (const Case& testCase : cases)
+            {
+                cpu::DDGIVolume volume;
+                if (!CreateVolume(settings, testCase, volume)) return false;
+
+                DDGIVolumeDescGPU desc = volume.GetDescGPU();
+                cpu::DDGIVolumeResources resources = cpu::DDGIGetVolumeResources(volume);
+
+                // Generate queries in (and slightly outside of) the volume
+                size_t numQueries = (size_t)settings.numQueries;
+                std::vector<float3> positions(numQueries), biases(numQueries), normals(numQueries);
+                float3 counts = { (float)(desc.probeCounts.x - 1), (float)(desc.probeCounts.y - 1), (float)(desc.probeCounts.z - 1) };
+                float3 extent = cpu::Mul(cpu::Mul(desc.probeSpacing, counts), 0.55f);
+                float3 origin = cpu::Add(desc.origin, cpu::Mul(cpu::ToFloat3(desc.probeScrollOffsets), desc.probeSpacing));
+
+                Random random((uint32_t)settings.seed + 1);
+                for (size_t index = 0; index < numQueries; index++)
+                {
+                    float3 position = { random.Next(-extent.x, extent.x), random.Next(-extent.y, extent.y), random.Next(-extent.z, extent.z) };
+                    positions[index] = cpu::Add(origin, cpu::RTXGIQuaternionRotate(position, desc.rotation));
+                    normals[index] = random.NextDirection();
+                    biases[index] = cpu::DDGIGetSurfaceBias(normals[index], random.NextDirection(), desc);
+                }
+
+                // Single queries
+                std::vector<float3> single(numQueries);
+                auto start = std::chrono::high_resolution_clock::now();
+                for (size_t index = 0; index < numQueries; index++)
+                {
+                    single[index] = cpu::DDGIGetVolumeIrradiance(positions[index], biases[index], normals[index], desc, resources);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                double singleTime = std::chrono::duration<double>(end - start).count();
+
+                // Batched queries
+                std::vector<float3> batched(numQueries);
+                start = std::chrono::high_resolution_clock::now();
+                cpu::DDGIGetVolumeIrradiance((uint32_t)numQueries, positions.data(), biases.data(), normals.data(), desc, resources, batched.data(), (uint32_t)settings.numThreads);
+                end = std::chrono::high_resolution_clock::now();
+                double batchedTime = std::chrono::duration<double>(end - start).count();
+
+                float maxError = 0.f;
+                for (size_t index = 0; index < numQueries; index++)
+                {
+                    for (size_t c = 0; c < 3; c++)
+                    {
+                        float error = fabsf(batched[index][c] - single[index][c]) / std::max(fabsf(single[index][c]), 1e-3f);
+                        maxError = std::max(maxError, error);
+                    }
+                }
+                result &= (maxError <= MaxRelativeError);
+
+                double singleRate = (double)numQueries / singleTime * 1e-6;
+                double batchedRate = (double)numQueries / batchedTime * 1e-6;
+                std::cout << std::left << std::setw(12) << testCase.name
+                          << std::setw(18) << std::fixed << std::setprecision(2) << singleRate
+                          << std::setw(18) << batchedRate
+                          << std::setw(12) << (batchedRate / singleRate)
+                          << std::setw(14) << std::scientific << std::setprecision(2) << maxError << std::defaultfloat << "\n";
+
+                volume.Destroy();
+            }
+
+            if (!result) std::cerr << "\nBatched queries differ from single queries by more than " << MaxRelativeError << "\n";
+            return result;
+        }
+    }
+}
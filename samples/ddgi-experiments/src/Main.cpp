@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+
+#include <iostream>
+
+void PrintUsage()
+{
+    std::cout << "Usage: DDGIExperiments <experiment> [--option value ...]\n\n";
+    std::cout << "Experiments:\n";
+    std::cout << "  blending      CPU probe blending throughput, single vs. multi-threaded\n";
+    std::cout << "                --probes 16 --rays 256 --texels 8 --threads 0 --iterations 10 --seed 1\n";
+    std::cout << "  irradiance    Batched CPU irradiance queries (default, rotated, and scrolling volumes)\n";
+    std::cout << "                --queries 1048576 --threads 1 --frames 8 --seed 1\n";
+    std::cout << "  visibility    Per-cell probe visibility masks in an interior scene (masked vs. unmasked queries)\n";
+    std::cout << "                --queries 262144 --frames 8 --runs 5 --seed 1 --room 2 --subdivisions 4 --samples 3 --threshold 0.05\n";
+    std::cout << "  relocation    CPU probe relocation and classification with solid ground and walls (baked static probe states)\n";
+    std::cout << "                --frames 4 --threads 0 --iterations 10 --seed 1 --floor -2.3 --min-frontface 0.3\n";
+    std::cout << "  hysteresis    Fixed vs. adaptive per-probe hysteresis (time-to-converge and flicker)\n";
+    std::cout << "                --frames 360 --rays 256 --seed 1 --min 0.7 --threshold 0.03 --epsilon 0.05\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    std::string experiment = argv[1];
+    Experiments::Arguments args(argc - 2, argv + 2);
+
+    bool result = false;
+    if (experiment.compare("blending") == 0) result = Experiments::Blending::Run(args);
+    else if (experiment.compare("irradiance") == 0) result = Experiments::Irradiance::Run(args);
+    else if (experiment.compare("visibility") == 0) result = Experiments::Visibility::Run(args);
+    else if (experiment.compare("relocation") == 0) result = Experiments::Relocation::Run(args);
+    else if (experiment.compare("hysteresis") == 0) result = Experiments::Hysteresis::Run(args);
+    else
+    {
+        PrintUsage();
+        return EXIT_FAILURE;
+    }
+
+    return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
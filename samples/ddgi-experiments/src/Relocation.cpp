@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+#include "Environment.h"
+
+#include <rtxgi/ddgi/cpu/DDGIVolume_CPU.h>
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+using namespace rtxgi;
+
+namespace Experiments
+{
+    namespace Relocation
+    {
+        struct Settings
+        {
+            int   numFrames = 4;
+            int   numThreads = 0;
+            int   numIterations = 10;
+            int   seed = 1;
+            float floorHeight = -2.3f;              // Height of the solid ground, between two probe planes
+            float minFrontfaceDistance = 0.3f;
+        };
+
+        //----------------------------------------------------------------------------------------------------------
+        // Private Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        DDGIVolumeDesc GetVolumeDesc(const Settings& settings)
+        {
+            DDGIVolumeDesc desc;
+            desc.name = (char*)"Probe Relocation and Classification";
+            desc.rngSeed = (uint32_t)settings.seed;
+            desc.origin = { 0.f, 0.f, 0.f };
+            desc.probeSpacing = { 1.f, 1.f, 1.f };
+            desc.probeCounts = { 16, 8, 16 };
+            desc.probeNumRays = 256;
+            desc.probeNumIrradianceInteriorTexels = 8;
+            desc.probeNumIrradianceTexels = 10;
+            desc.probeNumDistanceInteriorTexels = 14;
+            desc.probeNumDistanceTexels = 16;
+            desc.probeRayDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeIrradianceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDistanceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeVariabilityFormat = EDDGIVolumeTextureFormat::F32;
+            desc.probeMinFrontfaceDistance = settings.minFrontfaceDistance;
+            desc.probeRelocationEnabled = true;
+            desc.probeClassificationEnabled = true;
+            return desc;
+        }
+
+        /**
+         * Solid ground below the volume's lower probe planes and two walls that are not aligned with probes.
+         */
+        Environment::Desc GetEnvironment(const Settings& settings)
+        {
+            float3 up = Environment::GetUpAxis();
+
+            Environment::Desc environment;
+            environment.floorHeight = settings.floorHeight;
+            environment.solidGround = true;
+            environment.walls.push_back({ { 1.f, 0.f, 0.f }, 2.1f });
+            environment.walls.push_back({ cpu::Cross3(up, { 1.f, 0.f, 0.f }), -1.2f });
+            return environment;
+        }
+
+        double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        }
+
+        //----------------------------------------------------------------------------------------------------------
+        // Public Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        bool Run(const Arguments& args)
+        {
+            Settings settings;
+            settings.numFrames = args.GetInt("--frames", settings.numFrames);
+            settings.numThreads = args.GetInt("--threads", settings.numThreads);
+            settings.numIterations = args.GetInt("--iterations", settings.numIterations);
+            settings.seed = args.GetInt("--seed", settings.seed);
+            settings.floorHeight = args.GetFloat("--floor", settings.floorHeight);
+            settings.minFrontfaceDistance = args.GetFloat("--min-frontface", settings.minFrontfaceDistance);
+
+            if (settings.numFrames <= 0 || settings.numThreads < 0 || settings.numIterations <= 0 || settings.minFrontfaceDistance <= 0.f)
+            {
+                std::cerr << "Invalid settings: --frames, --iterations, and --min-frontface must be positive, --threads must not be negative\n";
+                return false;
+            }
+
+            cpu::DDGIVolume volume;
+            if (volume.Create(GetVolumeDesc(settings)) != ERTXGIStatus::OK) return false;
+
+            // Bake: trace, blend, relocate, and classify the probes (in the same order as the SDK's GPU update)
+            Environment::Desc environment = GetEnvironment(settings);
+            cpu::DDGIVolume* volumes[] = { &volume };
+            for (int frame = 0; frame < settings.numFrames; frame++)
+            {
+                volume.Update();
+                Environment::TraceProbes(environment, volume);
+                cpu::UpdateDDGIVolumeProbes(1, volumes, (uint32_t)settings.numThreads);
+                if (cpu::RelocateDDGIVolumeProbes(1, volumes, (uint32_t)settings.numThreads) != ERTXGIStatus::OK) return false;
+                if (cpu::ClassifyDDGIVolumeProbes(1, volumes, (uint32_t)settings.numThreads) != ERTXGIStatus::OK) return false;
+            }
+
+            DDGIVolumeDescGPU desc = volume.GetDescGPU();
+            const cpu::Texture2DArray& rayData = volume.GetProbeRayData();
+            const cpu::Texture2DArray& probeData = volume.GetProbeData();
+
+            // Results must not depend on the number of threads. The same thread counts are checked, timed, and reported.
+            uint32_t numThreads = (settings.numThreads == 0) ? cpu::GetHardwareThreadCount() : (uint32_t)settings.numThreads;
+            uint32_t threadCounts[] = { 1, numThreads };
+            cpu::Texture2DArray results[2];
+            for (uint32_t index = 0; index < 2; index++)
+            {
+                results[index] = probeData;
+                cpu::DDGIRelocateProbes(desc, rayData, results[index], threadCounts[index]);
+                cpu::DDGIClassifyProbes(desc, rayData, results[index], threadCounts[index]);
+            }
+            bool identical = (memcmp(results[0].texels.data(), results[1].texels.data(), results[0].texels.size() * sizeof(float4)) == 0);
+
+            // Time the passes on the baked ray data
+            double times[2][2] = {};
+            for (uint32_t index = 0; index < 2; index++)
+            {
+                uint32_t threads = threadCounts[index];
+                cpu::Texture2DArray scratch = probeData;
+
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int iteration = 0; iteration < settings.numIterations; iteration++) cpu::DDGIRelocateProbes(desc, rayData, scratch, threads);
+                times[index][0] = GetMilliseconds(start) / settings.numIterations;
+
+                start = std::chrono::high_resolution_clock::now();
+                for (int iteration = 0; iteration < settings.numIterations; iteration++) cpu::DDGIClassifyProbes(desc, rayData, scratch, threads);
+                times[index][1] = GetMilliseconds(start) / settings.numIterations;
+            }
+
+            // Probe statistics. Active probes must not be inside the ground.
+            float3 up = Environment::GetUpAxis();
+            int numProbes = volume.GetNumProbes();
+            int numRelocated = 0, numInactive = 0, numActiveInGround = 0, numRelocatedOutOfGround = 0;
+            for (int probeIndex = 0; probeIndex < numProbes; probeIndex++)
+            {
+                int3 probeCoords = cpu::DDGIGetProbeCoords(probeIndex, desc);
+                const float4& texel = probeData[cpu::DDGIGetProbeTexelCoords(probeIndex, desc)];
+                bool relocated = (texel.x != 0.f || texel.y != 0.f || texel.z != 0.f);
+                bool active = (cpu::DDGIDecodeProbeState(texel.w) == cpu::DDGI_PROBE_STATE_ACTIVE);
+                bool inGround = (cpu::Dot3(cpu::DDGIGetProbeWorldPosition(probeCoords, desc, probeData), up) <= settings.floorHeight);
+                bool wasInGround = (cpu::Dot3(cpu::DDGIGetProbeWorldPosition(probeCoords, desc), up) <= settings.floorHeight);
+
+                numRelocated += relocated ? 1 : 0;
+                numInactive += active ? 0 : 1;
+                numActiveInGround += (active && inGround) ? 1 : 0;
+                numRelocatedOutOfGround += (wasInGround && !inGround) ? 1 : 0;
+            }
+
+            // Rays traced per frame: without classification, with per-frame classification (inactive probes trace fixed rays), and with baked static states
+            int numActive = numProbes - numInactive;
+            double allRays = (double)numProbes * desc.probeNumRays;
+            double classifiedRays = ((double)numActive * desc.probeNumRays) + ((double)numInactive * std::min(desc.probeNumRays, cpu::DDGI_NUM_FIXED_RAYS));
+            double staticRays = (double)numActive * desc.probeNumRays;
+
+            std::cout << "Probe relocation and classification experiment: " << numProbes << " probes, " << desc.probeNumRays << " rays, "
+                      << settings.numFrames << " frames, solid ground at " << settings.floorHeight << ", " << environment.walls.size() << " walls\n\n";
+
+            std::cout << std::fixed << std::setprecision(3);
+            std::cout << "Relocated probes:        " << numRelocated << " (" << numRelocatedOutOfGround << " moved out of the ground)\n";
+            std::cout << "Inactive probes:         " << numInactive << " of " << numProbes << " (" << numActiveInGround << " active probes in the ground)\n";
+            std::cout << "Relocation:              " << times[0][0] << " ms (" << threadCounts[0] << " thread), " << times[1][0] << " ms (" << threadCounts[1] << " threads)\n";
+            std::cout << "Classification:          " << times[0][1] << " ms (" << threadCounts[0] << " thread), " << times[1][1] << " ms (" << threadCounts[1] << " threads)\n";
+            std::cout << std::setprecision(1);
+            std::cout << "Rays per frame:          " << allRays << " all probes, " << classifiedRays << " classified per frame (-"
+                      << (100.0 * (1.0 - classifiedRays / allRays)) << "%), " << staticRays << " static states (-" << (100.0 * (1.0 - staticRays / allRays)) << "%)\n";
+            std::cout << "Results with " << threadCounts[0] << " and " << threadCounts[1] << " threads: " << (identical ? "identical" : "different") << "\n";
+            std::cout << std::defaultfloat;
+
+            volume.Destroy();
+
+            if (!identical) std::cerr << "\nRelocation and classification results depend on the number of threads\n";
+            if (numActiveInGround > 0) std::cerr << "\nActive probes remain inside the ground\n";
+            return identical && (numActiveInGround == 0);
+        }
+    }
+}
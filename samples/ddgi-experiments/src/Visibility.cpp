@@ -0,0 +1,260 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Experiments.h"
+#include "Environment.h"
+
+#include <rtxgi/ddgi/cpu/Irradiance_CPU.h>
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+using namespace rtxgi;
+
+namespace Experiments
+{
+    namespace Visibility
+    {
+        // Maximum relative difference allowed between batched and single masked queries
+        static const float MaxRelativeError = 1e-3f;
+
+        struct Settings
+        {
+            int   numQueries = 1 << 18;
+            int   numFrames = 8;
+            int   numRuns = 5;                   // Batched queries are timed this many times (interleaved), the best run is reported
+            int   seed = 1;
+            float roomSize = 2.f;                // Distance between the walls that split the volume into rooms
+            cpu::DDGIProbeVisibilityMasksDesc masks;
+        };
+
+        //----------------------------------------------------------------------------------------------------------
+        // Private Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        /**
+         * A small deterministic random number generator.
+         */
+        struct Random
+        {
+            uint32_t state;
+
+            explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+            float Next()
+            {
+                state = (state * 1664525u) + 1013904223u;
+                return (float)(state >> 8) * (1.f / 16777216.f);
+            }
+
+            float Next(float min, float max) { return min + ((max - min) * Next()); }
+
+            float3 NextDirection()
+            {
+                return cpu::RTXGISphericalFibonacci(Next(0.f, 4095.f), 4096.f);
+            }
+        };
+
+        DDGIVolumeDesc GetVolumeDesc(const Settings& settings)
+        {
+            DDGIVolumeDesc desc;
+            desc.name = (char*)"Probe Visibility Masks";
+            desc.rngSeed = (uint32_t)settings.seed;
+            desc.origin = { 0.f, 0.f, 0.f };
+            desc.probeSpacing = { 1.f, 1.f, 1.f };
+            desc.probeCounts = { 16, 16, 16 };
+            desc.probeNumRays = 256;
+            desc.probeNumIrradianceInteriorTexels = 8;
+            desc.probeNumIrradianceTexels = 10;
+            desc.probeNumDistanceInteriorTexels = 14;
+            desc.probeNumDistanceTexels = 16;
+            desc.probeRayDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeIrradianceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDistanceFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeDataFormat = EDDGIVolumeTextureFormat::F32x4;
+            desc.probeVariabilityFormat = EDDGIVolumeTextureFormat::F32;
+            return desc;
+        }
+
+        /**
+         * An interior scene: walls along both horizontal axes split the volume into rooms (walls are not aligned with probes).
+         */
+        Environment::Desc GetEnvironment(const Settings& settings)
+        {
+            float3 up = Environment::GetUpAxis();
+            float3 axes[] = { { 1.f, 0.f, 0.f }, cpu::Cross3(up, { 1.f, 0.f, 0.f }) };
+
+            Environment::Desc environment;
+            environment.floorHeight = -7.9f;
+            for (const float3& axis : axes)
+            {
+                // Walls are offset from the probe planes (at half integer coordinates), and stop at the volume's bounds
+                for (float distance = 0.1f - (floorf(8.f / settings.roomSize) * settings.roomSize); distance < 8.f; distance += settings.roomSize)
+                {
+                    if (distance > -8.f) environment.walls.push_back({ axis, distance });
+                }
+            }
+            return environment;
+        }
+
+        /**
+         * Returns the relative difference between two irradiance values.
+         */
+        float GetRelativeError(const float3& value, const float3& reference)
+        {
+            float error = 0.f;
+            for (size_t c = 0; c < 3; c++) error = std::max(error, fabsf(value[c] - reference[c]) / std::max(fabsf(reference[c]), 1e-3f));
+            return error;
+        }
+
+        double GetRate(size_t numQueries, std::chrono::high_resolution_clock::time_point start)
+        {
+            double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+            return (double)numQueries / seconds * 1e-6;
+        }
+
+        //----------------------------------------------------------------------------------------------------------
+        // Public Functions
+        //----------------------------------------------------------------------------------------------------------
+
+        bool Run(const Arguments& args)
+        {
+            Settings settings;
+            settings.numQueries = args.GetInt("--queries", settings.numQueries);
+            settings.numFrames = args.GetInt("--frames", settings.numFrames);
+            settings.numRuns = args.GetInt("--runs", settings.numRuns);
+            settings.seed = args.GetInt("--seed", settings.seed);
+            settings.roomSize = args.GetFloat("--room", settings.roomSize);
+            settings.masks.cellSubdivisions = args.GetInt("--subdivisions", settings.masks.cellSubdivisions);
+            settings.masks.samplesPerAxis = args.GetInt("--samples", settings.masks.samplesPerAxis);
+            settings.masks.visibilityThreshold = args.GetFloat("--threshold", settings.masks.visibilityThreshold);
+
+            if (settings.numQueries <= 0 || settings.numFrames <= 0 || settings.numRuns <= 0 || settings.masks.cellSubdivisions <= 0 || settings.masks.samplesPerAxis < 2 || settings.roomSize <= 0.f)
+            {
+                std::cerr << "Invalid settings: --queries, --frames, --runs, --subdivisions, and --room must be positive, --samples must be at least 2\n";
+                return false;
+            }
+
+            // Create the volume and converge its probes in the interior scene
+            cpu::DDGIVolume volume;
+            if (volume.Create(GetVolumeDesc(settings)) != ERTXGIStatus::OK) return false;
+
+            Environment::Desc environment = GetEnvironment(settings);
+            cpu::DDGIVolume* volumes[] = { &volume };
+            for (int frame = 0; frame < settings.numFrames; frame++)
+            {
+                volume.Update();
+                Environment::TraceProbes(environment, volume);
+                cpu::UpdateDDGIVolumeProbes(1, volumes);
+            }
+
+            DDGIVolumeDescGPU desc = volume.GetDescGPU();
+            cpu::DDGIVolumeResources resources = cpu::DDGIGetVolumeResources(volume);
+
+            // Build the visibility masks
+            cpu::DDGIProbeVisibilityMasks masks;
+            auto start = std::chrono::high_resolution_clock::now();
+            if (cpu::DDGIBuildProbeVisibilityMasks(desc, resources, settings.masks, masks) != ERTXGIStatus::OK) return false;
+            double buildTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            cpu::DDGIVolumeResources maskedResources = resources;
+            maskedResources.probeVisibilityMasks = &masks;
+
+            // Generate queries in the volume
+            size_t numQueries = (size_t)settings.numQueries;
+            std::vector<float3> positions(numQueries), biases(numQueries), normals(numQueries);
+            float3 counts = { (float)(desc.probeCounts.x - 1), (float)(desc.probeCounts.y - 1), (float)(desc.probeCounts.z - 1) };
+            float3 extent = cpu::Mul(cpu::Mul(desc.probeSpacing, counts), 0.5f);
+
+            Random random((uint32_t)settings.seed);
+            for (size_t index = 0; index < numQueries; index++)
+            {
+                positions[index] = { random.Next(-extent.x, extent.x), random.Next(-extent.y, extent.y), random.Next(-extent.z, extent.z) };
+                normals[index] = random.NextDirection();
+                biases[index] = cpu::DDGIGetSurfaceBias(normals[index], random.NextDirection(), desc);
+            }
+
+            // Single and batched queries, without and with masks
+            std::vector<float3> single(numQueries), singleMasked(numQueries), batched(numQueries), batchedMasked(numQueries);
+
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t index = 0; index < numQueries; index++) single[index] = cpu::DDGIGetVolumeIrradiance(positions[index], biases[index], normals[index], desc, resources);
+            double singleRate = GetRate(numQueries, start);
+
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t index = 0; index < numQueries; index++) singleMasked[index] = cpu::DDGIGetVolumeIrradiance(positions[index], biases[index], normals[index], desc, maskedResources);
+            double singleMaskedRate = GetRate(numQueries, start);
+
+            // Batched queries are fast enough for timing noise to matter, so compare the best of several runs
+            double batchedRate = 0.0, batchedMaskedRate = 0.0;
+            for (int run = 0; run < settings.numRuns; run++)
+            {
+                start = std::chrono::high_resolution_clock::now();
+                cpu::DDGIGetVolumeIrradiance((uint32_t)numQueries, positions.data(), biases.data(), normals.data(), desc, resources, batched.data());
+                batchedRate = std::max(batchedRate, GetRate(numQueries, start));
+
+                start = std::chrono::high_resolution_clock::now();
+                cpu::DDGIGetVolumeIrradiance((uint32_t)numQueries, positions.data(), biases.data(), normals.data(), desc, maskedResources, batchedMasked.data());
+                batchedMaskedRate = std::max(batchedMaskedRate, GetRate(numQueries, start));
+            }
+
+            // Mask statistics, empty masks sample all probes
+            double visibleProbes = 0.0;
+            size_t numEmptyMasks = 0;
+            for (uint8_t mask : masks.masks)
+            {
+                int count = 0;
+                for (int bit = 0; bit < 8; bit++) count += (mask >> bit) & 1;
+                visibleProbes += (mask == 0) ? 8 : count;
+                if (mask == 0) numEmptyMasks++;
+            }
+            visibleProbes /= (double)masks.masks.size();
+
+            // Errors: masked vs. unmasked (the approximation), batched vs. single masked (the implementation)
+            double meanError = 0.0;
+            float maxError = 0.f;
+            float maxBatchedError = 0.f;
+            for (size_t index = 0; index < numQueries; index++)
+            {
+                float error = GetRelativeError(singleMasked[index], single[index]);
+                meanError += (double)error;
+                maxError = std::max(maxError, error);
+                maxBatchedError = std::max(maxBatchedError, GetRelativeError(batchedMasked[index], singleMasked[index]));
+            }
+            meanError /= (double)numQueries;
+
+            std::cout << "Probe visibility mask experiment: " << volume.GetNumProbes() << " probes, " << environment.walls.size() << " walls, "
+                      << masks.masks.size() << " cells (" << settings.masks.cellSubdivisions << "^3 per probe cell), "
+                      << settings.numQueries << " queries, " << cpu::GetSIMDName() << " (" << cpu::GetSIMDWidth() << " wide)\n\n";
+
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "Build time:              " << buildTime << " ms\n";
+            std::cout << "Sampled probes per cell: " << visibleProbes << " of 8 (" << numEmptyMasks << " empty masks)\n";
+            std::cout << "Single queries:          " << singleRate << " -> " << singleMaskedRate << " Mq/s (" << (singleMaskedRate / singleRate) << "x)\n";
+            std::cout << "Batched queries:         " << batchedRate << " -> " << batchedMaskedRate << " Mq/s (" << (batchedMaskedRate / batchedRate) << "x)\n";
+            std::cout << std::scientific;
+            std::cout << "Masked vs. unmasked:     " << meanError << " mean, " << maxError << " max relative error\n";
+            std::cout << "Batched vs. single:      " << maxBatchedError << " max relative error\n";
+            std::cout << std::defaultfloat;
+
+            volume.Destroy();
+
+            if (maxBatchedError > MaxRelativeError)
+            {
+                std::cerr << "\nBatched masked queries differ from single masked queries by more than " << MaxRelativeError << "\n";
+                return false;
+            }
+            return true;
+        }
+    }
+}
@@ -0,0 +1,189 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <rtxgi/Types.h>
+
+#include <cfloat>
+#include <cstdint>
+#include <fstream>
+#include <vector>
+
+namespace Scenes
+{
+    struct Mesh;
+    struct Scene;
+}
+
+// A two-level CPU bounding volume hierarchy of a scene, mirroring the GPU acceleration structures:
+// one bottom level BVH per Scenes::Mesh (all of its primitives) and a top level BVH over the Scenes::MeshInstances.
+// Binary BVHs are built with binned SAH (on multiple threads) and collapsed to 8-wide nodes, whose child
+// bounds are tested with the SDK's CPU SIMD layer (AVX2: one 8-wide test, NEON: two 4-wide tests).
+namespace BVH
+{
+    static const uint32_t NodeWidth = 8;
+    static const uint32_t InvalidIndex = 0xFFFFFFFF;
+
+    struct Ray
+    {
+        rtxgi::float3 origin;
+        float         tMin = 0.f;
+        rtxgi::float3 direction;        // Does not need to be normalized, hit distances are in units of the direction's length
+        float         tMax = FLT_MAX;
+    };
+
+    struct Hit
+    {
+        float    t = FLT_MAX;
+        float    u = 0.f;               // Barycentric coordinates of the hit point: (1 - u - v) * v0 + u * v1 + v * v2
+        float    v = 0.f;
+        uint32_t instanceIndex = InvalidIndex;
+        uint32_t primitiveIndex = InvalidIndex;   // Index of the Scenes::MeshPrimitive in the instance's mesh
+        uint32_t triangleIndex = InvalidIndex;    // Index of the triangle in the mesh primitive
+        bool     frontFace = true;                // Same facing as the GPU instances: counter-clockwise winding seen from the ray in right handed coordinate systems, clockwise in left handed
+
+        bool IsValid() const { return instanceIndex != InvalidIndex; }
+    };
+
+    /**
+     * An 8-wide BVH node. Child bounds are stored as structures of arrays for SIMD box tests.
+     * Children are internal node indices or leaves (LeafFlag | (count - 1) << LeafCountShift | first item).
+     * Unused child slots have inverted (empty) bounds and are never hit.
+     */
+    struct alignas(32) Node
+    {
+        static const uint32_t LeafFlag = 0x80000000;
+        static const uint32_t LeafCountShift = 26;
+        static const uint32_t LeafFirstMask = (1u << LeafCountShift) - 1;
+        static const uint32_t MaxLeafSize = 32;
+
+        float    minX[NodeWidth];
+        float    minY[NodeWidth];
+        float    minZ[NodeWidth];
+        float    maxX[NodeWidth];
+        float    maxY[NodeWidth];
+        float    maxZ[NodeWidth];
+        uint32_t children[NodeWidth];
+    };
+
+    struct BuildDesc
+    {
+        uint32_t maxLeafSize = 4;       // Maximum triangles per bottom level leaf (at most Node::MaxLeafSize)
+        uint32_t numBins = 16;          // SAH bins per axis
+        uint32_t numThreads = 0;        // 0: use all hardware threads
+        bool     proxies = false;       // Build the bottom level BVHs from the scene's proxy meshes (when it has them)
+    };
+
+    /**
+     * A bottom level BVH over the triangles of all of a mesh's primitives, in the mesh's local space.
+     * Triangles are stored as structures of arrays (first vertex and two edges) in leaf order, padded for SIMD loads.
+     */
+    struct MeshBVH
+    {
+        std::vector<Node>     nodes;
+        rtxgi::AABB           bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+        uint32_t              numTriangles = 0;
+
+        std::vector<float>    v0x, v0y, v0z;
+        std::vector<float>    e1x, e1y, e1z;
+        std::vector<float>    e2x, e2y, e2z;
+        std::vector<uint32_t> primitiveIndices;
+        std::vector<uint32_t> triangleIndices;
+    };
+
+    struct Instance
+    {
+        uint32_t meshIndex = InvalidIndex;   // InvalidIndex: the instance is not in the top level BVH (empty mesh or singular transform)
+        float    worldToObject[3][4];
+        float    objectToWorld[3][4];
+    };
+
+    /**
+     * The scene BVH: a top level BVH over instances that reference bottom level BVHs.
+     */
+    struct SceneBVH
+    {
+        std::vector<Node>     nodes;
+        rtxgi::AABB           bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+        std::vector<Instance> instances;   // Indexed by scene instance index
+        std::vector<MeshBVH>  meshes;      // Indexed by scene mesh index
+        bool                  proxies = false;   // Built from the scene's proxy meshes: hits reference their primitives and triangles
+    };
+
+    /**
+     * A bottom level subtree of an instance, referenced by a ProbeBVH.
+     */
+    struct ProbeSubtree
+    {
+        uint32_t instanceIndex;
+        uint32_t item;                      // Bottom level node index or encoded leaf
+    };
+
+    /**
+     * The scene BVH as seen from a point that many rays start from (e.g. a DDGI probe).
+     * The scene BVH is cut into bottom level subtrees that lie on one side of the point's axis planes (or are leaves),
+     * and the subtrees within the radius are sorted into the direction octants they can be hit from. Each octant gets a
+     * small BVH over its subtrees, with their bounds clipped to the octant (rays from the point never leave their octant).
+     * Rays from the point then start at the subtrees on their side of it, instead of traversing the top level BVH and the
+     * upper bottom level nodes again for every ray. Geometry is not copied and hits are the same as the scene BVH's.
+     */
+    struct ProbeBVH
+    {
+        rtxgi::float3             origin = { 0.f, 0.f, 0.f };
+        float                     radius = -1.f;            // Negative: not built
+        std::vector<Node>         octants[8];               // Indexed by GetOctant(), leaves hold a single subtree index
+        std::vector<ProbeSubtree> subtrees;
+    };
+
+    // Returns the direction octant of a ray: bits 0, 1, and 2 are set for negative x, y, and z directions
+    inline uint32_t GetOctant(const rtxgi::float3& direction)
+    {
+        return (direction.x < 0.f ? 1u : 0u) | (direction.y < 0.f ? 2u : 0u) | (direction.z < 0.f ? 4u : 0u);
+    }
+
+    // Returns the meshes the scene BVH was built from (the scene's meshes or proxy meshes), whose primitives and triangles hits reference
+    const std::vector<Scenes::Mesh>& GetMeshes(const Scenes::Scene& scene, const SceneBVH& bvh);
+
+    // Builds the bottom level BVH of a mesh
+    void BuildMesh(const Scenes::Mesh& mesh, const BuildDesc& desc, MeshBVH& bvh);
+
+    // Builds the bottom level BVHs of all meshes and the top level BVH of all instances
+    void Build(const Scenes::Scene& scene, const BuildDesc& desc, SceneBVH& bvh);
+
+    // Rebuilds the top level BVH only, after instance transforms change
+    void BuildInstances(const Scenes::Scene& scene, const BuildDesc& desc, SceneBVH& bvh);
+
+    // Finds the closest hit along the ray. Returns false if nothing is hit.
+    bool TraceClosestHit(const SceneBVH& bvh, const Ray& ray, Hit& hit);
+
+    // Returns true if anything is hit along the ray (e.g. for shadow and visibility rays)
+    bool TraceAnyHit(const SceneBVH& bvh, const Ray& ray);
+
+    // Traces a batch of rays on multiple threads (0: use all hardware threads)
+    void TraceClosestHit(const SceneBVH& bvh, uint32_t numRays, const Ray* rays, Hit* hits, uint32_t numThreads = 0);
+    void TraceAnyHit(const SceneBVH& bvh, uint32_t numRays, const Ray* rays, bool* hits, uint32_t numThreads = 0);
+
+    // Cuts the scene BVH around the origin and builds the octant BVHs of the subtrees within the radius
+    void BuildProbe(const SceneBVH& bvh, const rtxgi::float3& origin, float radius, const BuildDesc& desc, ProbeBVH& probe);
+
+    // Finds the closest hit of a ray that starts at the probe's origin and ends within its radius (the probe must be built from the scene BVH)
+    bool TraceClosestHit(const SceneBVH& bvh, const ProbeBVH& probe, const Ray& ray, Hit& hit);
+
+    // Traces a batch of rays from the probe's origin on the calling thread, one octant after another
+    void TraceClosestHit(const SceneBVH& bvh, const ProbeBVH& probe, uint32_t numRays, const Ray* rays, Hit* hits);
+
+    // Returns the number of bytes allocated by the probe's BVHs
+    size_t GetMemorySize(const ProbeBVH& probe);
+
+    // Measures build times and closest/any hit throughput on the scene, checks hits against brute force,
+    // compares probe BVHs with per-ray traversal on probe rays, and writes the results to the log
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log);
+}
@@ -14,6 +14,40 @@
 
 namespace Caches
 {
+    /**
+     * A read-only memory mapping of a scene cache file. Cached textures and geometry pools share ownership of the mapping that
+     * holds their arrays (see Textures::Texture::owner and Scenes::GeometryPool), so the mapping lives until the last of them is released.
+     */
+    struct Mapping
+    {
+        const uint8_t* data = nullptr;
+        uint64_t size = 0;
+    #if defined(_WIN32) || defined(WIN32)
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+    #endif
+
+        ~Mapping();
+    };
+
+    // Returns a 64-bit hash of the bytes (the xxHash64 algorithm)
+    uint64_t Hash(const void* data, uint64_t size, uint64_t seed = 0);
+
+    // Updates the size, write time, and content hash of the scene source file in the directory, returns false if the file doesn't exist.
+    // Files with the size and write time of the source's hash aren't read again.
+    bool UpdateSource(const std::string& directory, Scenes::SourceFile& source);
+
+    // Returns true if the scene's textures or geometry pools reference arrays in the mapping
+    bool IsMapped(const Scenes::Scene& scene, const Mapping& mapping);
+
     bool Serialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log);
-    bool Deserialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log);
+
+    // Writes the scene cache file on a background thread, from a snapshot of the scene (the scene can change while it runs).
+    // FinishSerialize() logs the result of a completed write (or waits for it), returns false while the write is in progress.
+    void SerializeAsync(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log);
+    bool FinishSerialize(Scenes::Scene& scene, std::ofstream& log, bool wait = false);
+    bool Deserialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log, uint32_t numThreads = 0);
+
+    // Measures loading the scene's cache, uncompressed and compressed, with 1 to all hardware threads and writes the results to the log
+    bool Benchmark(Scenes::Scene& scene, std::ofstream& log);
 }
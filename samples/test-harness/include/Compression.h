@@ -0,0 +1,41 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Lossless compression of the scene cache's arrays. The codec is a byte oriented LZ77 variant in the style of LZ4:
+// sequences of literals followed by a match (a copy of earlier output) within a 64KB window, found with a single hash
+// table probe. It trades compression ratio for decompression speed, decompression is bounded by memory bandwidth.
+//
+// Filters reorder arrays of elements before compression so similar bytes end up next to each other: shuffling groups
+// the n-th bytes of all elements (e.g. the exponents of vertex position floats), delta encoding turns runs of nearby
+// indices into runs of small differences.
+namespace Compression
+{
+    // Returns the largest compressed size of size bytes (incompressible bytes grow slightly)
+    uint64_t GetMaxCompressedSize(uint64_t size);
+
+    // Compresses size bytes into dst (at least GetMaxCompressedSize(size) bytes), returns the compressed size
+    uint64_t Compress(const uint8_t* src, uint64_t size, uint8_t* dst);
+
+    // Decompresses exactly size bytes into dst, returns false if the compressed bytes are invalid.
+    // Reads and writes stay within the given sizes for any input.
+    bool Decompress(const uint8_t* src, uint64_t compressedSize, uint8_t* dst, uint64_t size);
+
+    // Transposes elements of stride bytes: byte b of element i moves to b * count + i. Bytes after the last whole element are copied.
+    void Shuffle(const uint8_t* src, uint64_t size, uint32_t stride, uint8_t* dst);
+    void Unshuffle(const uint8_t* src, uint64_t size, uint32_t stride, uint8_t* dst);
+
+    // Replaces each value with its difference to the previous value (in place)
+    void DeltaEncode(uint32_t* values, uint64_t count);
+    void DeltaDecode(uint32_t* values, uint64_t count);
+}
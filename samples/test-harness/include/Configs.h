@@ -43,6 +43,7 @@ namespace Configs
         bool               probeRelocationEnabled = false;
         bool               probeClassificationEnabled = false;
         bool               probeVariabilityEnabled = false;
+        bool               probeAdaptiveHysteresisEnabled = false;
         bool               infiniteScrollingEnabled = false;
         bool               clearProbeVariability = false;
 
@@ -63,6 +64,8 @@ namespace Configs
         float              probeIrradianceThreshold = 0.f;
         float              probeBrightnessThreshold = 0.f;
         float              probeVariabilityThreshold = 0.f;
+        float              probeAdaptiveHysteresisMin = 0.7f;
+        float              probeAdaptiveHysteresisThreshold = 0.03f;
 
         float              probeMinFrontfaceDistance = 0.f;
 
@@ -186,6 +189,11 @@ namespace Configs
         std::string screenshotPath = "";
         DirectX::XMFLOAT3 skyColor = { 0.f, 0.f, 0.f };
         float skyIntensity = 1.f;
+        float proxyRatio = 0.f;             // fraction of triangles kept by the probe ray tracing proxy meshes (0: no proxies)
+        float proxyMaxError = 0.01f;        // maximum proxy mesh error, relative to the mesh's bounding box diagonal
+        int   opacityLevel = 2;             // subdivision level of the alpha-tested triangles' opacity states, 4^level micro-triangles (0-2, negative: no states)
+        bool  cacheCompression = false;     // compress the vertex, index, and texel arrays of the scene cache file
+        bool  compactVertices = false;      // encode the mesh vertices in 20 bytes (quantized, see Quantization.h) for the GPU
 
         std::vector<Camera> cameras;
         std::vector<Light> lights;
@@ -216,6 +224,12 @@ namespace Configs
         bool        showUI = true;
         bool        showPerf = false;
         bool        benchmarkRunning = false;
+        bool        benchmarkBVH = false;         // Benchmark the CPU scene BVH after the scene loads (requires RTXGI_CPU_ENABLE)
+        bool        benchmarkSamplers = false;    // Benchmark the CPU texture samplers after the scene loads
+        bool        benchmarkCaches = false;      // Benchmark loading the scene cache after the scene loads
+        bool        benchmarkQuantization = false; // Benchmark the compact vertex format (encoding and round trip errors) after the scene loads
+        bool        benchmarkOptimize = false;    // Measure the fetch locality of the mesh optimization when the scene is built from its glTF file
+        bool        benchmarkIndexBuffers = false; // Validate the 16-bit and 32-bit index buffers after the scene loads
 
         uint32_t    benchmarkProgress = 0;
 
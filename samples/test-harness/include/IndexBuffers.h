@@ -0,0 +1,66 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "graphics/Types.h"
+
+#include <fstream>
+
+namespace Scenes
+{
+    struct Scene;
+    struct Mesh;
+    struct MeshPrimitive;
+}
+
+// Lays out the index buffers of meshes with an index format per primitive (MeshPrimitive::indexFormat). Primitives whose indices
+// are all below 0xFFFF (the strip cut value) use 16-bit indices, others 32-bit indices. The primitives' indices stay 32-bit in
+// their geometry pool, the format applies to the mesh's index buffer and to the scene cache, which stores the index buffers.
+//
+// A mesh's index buffer holds its primitives' indices in order, each primitive starting 4 byte aligned (the padding is zero).
+// The opacity states follow the indices (see Opacity.h). GeometryData::indexByteAddress flags the format (INDEX_FORMAT_16),
+// and the ray tracing shaders load the triangles' 16-bit indices from the aligned words that hold them (see LoadIndices()).
+namespace IndexBuffers
+{
+    struct Stats
+    {
+        uint64_t numPrimitives = 0;
+        uint64_t num16BitPrimitives = 0;            // Primitives with 16-bit indices
+        uint64_t numBytes = 0;                      // Of the index buffers' indices
+        uint64_t num32BitBytes = 0;                 // Of the indices as 32-bit indices
+        uint64_t numErrors = 0;                     // Triangles whose indices don't load back from the index buffers
+        double   seconds = 0.0;
+    };
+
+    // Returns the smallest index format (INDEX_FORMAT_*) of the primitive's indices
+    uint32_t SelectFormat(const Scenes::MeshPrimitive& primitive);
+
+    // Returns the size in bytes of an index of the primitive's format
+    uint32_t GetStride(const Scenes::MeshPrimitive& primitive);
+
+    // Sets the byte offsets of the mesh's primitives in its index buffer, from their formats. Returns the size of the indices in bytes.
+    uint32_t Layout(Scenes::Mesh& mesh);
+
+    // Returns the size in bytes of the indices of the mesh's index buffer (the opacity states follow them)
+    uint32_t GetSize(const Scenes::Mesh& mesh);
+
+    // Writes the indices of the mesh's index buffer (GetSize() bytes)
+    void Write(const Scenes::Mesh& mesh, uint8_t* data);
+
+    // Selects the index formats of the meshes' primitives and lays out their index buffers
+    void SelectFormats(Scenes::Mesh* meshes, size_t numMeshes);
+
+    // Writes the meshes' index buffers and loads each triangle's indices back the way the ray tracing shaders do
+    void Validate(const Scenes::Mesh* meshes, size_t numMeshes, Stats& stats);
+
+    // Validates the scene's index buffers (see Validate()) and writes their formats and sizes to the log
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log);
+}
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Scenes
+{
+    struct Scene;
+}
+
+// Classifies the triangles of alpha-tested (masked) mesh primitives as opaque, transparent, or unknown, so the any-hit
+// shaders accept or ignore most candidate hits without loading texture coordinates and sampling the albedo texture.
+//
+// Triangles are split into 4^level micro-triangles (a uniform subdivision in barycentric space, see GetMicroTriangle()).
+// The UV footprint of each micro-triangle is rasterized against the alpha of the texture mips the any-hit shaders sample:
+// mip 0 (AHS_LOD0) and the two mips of the fixed GI lod (AHS_GI). Every texel a bilinear sample inside the footprint can
+// read is tested, with wrap addressing. A micro-triangle is opaque (or transparent) only if all of them are, otherwise its
+// state is unknown and the shaders alpha-test as before. AHS_PRIMARY samples anisotropically and always alpha-tests.
+//
+// The 2-bit states of a triangle's micro-triangles are packed in one word. A mesh's states are stored after its indices in
+// its index buffer, GeometryData::opacityStates locates a primitive's states.
+namespace Opacity
+{
+    static const uint32_t MaxLevel = 2;             // 16 micro-triangles of 2 bits fill a word
+
+    struct Desc
+    {
+        uint32_t level = 2;                         // Subdivision level, 4^level micro-triangles per triangle
+        float    alphaMargin = 1.f / 255.f;         // Texels within the margin of the alpha cutoff are neither opaque nor transparent
+        uint32_t numThreads = 0;                    // 0: use all hardware threads
+    };
+
+    struct Stats
+    {
+        uint64_t numTriangles = 0;                  // Classified triangles
+        uint64_t numUnclassified = 0;               // Alpha-tested triangles with textures the CPU can't read
+        uint64_t numOpaque = 0;                     // Micro-triangles per state
+        uint64_t numTransparent = 0;
+        uint64_t numUnknown = 0;
+        uint64_t numTexels = 0;                     // Texels tested
+        double   seconds = 0.0;
+    };
+
+    // Returns the micro-triangle that contains the barycentrics (the weights of the triangle's second and third vertices)
+    uint32_t GetMicroTriangle(float u, float v, uint32_t level);
+
+    // Returns the opacity state (OPACITY_STATE_*) of a micro-triangle in a triangle's packed states
+    inline uint32_t GetState(uint32_t states, uint32_t microTriangle) { return (states >> (microTriangle * 2)) & 0x3; }
+
+    // Classifies the triangles of the scene's alpha-tested mesh primitives and lays out their states in the mesh index buffers
+    void Classify(Scenes::Scene& scene, const Desc& desc, Stats& stats);
+
+    // Removes the scene's opacity states
+    void Clear(Scenes::Scene& scene);
+}
@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Scenes
+{
+    struct MeshPrimitive;
+}
+
+// Optimizes the memory locality of mesh primitives when the scene is built from its glTF file:
+//
+// 1. Welding: vertices that are bitwise equal (all attributes of Graphics::Vertex) are merged.
+// 2. Triangle order: the triangles are reordered for vertex reuse (Tipsify, Sander et al. 2007), so consecutive triangles
+//    share vertices and spatially close triangles are close in the index buffer.
+// 3. Vertex order: the vertices are reordered in the order the triangles first use them (vertices no triangle uses are
+//    removed), so the vertices of a triangle and its neighbors share cache lines.
+//
+// The welded primitives render the same triangles (the same vertex attributes in the same winding order).
+//
+// SimulateFetches() measures the locality of the index and vertex loads of hit shading: triangles are visited in a spatially
+// coherent order (like the hits of probe rays), and their indices and vertices are loaded through a simulated L1 cache.
+// OptimizePrimitive() only simulates the loads before and after optimizing when Desc::simulateFetches is set (the
+// app.benchmarkOptimize config option), scene builds otherwise only weld and reorder.
+namespace Optimize
+{
+    struct Desc
+    {
+        bool     weld = true;
+        bool     reorderTriangles = true;
+        bool     reorderVertices = true;
+        uint32_t cacheSize = 16;                    // Vertices, the cache Tipsify reorders the triangles for
+        bool     simulateFetches = false;           // Measure the fetch locality before and after optimizing (Stats::before and after)
+    };
+
+    struct FetchStats
+    {
+        uint64_t numTriangles = 0;
+        uint64_t numVertexMisses = 0;               // Misses of a 16 entry FIFO vertex cache, in index order
+        uint64_t numLineMisses = 0;                 // Misses of a 32KB, 8-way LRU cache of 64B lines, in hit order
+    };
+
+    struct Stats
+    {
+        uint64_t numPrimitives = 0;                 // Optimized primitives
+        uint64_t numVertices = 0;                   // Vertices before optimization
+        uint64_t numWelded = 0;                     // Duplicate vertices removed
+        uint64_t numUnreferenced = 0;               // Vertices no triangle uses removed
+        FetchStats before;                          // Empty unless Desc::simulateFetches is set
+        FetchStats after;
+        double   seconds = 0.0;                     // Summed over the threads
+    };
+
+    // Merges the primitive's duplicate vertices, returns the number of vertices removed
+    uint64_t WeldVertices(Scenes::MeshPrimitive& primitive);
+
+    // Reorders the primitive's triangles for vertex reuse in a cache of the size (Tipsify)
+    void ReorderTriangles(Scenes::MeshPrimitive& primitive, uint32_t cacheSize);
+
+    // Reorders the primitive's vertices in the order of first use by the triangles, returns the number of unused vertices removed
+    uint64_t ReorderVertices(Scenes::MeshPrimitive& primitive);
+
+    // Adds the loads of the primitive's hit shading (see above), vertices of the stride in bytes
+    void SimulateFetches(const Scenes::MeshPrimitive& primitive, uint32_t vertexStride, FetchStats& stats);
+
+    // Optimizes the primitive (in place, its vertex and index counts only decrease) and adds its statistics.
+    // Primitives with indices that are out of range or not whole triangles are not changed.
+    void OptimizePrimitive(Scenes::MeshPrimitive& primitive, const Desc& desc, Stats& stats);
+}
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "graphics/Types.h"
+
+#include <fstream>
+
+namespace Scenes
+{
+    struct Scene;
+    struct Mesh;
+    struct MeshPrimitive;
+}
+
+// Encodes the vertices of the scene's meshes in a compact 20 byte format (Graphics::Vertex is 48 bytes), which the ray
+// tracing shaders decode when they load the vertices of a hit triangle (see LoadVertices() in RayTracing.hlsl/glsl).
+//
+// Positions are 16-bit signed normalized values in the bounding box of their mesh: center + (value / 32767) * halfExtent.
+// Normals and tangents are 16-bit signed normalized octahedral coordinates, and texture coordinates are half floats. The
+// sign of the bitangent (the tangent's w) is stored in the position's w. Zero normals and tangents (e.g. missing tangents)
+// decode as +Z.
+//
+// A compact vertex buffer starts with the dequantization transform of its mesh (a row major 3x4 matrix), the vertices follow.
+// The acceleration structure builds read the positions in the R16G16B16A16_SNORM format and apply the same transform.
+// GeometryData::vertexByteAddress flags the format (VERTEX_FORMAT_COMPACT).
+namespace Quantization
+{
+    static const uint32_t DequantizationSize = 48;  // Bytes, the transform before the vertices of a compact vertex buffer
+
+    struct CompactVertex
+    {
+        int16_t  position[4];                       // xyz: snorm in the mesh bounding box, w: the bitangent sign (+-32767)
+        uint32_t normal;                            // Octahedral, 2x snorm16
+        uint32_t tangent;                           // Octahedral, 2x snorm16
+        uint32_t uv0;                               // 2x half
+    };
+
+    struct Desc
+    {
+        uint32_t numThreads = 0;                    // 0: use all hardware threads
+    };
+
+    struct Stats
+    {
+        uint64_t numVertices = 0;                   // Encoded vertices
+        double   seconds = 0.0;
+    };
+
+    // Writes the transform (a row major 3x4 matrix) that maps snorm positions to the bounding box
+    void GetDequantization(const rtxgi::AABB& boundingBox, float transform[12]);
+
+    // Encodes (decodes) a vertex of a mesh with the bounding box
+    void Encode(const Graphics::Vertex& vertex, const rtxgi::AABB& boundingBox, CompactVertex& compact);
+    void Decode(const CompactVertex& compact, const rtxgi::AABB& boundingBox, Graphics::Vertex& vertex);
+
+    // Encodes the vertices of the scene's meshes that aren't encoded yet in their geometry pools
+    void Encode(Scenes::Scene& scene, const Desc& desc, Stats& stats);
+
+    // Removes the scene's compact vertices
+    void Clear(Scenes::Scene& scene);
+
+    // Returns true if the mesh's vertices are encoded (its vertex buffer uses the compact format)
+    bool IsCompact(const Scenes::Mesh& mesh);
+
+    // Returns the mesh's range of its geometry pool's compact vertices (see IsCompact())
+    CompactVertex* GetCompactVertices(const Scenes::Mesh& mesh);
+
+    // Returns the vertex format (VERTEX_FORMAT_*), stride, and buffer size of the mesh's vertex buffer
+    uint32_t GetVertexFormat(const Scenes::Mesh& mesh);
+    uint32_t GetVertexStride(const Scenes::Mesh& mesh);
+    uint64_t GetVertexBufferSize(const Scenes::Mesh& mesh);
+
+    // Returns the byte address of the primitive's first vertex in the mesh's vertex buffer
+    uint32_t GetVertexByteAddress(const Scenes::Mesh& mesh, const Scenes::MeshPrimitive& primitive);
+
+    // Writes the mesh's vertex buffer (GetVertexBufferSize() bytes)
+    void WriteVertexBuffer(const Scenes::Mesh& mesh, uint8_t* data);
+
+    // Measures encoding throughput on the scene's vertices with 1 and all hardware threads, checks the round trip errors
+    // of every vertex against the format's error bounds, and writes the results to the log
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log);
+}
@@ -0,0 +1,102 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include "Textures.h"
+
+#include <rtxgi/Types.h>
+
+#include <fstream>
+#include <vector>
+
+namespace Scenes
+{
+    struct Scene;
+}
+
+// Samples the textures of a scene on the CPU, reading their in-memory layouts directly (see Textures::FormatTexture()
+// and Textures::FormatCompressedTexture()): tightly packed RGBA8 texels without mips, or BC7 blocks with 256 byte aligned
+// block rows and 512 byte aligned mips. BC7 blocks are decoded on demand into a small per thread cache of decoded blocks.
+//
+// Sampling mirrors the harness' shaders: wrap addressing, bilinear filtering within a mip, linear filtering between mips,
+// and texture coordinate differentials from ray differentials (ComputeUV0Differentials() in RayTracing.hlsl), with the
+// ray's direction differentials given by a ray cone instead of the camera. Texels are returned as UNORM values, like the
+// GPU's R8G8B8A8_UNORM and BC7_UNORM textures.
+namespace Samplers
+{
+    struct Mip
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t rowPitch = 0;                      // Bytes between rows of texels (RGBA8) or blocks (BC7)
+        uint64_t offset = 0;                        // Byte offset of the mip in the texture's texels
+    };
+
+    /**
+     * The layout of a texture's texels. Views don't own the texels, the texture must stay loaded.
+     */
+    struct View
+    {
+        Textures::ETextureFormat format = Textures::ETextureFormat::UNCOMPRESSED;
+        const uint8_t* texels = nullptr;
+        std::vector<Mip> mips;
+    };
+
+    /**
+     * Decoded BC7 blocks, direct mapped by block coordinates (4x4 texels of 16x16 blocks share the entries).
+     * Caches are not thread safe, use one per thread.
+     */
+    struct BlockCache
+    {
+        static const uint32_t NumEntries = 256;
+
+        const uint8_t* blocks[NumEntries] = {};     // Address of the cached block, nullptr: empty
+        uint8_t  texels[NumEntries][16][4];         // RGBA8 texels of the cached blocks, in rows
+        uint64_t numHits = 0;
+        uint64_t numMisses = 0;
+    };
+
+    // Computes the texture's layout, returns false if its format or size can't be read
+    bool CreateView(const Textures::Texture& texture, View& view);
+
+    // Decodes a 16 byte BC7 block into its 4x4 RGBA8 texels, in rows
+    void DecodeBC7Block(const uint8_t* block, uint8_t texels[16][4]);
+
+    // Decodes a mip into tightly packed RGBA8 rows, returns false if the view doesn't have the mip
+    bool LoadMip(const View& view, uint32_t mip, std::vector<uint8_t>& texels);
+
+    // Loads a texel (wrap addressing)
+    rtxgi::float4 Load(const View& view, uint32_t mip, int64_t x, int64_t y, BlockCache& cache);
+
+    // Samples a mip with bilinear filtering (wrap addressing)
+    rtxgi::float4 SampleBilinear(const View& view, uint32_t mip, const rtxgi::float2& uv, BlockCache& cache);
+
+    // Samples the mips with trilinear filtering, the lod is clamped to the view's mips
+    rtxgi::float4 SampleLevel(const View& view, const rtxgi::float2& uv, float lod, BlockCache& cache);
+
+    // Returns the (isotropic) lod of texture coordinate differentials: the log2 of the longest differential in mip 0 texels
+    float ComputeLod(const View& view, const rtxgi::float2& dUVdx, const rtxgi::float2& dUVdy);
+
+    // Samples the mips with trilinear filtering at the lod of texture coordinate differentials
+    rtxgi::float4 SampleGrad(const View& view, const rtxgi::float2& uv, const rtxgi::float2& dUVdx, const rtxgi::float2& dUVdy, BlockCache& cache);
+
+    // Returns the spread angle of the cones of rays distributed uniformly over the sphere (e.g. a probe's rays)
+    float GetConeSpreadAngle(uint32_t numRays);
+
+    // Computes the texture coordinate differentials of a ray cone's footprint on a triangle (world space vertex positions).
+    // The cone's width grows by the spread angle per unit of distance along the (normalized) ray direction, from zero at the ray origin.
+    void ComputeUV0Differentials(const rtxgi::float3 positions[3], const rtxgi::float2 uvs[3], const rtxgi::float3& rayDirection, float hitT, float coneSpreadAngle,
+                                 rtxgi::float2& dUVdx, rtxgi::float2& dUVdy);
+
+    // Measures sampling throughput on the scene's textures for coherent and incoherent access,
+    // checks bilinear samples at texel centers against texel loads, and writes the results to the log
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log);
+}
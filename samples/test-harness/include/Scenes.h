@@ -11,13 +11,54 @@
 
 #include "Common.h"
 #include "Configs.h"
+#include "IndexBuffers.h"
+#include "Quantization.h"
 #include "Textures.h"
 
 #include "graphics/Types.h"
 
+#include <memory>
+
+namespace Caches
+{
+    struct Mapping;
+    struct Serialization;
+}
+
 namespace Scenes
 {
 
+    /**
+     * The vertices and indices of the primitives of a set of meshes (e.g. the scene's meshes), in one allocation each.
+     * Meshes share ownership of their pool, their primitives view ranges of it (in mesh and primitive order).
+     * Pools loaded from a scene cache can view its arrays in the file mapping (read-only, they keep it mapped, see Caches.cpp).
+     */
+    struct GeometryPool
+    {
+        std::shared_ptr<Graphics::Vertex[]> vertices;
+        std::shared_ptr<uint32_t[]> indices;
+        std::shared_ptr<Quantization::CompactVertex[]> compactVertices; // in the order of the vertices, null: not encoded (see Quantization.h), shared with cache writes
+        uint64_t numVertices = 0;
+        uint64_t numIndices = 0;
+    };
+
+    /**
+     * A range of elements in a geometry pool.
+     */
+    template<typename T>
+    struct PoolView
+    {
+        T* elements = nullptr;
+        size_t count = 0;
+
+        T* data() const { return elements; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        T* begin() const { return elements; }
+        T* end() const { return elements + count; }
+        T& operator[](size_t index) const { return elements[index]; }
+    };
+
     struct MeshPrimitive
     {
         int                           index = -1;
@@ -25,10 +66,13 @@ namespace Scenes
         bool                          opaque = true;
         bool                          doubleSided = false;
         uint32_t                      vertexByteOffset = 0;
-        uint32_t                      indexByteOffset = 0;
+        uint32_t                      indexByteOffset = 0;    // in the mesh's index buffer (see IndexBuffers.h)
+        uint32_t                      indexFormat = Graphics::INDEX_FORMAT_32;
         rtxgi::AABB                   boundingBox; // not instanced transformed
-        std::vector<Graphics::Vertex> vertices;
-        std::vector<uint32_t>         indices;
+        PoolView<Graphics::Vertex>    vertices;               // in the mesh's geometry pool
+        PoolView<uint32_t>            indices;
+        uint32_t                      opacityByteOffset = 0;  // in the mesh's index buffer, after the indices
+        std::vector<uint32_t>         opacityStates;          // one word per triangle (see Opacity.h), empty: not classified
     };
 
     struct Mesh
@@ -37,8 +81,15 @@ namespace Scenes
         std::string name = "";
         uint32_t numIndices = 0;
         uint32_t numVertices = 0;
+        uint32_t numOpacityStates = 0; // opacity state words stored after the indices
+        uint64_t hash = 0;             // of the mesh's glTF primitives and their data, 0: unknown
         rtxgi::AABB boundingBox; // not instance transformed
         std::vector<MeshPrimitive> primitives;
+
+        // The vertices and indices of the mesh's primitives, contiguous in the geometry pool (its vertex and index buffers)
+        std::shared_ptr<GeometryPool> pool;
+        PoolView<Graphics::Vertex> vertices;
+        PoolView<uint32_t> indices;
     };
 
     struct MeshInstance
@@ -52,6 +103,8 @@ namespace Scenes
             0.f, 1.f, 0.f, 0.f,
             0.f, 0.f, 1.f, 0.f
         };
+        bool dirty = false;              // the transform changed since the last ClearInstanceEdits()
+        rtxgi::AABB previousBoundingBox; // instance transformed, before the first change (valid when dirty)
     };
 
     struct Material
@@ -98,12 +151,21 @@ namespace Scenes
         std::vector<int> children;
     };
 
+    struct SourceFile
+    {
+        std::string uri = "";   // relative to the scene directory
+        uint64_t size = 0;
+        int64_t  time = 0;      // last write time
+        uint64_t hash = 0;      // of the contents (see Caches::Hash())
+    };
+
     struct Scene
     {
         std::string name = "";
         uint32_t activeCamera = 0;
         uint32_t numMeshPrimitives = 0;
         uint32_t numTriangles = 0;
+        uint32_t numProxyTriangles = 0;
         uint32_t hasDirectionalLight = 0;
         uint32_t numPointLights = 0;
         uint32_t numSpotLights = 0;
@@ -121,6 +183,27 @@ namespace Scenes
         std::vector<Material> materials;
         std::vector<Textures::Texture> textures;
 
+        // Simplified meshes for probe ray tracing, indexed by mesh index (empty: no proxies)
+        float proxyRatio = 0.f;
+        float proxyMaxError = 0.f;
+        std::vector<Mesh> proxyMeshes;
+
+        // Subdivision level of the alpha-tested triangles' opacity states (negative: not classified)
+        int opacityLevel = -1;
+
+        // The glTF file, buffers, and images the scene was built from. When a source changes, the scene is rebuilt from the
+        // glTF file and reuses the textures and meshes of its cache whose content hashes didn't change.
+        std::vector<SourceFile> sources;
+
+        // Compress the arrays of the scene's cache file (see Caches.cpp)
+        bool cacheCompression = false;
+
+        // The scene cache file the scene was loaded from, mapped while textures and geometry pools reference it (null: not loaded from a cache)
+        std::shared_ptr<Caches::Mapping> cacheMapping;
+
+        // The background write of the scene's cache file (null: none in progress), destroyed first so the scene waits for it
+        std::shared_ptr<Caches::Serialization> cacheWrite;
+
         Camera& GetActiveCamera() { return cameras[activeCamera]; }
         const Camera& GetActiveCamera() const { return cameras[activeCamera]; }
     };
@@ -128,6 +211,13 @@ namespace Scenes
     bool Initialize(const Configs::Config& config, Scene& scene, std::ofstream& log);
     void Traverse(size_t nodeIndex, DirectX::XMMATRIX transform, Scene& scene);
     void UpdateCamera(Camera& camera);
+    void SetInstanceTransform(Scene& scene, uint32_t instanceIndex, const float transform[3][4]);
+    void ClearInstanceEdits(Scene& scene);
     void Cleanup(Scene& scene);
 
+    // Allocates one geometry pool for the meshes, sized by the counts of their primitives' vertex and index views, and points the
+    // views of the meshes and primitives at their ranges of it. Primitive views with elements (e.g. of another pool) are copied.
+    // The pool has no compact vertices (see Quantization::Encode()). The primitives keep their index formats.
+    void AllocateGeometry(Mesh* meshes, size_t numMeshes);
+
 }
@@ -0,0 +1,50 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace Scenes
+{
+    struct Mesh;
+    struct Scene;
+}
+
+// Simplifies meshes into proxy meshes for probe ray tracing. Probe rays only feed low frequency diffuse irradiance,
+// so they can be traced against coarser geometry than the geometry seen by primary rays.
+//
+// Each mesh primitive is simplified on its own (proxies keep the primitives and their materials) with quadric error
+// metric half-edge collapses: a vertex moves onto a neighbor, so the remaining vertices and their attributes are unchanged.
+// Vertices on open boundaries only collapse along the boundary (and the boundary's planes are added to their quadrics),
+// so primitives that share a boundary don't crack apart. Vertices on UV or normal seams (positions shared by vertices
+// with different attributes) and vertices of non-manifold edges are never collapsed.
+namespace Simplify
+{
+    struct Desc
+    {
+        float    targetRatio = 0.25f;   // Target fraction of the triangles of each mesh primitive
+        float    maxError = 0.01f;      // Maximum geometric error, relative to the mesh's bounding box diagonal
+        uint32_t numThreads = 0;        // 0: use all hardware threads
+    };
+
+    struct Stats
+    {
+        uint64_t numTriangles = 0;
+        uint64_t numProxyTriangles = 0;
+        double   seconds = 0.0;
+    };
+
+    // Simplifies the mesh's primitives into the proxy mesh
+    void SimplifyMesh(const Scenes::Mesh& mesh, const Desc& desc, Scenes::Mesh& proxy);
+
+    // Simplifies the scene's meshes into its proxy meshes, one mesh per thread. Meshes that already have a proxy mesh are skipped.
+    void CreateProxies(Scenes::Scene& scene, const Desc& desc, Stats& stats);
+}
@@ -12,6 +12,8 @@
 
 #include "Common.h"
 
+#include <memory>
+
 namespace Textures
 {
     enum class ETextureType
@@ -42,7 +44,10 @@ namespace Textures
         uint64_t texelBytes = 0;    // the number of bytes (aligned, all mips)
         uint8_t* texels = nullptr;
 
+        uint64_t hash = 0;          // of the source image file, 0: unknown
+
         bool cached = false;
+        std::shared_ptr<const void> owner;  // shares the texels (e.g. a mapped scene cache file), null: the texture owns its texels
 
         void SetName(std::string n)
         {
@@ -38,6 +38,19 @@
     const uint POSTPROCESS_FLAG_USE_DITHER = 0x4;
     const uint POSTPROCESS_FLAG_USE_GAMMA = 0x8;
 
+    // OPACITY_STATES
+    const uint OPACITY_STATE_TRANSPARENT = 0;
+    const uint OPACITY_STATE_OPAQUE = 1;
+    const uint OPACITY_STATE_UNKNOWN = 2;
+
+    // VERTEX_FORMATS
+    const uint VERTEX_FORMAT_FLOAT = 0;
+    const uint VERTEX_FORMAT_COMPACT = 0x1;
+
+    // INDEX_FORMATS
+    const uint INDEX_FORMAT_32 = 0;
+    const uint INDEX_FORMAT_16 = 0x1;
+
 #else
     enum COMPOSITE_USE_FLAGS
     {
@@ -63,6 +76,25 @@
         POSTPROCESS_FLAG_USE_DITHER = 0x4,
         POSTPROCESS_FLAG_USE_GAMMA = 0x8,
     };
+
+    enum OPACITY_STATES
+    {
+        OPACITY_STATE_TRANSPARENT = 0,
+        OPACITY_STATE_OPAQUE = 1,
+        OPACITY_STATE_UNKNOWN = 2
+    };
+
+    enum VERTEX_FORMATS
+    {
+        VERTEX_FORMAT_FLOAT = 0,
+        VERTEX_FORMAT_COMPACT = 0x1
+    };
+
+    enum INDEX_FORMATS
+    {
+        INDEX_FORMAT_32 = 0,
+        INDEX_FORMAT_16 = 0x1
+    };
 #endif
 
     struct Payload
@@ -120,8 +152,9 @@
     struct GeometryData
     {
         uint materialIndex;
-        uint indexByteAddress;
-        uint vertexByteAddress;
+        uint indexByteAddress;  // The index format (INDEX_FORMAT_*) in the low bit
+        uint vertexByteAddress; // The vertex format (VERTEX_FORMAT_*) in the low bit
+        uint opacityStates;     // Byte address of the triangles' opacity states in the index buffer, the subdivision level + 1 in the low 2 bits (0: no states)
     };
 
     struct Camera
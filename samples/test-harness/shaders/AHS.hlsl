@@ -24,6 +24,11 @@ void AHS_LOD0(inout PackedPayload packedPayload, BuiltInTriangleIntersectionAttr
     float alpha = material.opacity;
     if (material.alphaMode == 2)
     {
+        // Accept or ignore the hit without sampling the texture when the micro-triangle's opacity is classified
+        uint opacityState = LoadOpacityState(InstanceID(), PrimitiveIndex(), geometry, attrib.barycentrics);
+        if (opacityState == OPACITY_STATE_OPAQUE) return;
+        if (opacityState == OPACITY_STATE_TRANSPARENT) IgnoreHit();
+
         // Load and interpolate the triangle's texture coordinates
         float3 barycentrics = float3((1.f - attrib.barycentrics.x - attrib.barycentrics.y), attrib.barycentrics.x, attrib.barycentrics.y);
         float2 uv0 = LoadAndInterpolateUV0(InstanceID(), PrimitiveIndex(), geometry, barycentrics);
@@ -88,6 +93,11 @@ void AHS_GI(inout PackedPayload payload, BuiltInTriangleIntersectionAttributes a
     float alpha = material.opacity;
     if (material.alphaMode == 2)
     {
+        // Accept or ignore the hit without sampling the texture when the micro-triangle's opacity is classified
+        uint opacityState = LoadOpacityState(InstanceID(), PrimitiveIndex(), geometry, attrib.barycentrics);
+        if (opacityState == OPACITY_STATE_OPAQUE) return;
+        if (opacityState == OPACITY_STATE_TRANSPARENT) IgnoreHit();
+
         // Load the vertices
         Vertex vertices[3];
         LoadVerticesPosUV0(InstanceID(), PrimitiveIndex(), geometry, vertices);
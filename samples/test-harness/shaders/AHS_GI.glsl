@@ -20,6 +20,11 @@ void main() {
 
     float alpha = material.opacity;
     if (material.alphaMode == 2) {
+        // Accept or ignore the hit without sampling the texture when the micro-triangle's opacity is classified
+        uint opacityState = LoadOpacityState(params.sceneIBH, gl_InstanceCustomIndexEXT, gl_PrimitiveID, geometry, attrib.barycentrics);
+        if (opacityState == OPACITY_STATE_OPAQUE) return;
+        if (opacityState == OPACITY_STATE_TRANSPARENT) ignoreIntersectionEXT;
+
         // Load the vertices
         Vertex vertices[3];
         LoadVerticesPosUV0(params.sceneIBH, params.sceneVBH, gl_InstanceCustomIndexEXT, gl_PrimitiveID, geometry, vertices);
@@ -189,11 +189,8 @@ void RayGen()
                 // Get the probe data texture array
                 Texture2DArray<float4> ProbeData = GetTex2DArray(resourceIndices.probeDataSRVIndex);
 
-                // Get the probe's location in the probe data texture
-                uint3 probeStateTexCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
-
                 // Get the probe's state
-                float probeState = ProbeData[probeStateTexCoords].w;
+                float probeState = DDGILoadProbeState(probeIndex, ProbeData, volume);
 
                 // Probe coloring
                 if (abs(dot(ray.Direction, sampleDirection)) < 0.45f)
@@ -297,8 +294,7 @@ void RayGenHideInactive()
                 Texture2DArray<float4> ProbeData = GetTex2DArray(resourceIndices.probeDataSRVIndex);
 
                 // Early out: if the probe is inactive
-                uint3 probeStateTexCoords = DDGIGetProbeTexelCoords(probeIndex, volume);
-                float probeState = ProbeData[probeStateTexCoords].w;
+                float probeState = DDGILoadProbeState(probeIndex, ProbeData, volume);
                 if(probeState == RTXGI_DDGI_PROBE_STATE_INACTIVE) continue;
 
                 // Get the probe's data to display
@@ -149,11 +149,12 @@ uvec4 ReadUInt4(Buffer ByteAddrBuffer, uint byteOffset) {
 
 void GetGeometryData(Buffer meshOffsets, Buffer geometryData, uint meshIndex, uint geometryIndex, out GeometryData geometry) {
     uint address = ReadUInt(meshOffsets, meshIndex * 4); // address of the Mesh in the GeometryData buffer
-    address += geometryIndex * 12; // offset to mesh primitive geometry, GeometryData stride is 12 bytes
+    address += geometryIndex * 16; // offset to mesh primitive geometry, GeometryData stride is 16 bytes
 
     geometry.materialIndex = ReadUInt(geometryData, address);
     geometry.indexByteAddress = ReadUInt(geometryData, address + 4);
     geometry.vertexByteAddress = ReadUInt(geometryData, address + 8);
+    geometry.opacityStates = ReadUInt(geometryData, address + 12);
 }
 
 DEFINE_ARRAY_REF(Buffer);
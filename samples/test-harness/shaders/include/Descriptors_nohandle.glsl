@@ -160,11 +160,12 @@ uvec4 ReadUInt4(uint index, uint byteOffset) {
 
 void GetGeometryData(uint meshIndex, uint geometryIndex, out GeometryData geometry) {
     uint address = ReadUInt(MESH_OFFSETS_INDEX, meshIndex * 4); // address of the Mesh in the GeometryData buffer
-    address += geometryIndex * 12; // offset to mesh primitive geometry, GeometryData stride is 12 bytes
+    address += geometryIndex * 16; // offset to mesh primitive geometry, GeometryData stride is 16 bytes
 
     geometry.materialIndex = ReadUInt(GEOMETRY_DATA_INDEX, address);
     geometry.indexByteAddress = ReadUInt(GEOMETRY_DATA_INDEX, address + 4);
     geometry.vertexByteAddress = ReadUInt(GEOMETRY_DATA_INDEX, address + 8);
+    geometry.opacityStates = ReadUInt(GEOMETRY_DATA_INDEX, address + 12);
 }
 
 #define GetSphereIndexBuffer ByteAddrBuffer[SPHERE_INDEX_BUFFER_INDEX]
@@ -71,13 +71,65 @@ Payload UnpackPayload(PackedPayload input)
 
 /**
  * Load a triangle's indices.
+ * Primitives with 16-bit indices (see IndexBuffers.h) load the two aligned words that hold the triangle's indices.
  */
 uint3 LoadIndices(uint meshIndex, uint primitiveIndex, GeometryData geometry)
 {
+    if (geometry.indexByteAddress & INDEX_FORMAT_16)
+    {
+        uint address = (geometry.indexByteAddress & ~INDEX_FORMAT_16) + (primitiveIndex * 3) * 2;  // 3 indices per primitive, 2 bytes for each index
+        uint2 words = GetIndexBuffer(meshIndex).Load2(address & ~3);
+        if (address & 2) return uint3(words.x >> 16, words.y & 0xFFFF, words.y >> 16);
+        return uint3(words.x & 0xFFFF, words.x >> 16, words.y & 0xFFFF);
+    }
+
     uint address = geometry.indexByteAddress + (primitiveIndex * 3) * 4;  // 3 indices per primitive, 4 bytes for each index
     return GetIndexBuffer(meshIndex).Load3(address); // Mesh index buffers start at index 4 and alternate with vertex buffer pointers
 }
 
+/**
+ * Unpack two 16-bit signed normalized values (compact vertices, see Quantization.h).
+ */
+float2 UnpackSnorm16x2(uint value)
+{
+    int2 values = asint(uint2(value << 16, value)) >> 16;
+    return max(float2(values) / 32767.f, -1.f);
+}
+
+/**
+ * Decode an octahedral encoded unit vector (compact vertices, see Quantization.h).
+ */
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e.x, e.y, 1.f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.f);
+    n.x += (n.x >= 0.f) ? -t : t;
+    n.y += (n.y >= 0.f) ? -t : t;
+    return normalize(n);
+}
+
+/**
+ * Load the dequantization transform at the start of a compact vertex buffer.
+ */
+float3x4 LoadDequantization(uint meshIndex)
+{
+    return float3x4(
+        asfloat(GetVertexBuffer(meshIndex).Load4(0)),
+        asfloat(GetVertexBuffer(meshIndex).Load4(16)),
+        asfloat(GetVertexBuffer(meshIndex).Load4(32)));
+}
+
+/**
+ * Load a compact vertex's position, and its bitangent direction in w.
+ */
+float4 LoadCompactPosition(uint meshIndex, uint address, float3x4 dequantization)
+{
+    uint2 words = GetVertexBuffer(meshIndex).Load2(address);
+    float2 xy = UnpackSnorm16x2(words.x);
+    float2 zw = UnpackSnorm16x2(words.y);
+    return float4(mul(dequantization, float4(xy, zw.x, 1.f)), zw.y);
+}
+
 /**
  * Load a triangle's vertex data (all: position, normal, tangent, uv0).
  */
@@ -88,6 +140,25 @@ void LoadVertices(uint meshIndex, uint primitiveIndex, GeometryData geometry, ou
 
     // Load the vertices
     uint address;
+    if (geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT)
+    {
+        float3x4 dequantization = LoadDequantization(meshIndex);
+        for (uint i = 0; i < 3; i++)
+        {
+            vertices[i] = (Vertex)0;
+            address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + (indices[i] * 20);  // Compact vertices are 20 bytes
+
+            // Load the position and bitangent direction, then the normal, tangent, and texture coordinates
+            float4 position = LoadCompactPosition(meshIndex, address, dequantization);
+            uint3 attributes = GetVertexBuffer(meshIndex).Load3(address + 8);
+            vertices[i].position = position.xyz;
+            vertices[i].normal = DecodeOctahedral(UnpackSnorm16x2(attributes.x));
+            vertices[i].tangent = float4(DecodeOctahedral(UnpackSnorm16x2(attributes.y)), position.w);
+            vertices[i].uv0 = f16tof32(uint2(attributes.z, attributes.z >> 16));
+        }
+        return;
+    }
+
     for (uint i = 0; i < 3; i++)
     {
         vertices[i] = (Vertex)0;
@@ -120,6 +191,22 @@ void LoadVerticesPosUV0(uint meshIndex, uint primitiveIndex, GeometryData geomet
 
     // Load the vertices
     uint address;
+    if (geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT)
+    {
+        float3x4 dequantization = LoadDequantization(meshIndex);
+        for (uint i = 0; i < 3; i++)
+        {
+            vertices[i] = (Vertex)0;
+            address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + (indices[i] * 20);  // Compact vertices are 20 bytes
+
+            // Load the position, skip the normal and tangent, load the texture coordinates
+            vertices[i].position = LoadCompactPosition(meshIndex, address, dequantization).xyz;
+            uint halves = GetVertexBuffer(meshIndex).Load(address + 16);
+            vertices[i].uv0 = f16tof32(uint2(halves, halves >> 16));
+        }
+        return;
+    }
+
     for (uint i = 0; i < 3; i++)
     {
         vertices[i] = (Vertex)0;
@@ -145,6 +232,17 @@ float2 LoadAndInterpolateUV0(uint meshIndex, uint primitiveIndex, GeometryData g
     // Interpolate the texture coordinates
     int address;
     float2 uv0 = float2(0.f, 0.f);
+    if (geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT)
+    {
+        for (uint i = 0; i < 3; i++)
+        {
+            address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + (indices[i] * 20);  // Compact vertices are 20 bytes
+            uint halves = GetVertexBuffer(meshIndex).Load(address + 16);                          // 16 bytes: skip position, normal, and tangent
+            uv0 += f16tof32(uint2(halves, halves >> 16)) * barycentrics[i];
+        }
+        return uv0;
+    }
+
     for (uint i = 0; i < 3; i++)
     {
         address = geometry.vertexByteAddress + (indices[i] * 12) * 4;  // 12 floats (3: pos, 3: normals, 4:tangent, 2:uv0)
@@ -155,6 +253,29 @@ float2 LoadAndInterpolateUV0(uint meshIndex, uint primitiveIndex, GeometryData g
     return uv0;
 }
 
+/**
+ * Load the opacity state of the triangle's micro-triangle at the barycentrics (see Opacity.h).
+ * Returns OPACITY_STATE_UNKNOWN when the triangle's opacity isn't classified.
+ */
+uint LoadOpacityState(uint meshIndex, uint primitiveIndex, GeometryData geometry, float2 barycentrics)
+{
+    if (geometry.opacityStates == 0) return OPACITY_STATE_UNKNOWN;
+
+    // The subdivision level + 1 is stored in the low 2 bits of the (4 byte aligned) address
+    uint segments = 1u << ((geometry.opacityStates & 0x3) - 1);
+    uint states = GetIndexBuffer(meshIndex).Load((geometry.opacityStates & ~0x3) + (primitiveIndex * 4));
+
+    // Micro-triangle rows of increasing v, with upright and inverted micro-triangles alternating along u
+    float u = max(barycentrics.x, 0.f) * segments;
+    float v = max(barycentrics.y, 0.f) * segments;
+    uint i = min(uint(u), segments - 1);
+    uint j = min(uint(v), segments - 1 - i);
+    uint microTriangle = (j * ((2 * segments) - j)) + (2 * i);
+    if ((i + j + 1) < segments && ((u - i) + (v - j)) > 1.f) microTriangle++;
+
+    return (states >> (microTriangle * 2)) & 0x3;
+}
+
 /**
  * Return interpolated vertex attributes (all).
  */
@@ -54,18 +54,78 @@ Payload UnpackPayload(PackedPayload packed) {
 
 /**
  * Load a triangle's indices.
+ * Primitives with 16-bit indices (see IndexBuffers.h) load the two aligned words that hold the triangle's indices.
  */
 uvec3 LoadIndices(uint meshIndex, uint primitiveIndex, GeometryData geometry) {
+    if ((geometry.indexByteAddress & INDEX_FORMAT_16) != 0) {
+        uint address = (geometry.indexByteAddress & ~INDEX_FORMAT_16) + (primitiveIndex * 3) * 2; // 3 indices per primitive, 2 bytes for each index
+        uvec2 words = ReadUInt2(GetIndexBufferGlobalIndex(meshIndex), address & ~3u);
+        if ((address & 2u) != 0) return uvec3(words.x >> 16, words.y & 0xFFFFu, words.y >> 16);
+        return uvec3(words.x & 0xFFFFu, words.x >> 16, words.y & 0xFFFFu);
+    }
+
     uint address = geometry.indexByteAddress + (primitiveIndex * 3) * 4; // 3 indices per primitive, 4 bytes for each index
     return ReadUInt3(GetIndexBufferGlobalIndex(meshIndex), address);
 }
 
+/**
+ * Decode an octahedral encoded unit vector (compact vertices, see Quantization.h).
+ */
+vec3 DecodeOctahedral(vec2 e)
+{
+    vec3 n = vec3(e.x, e.y, 1.f - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.f);
+    n.x += (n.x >= 0.f) ? -t : t;
+    n.y += (n.y >= 0.f) ? -t : t;
+    return normalize(n);
+}
+
+/**
+ * Load a compact vertex's position, and its bitangent direction in w.
+ * The dequantization transform (3 rows) is at the start of the compact vertex buffer.
+ */
+vec4 LoadCompactPosition(uint vertexBuffer, uint address, vec4 dequantization[3])
+{
+    uvec2 words = ReadUInt2(vertexBuffer, address);
+    vec2 xy = unpackSnorm2x16(words.x);
+    vec2 zw = unpackSnorm2x16(words.y);
+    vec4 position = vec4(xy, zw.x, 1.f);
+    return vec4(dot(dequantization[0], position), dot(dequantization[1], position), dot(dequantization[2], position), zw.y);
+}
+
+/**
+ * Load the dequantization transform at the start of a compact vertex buffer.
+ */
+void LoadDequantization(uint vertexBuffer, out vec4 dequantization[3])
+{
+    dequantization[0] = uintBitsToFloat(ReadUInt4(vertexBuffer, 0));
+    dequantization[1] = uintBitsToFloat(ReadUInt4(vertexBuffer, 16));
+    dequantization[2] = uintBitsToFloat(ReadUInt4(vertexBuffer, 32));
+}
+
 // Function to load vertices
 void LoadVertices(uint meshIndex, uint primitiveIndex, GeometryData geometry, out Vertex vertices[3]) {
     // Get the indices
     uvec3 indices = LoadIndices(meshIndex, primitiveIndex, geometry);
 
     // Load the vertices
+    if ((geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT) != 0) {
+        vec4 dequantization[3];
+        LoadDequantization(GetVertexBufferGlobalIndex(meshIndex), dequantization);
+        for (int i = 0; i < 3; i++) {
+            uint address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + indices[i] * 20; // Compact vertices are 20 bytes
+
+            // Load the position and bitangent direction, then the normal, tangent, and texture coordinates
+            vec4 position = LoadCompactPosition(GetVertexBufferGlobalIndex(meshIndex), address, dequantization);
+            uvec3 attributes = ReadUInt3(GetVertexBufferGlobalIndex(meshIndex), address + 8);
+            vertices[i].position = position.xyz;
+            vertices[i].normal = DecodeOctahedral(unpackSnorm2x16(attributes.x));
+            vertices[i].tangent = vec4(DecodeOctahedral(unpackSnorm2x16(attributes.y)), position.w);
+            vertices[i].uv0 = unpackHalf2x16(attributes.z);
+        }
+        return;
+    }
+
     for (int i = 0; i < 3; i++) {
         vertices[i] = Vertex(vec3(0.f), vec3(0.f), vec4(0.f), vec2(0.f));
         uint address = geometry.vertexByteAddress + indices[i] * 48; // Vertices contain 12 floats / 48 bytes
@@ -97,6 +157,20 @@ void LoadVerticesPosUV0(uint meshIndex, uint primitiveIndex, GeometryData geomet
 
     // Load the vertices
     uint address;
+    if ((geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT) != 0) {
+        vec4 dequantization[3];
+        LoadDequantization(GetVertexBufferGlobalIndex(meshIndex), dequantization);
+        for (uint i = 0; i < 3; i++) {
+            vertices[i] = Vertex(vec3(0.f), vec3(0.f), vec4(0.f), vec2(0.f));
+            address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + indices[i] * 20; // Compact vertices are 20 bytes
+
+            // Load the position, skip the normal and tangent, load the texture coordinates
+            vertices[i].position = LoadCompactPosition(GetVertexBufferGlobalIndex(meshIndex), address, dequantization).xyz;
+            vertices[i].uv0 = unpackHalf2x16(ReadUInt(GetVertexBufferGlobalIndex(meshIndex), address + 16));
+        }
+        return;
+    }
+
     for (uint i = 0; i < 3; i++) {
         vertices[i] = Vertex(vec3(0.f), vec3(0.f), vec4(0.f), vec2(0.f));
         address = geometry.vertexByteAddress + (indices[i] * 12) * 4;  // Vertices contain 12 floats / 48 bytes
@@ -121,6 +195,17 @@ vec2 LoadAndInterpolateUV0(uint meshIndex, uint primitiveIndex, GeometryData geo
     // Interpolate the texture coordinates
     uint address;
     vec2 uv0 = vec2(0.f, 0.f);
+    if ((geometry.vertexByteAddress & VERTEX_FORMAT_COMPACT) != 0)
+    {
+        for (uint i = 0; i < 3; i++)
+        {
+            address = (geometry.vertexByteAddress & ~VERTEX_FORMAT_COMPACT) + indices[i] * 20;  // Compact vertices are 20 bytes
+            address += 16;                                                                      // 16 bytes: skip position, normal, and tangent
+            uv0 += unpackHalf2x16(ReadUInt(GetVertexBufferGlobalIndex(meshIndex), address)) * barycentrics[i];
+        }
+        return uv0;
+    }
+
     for (uint i = 0; i < 3; i++)
     {
         address = geometry.vertexByteAddress + (indices[i] * 12) * 4;  // 12 floats (3: pos, 3: normals, 4:tangent, 2:uv0)
@@ -131,6 +216,29 @@ vec2 LoadAndInterpolateUV0(uint meshIndex, uint primitiveIndex, GeometryData geo
     return uv0;
 }
 
+/**
+ * Load the opacity state of the triangle's micro-triangle at the barycentrics (see Opacity.h).
+ * Returns OPACITY_STATE_UNKNOWN when the triangle's opacity isn't classified.
+ */
+uint LoadOpacityState(uint meshIndex, uint primitiveIndex, GeometryData geometry, vec2 barycentrics)
+{
+    if (geometry.opacityStates == 0) return OPACITY_STATE_UNKNOWN;
+
+    // The subdivision level + 1 is stored in the low 2 bits of the (4 byte aligned) address
+    uint segments = 1u << ((geometry.opacityStates & 0x3u) - 1u);
+    uint states = ReadUInt(GetIndexBufferGlobalIndex(meshIndex), (geometry.opacityStates & ~0x3u) + (primitiveIndex * 4));
+
+    // Micro-triangle rows of increasing v, with upright and inverted micro-triangles alternating along u
+    float u = max(barycentrics.x, 0.f) * segments;
+    float v = max(barycentrics.y, 0.f) * segments;
+    uint i = min(uint(u), segments - 1);
+    uint j = min(uint(v), segments - 1 - i);
+    uint microTriangle = (j * ((2 * segments) - j)) + (2 * i);
+    if ((i + j + 1) < segments && ((u - i) + (v - j)) > 1.f) microTriangle++;
+
+    return (states >> (microTriangle * 2)) & 0x3u;
+}
+
 /**
  * Return interpolated vertex attributes (all).
  */
@@ -0,0 +1,1471 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "BVH.h"
+#include "Scenes.h"
+
+#include <rtxgi/ddgi/cpu/Parallel_CPU.h>
+#include <rtxgi/ddgi/cpu/SIMD_CPU.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <memory>
+
+using namespace rtxgi;
+
+namespace simd = rtxgi::cpu::simd;
+
+namespace BVH
+{
+
+    // Ranges with at most this many items are built as independent subtrees on the worker threads
+    static const uint32_t c_subtreeSize = 4096;
+
+    // Ranges with more than this many items are binned on multiple threads
+    static const uint32_t c_parallelBinningSize = 65536;
+    static const uint32_t c_binningChunkSize = 16384;
+
+    // Binary depth after which ranges are split at the median instead of with SAH (bounds the traversal stack size)
+    static const uint32_t c_maxSAHDepth = 40;
+
+    static const uint32_t c_maxBins = 64;
+    static const uint32_t c_stackSize = 512;
+    static const uint32_t c_raysPerChunk = 256;
+
+    // Probe BVHs open bottom level nodes that straddle the probe's axis planes when they are closer to the probe than this fraction of their size
+    static const float c_probeCutScale = 0.25f;
+    static const uint32_t c_probeRays = 256;
+
+    // SAH cost of traversing a node, relative to intersecting a triangle (or an instance)
+    static const float c_traversalCost = 1.f;
+
+    // Meshes with fewer triangles than this are built in parallel with each other, larger meshes are built one at a time on all threads
+    static const uint32_t c_parallelMeshSize = 16384;
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Build Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    struct Bounds
+    {
+        float3 min = { FLT_MAX, FLT_MAX, FLT_MAX };
+        float3 max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+        void Grow(const float3& point)
+        {
+            min = { std::min(min.x, point.x), std::min(min.y, point.y), std::min(min.z, point.z) };
+            max = { std::max(max.x, point.x), std::max(max.y, point.y), std::max(max.z, point.z) };
+        }
+
+        void Grow(const Bounds& bounds)
+        {
+            min = { std::min(min.x, bounds.min.x), std::min(min.y, bounds.min.y), std::min(min.z, bounds.min.z) };
+            max = { std::max(max.x, bounds.max.x), std::max(max.y, bounds.max.y), std::max(max.z, bounds.max.z) };
+        }
+
+        bool IsEmpty() const { return (min.x > max.x) || (min.y > max.y) || (min.z > max.z); }
+
+        float HalfArea() const
+        {
+            if (IsEmpty()) return 0.f;
+            float3 extent = { max.x - min.x, max.y - min.y, max.z - min.z };
+            return (extent.x * extent.y) + (extent.y * extent.z) + (extent.z * extent.x);
+        }
+
+        float3 Center() const { return { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f }; }
+    };
+
+    struct BinaryNode
+    {
+        Bounds   bounds;
+        uint32_t left = InvalidIndex;       // Internal nodes: child node indices
+        uint32_t right = InvalidIndex;
+        uint32_t first = 0;                 // Leaves: range of items in the builder's item order
+        uint32_t count = 0;
+
+        bool IsLeaf() const { return left == InvalidIndex; }
+    };
+
+    struct Bin
+    {
+        Bounds   bounds;
+        uint32_t count = 0;
+    };
+
+    struct Split
+    {
+        uint32_t axis = 0;
+        uint32_t bin = 0;                   // Items in bins below this one go to the left child
+        float    cost = FLT_MAX;
+    };
+
+    // A range of items that is built into a subtree on a worker thread, then attached to its placeholder node
+    struct SubtreeTask
+    {
+        uint32_t nodeIndex;
+        uint32_t first;
+        uint32_t count;
+        uint32_t depth;
+    };
+
+    /**
+     * Builds a binary BVH over items with the given bounds. Items are reordered (through indices), not moved.
+     * The result does not depend on the number of threads.
+     */
+    struct Builder
+    {
+        const std::vector<Bounds>* itemBounds = nullptr;
+        std::vector<float3>        centroids;
+        std::vector<uint32_t>      indices;
+        std::vector<BinaryNode>    nodes;
+
+        uint32_t                   maxLeafSize = 1;
+        uint32_t                   numBins = 16;
+        uint32_t                   numThreads = 0;
+    };
+
+    void GetRangeBounds(const Builder& builder, uint32_t first, uint32_t count, bool parallel, Bounds& bounds, Bounds& centroidBounds)
+    {
+        const std::vector<Bounds>& itemBounds = *builder.itemBounds;
+        if (!parallel || count <= c_parallelBinningSize)
+        {
+            for (uint32_t index = first; index < first + count; index++)
+            {
+                uint32_t item = builder.indices[index];
+                bounds.Grow(itemBounds[item]);
+                centroidBounds.Grow(builder.centroids[item]);
+            }
+            return;
+        }
+
+        // Bounds are order independent, so the chunks can be merged in any order
+        uint32_t numChunks = DivRoundUp(count, c_binningChunkSize);
+        std::vector<Bounds> chunkBounds(numChunks), chunkCentroidBounds(numChunks);
+        cpu::ParallelFor(numChunks, 1, builder.numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t chunk = begin; chunk < end; chunk++)
+            {
+                uint32_t chunkFirst = first + (chunk * c_binningChunkSize);
+                uint32_t chunkCount = std::min(c_binningChunkSize, first + count - chunkFirst);
+                GetRangeBounds(builder, chunkFirst, chunkCount, false, chunkBounds[chunk], chunkCentroidBounds[chunk]);
+            }
+        });
+
+        for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            bounds.Grow(chunkBounds[chunk]);
+            centroidBounds.Grow(chunkCentroidBounds[chunk]);
+        }
+    }
+
+    inline uint32_t GetBin(const Builder& builder, uint32_t item, uint32_t axis, const Bounds& centroidBounds, float scale)
+    {
+        float offset = (builder.centroids[item][axis] - centroidBounds.min[axis]) * scale;
+        return std::min(builder.numBins - 1, (uint32_t)std::max(offset, 0.f));
+    }
+
+    void BinRange(const Builder& builder, uint32_t first, uint32_t count, const Bounds& centroidBounds, const float* scales, Bin (*bins)[c_maxBins])
+    {
+        const std::vector<Bounds>& itemBounds = *builder.itemBounds;
+        for (uint32_t index = first; index < first + count; index++)
+        {
+            uint32_t item = builder.indices[index];
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                if (scales[axis] <= 0.f) continue;
+                Bin& bin = bins[axis][GetBin(builder, item, axis, centroidBounds, scales[axis])];
+                bin.bounds.Grow(itemBounds[item]);
+                bin.count++;
+            }
+        }
+    }
+
+    /**
+     * Finds the binned SAH split with the lowest cost on all three axes.
+     * Returns false if the centroids can't be separated.
+     */
+    bool FindSplit(const Builder& builder, uint32_t first, uint32_t count, bool parallel, const Bounds& bounds, const Bounds& centroidBounds, float* scales, Split& split)
+    {
+        bool separable = false;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+            scales[axis] = (extent > 0.f) ? ((float)builder.numBins / extent) : 0.f;
+            separable |= (extent > 0.f);
+        }
+        if (!separable) return false;
+
+        Bin bins[3][c_maxBins];
+        if (!parallel || count <= c_parallelBinningSize)
+        {
+            BinRange(builder, first, count, centroidBounds, scales, bins);
+        }
+        else
+        {
+            // Bin chunks of the range on multiple threads and merge them (bounds and counts are order independent)
+            uint32_t numChunks = DivRoundUp(count, c_binningChunkSize);
+            std::vector<Bin> chunkBins((size_t)numChunks * 3 * c_maxBins);
+            cpu::ParallelFor(numChunks, 1, builder.numThreads, [&](uint32_t begin, uint32_t end)
+            {
+                for (uint32_t chunk = begin; chunk < end; chunk++)
+                {
+                    uint32_t chunkFirst = first + (chunk * c_binningChunkSize);
+                    uint32_t chunkCount = std::min(c_binningChunkSize, first + count - chunkFirst);
+                    BinRange(builder, chunkFirst, chunkCount, centroidBounds, scales, (Bin(*)[c_maxBins])&chunkBins[(size_t)chunk * 3 * c_maxBins]);
+                }
+            });
+
+            for (uint32_t chunk = 0; chunk < numChunks; chunk++)
+            {
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    for (uint32_t bin = 0; bin < builder.numBins; bin++)
+                    {
+                        const Bin& chunkBin = chunkBins[((size_t)chunk * 3 * c_maxBins) + (axis * c_maxBins) + bin];
+                        bins[axis][bin].bounds.Grow(chunkBin.bounds);
+                        bins[axis][bin].count += chunkBin.count;
+                    }
+                }
+            }
+        }
+
+        // Sweep the bins from the right to accumulate the right side costs, then from the left to evaluate the splits
+        float parentArea = std::max(bounds.HalfArea(), FLT_MIN);
+        bool found = false;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            if (scales[axis] <= 0.f) continue;
+
+            float rightCosts[c_maxBins] = {};
+            Bounds rightBounds;
+            uint32_t rightCount = 0;
+            for (uint32_t bin = builder.numBins - 1; bin > 0; bin--)
+            {
+                rightBounds.Grow(bins[axis][bin].bounds);
+                rightCount += bins[axis][bin].count;
+                rightCosts[bin] = rightBounds.HalfArea() * (float)rightCount;
+            }
+
+            Bounds leftBounds;
+            uint32_t leftCount = 0;
+            for (uint32_t bin = 1; bin < builder.numBins; bin++)
+            {
+                leftBounds.Grow(bins[axis][bin - 1].bounds);
+                leftCount += bins[axis][bin - 1].count;
+                if (leftCount == 0 || leftCount == count) continue;
+
+                float cost = c_traversalCost + (((leftBounds.HalfArea() * (float)leftCount) + rightCosts[bin]) / parentArea);
+                if (cost < split.cost)
+                {
+                    split.axis = axis;
+                    split.bin = bin;
+                    split.cost = cost;
+                    found = true;
+                }
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Splits the range at the median centroid on the centroid bounds' largest axis (ties are broken by item index).
+     */
+    uint32_t SplitMedian(Builder& builder, uint32_t first, uint32_t count, const Bounds& centroidBounds)
+    {
+        float3 extent = { centroidBounds.max.x - centroidBounds.min.x, centroidBounds.max.y - centroidBounds.min.y, centroidBounds.max.z - centroidBounds.min.z };
+        uint32_t axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : ((extent.y >= extent.z) ? 1 : 2);
+
+        uint32_t middle = first + (count / 2);
+        const std::vector<float3>& centroids = builder.centroids;
+        std::nth_element(builder.indices.begin() + first, builder.indices.begin() + middle, builder.indices.begin() + first + count, [&](uint32_t a, uint32_t b)
+        {
+            if (centroids[a][axis] != centroids[b][axis]) return centroids[a][axis] < centroids[b][axis];
+            return a < b;
+        });
+        return middle;
+    }
+
+    /**
+     * Builds the subtree of a range of items into nodes and returns the index of its root node.
+     * When tasks are given, ranges of at most c_subtreeSize items become placeholder nodes and tasks instead.
+     */
+    uint32_t BuildRange(Builder& builder, std::vector<BinaryNode>& nodes, uint32_t first, uint32_t count, uint32_t depth, std::vector<SubtreeTask>* tasks)
+    {
+        bool parallel = (tasks != nullptr);
+        uint32_t nodeIndex = (uint32_t)nodes.size();
+        nodes.emplace_back();
+
+        Bounds bounds, centroidBounds;
+        GetRangeBounds(builder, first, count, parallel, bounds, centroidBounds);
+        nodes[nodeIndex].bounds = bounds;
+
+        if (parallel && count <= c_subtreeSize)
+        {
+            tasks->push_back({ nodeIndex, first, count, depth });
+            return nodeIndex;
+        }
+
+        // Find the best split, or make a leaf if that's cheaper (and allowed)
+        float scales[3] = {};
+        Split split;
+        bool canSplit = (count > 1) && (depth < c_maxSAHDepth) && FindSplit(builder, first, count, parallel, bounds, centroidBounds, scales, split);
+        if (count <= builder.maxLeafSize && (!canSplit || (float)count <= split.cost))
+        {
+            nodes[nodeIndex].first = first;
+            nodes[nodeIndex].count = count;
+            return nodeIndex;
+        }
+
+        uint32_t middle = 0;
+        if (canSplit)
+        {
+            // Use the same bin computation as the binning, so the partition matches the evaluated split
+            auto begin = builder.indices.begin() + first;
+            auto end = begin + count;
+            middle = first + (uint32_t)(std::partition(begin, end, [&](uint32_t item)
+            {
+                return GetBin(builder, item, split.axis, centroidBounds, scales[split.axis]) < split.bin;
+            }) - begin);
+        }
+        else
+        {
+            middle = SplitMedian(builder, first, count, centroidBounds);
+        }
+
+        uint32_t left = BuildRange(builder, nodes, first, middle - first, depth + 1, tasks);
+        uint32_t right = BuildRange(builder, nodes, middle, first + count - middle, depth + 1, tasks);
+        nodes[nodeIndex].left = left;
+        nodes[nodeIndex].right = right;
+        return nodeIndex;
+    }
+
+    void BuildBinary(const std::vector<Bounds>& itemBounds, uint32_t maxLeafSize, const BuildDesc& desc, Builder& builder)
+    {
+        uint32_t numItems = (uint32_t)itemBounds.size();
+        builder.itemBounds = &itemBounds;
+        builder.maxLeafSize = maxLeafSize;
+        builder.numBins = std::max(2u, std::min(desc.numBins, c_maxBins));
+        builder.numThreads = desc.numThreads;
+        builder.centroids.resize(numItems);
+        builder.indices.resize(numItems);
+        for (uint32_t item = 0; item < numItems; item++)
+        {
+            builder.centroids[item] = itemBounds[item].Center();
+            builder.indices[item] = item;
+        }
+        if (numItems == 0) return;
+
+        // Split the top of the tree on this thread, then build the subtrees on all threads
+        std::vector<SubtreeTask> tasks;
+        BuildRange(builder, builder.nodes, 0, numItems, 0, &tasks);
+
+        std::vector<std::vector<BinaryNode>> subtrees(tasks.size());
+        cpu::ParallelFor((uint32_t)tasks.size(), 1, desc.numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t taskIndex = begin; taskIndex < end; taskIndex++)
+            {
+                const SubtreeTask& task = tasks[taskIndex];
+                BuildRange(builder, subtrees[taskIndex], task.first, task.count, task.depth, nullptr);
+            }
+        });
+
+        // Attach the subtrees: each root replaces its placeholder, the other nodes are appended
+        for (size_t taskIndex = 0; taskIndex < tasks.size(); taskIndex++)
+        {
+            const std::vector<BinaryNode>& subtree = subtrees[taskIndex];
+            uint32_t offset = (uint32_t)builder.nodes.size() - 1;
+            auto Remap = [&](uint32_t index) { return (index == 0) ? tasks[taskIndex].nodeIndex : offset + index; };
+
+            for (size_t index = 0; index < subtree.size(); index++)
+            {
+                BinaryNode node = subtree[index];
+                if (!node.IsLeaf())
+                {
+                    node.left = Remap(node.left);
+                    node.right = Remap(node.right);
+                }
+                if (index == 0) builder.nodes[tasks[taskIndex].nodeIndex] = node;
+                else builder.nodes.push_back(node);
+            }
+        }
+    }
+
+    /**
+     * Collapses a binary BVH into 8-wide nodes by repeatedly opening the child with the largest surface area.
+     * Leaves reference item ranges in the builder's order, or items directly through itemMap (for single item leaves).
+     */
+    uint32_t Collapse(const std::vector<BinaryNode>& binary, uint32_t binaryIndex, const uint32_t* itemMap, std::vector<Node>& nodes)
+    {
+        uint32_t nodeIndex = (uint32_t)nodes.size();
+        nodes.emplace_back();
+
+        uint32_t children[NodeWidth];
+        uint32_t numChildren = 0;
+        const BinaryNode& root = binary[binaryIndex];
+        if (root.IsLeaf())
+        {
+            children[numChildren++] = binaryIndex;
+        }
+        else
+        {
+            children[numChildren++] = root.left;
+            children[numChildren++] = root.right;
+        }
+
+        while (numChildren < NodeWidth)
+        {
+            int largest = -1;
+            float largestArea = -1.f;
+            for (uint32_t child = 0; child < numChildren; child++)
+            {
+                const BinaryNode& node = binary[children[child]];
+                if (!node.IsLeaf() && node.bounds.HalfArea() > largestArea)
+                {
+                    largest = (int)child;
+                    largestArea = node.bounds.HalfArea();
+                }
+            }
+            if (largest < 0) break;
+
+            const BinaryNode& opened = binary[children[largest]];
+            children[largest] = opened.left;
+            children[numChildren++] = opened.right;
+        }
+
+        // Empty slots have inverted bounds and are never hit
+        const float infinity = std::numeric_limits<float>::infinity();
+        for (uint32_t slot = 0; slot < NodeWidth; slot++)
+        {
+            Node& node = nodes[nodeIndex];
+            node.minX[slot] = node.minY[slot] = node.minZ[slot] = infinity;
+            node.maxX[slot] = node.maxY[slot] = node.maxZ[slot] = -infinity;
+            node.children[slot] = InvalidIndex;
+        }
+
+        for (uint32_t slot = 0; slot < numChildren; slot++)
+        {
+            const BinaryNode& child = binary[children[slot]];
+            uint32_t encoded;
+            if (child.IsLeaf())
+            {
+                uint32_t first = itemMap ? itemMap[child.first] : child.first;
+                encoded = Node::LeafFlag | ((child.count - 1) << Node::LeafCountShift) | first;
+            }
+            else
+            {
+                encoded = Collapse(binary, children[slot], itemMap, nodes);
+            }
+
+            // Write through the index, the recursion may have reallocated the nodes
+            Node& node = nodes[nodeIndex];
+            node.minX[slot] = child.bounds.min.x;
+            node.minY[slot] = child.bounds.min.y;
+            node.minZ[slot] = child.bounds.min.z;
+            node.maxX[slot] = child.bounds.max.x;
+            node.maxY[slot] = child.bounds.max.y;
+            node.maxZ[slot] = child.bounds.max.z;
+            node.children[slot] = encoded;
+        }
+        return nodeIndex;
+    }
+
+    float3 TransformPoint(const float (&transform)[3][4], const float3& point)
+    {
+        return
+        {
+            (transform[0][0] * point.x) + (transform[0][1] * point.y) + (transform[0][2] * point.z) + transform[0][3],
+            (transform[1][0] * point.x) + (transform[1][1] * point.y) + (transform[1][2] * point.z) + transform[1][3],
+            (transform[2][0] * point.x) + (transform[2][1] * point.y) + (transform[2][2] * point.z) + transform[2][3]
+        };
+    }
+
+    float3 TransformVector(const float (&transform)[3][4], const float3& vector)
+    {
+        return
+        {
+            (transform[0][0] * vector.x) + (transform[0][1] * vector.y) + (transform[0][2] * vector.z),
+            (transform[1][0] * vector.x) + (transform[1][1] * vector.y) + (transform[1][2] * vector.z),
+            (transform[2][0] * vector.x) + (transform[2][1] * vector.y) + (transform[2][2] * vector.z)
+        };
+    }
+
+    /**
+     * Inverts a 3x4 affine transform. Returns false if the transform is singular.
+     */
+    bool InvertTransform(const float (&transform)[3][4], float (&inverse)[3][4])
+    {
+        const float (&m)[3][4] = transform;
+        float cofactors[3][3] =
+        {
+            { (m[1][1] * m[2][2]) - (m[1][2] * m[2][1]), (m[0][2] * m[2][1]) - (m[0][1] * m[2][2]), (m[0][1] * m[1][2]) - (m[0][2] * m[1][1]) },
+            { (m[1][2] * m[2][0]) - (m[1][0] * m[2][2]), (m[0][0] * m[2][2]) - (m[0][2] * m[2][0]), (m[0][2] * m[1][0]) - (m[0][0] * m[1][2]) },
+            { (m[1][0] * m[2][1]) - (m[1][1] * m[2][0]), (m[0][1] * m[2][0]) - (m[0][0] * m[2][1]), (m[0][0] * m[1][1]) - (m[0][1] * m[1][0]) }
+        };
+
+        float determinant = (m[0][0] * cofactors[0][0]) + (m[0][1] * cofactors[1][0]) + (m[0][2] * cofactors[2][0]);
+        if (determinant == 0.f || !std::isfinite(determinant)) return false;
+
+        float invDeterminant = 1.f / determinant;
+        for (uint32_t row = 0; row < 3; row++)
+        {
+            for (uint32_t column = 0; column < 3; column++) inverse[row][column] = cofactors[row][column] * invDeterminant;
+            inverse[row][3] = -((inverse[row][0] * m[0][3]) + (inverse[row][1] * m[1][3]) + (inverse[row][2] * m[2][3]));
+        }
+        return true;
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Traversal Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    struct TraversalRay
+    {
+        simd::vfloat originX, originY, originZ;
+        simd::vfloat directionX, directionY, directionZ;
+        simd::vfloat invDirectionX, invDirectionY, invDirectionZ;
+        simd::vfloat tMin;
+        bool         negativeX, negativeY, negativeZ;
+    };
+
+    struct StackEntry
+    {
+        uint32_t item;                      // Node index or encoded leaf
+        float    tNear;
+    };
+
+    inline float SafeInverse(float value)
+    {
+        // Avoid infinities (and NaNs from 0 * infinity) for axis aligned directions
+        const float epsilon = 1e-20f;
+        if (fabsf(value) < epsilon) value = (value < 0.f) ? -epsilon : epsilon;
+        return 1.f / value;
+    }
+
+    TraversalRay GetTraversalRay(const float3& origin, const float3& direction, float tMin)
+    {
+        TraversalRay ray;
+        ray.originX = simd::Set1(origin.x);
+        ray.originY = simd::Set1(origin.y);
+        ray.originZ = simd::Set1(origin.z);
+        ray.directionX = simd::Set1(direction.x);
+        ray.directionY = simd::Set1(direction.y);
+        ray.directionZ = simd::Set1(direction.z);
+        ray.invDirectionX = simd::Set1(SafeInverse(direction.x));
+        ray.invDirectionY = simd::Set1(SafeInverse(direction.y));
+        ray.invDirectionZ = simd::Set1(SafeInverse(direction.z));
+        ray.tMin = simd::Set1(tMin);
+        ray.negativeX = (direction.x < 0.f);
+        ray.negativeY = (direction.y < 0.f);
+        ray.negativeZ = (direction.z < 0.f);
+        return ray;
+    }
+
+    /**
+     * Tests the ray against the bounds of a node's children. Returns a bit mask of the hit children and their entry distances.
+     */
+    inline uint32_t IntersectNode(const Node& node, const TraversalRay& ray, float tMax, float* tNear)
+    {
+        const float* nearX = ray.negativeX ? node.maxX : node.minX;
+        const float* nearY = ray.negativeY ? node.maxY : node.minY;
+        const float* nearZ = ray.negativeZ ? node.maxZ : node.minZ;
+        const float* farX = ray.negativeX ? node.minX : node.maxX;
+        const float* farY = ray.negativeY ? node.minY : node.maxY;
+        const float* farZ = ray.negativeZ ? node.minZ : node.maxZ;
+
+        simd::vfloat tMaxV = simd::Set1(tMax);
+        uint32_t mask = 0;
+        for (uint32_t offset = 0; offset < NodeWidth; offset += (uint32_t)simd::Width)
+        {
+            simd::vfloat tEnterX = simd::Mul(simd::Sub(simd::Load(nearX + offset), ray.originX), ray.invDirectionX);
+            simd::vfloat tEnterY = simd::Mul(simd::Sub(simd::Load(nearY + offset), ray.originY), ray.invDirectionY);
+            simd::vfloat tEnterZ = simd::Mul(simd::Sub(simd::Load(nearZ + offset), ray.originZ), ray.invDirectionZ);
+            simd::vfloat tExitX = simd::Mul(simd::Sub(simd::Load(farX + offset), ray.originX), ray.invDirectionX);
+            simd::vfloat tExitY = simd::Mul(simd::Sub(simd::Load(farY + offset), ray.originY), ray.invDirectionY);
+            simd::vfloat tExitZ = simd::Mul(simd::Sub(simd::Load(farZ + offset), ray.originZ), ray.invDirectionZ);
+
+            simd::vfloat tEnter = simd::Max(simd::Max(tEnterX, tEnterY), simd::Max(tEnterZ, ray.tMin));
+            simd::vfloat tExit = simd::Min(simd::Min(tExitX, tExitY), simd::Min(tExitZ, tMaxV));
+
+            mask |= (uint32_t)simd::MoveMask(simd::LessEqual(tEnter, tExit)) << offset;
+            simd::Store(tNear + offset, tEnter);
+        }
+        return mask;
+    }
+
+    /**
+     * Pushes the hit children of a node. For closest hits, nearer children are pushed last so they are visited first.
+     */
+    template<bool AnyHit>
+    inline void PushChildren(const Node& node, uint32_t mask, const float* tNear, StackEntry* stack, uint32_t& stackSize)
+    {
+        StackEntry entries[NodeWidth];
+        uint32_t numEntries = 0;
+        while (mask)
+        {
+            uint32_t slot = 0;
+            while (!(mask & (1u << slot))) slot++;
+            mask &= ~(1u << slot);
+            entries[numEntries++] = { node.children[slot], tNear[slot] };
+        }
+
+        if (!AnyHit)
+        {
+            // Insertion sort by decreasing distance
+            for (uint32_t index = 1; index < numEntries; index++)
+            {
+                StackEntry entry = entries[index];
+                uint32_t position = index;
+                while (position > 0 && entries[position - 1].tNear < entry.tNear)
+                {
+                    entries[position] = entries[position - 1];
+                    position--;
+                }
+                entries[position] = entry;
+            }
+        }
+
+        for (uint32_t index = 0; index < numEntries && stackSize < c_stackSize; index++) stack[stackSize++] = entries[index];
+    }
+
+    /**
+     * Traverses 8-wide nodes from the root (a node index or encoded leaf) and calls leafFunc(leaf, tMax) for each leaf the ray reaches.
+     * leafFunc returns true when it hits something (and shortens tMax for closest hits).
+     */
+    template<bool AnyHit, typename LeafFunc>
+    bool Traverse(const std::vector<Node>& nodes, const TraversalRay& ray, float tMin, float& tMax, LeafFunc&& leafFunc, uint32_t root = 0)
+    {
+        if (nodes.empty()) return false;
+
+        StackEntry stack[c_stackSize];
+        uint32_t stackSize = 0;
+        stack[stackSize++] = { root, tMin };
+
+        alignas(32) float tNear[NodeWidth];
+        bool found = false;
+        while (stackSize > 0)
+        {
+            StackEntry entry = stack[--stackSize];
+            if (entry.tNear > tMax) continue;
+
+            if (entry.item & Node::LeafFlag)
+            {
+                if (leafFunc(entry.item, tMax))
+                {
+                    found = true;
+                    if (AnyHit) return true;
+                }
+                continue;
+            }
+
+            const Node& node = nodes[entry.item];
+            uint32_t mask = IntersectNode(node, ray, tMax, tNear);
+            PushChildren<AnyHit>(node, mask, tNear, stack, stackSize);
+        }
+        return found;
+    }
+
+    /**
+     * Intersects the ray with a leaf's triangles, simd::Width triangles at a time (Moller-Trumbore).
+     * Closest hits take the nearest triangle, or the first in leaf order on ties.
+     */
+    template<bool AnyHit>
+    bool IntersectTriangles(const MeshBVH& mesh, uint32_t leaf, const TraversalRay& ray, float& tMax, Hit& hit)
+    {
+        uint32_t first = leaf & Node::LeafFirstMask;
+        uint32_t count = ((leaf & ~Node::LeafFlag) >> Node::LeafCountShift) + 1;
+
+        alignas(32) float t[simd::Width], u[simd::Width], v[simd::Width], det[simd::Width], lanes[simd::Width];
+        for (int lane = 0; lane < simd::Width; lane++) lanes[lane] = (float)lane;
+        simd::vfloat laneIndices = simd::Load(lanes);
+
+        simd::vfloat zero = simd::Set1(0.f);
+        simd::vfloat one = simd::Set1(1.f);
+
+        bool found = false;
+        for (uint32_t offset = 0; offset < count; offset += (uint32_t)simd::Width)
+        {
+            size_t index = first + offset;
+            simd::vfloat e1x = simd::Load(&mesh.e1x[index]);
+            simd::vfloat e1y = simd::Load(&mesh.e1y[index]);
+            simd::vfloat e1z = simd::Load(&mesh.e1z[index]);
+            simd::vfloat e2x = simd::Load(&mesh.e2x[index]);
+            simd::vfloat e2y = simd::Load(&mesh.e2y[index]);
+            simd::vfloat e2z = simd::Load(&mesh.e2z[index]);
+
+            // p = direction x e2
+            simd::vfloat px = simd::Sub(simd::Mul(ray.directionY, e2z), simd::Mul(ray.directionZ, e2y));
+            simd::vfloat py = simd::Sub(simd::Mul(ray.directionZ, e2x), simd::Mul(ray.directionX, e2z));
+            simd::vfloat pz = simd::Sub(simd::Mul(ray.directionX, e2y), simd::Mul(ray.directionY, e2x));
+            simd::vfloat determinant = simd::Add(simd::Add(simd::Mul(e1x, px), simd::Mul(e1y, py)), simd::Mul(e1z, pz));
+            simd::vfloat invDeterminant = simd::Div(one, determinant);
+
+            // s = origin - v0, q = s x e1
+            simd::vfloat sx = simd::Sub(ray.originX, simd::Load(&mesh.v0x[index]));
+            simd::vfloat sy = simd::Sub(ray.originY, simd::Load(&mesh.v0y[index]));
+            simd::vfloat sz = simd::Sub(ray.originZ, simd::Load(&mesh.v0z[index]));
+            simd::vfloat qx = simd::Sub(simd::Mul(sy, e1z), simd::Mul(sz, e1y));
+            simd::vfloat qy = simd::Sub(simd::Mul(sz, e1x), simd::Mul(sx, e1z));
+            simd::vfloat qz = simd::Sub(simd::Mul(sx, e1y), simd::Mul(sy, e1x));
+
+            simd::vfloat hitU = simd::Mul(simd::Add(simd::Add(simd::Mul(sx, px), simd::Mul(sy, py)), simd::Mul(sz, pz)), invDeterminant);
+            simd::vfloat hitV = simd::Mul(simd::Add(simd::Add(simd::Mul(ray.directionX, qx), simd::Mul(ray.directionY, qy)), simd::Mul(ray.directionZ, qz)), invDeterminant);
+            simd::vfloat hitT = simd::Mul(simd::Add(simd::Add(simd::Mul(e2x, qx), simd::Mul(e2y, qy)), simd::Mul(e2z, qz)), invDeterminant);
+
+            // Padding lanes past the end of the leaf are masked out (degenerate triangles fail on NaN/infinite barycentrics)
+            simd::vmask inLeaf = simd::Greater(simd::Set1((float)(count - offset)), laneIndices);
+            simd::vmask valid = simd::And(simd::GreaterEqual(hitU, zero), simd::GreaterEqual(hitV, zero));
+            valid = simd::And(valid, simd::LessEqual(simd::Add(hitU, hitV), one));
+            valid = simd::And(valid, simd::And(simd::Greater(hitT, ray.tMin), simd::Less(hitT, simd::Set1(tMax))));
+            valid = simd::And(valid, inLeaf);
+
+            int mask = simd::MoveMask(valid);
+            if (mask == 0) continue;
+            if (AnyHit) return true;
+
+            simd::Store(t, hitT);
+            simd::Store(u, hitU);
+            simd::Store(v, hitV);
+            simd::Store(det, determinant);
+            for (int lane = 0; lane < simd::Width; lane++)
+            {
+                if (!(mask & (1 << lane)) || t[lane] >= tMax) continue;
+
+                tMax = t[lane];
+                hit.t = t[lane];
+                hit.u = u[lane];
+                hit.v = v[lane];
+                hit.primitiveIndex = mesh.primitiveIndices[index + (size_t)lane];
+                hit.triangleIndex = mesh.triangleIndices[index + (size_t)lane];
+            #if (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT) || (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP)
+                hit.frontFace = (det[lane] < 0.f);
+            #else
+                hit.frontFace = (det[lane] > 0.f);
+            #endif
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    /**
+     * Traverses a bottom level subtree (the root node or any node or leaf below it) of an instance.
+     * The ray is transformed to object space without normalization, so hit distances are unchanged.
+     */
+    template<bool AnyHit>
+    bool TraceInstance(const SceneBVH& bvh, uint32_t instanceIndex, uint32_t root, const Ray& ray, float& tMax, Hit& hit)
+    {
+        const Instance& instance = bvh.instances[instanceIndex];
+        const MeshBVH& mesh = bvh.meshes[instance.meshIndex];
+
+        TraversalRay objectRay = GetTraversalRay(TransformPoint(instance.worldToObject, ray.origin), TransformVector(instance.worldToObject, ray.direction), ray.tMin);
+        bool instanceHit = Traverse<AnyHit>(mesh.nodes, objectRay, ray.tMin, tMax, [&](uint32_t triangles, float& triangleTMax)
+        {
+            return IntersectTriangles<AnyHit>(mesh, triangles, objectRay, triangleTMax, hit);
+        }, root);
+        if (instanceHit) hit.instanceIndex = instanceIndex;
+        return instanceHit;
+    }
+
+    template<bool AnyHit>
+    bool TraceRay(const SceneBVH& bvh, const Ray& ray, Hit& hit)
+    {
+        TraversalRay worldRay = GetTraversalRay(ray.origin, ray.direction, ray.tMin);
+        float tMax = ray.tMax;
+
+        // Top level leaves hold a single instance
+        return Traverse<AnyHit>(bvh.nodes, worldRay, ray.tMin, tMax, [&](uint32_t leaf, float& instanceTMax)
+        {
+            return TraceInstance<AnyHit>(bvh, leaf & Node::LeafFirstMask, 0, ray, instanceTMax, hit);
+        });
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Probe Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * The subtrees of a probe's cut, sorted into the octants they can be hit from.
+     */
+    struct ProbeCut
+    {
+        float3                origin;
+        float                 radius;
+        std::vector<Bounds>   bounds[8];            // World space subtree bounds, clipped to the octant
+        std::vector<uint32_t> subtrees[8];          // ProbeBVH subtree indices
+    };
+
+    inline float GetDistanceSquared(const Bounds& bounds, const float3& point)
+    {
+        float dx = std::max(std::max(bounds.min.x - point.x, point.x - bounds.max.x), 0.f);
+        float dy = std::max(std::max(bounds.min.y - point.y, point.y - bounds.max.y), 0.f);
+        float dz = std::max(std::max(bounds.min.z - point.z, point.z - bounds.max.z), 0.f);
+        return (dx * dx) + (dy * dy) + (dz * dz);
+    }
+
+    /**
+     * Clips the bounds to the part that rays from the origin in the octant can reach within the radius: the octant's side
+     * of the origin on each axis, and the sphere's bounds. Returns false if the rays can't reach the bounds.
+     */
+    inline bool ClipToOctant(const Bounds& bounds, const float3& origin, float radius, uint32_t octant, Bounds& clipped)
+    {
+        clipped = bounds;
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            if (octant & (1u << axis))
+            {
+                clipped.min[axis] = std::max(clipped.min[axis], origin[axis] - radius);
+                clipped.max[axis] = std::min(clipped.max[axis], origin[axis]);
+            }
+            else
+            {
+                clipped.min[axis] = std::max(clipped.min[axis], origin[axis]);
+                clipped.max[axis] = std::min(clipped.max[axis], origin[axis] + radius);
+            }
+        }
+        return !clipped.IsEmpty() && GetDistanceSquared(clipped, origin) <= (radius * radius);
+    }
+
+    Bounds TransformBounds(const float (&transform)[3][4], const Bounds& bounds)
+    {
+        Bounds result;
+        for (uint32_t corner = 0; corner < 8; corner++)
+        {
+            float3 position =
+            {
+                (corner & 1) ? bounds.max.x : bounds.min.x,
+                (corner & 2) ? bounds.max.y : bounds.min.y,
+                (corner & 4) ? bounds.max.z : bounds.min.z
+            };
+            result.Grow(TransformPoint(transform, position));
+        }
+        return result;
+    }
+
+    inline bool HasInternalChildren(const Node& node)
+    {
+        for (uint32_t slot = 0; slot < NodeWidth; slot++)
+        {
+            if (node.children[slot] != InvalidIndex && !(node.children[slot] & Node::LeafFlag)) return true;
+        }
+        return false;
+    }
+
+    /**
+     * Adds a bottom level subtree of an instance to the octants it can be hit from. Subtrees near the origin that straddle
+     * its axis planes are opened, unless they only hold leaves (each subtree a ray visits costs an object space ray, so
+     * opening nodes just above the leaves costs more than it saves). Distant subtrees are reached by few of the rays and
+     * are kept whole, which keeps the octant BVHs small.
+     */
+    void CutSubtree(const SceneBVH& bvh, uint32_t instanceIndex, uint32_t item, const Bounds& objectBounds, ProbeCut& cut, ProbeBVH& probe)
+    {
+        const Instance& instance = bvh.instances[instanceIndex];
+        Bounds worldBounds = TransformBounds(instance.objectToWorld, objectBounds);
+
+        Bounds clipped[8];
+        uint32_t octants = 0;
+        uint32_t numOctants = 0;
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            if (!ClipToOctant(worldBounds, cut.origin, cut.radius, octant, clipped[octant])) continue;
+            octants |= (1u << octant);
+            numOctants++;
+        }
+        if (numOctants == 0) return;
+
+        const Node* node = (item & Node::LeafFlag) ? nullptr : &bvh.meshes[instance.meshIndex].nodes[item];
+        float3 extent = { worldBounds.max.x - worldBounds.min.x, worldBounds.max.y - worldBounds.min.y, worldBounds.max.z - worldBounds.min.z };
+        float sizeSquared = (extent.x * extent.x) + (extent.y * extent.y) + (extent.z * extent.z);
+        bool near = GetDistanceSquared(worldBounds, cut.origin) < (sizeSquared * c_probeCutScale * c_probeCutScale);
+        if (numOctants > 1 && near && node && HasInternalChildren(*node))
+        {
+            for (uint32_t slot = 0; slot < NodeWidth; slot++)
+            {
+                if (node->children[slot] == InvalidIndex) continue;
+
+                Bounds childBounds;
+                childBounds.min = { node->minX[slot], node->minY[slot], node->minZ[slot] };
+                childBounds.max = { node->maxX[slot], node->maxY[slot], node->maxZ[slot] };
+                CutSubtree(bvh, instanceIndex, node->children[slot], childBounds, cut, probe);
+            }
+            return;
+        }
+
+        uint32_t subtreeIndex = (uint32_t)probe.subtrees.size();
+        probe.subtrees.push_back({ instanceIndex, item });
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            if (!(octants & (1u << octant))) continue;
+            cut.bounds[octant].push_back(clipped[octant]);
+            cut.subtrees[octant].push_back(subtreeIndex);
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Benchmark Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    struct Random
+    {
+        uint32_t state;
+
+        explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+        float Next()
+        {
+            state = (state * 1664525u) + 1013904223u;
+            return (float)(state >> 8) * (1.f / 16777216.f);
+        }
+
+        float Next(float min, float max) { return min + ((max - min) * Next()); }
+    };
+
+    /**
+     * Intersects the ray with every triangle of every instance (scalar, same math as the SIMD path).
+     */
+    bool TraceBruteForce(const SceneBVH& bvh, const Ray& ray, bool anyHit, Hit& hit)
+    {
+        float tMax = ray.tMax;
+        for (uint32_t instanceIndex = 0; instanceIndex < (uint32_t)bvh.instances.size(); instanceIndex++)
+        {
+            const Instance& instance = bvh.instances[instanceIndex];
+            if (instance.meshIndex == InvalidIndex) continue;
+
+            const MeshBVH& mesh = bvh.meshes[instance.meshIndex];
+            float3 o = TransformPoint(instance.worldToObject, ray.origin);
+            float3 d = TransformVector(instance.worldToObject, ray.direction);
+            for (uint32_t index = 0; index < (uint32_t)mesh.primitiveIndices.size(); index++)
+            {
+                if (mesh.primitiveIndices[index] == InvalidIndex) continue;
+
+                float3 e1 = { mesh.e1x[index], mesh.e1y[index], mesh.e1z[index] };
+                float3 e2 = { mesh.e2x[index], mesh.e2y[index], mesh.e2z[index] };
+                float3 p = { (d.y * e2.z) - (d.z * e2.y), (d.z * e2.x) - (d.x * e2.z), (d.x * e2.y) - (d.y * e2.x) };
+                float determinant = (e1.x * p.x) + (e1.y * p.y) + (e1.z * p.z);
+                float invDeterminant = 1.f / determinant;
+                float3 s = { o.x - mesh.v0x[index], o.y - mesh.v0y[index], o.z - mesh.v0z[index] };
+                float3 q = { (s.y * e1.z) - (s.z * e1.y), (s.z * e1.x) - (s.x * e1.z), (s.x * e1.y) - (s.y * e1.x) };
+                float u = ((s.x * p.x) + (s.y * p.y) + (s.z * p.z)) * invDeterminant;
+                float v = ((d.x * q.x) + (d.y * q.y) + (d.z * q.z)) * invDeterminant;
+                float t = ((e2.x * q.x) + (e2.y * q.y) + (e2.z * q.z)) * invDeterminant;
+                if (!(u >= 0.f && v >= 0.f && (u + v) <= 1.f && t > ray.tMin && t < tMax)) continue;
+
+                tMax = t;
+                hit.t = t;
+                hit.instanceIndex = instanceIndex;
+                if (anyHit) return true;
+            }
+        }
+        return hit.IsValid();
+    }
+
+    double GetRate(size_t numRays, std::chrono::high_resolution_clock::time_point start)
+    {
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return (double)numRays / seconds * 1e-6;
+    }
+
+    double GetMilliseconds(std::chrono::high_resolution_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * Builds the bottom level BVH of a mesh.
+     */
+    void BuildMesh(const Scenes::Mesh& mesh, const BuildDesc& desc, MeshBVH& bvh)
+    {
+        bvh = MeshBVH();
+
+        // Gather the triangles of all primitives
+        std::vector<Bounds> triangleBounds;
+        std::vector<float3> vertices;
+        std::vector<uint32_t> primitiveIndices, triangleIndices;
+        for (uint32_t primitiveIndex = 0; primitiveIndex < (uint32_t)mesh.primitives.size(); primitiveIndex++)
+        {
+            const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
+            for (uint32_t triangleIndex = 0; triangleIndex < (uint32_t)(primitive.indices.size() / 3); triangleIndex++)
+            {
+                Bounds bounds;
+                for (uint32_t vertex = 0; vertex < 3; vertex++)
+                {
+                    const float3& position = primitive.vertices[primitive.indices[(triangleIndex * 3) + vertex]].position;
+                    bounds.Grow(position);
+                    vertices.push_back(position);
+                }
+                triangleBounds.push_back(bounds);
+                primitiveIndices.push_back(primitiveIndex);
+                triangleIndices.push_back(triangleIndex);
+            }
+        }
+
+        bvh.numTriangles = (uint32_t)triangleBounds.size();
+        if (bvh.numTriangles == 0) return;
+
+        Builder builder;
+        BuildBinary(triangleBounds, std::max(1u, std::min(desc.maxLeafSize, Node::MaxLeafSize)), desc, builder);
+
+        // Store the triangles in leaf order, padded with degenerate triangles so full SIMD loads stay in bounds
+        size_t numStored = (size_t)bvh.numTriangles + NodeWidth;
+        for (std::vector<float>* values : { &bvh.v0x, &bvh.v0y, &bvh.v0z, &bvh.e1x, &bvh.e1y, &bvh.e1z, &bvh.e2x, &bvh.e2y, &bvh.e2z }) values->assign(numStored, 0.f);
+        bvh.primitiveIndices.assign(numStored, InvalidIndex);
+        bvh.triangleIndices.assign(numStored, InvalidIndex);
+
+        for (uint32_t index = 0; index < bvh.numTriangles; index++)
+        {
+            uint32_t triangle = builder.indices[index];
+            const float3& v0 = vertices[(triangle * 3) + 0];
+            const float3& v1 = vertices[(triangle * 3) + 1];
+            const float3& v2 = vertices[(triangle * 3) + 2];
+            bvh.v0x[index] = v0.x;
+            bvh.v0y[index] = v0.y;
+            bvh.v0z[index] = v0.z;
+            bvh.e1x[index] = v1.x - v0.x;
+            bvh.e1y[index] = v1.y - v0.y;
+            bvh.e1z[index] = v1.z - v0.z;
+            bvh.e2x[index] = v2.x - v0.x;
+            bvh.e2y[index] = v2.y - v0.y;
+            bvh.e2z[index] = v2.z - v0.z;
+            bvh.primitiveIndices[index] = primitiveIndices[triangle];
+            bvh.triangleIndices[index] = triangleIndices[triangle];
+        }
+
+        const Bounds& bounds = builder.nodes[0].bounds;
+        bvh.bounds = { bounds.min, bounds.max };
+        Collapse(builder.nodes, 0, nullptr, bvh.nodes);
+    }
+
+    const std::vector<Scenes::Mesh>& GetMeshes(const Scenes::Scene& scene, const SceneBVH& bvh)
+    {
+        return bvh.proxies ? scene.proxyMeshes : scene.meshes;
+    }
+
+    /**
+     * Builds the bottom level BVHs of all meshes and the top level BVH of all instances.
+     */
+    void Build(const Scenes::Scene& scene, const BuildDesc& desc, SceneBVH& bvh)
+    {
+        bvh.proxies = desc.proxies && !scene.proxyMeshes.empty();
+        const std::vector<Scenes::Mesh>& meshes = GetMeshes(scene, bvh);
+
+        uint32_t numMeshes = (uint32_t)meshes.size();
+        bvh.meshes.clear();
+        bvh.meshes.resize(numMeshes);
+
+        // Small meshes are built in parallel with each other (on one thread each), large meshes one at a time on all threads
+        std::vector<uint32_t> smallMeshes, largeMeshes;
+        for (uint32_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            if (meshes[meshIndex].numIndices / 3 < c_parallelMeshSize) smallMeshes.push_back(meshIndex);
+            else largeMeshes.push_back(meshIndex);
+        }
+
+        BuildDesc meshDesc = desc;
+        meshDesc.numThreads = 1;
+        cpu::ParallelFor((uint32_t)smallMeshes.size(), 1, desc.numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t index = begin; index < end; index++) BuildMesh(meshes[smallMeshes[index]], meshDesc, bvh.meshes[smallMeshes[index]]);
+        });
+        for (uint32_t meshIndex : largeMeshes) BuildMesh(meshes[meshIndex], desc, bvh.meshes[meshIndex]);
+
+        BuildInstances(scene, desc, bvh);
+    }
+
+    /**
+     * Rebuilds the top level BVH over the scene's instances (e.g. after instance transforms change).
+     * Bottom level BVHs must already be built.
+     */
+    void BuildInstances(const Scenes::Scene& scene, const BuildDesc& desc, SceneBVH& bvh)
+    {
+        uint32_t numInstances = (uint32_t)scene.instances.size();
+        bvh.nodes.clear();
+        bvh.instances.assign(numInstances, Instance());
+        bvh.bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+        // Instance bounds are the world space bounds of the transformed mesh bounds' corners
+        std::vector<Bounds> instanceBounds;
+        std::vector<uint32_t> instanceIndices;
+        for (uint32_t instanceIndex = 0; instanceIndex < numInstances; instanceIndex++)
+        {
+            const Scenes::MeshInstance& sceneInstance = scene.instances[instanceIndex];
+            if (sceneInstance.meshIndex < 0 || (size_t)sceneInstance.meshIndex >= bvh.meshes.size()) continue;
+
+            const MeshBVH& mesh = bvh.meshes[(size_t)sceneInstance.meshIndex];
+            Instance& instance = bvh.instances[instanceIndex];
+            if (mesh.nodes.empty() || !InvertTransform(sceneInstance.transform, instance.worldToObject)) continue;
+
+            instance.meshIndex = (uint32_t)sceneInstance.meshIndex;
+            memcpy(instance.objectToWorld, sceneInstance.transform, sizeof(instance.objectToWorld));
+
+            Bounds bounds;
+            for (uint32_t corner = 0; corner < 8; corner++)
+            {
+                float3 position =
+                {
+                    (corner & 1) ? mesh.bounds.max.x : mesh.bounds.min.x,
+                    (corner & 2) ? mesh.bounds.max.y : mesh.bounds.min.y,
+                    (corner & 4) ? mesh.bounds.max.z : mesh.bounds.min.z
+                };
+                bounds.Grow(TransformPoint(sceneInstance.transform, position));
+            }
+            instanceBounds.push_back(bounds);
+            instanceIndices.push_back(instanceIndex);
+        }
+        if (instanceBounds.empty()) return;
+
+        // Single instance leaves reference the scene instance index directly
+        Builder builder;
+        BuildBinary(instanceBounds, 1, desc, builder);
+
+        std::vector<uint32_t> itemMap(builder.indices.size());
+        for (size_t index = 0; index < itemMap.size(); index++) itemMap[index] = instanceIndices[builder.indices[index]];
+
+        const Bounds& bounds = builder.nodes[0].bounds;
+        bvh.bounds = { bounds.min, bounds.max };
+        Collapse(builder.nodes, 0, itemMap.data(), bvh.nodes);
+    }
+
+    /**
+     * Finds the closest hit along the ray. Returns false if nothing is hit.
+     */
+    bool TraceClosestHit(const SceneBVH& bvh, const Ray& ray, Hit& hit)
+    {
+        hit = Hit();
+        return TraceRay<false>(bvh, ray, hit);
+    }
+
+    /**
+     * Returns true if anything is hit along the ray.
+     */
+    bool TraceAnyHit(const SceneBVH& bvh, const Ray& ray)
+    {
+        Hit hit;
+        return TraceRay<true>(bvh, ray, hit);
+    }
+
+    void TraceClosestHit(const SceneBVH& bvh, uint32_t numRays, const Ray* rays, Hit* hits, uint32_t numThreads)
+    {
+        cpu::ParallelFor(numRays, c_raysPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t index = begin; index < end; index++) TraceClosestHit(bvh, rays[index], hits[index]);
+        });
+    }
+
+    void TraceAnyHit(const SceneBVH& bvh, uint32_t numRays, const Ray* rays, bool* hits, uint32_t numThreads)
+    {
+        cpu::ParallelFor(numRays, c_raysPerChunk, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t index = begin; index < end; index++) hits[index] = TraceAnyHit(bvh, rays[index]);
+        });
+    }
+
+    /**
+     * Cuts the scene BVH around the origin and builds the octant BVHs of the subtrees within the radius.
+     */
+    void BuildProbe(const SceneBVH& bvh, const float3& origin, float radius, const BuildDesc& desc, ProbeBVH& probe)
+    {
+        probe.origin = origin;
+        probe.radius = radius;
+        probe.subtrees.clear();
+
+        ProbeCut cut;
+        cut.origin = origin;
+        cut.radius = radius;
+
+        // Cut the instances within the radius, starting at their bottom level roots
+        float radiusSquared = radius * radius;
+        uint32_t stack[c_stackSize];
+        uint32_t stackSize = 0;
+        if (!bvh.nodes.empty()) stack[stackSize++] = 0;
+        while (stackSize > 0)
+        {
+            const Node& node = bvh.nodes[stack[--stackSize]];
+            for (uint32_t slot = 0; slot < NodeWidth; slot++)
+            {
+                if (node.children[slot] == InvalidIndex) continue;
+
+                Bounds bounds;
+                bounds.min = { node.minX[slot], node.minY[slot], node.minZ[slot] };
+                bounds.max = { node.maxX[slot], node.maxY[slot], node.maxZ[slot] };
+                if (GetDistanceSquared(bounds, origin) > radiusSquared) continue;
+
+                if (node.children[slot] & Node::LeafFlag)
+                {
+                    uint32_t instanceIndex = node.children[slot] & Node::LeafFirstMask;
+                    const MeshBVH& mesh = bvh.meshes[bvh.instances[instanceIndex].meshIndex];
+                    Bounds meshBounds;
+                    meshBounds.min = mesh.bounds.min;
+                    meshBounds.max = mesh.bounds.max;
+                    CutSubtree(bvh, instanceIndex, 0, meshBounds, cut, probe);
+                }
+                else if (stackSize < c_stackSize)
+                {
+                    stack[stackSize++] = node.children[slot];
+                }
+            }
+        }
+
+        // Single subtree leaves reference the probe's subtree index directly
+        for (uint32_t octant = 0; octant < 8; octant++)
+        {
+            probe.octants[octant].clear();
+            if (cut.bounds[octant].empty()) continue;
+
+            Builder builder;
+            BuildBinary(cut.bounds[octant], 1, desc, builder);
+
+            std::vector<uint32_t> itemMap(builder.indices.size());
+            for (size_t index = 0; index < itemMap.size(); index++) itemMap[index] = cut.subtrees[octant][builder.indices[index]];
+            Collapse(builder.nodes, 0, itemMap.data(), probe.octants[octant]);
+        }
+    }
+
+    /**
+     * Finds the closest hit of a ray that starts at the probe's origin and ends within its radius.
+     * Only the BVH of the ray's octant is traversed, its leaves continue in the instances' bottom level BVHs.
+     */
+    bool TraceClosestHit(const SceneBVH& bvh, const ProbeBVH& probe, const Ray& ray, Hit& hit)
+    {
+        hit = Hit();
+        TraversalRay worldRay = GetTraversalRay(ray.origin, ray.direction, ray.tMin);
+        float tMax = ray.tMax;
+
+        return Traverse<false>(probe.octants[GetOctant(ray.direction)], worldRay, ray.tMin, tMax, [&](uint32_t leaf, float& subtreeTMax)
+        {
+            const ProbeSubtree& subtree = probe.subtrees[leaf & Node::LeafFirstMask];
+            return TraceInstance<false>(bvh, subtree.instanceIndex, subtree.item, ray, subtreeTMax, hit);
+        });
+    }
+
+    void TraceClosestHit(const SceneBVH& bvh, const ProbeBVH& probe, uint32_t numRays, const Ray* rays, Hit* hits)
+    {
+        // Order the rays by octant (counting sort), so consecutive rays traverse the same BVH
+        uint32_t offsets[9] = {};
+        for (uint32_t index = 0; index < numRays; index++) offsets[GetOctant(rays[index].direction) + 1]++;
+        for (uint32_t octant = 0; octant < 8; octant++) offsets[octant + 1] += offsets[octant];
+
+        std::vector<uint32_t> order(numRays);
+        for (uint32_t index = 0; index < numRays; index++) order[offsets[GetOctant(rays[index].direction)]++] = index;
+
+        for (uint32_t index : order) TraceClosestHit(bvh, probe, rays[index], hits[index]);
+    }
+
+    size_t GetMemorySize(const ProbeBVH& probe)
+    {
+        size_t size = probe.subtrees.capacity() * sizeof(ProbeSubtree);
+        for (const std::vector<Node>& nodes : probe.octants) size += nodes.capacity() * sizeof(Node);
+        return size;
+    }
+
+    /**
+     * Measures build times and ray throughput on the scene, checks hits against brute force, and compares probe BVHs with per-ray traversal.
+     */
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log)
+    {
+        const uint32_t numRays = 1 << 20;
+        const uint32_t numValidationRays = 256;
+        uint32_t numThreads = cpu::GetHardwareThreadCount();
+
+        // Build on one thread and on all threads
+        BuildDesc desc;
+        SceneBVH bvh;
+        double buildTimes[2];
+        for (uint32_t index = 0; index < 2; index++)
+        {
+            desc.numThreads = (index == 0) ? 1 : numThreads;
+            auto start = std::chrono::high_resolution_clock::now();
+            Build(scene, desc, bvh);
+            buildTimes[index] = GetMilliseconds(start);
+        }
+
+        size_t numNodes = bvh.nodes.size();
+        uint32_t numTriangles = 0;
+        for (const MeshBVH& mesh : bvh.meshes)
+        {
+            numNodes += mesh.nodes.size();
+            numTriangles += mesh.numTriangles;
+        }
+
+        // Random rays from inside the scene bounds: closest hit rays and any hit rays with random lengths
+        float3 extent = { bvh.bounds.max.x - bvh.bounds.min.x, bvh.bounds.max.y - bvh.bounds.min.y, bvh.bounds.max.z - bvh.bounds.min.z };
+        float maxDistance = sqrtf((extent.x * extent.x) + (extent.y * extent.y) + (extent.z * extent.z));
+
+        Random random(1);
+        std::vector<Ray> rays(numRays), shadowRays(numRays);
+        for (uint32_t index = 0; index < numRays; index++)
+        {
+            float3 origin = { random.Next(bvh.bounds.min.x, bvh.bounds.max.x), random.Next(bvh.bounds.min.y, bvh.bounds.max.y), random.Next(bvh.bounds.min.z, bvh.bounds.max.z) };
+            float z = random.Next(-1.f, 1.f);
+            float phi = random.Next(0.f, 6.28318530718f);
+            float r = sqrtf(std::max(0.f, 1.f - (z * z)));
+            rays[index].origin = origin;
+            rays[index].direction = { r * cosf(phi), r * sinf(phi), z };
+            shadowRays[index] = rays[index];
+            shadowRays[index].tMax = random.Next(0.f, 0.5f * maxDistance);
+        }
+
+        std::vector<Hit> hits(numRays);
+        std::unique_ptr<bool[]> anyHits(new bool[numRays]);
+        double rates[2][2];
+        for (uint32_t index = 0; index < 2; index++)
+        {
+            uint32_t threads = (index == 0) ? 1 : numThreads;
+            auto start = std::chrono::high_resolution_clock::now();
+            TraceClosestHit(bvh, numRays, rays.data(), hits.data(), threads);
+            rates[index][0] = GetRate(numRays, start);
+
+            start = std::chrono::high_resolution_clock::now();
+            TraceAnyHit(bvh, numRays, shadowRays.data(), anyHits.get(), threads);
+            rates[index][1] = GetRate(numRays, start);
+        }
+
+        uint32_t numHits = 0, numShadowHits = 0;
+        for (uint32_t index = 0; index < numRays; index++)
+        {
+            numHits += hits[index].IsValid() ? 1 : 0;
+            numShadowHits += anyHits[index] ? 1 : 0;
+        }
+
+        // Check a subset of the rays against brute force
+        uint32_t numMismatches = 0;
+        for (uint32_t index = 0; index < numValidationRays; index++)
+        {
+            uint32_t rayIndex = (uint32_t)(((uint64_t)index * numRays) / numValidationRays);
+            Hit reference, shadowReference;
+            bool hit = TraceBruteForce(bvh, rays[rayIndex], false, reference);
+            bool shadowHit = TraceBruteForce(bvh, shadowRays[rayIndex], true, shadowReference);
+
+            if (hit != hits[rayIndex].IsValid() || shadowHit != anyHits[rayIndex]) numMismatches++;
+            else if (hit && fabsf(reference.t - hits[rayIndex].t) > (1e-5f * std::max(1.f, reference.t))) numMismatches++;
+        }
+
+        log << "\n\tCPU BVH: " << bvh.meshes.size() << " meshes, " << bvh.instances.size() << " instances, " << numTriangles << " triangles, " << numNodes << " nodes (" << RTXGI_CPU_SIMD_NAME << ")";
+        log << "\n\tBuild: " << buildTimes[0] << " ms (1 thread), " << buildTimes[1] << " ms (" << numThreads << " threads)";
+        log << "\n\tClosest hit: " << rates[0][0] << " Mrays/s (1 thread), " << rates[1][0] << " Mrays/s (" << numThreads << " threads), " << (100.0 * numHits / numRays) << "% hit";
+        log << "\n\tAny hit: " << rates[0][1] << " Mrays/s (1 thread), " << rates[1][1] << " Mrays/s (" << numThreads << " threads), " << (100.0 * numShadowHits / numRays) << "% hit";
+        log << "\n\tBrute force check: " << numMismatches << " of " << numValidationRays << " rays differ";
+
+        // Probe rays: rays in all directions from random points, reaching across the scene (no distance culling).
+        // Traced per ray with the scene BVH and per point with probe BVHs (built on the worker threads, one per point).
+        const uint32_t numProbes = 1024;
+        uint32_t numProbeRays = numProbes * c_probeRays;
+        std::vector<Ray> probeRays(numProbeRays);
+        for (uint32_t probeIndex = 0; probeIndex < numProbes; probeIndex++)
+        {
+            float3 origin = { random.Next(bvh.bounds.min.x, bvh.bounds.max.x), random.Next(bvh.bounds.min.y, bvh.bounds.max.y), random.Next(bvh.bounds.min.z, bvh.bounds.max.z) };
+            for (uint32_t rayIndex = 0; rayIndex < c_probeRays; rayIndex++)
+            {
+                float z = random.Next(-1.f, 1.f);
+                float phi = random.Next(0.f, 6.28318530718f);
+                float r = sqrtf(std::max(0.f, 1.f - (z * z)));
+                Ray& ray = probeRays[(probeIndex * c_probeRays) + rayIndex];
+                ray.origin = origin;
+                ray.direction = { r * cosf(phi), r * sinf(phi), z };
+                ray.tMax = maxDistance;
+            }
+        }
+
+        std::vector<ProbeBVH> probes(numProbes);
+        BuildDesc probeDesc = desc;
+        probeDesc.numThreads = 1;
+        auto start = std::chrono::high_resolution_clock::now();
+        cpu::ParallelFor(numProbes, 1, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t probeIndex = begin; probeIndex < end; probeIndex++) BuildProbe(bvh, probeRays[probeIndex * c_probeRays].origin, maxDistance, probeDesc, probes[probeIndex]);
+        });
+        double probeBuildTime = GetMilliseconds(start);
+
+        std::vector<Hit> rayHits(numProbeRays), probeHits(numProbeRays);
+        start = std::chrono::high_resolution_clock::now();
+        TraceClosestHit(bvh, numProbeRays, probeRays.data(), rayHits.data(), numThreads);
+        double rayRate = GetRate(numProbeRays, start);
+
+        start = std::chrono::high_resolution_clock::now();
+        cpu::ParallelFor(numProbes, 1, numThreads, [&](uint32_t begin, uint32_t end)
+        {
+            for (uint32_t probeIndex = begin; probeIndex < end; probeIndex++)
+            {
+                uint32_t first = probeIndex * c_probeRays;
+                TraceClosestHit(bvh, probes[probeIndex], c_probeRays, &probeRays[first], &probeHits[first]);
+            }
+        });
+        double probeRate = GetRate(numProbeRays, start);
+
+        size_t probeMemory = 0;
+        size_t numSubtrees = 0;
+        for (const ProbeBVH& probe : probes)
+        {
+            probeMemory += GetMemorySize(probe);
+            numSubtrees += probe.subtrees.size();
+        }
+
+        // Coplanar triangles (e.g. of overlapping instances) may resolve to a different, equally close triangle, so only distances are compared
+        uint32_t numProbeMismatches = 0;
+        for (uint32_t index = 0; index < numProbeRays; index++)
+        {
+            const Hit& rayHit = rayHits[index];
+            const Hit& probeHit = probeHits[index];
+            if (rayHit.IsValid() != probeHit.IsValid()) numProbeMismatches++;
+            else if (rayHit.IsValid() && fabsf(rayHit.t - probeHit.t) > (1e-5f * std::max(1.f, rayHit.t))) numProbeMismatches++;
+        }
+
+        log << "\n\tProbe rays (" << numProbes << " points, " << c_probeRays << " rays each): " << rayRate << " Mrays/s per ray, " << probeRate << " Mrays/s with probe BVHs (" << numThreads << " threads)";
+        log << "\n\tProbe BVHs: " << probeBuildTime << " ms build (" << numThreads << " threads), " << ((double)numSubtrees / numProbes) << " subtrees and "
+            << ((double)probeMemory / numProbes / 1024.0) << " KB per probe";
+        log << "\n\tProbe BVH check: " << numProbeMismatches << " of " << numProbeRays << " rays differ from per ray traversal\n";
+
+        // Probe rays traced against the proxy meshes, compared with the full geometry
+        if (!scene.proxyMeshes.empty())
+        {
+            BuildDesc proxyDesc = desc;
+            proxyDesc.proxies = true;
+            SceneBVH proxyBVH;
+            start = std::chrono::high_resolution_clock::now();
+            Build(scene, proxyDesc, proxyBVH);
+            double proxyBuildTime = GetMilliseconds(start);
+
+            start = std::chrono::high_resolution_clock::now();
+            TraceClosestHit(proxyBVH, numProbeRays, probeRays.data(), probeHits.data(), numThreads);
+            double proxyRate = GetRate(numProbeRays, start);
+
+            uint32_t numProxyTriangles = 0;
+            for (const MeshBVH& mesh : proxyBVH.meshes) numProxyTriangles += mesh.numTriangles;
+
+            uint32_t numProxyMismatches = 0;
+            uint32_t numBothHits = 0;
+            double distanceError = 0.0;
+            for (uint32_t index = 0; index < numProbeRays; index++)
+            {
+                const Hit& rayHit = rayHits[index];
+                const Hit& proxyHit = probeHits[index];
+                if (rayHit.IsValid() != proxyHit.IsValid()) numProxyMismatches++;
+                else if (rayHit.IsValid())
+                {
+                    distanceError += fabs((double)rayHit.t - (double)proxyHit.t);
+                    numBothHits++;
+                }
+            }
+
+            log << "\tProxy meshes: " << numProxyTriangles << " of " << numTriangles << " triangles (" << (100.0 * numProxyTriangles / std::max(numTriangles, 1u)) << "%), "
+                << proxyBuildTime << " ms build (" << numThreads << " threads)";
+            log << "\n\tProxy probe rays: " << proxyRate << " Mrays/s per ray (" << numThreads << " threads), " << numProxyMismatches << " of " << numProbeRays
+                << " rays hit or miss differently, " << (distanceError / std::max(numBothHits, 1u)) << " mean hit distance difference\n";
+        }
+
+        return (numMismatches == 0) && (numProbeMismatches == 0);
+    }
+
+}
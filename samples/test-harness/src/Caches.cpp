@@ -9,50 +9,386 @@
 */
 
 #include "Caches.h"
+#include "Compression.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <thread>
+
+#if __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace DirectX;
 
-#define SCENE_CACHE_VERSION 4
+#define SCENE_CACHE_VERSION 15
+
+// Scene cache file layout:
+//   Header:        version, coordinate system, number of sections
+//   Section table: byte offset and size of each section (in ESection order)
+//   Sections:      the scene section (header values, nodes, cameras, lights, instances, materials, sources), the contents section (the
+//                  number of meshes, proxy meshes, and textures, the byte offset and size of each of their records, and the vertex,
+//                  index, and compact vertex arrays of the mesh and proxy mesh geometry pools), the mesh section (mesh and proxy mesh records, with
+//                  the ranges of their geometry pool), the texture section (texture records), and the data section. The data section
+//                  holds the geometry pool, opacity state, and texel arrays, each aligned to CacheAlignment bytes. The other sections
+//                  locate their arrays with byte offsets and sizes in the data section.
+// The index array of a geometry pool holds the index buffers of its meshes (in mesh order, with 16 or 32-bit indices per primitive,
+// see IndexBuffers.h), they're widened to the pool's 32-bit indices once read.
+// The file is memory mapped: uncompressed texel, vertex, and compact vertex arrays are referenced in the mapping (textures and
+// geometry pools share ownership of it), like index arrays of 32-bit indices only. Index arrays with 16-bit index buffers are
+// copied out and widened to the pool's 32-bit indices, other arrays are copied out with a single copy each (large arrays in
+// chunks, in parallel). Mapped arrays are read-only, Unmap() copies them out before the file is replaced on Windows.
+// Mesh and texture records are decoded in parallel, while the calling thread decodes the scene section.
+//
+// Compressed caches (Scenes::Scene::cacheCompression) split each array into chunks of about CacheChunkSize bytes, filter
+// them (see EFilter), and compress them with Compression::Compress(). Each compressed array starts with its number of
+// chunks, the size of its chunks before compression, and the compressed size of each chunk (the high bit marks chunks
+// that are stored uncompressed), followed by the chunks. Arrays that don't shrink by at least 1/8 stay uncompressed, so
+// textures that don't compress (e.g. BC7 texels) still reference their texels in the mapping. Chunks are decompressed
+// in parallel once the mesh and texture records are decoded.
 
 namespace Caches
 {
+    static const uint64_t CacheAlignment = 64;
+    static const uint64_t CacheChunkSize = 256 * 1024;
+    static const uint32_t RawChunk = 0x80000000;
+
+    enum class ECodec : uint32_t
+    {
+        None = 0,       // The array's bytes
+        LZ,             // Compressed chunks of the filtered array
+    };
+
+    enum class EFilter : uint32_t
+    {
+        None = 0,
+        Shuffle,        // Compression::Shuffle() of the array's elements
+        DeltaShuffle,   // Compression::DeltaEncode() of the array's 32-bit values, then Compression::Shuffle()
+        Count
+    };
+
+    enum class ESection : uint32_t
+    {
+        Scene = 0,
+        Contents,
+        Meshes,
+        Textures,
+        Data,
+        Count
+    };
+
+    struct Header
+    {
+        uint32_t version = SCENE_CACHE_VERSION;     // First, so caches of earlier versions are detected
+        uint32_t coordinateSystem = COORDINATE_SYSTEM;
+        uint32_t numSections = static_cast<uint32_t>(ESection::Count);
+        uint32_t compressed = 0;                    // 1: arrays may be compressed
+    };
+
+    // Byte range of a section in the file, or of a mesh or texture record in its section
+    struct Section
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+    };
 
     //----------------------------------------------------------------------------------------------------------
-    // Private Deserialization Functions
+    // Private Mapping Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * Maps the file for reading, returns nullptr if it doesn't exist or can't be mapped.
+     */
+    std::shared_ptr<Mapping> Map(const std::string& filepath)
+    {
+        std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>();
+    #if defined(_WIN32) || defined(WIN32)
+        // Other processes can rename the file (Serialize() replaces the cache) while it's mapped
+        mapping->file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (mapping->file == INVALID_HANDLE_VALUE) return nullptr;
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(mapping->file, &size) || size.QuadPart == 0) return nullptr;
+        mapping->size = static_cast<uint64_t>(size.QuadPart);
+
+        mapping->mapping = CreateFileMappingA(mapping->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping->mapping == nullptr) return nullptr;
+
+        mapping->data = static_cast<const uint8_t*>(MapViewOfFile(mapping->mapping, FILE_MAP_READ, 0, 0, 0));
+        if (mapping->data == nullptr) return nullptr;
+    #else
+        int file = open(filepath.c_str(), O_RDONLY);
+        if (file < 0) return nullptr;
+
+        struct stat status;
+        if (fstat(file, &status) != 0 || status.st_size == 0)
+        {
+            close(file);
+            return nullptr;
+        }
+        mapping->size = static_cast<uint64_t>(status.st_size);
+
+        void* data = mmap(nullptr, mapping->size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED) return nullptr;
+
+        // Start reading the whole file ahead of the page faults
+        madvise(data, mapping->size, MADV_WILLNEED);
+        mapping->data = static_cast<const uint8_t*>(data);
+    #endif
+        return mapping;
+    }
+
+    Mapping::~Mapping()
+    {
+    #if defined(_WIN32) || defined(WIN32)
+        if (data) UnmapViewOfFile(data);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+    #else
+        if (data) munmap(const_cast<uint8_t*>(data), size);
+    #endif
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Hash Functions
     //----------------------------------------------------------------------------------------------------------
 
-    void Read(std::ifstream& in, uint32_t* value)
+    static const uint64_t HashPrime1 = 11400714785074694791ull;
+    static const uint64_t HashPrime2 = 14029467366897019727ull;
+    static const uint64_t HashPrime3 = 1609587929392839161ull;
+    static const uint64_t HashPrime4 = 9650029242287828579ull;
+    static const uint64_t HashPrime5 = 2870177450012600261ull;
+
+    inline uint64_t RotateLeft(uint64_t value, uint32_t bits)
     {
-        in.read((char*)value, sizeof(uint32_t));
-        in.seekg(in.tellg());
+        return (value << bits) | (value >> (64 - bits));
     }
 
-    void Read(std::ifstream& in, void* value, size_t size)
+    inline uint64_t HashRound(uint64_t accumulator, uint64_t value)
     {
-        in.read((char*)value, size);
-        in.seekg(in.tellg());
+        accumulator += value * HashPrime2;
+        return RotateLeft(accumulator, 31) * HashPrime1;
     }
 
-    void ReadTexture(std::ifstream& in, Textures::Texture& texture)
+    inline uint64_t HashMerge(uint64_t hash, uint64_t accumulator)
     {
-        // Texture name
-        uint32_t numChars;
-        Read(in, &numChars);
+        hash ^= HashRound(0, accumulator);
+        return (hash * HashPrime1) + HashPrime4;
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Deserialization Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * A compressed chunk of an array, decompressed after the records are decoded.
+     */
+    struct Chunk
+    {
+        const uint8_t* data = nullptr;
+        uint64_t size = 0;
+        bool compressed = false;
+        uint8_t* values = nullptr;          // The chunk's values in the array
+        uint64_t rawSize = 0;
+        EFilter filter = EFilter::None;
+        uint32_t stride = 1;
+    };
+
+    /**
+     * The location and encoding of an array in the data section.
+     */
+    struct ArrayInfo
+    {
+        const uint8_t* data = nullptr;
+        uint64_t size = 0;
+        uint64_t rawSize = 0;
+        ECodec codec = ECodec::None;
+        EFilter filter = EFilter::None;
+    };
 
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        texture.name = std::string(buffer);
-        delete[] buffer;
+    /**
+     * Reads a section of the mapped cache. Reads past the end of the section fail and zero their values,
+     * the reader stays invalid afterwards.
+     */
+    struct Reader
+    {
+        const uint8_t* data = nullptr;
+        uint64_t size = 0;
+        uint64_t position = 0;
+        const uint8_t* arrays = nullptr;        // The data section
+        uint64_t arraysSize = 0;
+        std::shared_ptr<const Mapping> mapping; // Shared by the textures and geometry pools that reference their arrays in the mapping
+        std::vector<Chunk>* chunks = nullptr;   // Compressed chunks of the arrays read
+        bool valid = true;
+    };
+
+    void Read(Reader& in, void* value, size_t size = sizeof(uint32_t))
+    {
+        if (!in.valid || size > (in.size - in.position))
+        {
+            in.valid = false;
+            memset(value, 0, size);
+            return;
+        }
+        memcpy(value, in.data + in.position, size);
+        in.position += size;
+    }
 
-        // Texture filepath
+    void ReadString(Reader& in, std::string& value)
+    {
+        uint32_t numChars = 0;
         Read(in, &numChars);
+        if (numChars > (in.size - in.position)) in.valid = false;
+        if (!in.valid) return;
+
+        value.assign(reinterpret_cast<const char*>(in.data + in.position), numChars);
+        in.position += numChars;
+    }
+
+    /**
+     * Reads a count of elements of at least the given size, counts larger than the rest of the section are invalid.
+     */
+    uint32_t ReadCount(Reader& in, size_t minimumSize)
+    {
+        uint32_t count = 0;
+        Read(in, &count);
+        if (static_cast<uint64_t>(count) * minimumSize > (in.size - in.position)) in.valid = false;
+        return in.valid ? count : 0;
+    }
+
+    /**
+     * Reads the location and encoding of an array in the data section.
+     */
+    ArrayInfo ReadArrayInfo(Reader& in)
+    {
+        ArrayInfo array;
+        uint64_t offset = 0;
+        Read(in, &offset, sizeof(uint64_t));
+        Read(in, &array.size, sizeof(uint64_t));
+        Read(in, &array.rawSize, sizeof(uint64_t));
+        Read(in, &array.codec, sizeof(ECodec));
+        Read(in, &array.filter, sizeof(EFilter));
+        if (offset > in.arraysSize || array.size > (in.arraysSize - offset)) in.valid = false;
+        if (array.codec == ECodec::None && array.size != array.rawSize) in.valid = false;
+        if (array.codec > ECodec::LZ || array.filter >= EFilter::Count) in.valid = false;
+        if (!in.valid) return ArrayInfo();
+
+        array.data = in.arrays + offset;
+        return array;
+    }
+
+    /**
+     * Copies an uncompressed array into the values, or adds the chunks of a compressed array to the reader's chunks.
+     * Uncompressed arrays larger than a chunk are added as uncompressed chunks, so they're copied in parallel.
+     */
+    void ReadArray(Reader& in, const ArrayInfo& array, uint32_t stride, uint8_t* values)
+    {
+        if (!in.valid || array.rawSize == 0) return;
+        if (array.codec == ECodec::None && array.rawSize <= CacheChunkSize)
+        {
+            memcpy(values, array.data, array.rawSize);
+            return;
+        }
+        if (array.codec == ECodec::None)
+        {
+            for (uint64_t offset = 0; offset < array.rawSize; offset += CacheChunkSize)
+            {
+                Chunk chunk;
+                chunk.data = array.data + offset;
+                chunk.size = std::min(CacheChunkSize, array.rawSize - offset);
+                chunk.values = values + offset;
+                chunk.rawSize = chunk.size;
+                in.chunks->push_back(chunk);
+            }
+            return;
+        }
+
+        // Chunk table
+        uint32_t header[2] = {};    // Number of chunks, chunk size
+        if (array.size >= sizeof(header)) memcpy(header, array.data, sizeof(header));
+        uint32_t numChunks = header[0];
+        uint64_t chunkSize = header[1];
+        uint64_t tableSize = sizeof(header) + (sizeof(uint32_t) * static_cast<uint64_t>(numChunks));
+        if (array.size < tableSize || chunkSize == 0 || (chunkSize % stride) != 0 || numChunks != (array.rawSize + chunkSize - 1) / chunkSize
+            || (array.filter == EFilter::DeltaShuffle && stride != sizeof(uint32_t)))
+        {
+            in.valid = false;
+            return;
+        }
+
+        const uint32_t* chunkSizes = reinterpret_cast<const uint32_t*>(array.data + sizeof(header));
+        uint64_t offset = tableSize;
+        for (uint32_t chunkIndex = 0; chunkIndex < numChunks; chunkIndex++)
+        {
+            Chunk chunk;
+            chunk.size = chunkSizes[chunkIndex] & ~RawChunk;
+            chunk.compressed = (chunkSizes[chunkIndex] & RawChunk) == 0;
+            chunk.values = values + (chunkIndex * chunkSize);
+            chunk.rawSize = std::min(chunkSize, array.rawSize - (chunkIndex * chunkSize));
+            chunk.filter = array.filter;
+            chunk.stride = stride;
+            if (chunk.size > (array.size - offset))
+            {
+                in.valid = false;
+                return;
+            }
+            chunk.data = array.data + offset;
+            offset += chunk.size;
+            in.chunks->push_back(chunk);
+        }
+    }
+
+    template<typename T>
+    void ReadArray(Reader& in, std::vector<T>& values)
+    {
+        ArrayInfo array = ReadArrayInfo(in);
+        if ((array.rawSize % sizeof(T)) != 0 || array.rawSize > (array.size * 256)) in.valid = false;  // Compression ratios are at most 255:1
+        if (!in.valid) return;
+
+        values.resize(array.rawSize / sizeof(T));
+        ReadArray(in, array, sizeof(T), reinterpret_cast<uint8_t*>(values.data()));
+    }
+
+    /**
+     * Decompresses a chunk, returns false if the chunk is invalid.
+     */
+    bool DecodeChunk(const Chunk& chunk, std::vector<uint8_t>& scratch)
+    {
+        // Filtered chunks are decompressed into the scratch memory first
+        uint8_t* filtered = chunk.values;
+        if (chunk.filter != EFilter::None)
+        {
+            scratch.resize(chunk.rawSize);
+            filtered = scratch.data();
+        }
+
+        if (chunk.compressed)
+        {
+            if (!Compression::Decompress(chunk.data, chunk.size, filtered, chunk.rawSize)) return false;
+        }
+        else
+        {
+            if (chunk.size != chunk.rawSize) return false;
+            memcpy(filtered, chunk.data, chunk.rawSize);
+        }
+
+        if (chunk.filter == EFilter::None) return true;
+        Compression::Unshuffle(filtered, chunk.rawSize, chunk.stride, chunk.values);
+        if (chunk.filter == EFilter::DeltaShuffle) Compression::DeltaDecode(reinterpret_cast<uint32_t*>(chunk.values), chunk.rawSize / sizeof(uint32_t));
+        return true;
+    }
 
-        buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        texture.filepath = std::string(buffer);
-        delete[] buffer;
+    void ReadTexture(Reader& in, Textures::Texture& texture)
+    {
+        ReadString(in, texture.name);
+        ReadString(in, texture.filepath);
 
         // Texture metadata
         Read(in, &texture.type, sizeof(Textures::ETextureType));
@@ -62,55 +398,128 @@ namespace Caches
         Read(in, &texture.stride);
         Read(in, &texture.mips);
         Read(in, &texture.texelBytes, sizeof(uint64_t));
+        Read(in, &texture.hash, sizeof(uint64_t));
 
-        texture.texels = new uint8_t[texture.texelBytes];
-        memset(texture.texels, 0, texture.texelBytes);
-        Read(in, texture.texels, texture.texelBytes);
-
+        // Uncompressed texels stay in the mapping
+        ArrayInfo array = ReadArrayInfo(in);
+        if (array.rawSize != texture.texelBytes || array.rawSize > (array.size * 256)) in.valid = false;
+        if (in.valid && array.codec == ECodec::None && array.rawSize > 0)
+        {
+            texture.texels = const_cast<uint8_t*>(array.data);
+            texture.owner = in.mapping;
+        }
+        else if (in.valid && array.rawSize > 0)
+        {
+            texture.texels = new uint8_t[array.rawSize];
+            ReadArray(in, array, 1, texture.texels);
+        }
         texture.cached = true;
     }
 
-    void ReadMaterial(std::ifstream& in, Scenes::Material& material)
+    void ReadMaterial(Reader& in, Scenes::Material& material)
     {
-        uint32_t numChars = 0;
-        Read(in, &numChars);
-
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        material.name = std::string(buffer);
-        delete[] buffer;
-
+        ReadString(in, material.name);
         Read(in, &material.data, material.GetGPUDataSize());
     }
 
-    void ReadMesh(std::ifstream& in, Scenes::Mesh& mesh)
+    /**
+     * Returns a read-only view of an uncompressed array in the mapping, which it keeps mapped.
+     */
+    template<typename T>
+    std::shared_ptr<T[]> ViewArray(const Reader& in, const ArrayInfo& array)
     {
-        uint32_t numChars = 0;
-        Read(in, &numChars);
+        return std::shared_ptr<T[]>(in.mapping, reinterpret_cast<T*>(const_cast<uint8_t*>(array.data)));
+    }
+
+    /**
+     * Reads the vertex, index, and compact vertex arrays of a geometry pool. Pools without compact vertices have an empty array.
+     * Uncompressed vertex and compact vertex arrays are viewed in the mapping, like an uncompressed index array of 32-bit indices
+     * only (the pool's indices as they are). Other index arrays (the meshes' index buffers) are read into the start of the pool's
+     * indices, which are widened once the meshes are read (see WidenIndices()). Returns the size of the index array in bytes.
+     */
+    uint64_t ReadGeometryPool(Reader& in, Scenes::GeometryPool& pool)
+    {
+        uint64_t numIndices = 0;
+        Read(in, &numIndices, sizeof(uint64_t));
+        ArrayInfo vertices = ReadArrayInfo(in);
+        ArrayInfo indices = ReadArrayInfo(in);
+        ArrayInfo compactVertices = ReadArrayInfo(in);
+        if ((vertices.rawSize % sizeof(Graphics::Vertex)) != 0 || vertices.rawSize > (vertices.size * 256)) in.valid = false;
+        if ((indices.rawSize % sizeof(uint32_t)) != 0 || indices.rawSize > (indices.size * 256)) in.valid = false;
+        if (indices.rawSize < (numIndices * sizeof(uint16_t)) || indices.rawSize > (numIndices * sizeof(uint32_t))) in.valid = false;
+        if (compactVertices.rawSize > (compactVertices.size * 256)) in.valid = false;
+        if (!in.valid) return 0;
+
+        pool.numVertices = vertices.rawSize / sizeof(Graphics::Vertex);
+        pool.numIndices = numIndices;
+        if (compactVertices.rawSize != 0 && compactVertices.rawSize != (pool.numVertices * sizeof(Quantization::CompactVertex)))
+        {
+            in.valid = false;
+            return 0;
+        }
+
+        if (vertices.codec == ECodec::None && vertices.rawSize > 0)
+        {
+            pool.vertices = ViewArray<Graphics::Vertex>(in, vertices);
+        }
+        else
+        {
+            pool.vertices.reset(new Graphics::Vertex[pool.numVertices]);
+            ReadArray(in, vertices, sizeof(Graphics::Vertex), reinterpret_cast<uint8_t*>(pool.vertices.get()));
+        }
+
+        if (indices.codec == ECodec::None && indices.rawSize > 0 && indices.rawSize == (pool.numIndices * sizeof(uint32_t)))
+        {
+            pool.indices = ViewArray<uint32_t>(in, indices);
+        }
+        else
+        {
+            pool.indices.reset(new uint32_t[pool.numIndices]);
+            ReadArray(in, indices, sizeof(uint32_t), reinterpret_cast<uint8_t*>(pool.indices.get()));
+        }
 
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        mesh.name = std::string(buffer);
-        delete[] buffer;
+        if (compactVertices.rawSize == 0) return indices.rawSize;
+        if (compactVertices.codec == ECodec::None)
+        {
+            pool.compactVertices = ViewArray<Quantization::CompactVertex>(in, compactVertices);
+        }
+        else
+        {
+            pool.compactVertices.reset(new Quantization::CompactVertex[pool.numVertices]);
+            ReadArray(in, compactVertices, sizeof(Quantization::CompactVertex), reinterpret_cast<uint8_t*>(pool.compactVertices.get()));
+        }
+        return indices.rawSize;
+    }
 
+    void ReadMesh(Reader& in, const std::shared_ptr<Scenes::GeometryPool>& pool, Scenes::Mesh& mesh)
+    {
+        ReadString(in, mesh.name);
         Read(in, &mesh.index, sizeof(uint32_t));
         Read(in, &mesh.numIndices, sizeof(uint32_t));
         Read(in, &mesh.numVertices, sizeof(uint32_t));
+        Read(in, &mesh.numOpacityStates, sizeof(uint32_t));
+        Read(in, &mesh.hash, sizeof(uint64_t));
 
         // Read mesh bounding box
         Read(in, &mesh.boundingBox, sizeof(rtxgi::AABB));
 
+        // Read the mesh's range of the geometry pool: vertex offset and count, index offset and count
+        uint64_t range[4] = {};
+        Read(in, range, sizeof(range));
+        if (range[0] > pool->numVertices || range[1] > (pool->numVertices - range[0])) in.valid = false;
+        if (range[2] > pool->numIndices || range[3] > (pool->numIndices - range[2])) in.valid = false;
+        if (!in.valid) return;
+
+        mesh.pool = pool;
+        mesh.vertices = { pool->vertices.get() + range[0], static_cast<size_t>(range[1]) };
+        mesh.indices = { pool->indices.get() + range[2], static_cast<size_t>(range[3]) };
+
         // Read MeshPrimitives
-        uint32_t numPrimitives;
-        Read(in, &numPrimitives);
+        uint64_t numVertices = 0, numIndices = 0;
+        uint32_t numPrimitives = ReadCount(in, sizeof(uint32_t));
         mesh.primitives.resize(numPrimitives);
         for (uint32_t primitiveIndex = 0; primitiveIndex < numPrimitives; primitiveIndex++)
         {
-            uint32_t numVertices = 0;
-            uint32_t numIndices = 0;
-
             Scenes::MeshPrimitive& mp = mesh.primitives[primitiveIndex];
 
             // Read the mesh primitive data
@@ -118,69 +527,137 @@ namespace Caches
             Read(in, &mp.material, sizeof(int));
             Read(in, &mp.opaque, sizeof(bool));
             Read(in, &mp.doubleSided, sizeof(bool));
-            Read(in, &mp.indexByteOffset, sizeof(uint32_t));
-            Read(in, &mp.vertexByteOffset, sizeof(uint32_t));
             Read(in, &mp.boundingBox, sizeof(rtxgi::AABB)); // post-transform bounding box
 
-            Read(in, &numVertices);
-            mp.vertices.resize(numVertices);
-            Read(in, mp.vertices.data(), sizeof(Graphics::Vertex) * numVertices);
+            // The primitive's vertices and indices follow the previous primitive's in the mesh's range
+            uint64_t counts[2] = {};
+            Read(in, counts, sizeof(counts));
+            if (counts[0] > (mesh.vertices.size() - numVertices) || counts[1] > (mesh.indices.size() - numIndices)) in.valid = false;
+            if (!in.valid) return;
 
-            Read(in, &numIndices);
-            mp.indices.resize(numIndices);
-            Read(in, mp.indices.data(), sizeof(uint32_t) * numIndices);
+            mp.vertices = { mesh.vertices.data() + numVertices, static_cast<size_t>(counts[0]) };
+            mp.indices = { mesh.indices.data() + numIndices, static_cast<size_t>(counts[1]) };
+            mp.vertexByteOffset = static_cast<uint32_t>(numVertices * sizeof(Graphics::Vertex));
+            numVertices += counts[0];
+            numIndices += counts[1];
 
-            // Update the mesh bounding box
-            mesh.boundingBox.min = { fmin(mesh.boundingBox.min.x, mp.boundingBox.min.x), fmin(mesh.boundingBox.min.y, mp.boundingBox.min.y) };
-            mesh.boundingBox.max = { fmax(mesh.boundingBox.max.x, mp.boundingBox.max.x), fmax(mesh.boundingBox.max.y, mp.boundingBox.max.y) };
+            Read(in, &mp.indexFormat, sizeof(uint32_t));
+            if (mp.indexFormat != Graphics::INDEX_FORMAT_32 && mp.indexFormat != Graphics::INDEX_FORMAT_16) in.valid = false;
+
+            Read(in, &mp.opacityByteOffset, sizeof(uint32_t));
+            ReadArray(in, mp.opacityStates);
         }
+        IndexBuffers::Layout(mesh);
     }
 
-    void ReadMeshInstance(std::ifstream& in, Scenes::MeshInstance& instance)
+    /**
+     * Returns true if the meshes' indices fill the geometry pool in mesh order, like the pools of Scenes::AllocateGeometry().
+     */
+    bool IsPacked(const std::vector<Scenes::Mesh>& meshes, const Scenes::GeometryPool* pool)
     {
-        uint32_t numChars = 0;
-        Read(in, &numChars);
+        // Without a pool, the meshes are packed if they have no indices
+        if (pool == nullptr) return std::all_of(meshes.begin(), meshes.end(), [](const Scenes::Mesh& mesh) { return mesh.indices.empty(); });
+
+        uint64_t numIndices = 0;
+        for (const Scenes::Mesh& mesh : meshes)
+        {
+            if (mesh.indices.empty()) continue;
+            if (mesh.indices.data() != pool->indices.get() + numIndices) return false;
+            numIndices += mesh.indices.size();
+        }
+        return (numIndices == pool->numIndices);
+    }
+
+    /**
+     * Gets the byte offsets of the meshes' index buffers in the index array of their geometry pool.
+     * Returns false if the meshes don't fill the pool in order, or their index buffers don't fill the array.
+     */
+    bool GetIndexBufferOffsets(const std::vector<Scenes::Mesh>& meshes, const Scenes::GeometryPool& pool, uint64_t size, std::vector<uint64_t>& offsets)
+    {
+        if (!IsPacked(meshes, &pool)) return false;
+
+        uint64_t offset = 0;
+        for (const Scenes::Mesh& mesh : meshes)
+        {
+            offsets.push_back(offset);
+            offset += IndexBuffers::GetSize(mesh);
+        }
+        return (offset == size);
+    }
+
+    /**
+     * Widens the index buffers at the start of the geometry pool's indices (see ReadGeometryPool()) to the primitives' 32-bit indices.
+     * An index buffer is never larger than its indices as 32-bit indices, so the primitives are widened in place from the last to the first.
+     * Index buffers of the size of the pool's indices hold 32-bit indices only and aren't changed (they may be viewed in the mapping).
+     * Returns false if such index buffers have primitives with 16-bit indices.
+     */
+    bool WidenIndices(const std::vector<Scenes::Mesh>& meshes, Scenes::GeometryPool& pool, const std::vector<uint64_t>& offsets, uint64_t size)
+    {
+        if (size == (pool.numIndices * sizeof(uint32_t)))
+        {
+            for (const Scenes::Mesh& mesh : meshes)
+            {
+                for (const Scenes::MeshPrimitive& mp : mesh.primitives)
+                {
+                    if (mp.indexFormat != Graphics::INDEX_FORMAT_32 && !mp.indices.empty()) return false;
+                }
+            }
+            return true;
+        }
 
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        instance.name = std::string(buffer);
-        delete[] buffer;
+        const uint8_t* buffers = reinterpret_cast<const uint8_t*>(pool.indices.get());
+        for (size_t meshIndex = meshes.size(); meshIndex-- > 0;)
+        {
+            const Scenes::Mesh& mesh = meshes[meshIndex];
+            for (size_t primitiveIndex = mesh.primitives.size(); primitiveIndex-- > 0;)
+            {
+                const Scenes::MeshPrimitive& mp = mesh.primitives[primitiveIndex];
+                const uint8_t* indices = buffers + offsets[meshIndex] + mp.indexByteOffset;
+                if (mp.indexFormat == Graphics::INDEX_FORMAT_32)
+                {
+                    if (!mp.indices.empty()) memmove(mp.indices.data(), indices, mp.indices.size() * sizeof(uint32_t));
+                    continue;
+                }
+                for (size_t index = mp.indices.size(); index-- > 0;)
+                {
+                    uint16_t value;
+                    memcpy(&value, indices + (index * sizeof(uint16_t)), sizeof(uint16_t));
+                    mp.indices[index] = value;
+                }
+            }
+        }
+        return true;
+    }
 
+    void ReadMeshInstance(Reader& in, Scenes::MeshInstance& instance)
+    {
+        ReadString(in, instance.name);
         Read(in, &instance.meshIndex, sizeof(int));
         Read(in, &instance.boundingBox, sizeof(rtxgi::AABB));
         Read(in, &instance.transform, sizeof(float) * 12);
     }
 
-    void ReadLight(std::ifstream& in, Scenes::Light& light)
+    void ReadLight(Reader& in, Scenes::Light& light)
     {
-        uint32_t numChars = 0;
-        Read(in, &numChars);
-
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        light.name = std::string(buffer);
-        delete[] buffer;
-
+        ReadString(in, light.name);
         Read(in, &light.data, light.GetGPUDataSize());
     }
 
-    void ReadCamera(std::ifstream& in, Scenes::Camera& camera)
+    void ReadCamera(Reader& in, Scenes::Camera& camera)
     {
-        uint32_t numChars = 0;
-        Read(in, &numChars);
-
-        char* buffer = new char[numChars];
-        in.read(buffer, numChars);
-        in.seekg(in.tellg());
-        camera.name = std::string(buffer);
-        delete[] buffer;
-
+        ReadString(in, camera.name);
         Read(in, &camera.data, camera.GetGPUDataSize());
     }
 
-    void ReadSceneNode(std::ifstream& in, Scenes::SceneNode& node)
+    void ReadSource(Reader& in, Scenes::SourceFile& source)
+    {
+        ReadString(in, source.uri);
+        Read(in, &source.size, sizeof(uint64_t));
+        Read(in, &source.time, sizeof(int64_t));
+        Read(in, &source.hash, sizeof(uint64_t));
+    }
+
+    void ReadSceneNode(Reader& in, Scenes::SceneNode& node)
     {
         Read(in, &node.instance, sizeof(int));
         Read(in, &node.camera, sizeof(int));
@@ -189,37 +666,198 @@ namespace Caches
         Read(in, &node.scale, sizeof(XMFLOAT3));
 
         // Read child node indices
-        uint32_t numChildren;
-        Read(in, &numChildren);
-        if (numChildren <= 0) return;
-
+        uint32_t numChildren = ReadCount(in, sizeof(int));
         node.children.resize(numChildren);
-        Read(in, node.children.data(), (sizeof(int) * numChildren));
+        if (numChildren > 0) Read(in, node.children.data(), (sizeof(int) * numChildren));
+    }
+
+    template<typename T, typename F>
+    void ReadElements(Reader& in, std::vector<T>& elements, F readElement)
+    {
+        uint32_t numElements = ReadCount(in, sizeof(uint32_t));
+        elements.resize(numElements);
+        for (uint32_t index = 0; index < numElements && in.valid; index++) readElement(in, elements[index]);
     }
 
     //----------------------------------------------------------------------------------------------------------
     // Private Serialization Functions
     //----------------------------------------------------------------------------------------------------------
 
-    void Write(std::ofstream& out, void* value, size_t size = sizeof(uint32_t))
+    /**
+     * A section of the cache in memory, and the arrays it references (stored in the data section when the cache is written).
+     */
+    struct Writer
+    {
+        std::vector<uint8_t> bytes;
+
+        struct Array
+        {
+            const uint8_t* data = nullptr;
+            uint64_t rawSize = 0;
+            EFilter filter = EFilter::None;
+            uint32_t stride = 1;
+            std::vector<uint8_t>* bytes = nullptr;  // The section that references the array
+            size_t position = 0;                    // Of the array's location in the section
+
+            ECodec codec = ECodec::None;
+            std::vector<uint8_t> encoded;           // Chunk table and chunks of compressed arrays
+            uint64_t offset = 0;
+        };
+        std::vector<Array>* arrays = nullptr;
+        std::vector<std::shared_ptr<const void>>* shared = nullptr; // Arrays the write copies or shares with the scene, kept until written
+    };
+
+    void Write(Writer& out, const void* value, size_t size = sizeof(uint32_t))
     {
-        out.write(reinterpret_cast<char*>(value), size);
-        out.seekp(out.tellp());
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(value);
+        out.bytes.insert(out.bytes.end(), bytes, bytes + size);
     }
 
-    void WriteTexture(std::ofstream& out, Textures::Texture& texture)
+    void WriteString(Writer& out, const std::string& value)
     {
-        // Texture name
-        uint32_t numChars = static_cast<uint32_t>(strlen(texture.name.c_str())) + 1;
+        uint32_t numChars = static_cast<uint32_t>(value.size());
         Write(out, &numChars);
-        out.write(texture.name.c_str(), numChars);
-        out.seekp(out.tellp());
+        Write(out, value.data(), numChars);
+    }
 
-        // Texture filepath
-        numChars = static_cast<uint32_t>(strlen(texture.filepath.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(texture.filepath.c_str(), numChars);
-        out.seekp(out.tellp());
+    /**
+     * Adds the array to the data section (the values are written by Serialize(), they aren't copied).
+     * Its location and encoding are written once the arrays are encoded and placed (see PlaceArrays()).
+     */
+    void WriteArray(Writer& out, const void* values, uint64_t size, EFilter filter, uint32_t stride)
+    {
+        Writer::Array array;
+        array.data = reinterpret_cast<const uint8_t*>(values);
+        array.rawSize = size;
+        array.filter = filter;
+        array.stride = stride;
+        array.bytes = &out.bytes;
+        array.position = out.bytes.size();
+        out.arrays->push_back(array);
+
+        const uint8_t location[32] = {};
+        Write(out, location, sizeof(location));
+    }
+
+    /**
+     * Filters and compresses a chunk of an array, chunks that don't compress are stored filtered and uncompressed.
+     */
+    void EncodeChunk(const Writer::Array& array, uint64_t offset, uint64_t size, std::vector<uint8_t>& scratch, std::vector<uint8_t>& chunk, bool& compressed)
+    {
+        const uint8_t* values = array.data + offset;
+        if (array.filter != EFilter::None)
+        {
+            scratch.resize(size * 2);
+            uint8_t* filtered = scratch.data();
+            if (array.filter == EFilter::DeltaShuffle)
+            {
+                uint8_t* deltas = scratch.data() + size;
+                memcpy(deltas, values, size);
+                Compression::DeltaEncode(reinterpret_cast<uint32_t*>(deltas), size / sizeof(uint32_t));
+                values = deltas;
+            }
+            Compression::Shuffle(values, size, array.stride, filtered);
+            values = filtered;
+        }
+
+        chunk.resize(Compression::GetMaxCompressedSize(size));
+        uint64_t compressedSize = Compression::Compress(values, size, chunk.data());
+        compressed = (compressedSize < size);
+        if (compressed) chunk.resize(compressedSize);
+        else chunk.assign(values, values + size);
+    }
+
+    /**
+     * Compresses the arrays, chunks are compressed by all hardware threads.
+     * Arrays that don't shrink by at least 1/8 stay uncompressed.
+     */
+    void EncodeArrays(std::vector<Writer::Array>& arrays)
+    {
+        struct Job { uint32_t array; uint64_t offset; uint64_t size; std::vector<uint8_t> chunk; bool compressed; };
+        std::vector<Job> jobs;
+        for (uint32_t arrayIndex = 0; arrayIndex < static_cast<uint32_t>(arrays.size()); arrayIndex++)
+        {
+            const Writer::Array& array = arrays[arrayIndex];
+            uint64_t chunkSize = (CacheChunkSize / array.stride) * array.stride;
+            for (uint64_t offset = 0; offset < array.rawSize; offset += chunkSize)
+            {
+                jobs.push_back({ arrayIndex, offset, std::min(chunkSize, array.rawSize - offset), {}, false });
+            }
+        }
+
+        uint32_t numJobs = static_cast<uint32_t>(jobs.size());
+        uint32_t numThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), std::max(numJobs, 1u));
+        std::atomic<uint32_t> next(0);
+        auto encode = [&]()
+        {
+            std::vector<uint8_t> scratch;
+            for (uint32_t index = next++; index < numJobs; index = next++)
+            {
+                Job& job = jobs[index];
+                EncodeChunk(arrays[job.array], job.offset, job.size, scratch, job.chunk, job.compressed);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 1; thread < numThreads; thread++) threads.emplace_back(encode);
+        encode();
+        for (std::thread& thread : threads) thread.join();
+
+        // Assemble the chunk tables and chunks of each array (the jobs are in array order)
+        for (uint32_t jobIndex = 0; jobIndex < numJobs;)
+        {
+            Writer::Array& array = arrays[jobs[jobIndex].array];
+            uint32_t end = jobIndex;
+            while (end < numJobs && jobs[end].array == jobs[jobIndex].array) end++;
+
+            uint32_t header[2] = { end - jobIndex, static_cast<uint32_t>(jobs[jobIndex].size) };
+            if (header[0] > 1) header[1] = static_cast<uint32_t>(jobs[jobIndex + 1].offset);
+            array.encoded.resize(sizeof(header) + (sizeof(uint32_t) * header[0]));
+            memcpy(array.encoded.data(), header, sizeof(header));
+            for (uint32_t index = jobIndex; index < end; index++)
+            {
+                uint32_t chunkSize = static_cast<uint32_t>(jobs[index].chunk.size()) | (jobs[index].compressed ? 0 : RawChunk);
+                memcpy(array.encoded.data() + sizeof(header) + (sizeof(uint32_t) * (index - jobIndex)), &chunkSize, sizeof(uint32_t));
+                array.encoded.insert(array.encoded.end(), jobs[index].chunk.begin(), jobs[index].chunk.end());
+                std::vector<uint8_t>().swap(jobs[index].chunk);
+            }
+
+            array.codec = ECodec::LZ;
+            if (array.encoded.size() > (array.rawSize - (array.rawSize / 8)))
+            {
+                array.codec = ECodec::None;
+                std::vector<uint8_t>().swap(array.encoded);
+            }
+            jobIndex = end;
+        }
+    }
+
+    /**
+     * Places the arrays in the data section and writes their locations and encodings, returns the size of the data section.
+     */
+    uint64_t PlaceArrays(std::vector<Writer::Array>& arrays)
+    {
+        uint64_t arraysSize = 0;
+        for (Writer::Array& array : arrays)
+        {
+            uint64_t size = (array.codec == ECodec::None) ? array.rawSize : array.encoded.size();
+            array.offset = (size > 0) ? ALIGN(CacheAlignment, arraysSize) : 0;
+            if (size > 0) arraysSize = array.offset + size;
+
+            uint8_t* location = array.bytes->data() + array.position;
+            memcpy(location, &array.offset, sizeof(uint64_t));
+            memcpy(location + 8, &size, sizeof(uint64_t));
+            memcpy(location + 16, &array.rawSize, sizeof(uint64_t));
+            memcpy(location + 24, &array.codec, sizeof(ECodec));
+            memcpy(location + 28, &array.filter, sizeof(EFilter));
+        }
+        return arraysSize;
+    }
+
+    void WriteTexture(Writer& out, const Textures::Texture& texture)
+    {
+        WriteString(out, texture.name);
+        WriteString(out, texture.filepath);
 
         // Texture metadata
         Write(out, &texture.type);
@@ -229,91 +867,94 @@ namespace Caches
         Write(out, &texture.stride);
         Write(out, &texture.mips);
         Write(out, &texture.texelBytes, sizeof(uint64_t));
+        Write(out, &texture.hash, sizeof(uint64_t));
 
         // Texels
-        Write(out, texture.texels, texture.texelBytes);
+        WriteArray(out, texture.texels, texture.texelBytes, EFilter::None, 1);
     }
 
-    void WriteMaterial(std::ofstream& out, Scenes::Material& material)
+    void WriteMaterial(Writer& out, const Scenes::Material& material)
     {
-        uint32_t numChars = static_cast<uint32_t>(strlen(material.name.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(material.name.c_str(), numChars);
-        out.seekp(out.tellp());
-
+        WriteString(out, material.name);
         Write(out, &material.data, material.GetGPUDataSize());
     }
 
-    void WriteMesh(std::ofstream& out, Scenes::Mesh& mesh)
+    void WriteMesh(Writer& out, const Scenes::Mesh& mesh)
     {
-        uint32_t numChars = static_cast<uint32_t>(strlen(mesh.name.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(mesh.name.c_str(), numChars);
-        out.seekp(out.tellp());
-
+        WriteString(out, mesh.name);
         Write(out, &mesh.index, sizeof(uint32_t));
         Write(out, &mesh.numIndices, sizeof(uint32_t));
         Write(out, &mesh.numVertices, sizeof(uint32_t));
+        Write(out, &mesh.numOpacityStates, sizeof(uint32_t));
+        Write(out, &mesh.hash, sizeof(uint64_t));
 
         // Mesh bounding box
         Write(out, &mesh.boundingBox, sizeof(rtxgi::AABB));
 
+        // The mesh's range of the geometry pool
+        uint64_t range[4] = { 0, mesh.vertices.size(), 0, mesh.indices.size() };
+        if (mesh.pool)
+        {
+            range[0] = static_cast<uint64_t>(mesh.vertices.data() - mesh.pool->vertices.get());
+            range[2] = static_cast<uint64_t>(mesh.indices.data() - mesh.pool->indices.get());
+        }
+        Write(out, range, sizeof(range));
+
+        // Copy the primitives' opacity states, the scene reclassifies them (see Opacity.h) while background writes run
+        std::shared_ptr<std::vector<uint32_t>> opacityStates = std::make_shared<std::vector<uint32_t>>();
+        for (const Scenes::MeshPrimitive& primitive : mesh.primitives) opacityStates->insert(opacityStates->end(), primitive.opacityStates.begin(), primitive.opacityStates.end());
+        if (!opacityStates->empty()) out.shared->push_back(opacityStates);
+
         // Write MeshPrimitives
         uint32_t numPrimitives = static_cast<uint32_t>(mesh.primitives.size());
         Write(out, &numPrimitives);
-        for (uint32_t primitiveIndex = 0; primitiveIndex < numPrimitives; primitiveIndex++)
+        const uint32_t* primitiveOpacityStates = opacityStates->data();
+        for (const Scenes::MeshPrimitive& primitive : mesh.primitives)
         {
-            Scenes::MeshPrimitive primitive = mesh.primitives[primitiveIndex];
-            uint32_t numVertices = static_cast<uint32_t>(primitive.vertices.size());
-            uint32_t numIndices = static_cast<uint32_t>(primitive.indices.size());
             Write(out, &primitive.index, sizeof(int));
             Write(out, &primitive.material, sizeof(int));
             Write(out, &primitive.opaque, sizeof(bool));
             Write(out, &primitive.doubleSided, sizeof(bool));
-            Write(out, &primitive.indexByteOffset, sizeof(uint32_t));
-            Write(out, &primitive.vertexByteOffset, sizeof(uint32_t));
             Write(out, &primitive.boundingBox, sizeof(rtxgi::AABB));
-            Write(out, &numVertices);
-            Write(out, primitive.vertices.data(), sizeof(Graphics::Vertex) * numVertices);
-            Write(out, &numIndices);
-            Write(out, primitive.indices.data(), sizeof(uint32_t) * numIndices);
-        }
 
+            uint64_t counts[2] = { primitive.vertices.size(), primitive.indices.size() };
+            Write(out, counts, sizeof(counts));
+            Write(out, &primitive.indexFormat, sizeof(uint32_t));
+            Write(out, &primitive.opacityByteOffset, sizeof(uint32_t));
+            WriteArray(out, primitiveOpacityStates, primitive.opacityStates.size() * sizeof(uint32_t), EFilter::None, sizeof(uint32_t));
+            primitiveOpacityStates += primitive.opacityStates.size();
+        }
     }
 
-    void WriteMeshInstance(std::ofstream& out, Scenes::MeshInstance& instance)
+    void WriteMeshInstance(Writer& out, const Scenes::MeshInstance& instance)
     {
-        uint32_t numChars = static_cast<uint32_t>(strlen(instance.name.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(instance.name.c_str(), numChars);
-        out.seekp(out.tellp());
-
+        WriteString(out, instance.name);
         Write(out, &instance.meshIndex, sizeof(int));
         Write(out, &instance.boundingBox, sizeof(rtxgi::AABB));
         Write(out, &instance.transform, sizeof(float) * 12);
     }
 
-    void WriteLight(std::ofstream& out, Scenes::Light& light)
+    void WriteLight(Writer& out, const Scenes::Light& light)
     {
-        uint32_t numChars = static_cast<uint32_t>(strlen(light.name.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(light.name.c_str(), numChars);
-        out.seekp(out.tellp());
-
+        WriteString(out, light.name);
         Write(out, &light.data, light.GetGPUDataSize());
     }
 
-    void WriteCamera(std::ofstream& out, Scenes::Camera& camera)
+    void WriteCamera(Writer& out, const Scenes::Camera& camera)
     {
-        uint32_t numChars = static_cast<uint32_t>(strlen(camera.name.c_str())) + 1;
-        Write(out, &numChars);
-        out.write(camera.name.c_str(), numChars);
-        out.seekp(out.tellp());
-
+        WriteString(out, camera.name);
         Write(out, &camera.data, camera.GetGPUDataSize());
     }
 
-    void WriteSceneNode(std::ofstream& out, Scenes::SceneNode& node)
+    void WriteSource(Writer& out, const Scenes::SourceFile& source)
+    {
+        WriteString(out, source.uri);
+        Write(out, &source.size, sizeof(uint64_t));
+        Write(out, &source.time, sizeof(int64_t));
+        Write(out, &source.hash, sizeof(uint64_t));
+    }
+
+    void WriteSceneNode(Writer& out, const Scenes::SceneNode& node)
     {
         Write(out, &node.instance, sizeof(int));
         Write(out, &node.camera, sizeof(int));
@@ -327,246 +968,960 @@ namespace Caches
         Write(out, node.children.data(), (sizeof(int) * numChildren));
     }
 
-    //----------------------------------------------------------------------------------------------------------
-    // Public Functions
-    //----------------------------------------------------------------------------------------------------------
+    template<typename T, typename F>
+    void WriteElements(Writer& out, const std::vector<T>& elements, F writeElement)
+    {
+        uint32_t numElements = static_cast<uint32_t>(elements.size());
+        Write(out, &numElements);
+        for (const T& element : elements) writeElement(out, element);
+    }
 
     /**
-     * Write the scene cache file to disk.
+     * Writes the elements as separate records and stores their byte ranges in the records.
      */
-    bool Serialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log)
+    template<typename T, typename F>
+    void WriteRecords(Writer& out, const std::vector<T>& elements, F writeElement, std::vector<Section>& records)
+    {
+        for (const T& element : elements)
+        {
+            Section record;
+            record.offset = out.bytes.size();
+            writeElement(out, element);
+            record.size = out.bytes.size() - record.offset;
+            records.push_back(record);
+        }
+    }
+
+    /**
+     * Returns the geometry pool of the meshes, null if they have no vertices and indices. Shared is false if the meshes have several pools.
+     */
+    const Scenes::GeometryPool* GetGeometryPool(const std::vector<Scenes::Mesh>& meshes, bool& shared)
     {
-        std::ofstream out;
-        out.open(filepath, std::ios::out | std::ios::binary);
-        if (out.is_open())
+        const Scenes::GeometryPool* pool = nullptr;
+        shared = true;
+        for (const Scenes::Mesh& mesh : meshes)
         {
-            log << "\n\tWriting scene cache file \'" + filepath + "\'...";
+            if (mesh.vertices.empty() && mesh.indices.empty()) continue;
+            if (pool != nullptr && mesh.pool.get() != pool) shared = false;
+            pool = mesh.pool.get();
+        }
+        return pool;
+    }
 
-            out.seekp(0, std::ios::beg);
+    /**
+     * Moves the meshes to one geometry pool if they have several (e.g. proxy meshes reused from the cache next to new ones),
+     * or don't fill their pool in order (e.g. the proxies of meshes removed from the scene).
+     */
+    void PackGeometry(std::vector<Scenes::Mesh>& meshes)
+    {
+        bool shared = true;
+        const Scenes::GeometryPool* pool = GetGeometryPool(meshes, shared);
+        if (!shared || !IsPacked(meshes, pool)) Scenes::AllocateGeometry(meshes.data(), meshes.size());
+    }
+
+    /**
+     * Writes the vertex, index, and compact vertex arrays of a geometry pool, meshes without geometry have no pool.
+     * The write shares the pool and its compact vertices (Quantization::Clear() releases them from the pool), and the index array
+     * holds a copy of the meshes' index buffers.
+     */
+    void WriteGeometryPool(Writer& out, const std::vector<Scenes::Mesh>& meshes)
+    {
+        bool shared = true;
+        const Scenes::GeometryPool* pool = GetGeometryPool(meshes, shared);
+        for (const Scenes::Mesh& mesh : meshes)
+        {
+            if (!pool || mesh.pool.get() != pool) continue;
+            out.shared->push_back(mesh.pool);
+            if (pool->compactVertices) out.shared->push_back(pool->compactVertices);
+            break;
+        }
+        uint64_t numVertices = pool ? pool->numVertices : 0;
+        uint64_t numIndices = pool ? pool->numIndices : 0;
+        uint64_t numCompactVertices = (pool && pool->compactVertices) ? numVertices : 0;
+
+        uint64_t indexBufferSize = 0;
+        for (const Scenes::Mesh& mesh : meshes) indexBufferSize += IndexBuffers::GetSize(mesh);
+        std::shared_ptr<uint8_t> indexBuffers(new uint8_t[indexBufferSize], std::default_delete<uint8_t[]>());
+        uint8_t* indexBuffer = indexBuffers.get();
+        for (const Scenes::Mesh& mesh : meshes)
+        {
+            IndexBuffers::Write(mesh, indexBuffer);
+            indexBuffer += IndexBuffers::GetSize(mesh);
+        }
+        out.shared->push_back(indexBuffers);
 
-            // Header
-            uint32_t cacheVersion = SCENE_CACHE_VERSION;
-            Write(out, &cacheVersion);
+        Write(out, &numIndices, sizeof(uint64_t));
+        WriteArray(out, pool ? pool->vertices.get() : nullptr, numVertices * sizeof(Graphics::Vertex), EFilter::Shuffle, sizeof(Graphics::Vertex));
+        WriteArray(out, indexBuffers.get(), indexBufferSize, EFilter::DeltaShuffle, sizeof(uint32_t));
+        WriteArray(out, pool ? pool->compactVertices.get() : nullptr, numCompactVertices * sizeof(Quantization::CompactVertex), EFilter::Shuffle, sizeof(Quantization::CompactVertex));
+    }
 
-            uint32_t coordinateSystem = COORDINATE_SYSTEM;
-            Write(out, &coordinateSystem);
+    /**
+     * Returns true if the bytes are in the mapping.
+     */
+    bool InMapping(const Mapping& mapping, const void* data)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        return (bytes != nullptr) && (bytes >= mapping.data) && (bytes < mapping.data + mapping.size);
+    }
 
-            Write(out, &scene.activeCamera);
-            Write(out, &scene.numMeshPrimitives);
-            Write(out, &scene.numTriangles);
-            Write(out, &scene.hasDirectionalLight);
-            Write(out, &scene.numPointLights);
-            Write(out, &scene.numSpotLights);
+    template<typename T>
+    void Rebase(Scenes::PoolView<T>& view, const T* from, T* to)
+    {
+        if (view.elements != nullptr) view.elements = to + (view.elements - from);
+    }
 
-            Write(out, &scene.boundingBox, sizeof(rtxgi::AABB));
+    /**
+     * Moves the meshes whose geometry pool views arrays in the mapping to pools with copies of the arrays.
+     */
+    void UnmapGeometry(std::vector<Scenes::Mesh>& meshes, const Mapping& mapping)
+    {
+        std::vector<std::pair<std::shared_ptr<Scenes::GeometryPool>, std::shared_ptr<Scenes::GeometryPool>>> pools;  // Mapped pool, copy
+        for (Scenes::Mesh& mesh : meshes)
+        {
+            if (!mesh.pool) continue;
+            std::shared_ptr<Scenes::GeometryPool> mapped = mesh.pool;
+            if (!InMapping(mapping, mapped->vertices.get()) && !InMapping(mapping, mapped->indices.get()) && !InMapping(mapping, mapped->compactVertices.get())) continue;
 
-            // Root Nodes
-            uint32_t numElements = static_cast<uint32_t>(scene.rootNodes.size());
-            Write(out, &numElements);
-            if (numElements > 0)
+            size_t poolIndex = 0;
+            while (poolIndex < pools.size() && pools[poolIndex].first != mapped) poolIndex++;
+            if (poolIndex == pools.size())
             {
-                Write(out, scene.rootNodes.data(), sizeof(int) * numElements);
+                std::shared_ptr<Scenes::GeometryPool> pool = std::make_shared<Scenes::GeometryPool>();
+                pool->numVertices = mapped->numVertices;
+                pool->numIndices = mapped->numIndices;
+                pool->vertices.reset(new Graphics::Vertex[pool->numVertices]);
+                pool->indices.reset(new uint32_t[pool->numIndices]);
+                if (pool->numVertices > 0) memcpy(pool->vertices.get(), mapped->vertices.get(), pool->numVertices * sizeof(Graphics::Vertex));
+                if (pool->numIndices > 0) memcpy(pool->indices.get(), mapped->indices.get(), pool->numIndices * sizeof(uint32_t));
+                if (mapped->compactVertices)
+                {
+                    pool->compactVertices.reset(new Quantization::CompactVertex[pool->numVertices]);
+                    if (pool->numVertices > 0) memcpy(pool->compactVertices.get(), mapped->compactVertices.get(), pool->numVertices * sizeof(Quantization::CompactVertex));
+                }
+                pools.emplace_back(mapped, pool);
             }
 
-            // Scene Nodes
-            numElements = static_cast<uint32_t>(scene.nodes.size());
-            Write(out, &numElements);
-            for (uint32_t nodeIndex = 0; nodeIndex < numElements; nodeIndex++)
+            const Scenes::GeometryPool& pool = *pools[poolIndex].second;
+            Rebase(mesh.vertices, mapped->vertices.get(), pool.vertices.get());
+            Rebase(mesh.indices, mapped->indices.get(), pool.indices.get());
+            for (Scenes::MeshPrimitive& mp : mesh.primitives)
             {
-                WriteSceneNode(out, scene.nodes[nodeIndex]);
+                Rebase(mp.vertices, mapped->vertices.get(), pool.vertices.get());
+                Rebase(mp.indices, mapped->indices.get(), pool.indices.get());
             }
+            mesh.pool = pools[poolIndex].second;
+        }
+    }
 
-            // Cameras
-            numElements = static_cast<uint32_t>(scene.cameras.size());
-            Write(out, &numElements);
-            for (uint32_t cameraIndex = 0; cameraIndex < numElements; cameraIndex++)
-            {
-                WriteCamera(out, scene.cameras[cameraIndex]);
-            }
+    /**
+     * Copies the texels of the scene's textures and the arrays of its geometry pools out of the cache file mapping and releases it.
+     */
+    void Unmap(Scenes::Scene& scene)
+    {
+        for (Textures::Texture& texture : scene.textures)
+        {
+            if (!texture.owner || texture.owner != scene.cacheMapping) continue;
 
-            // Lights
-            numElements = static_cast<uint32_t>(scene.lights.size());
-            Write(out, &numElements);
-            for (uint32_t lightIndex = 0; lightIndex < numElements; lightIndex++)
+            uint8_t* texels = new uint8_t[texture.texelBytes];
+            if (texture.texelBytes > 0) memcpy(texels, texture.texels, texture.texelBytes);
+            texture.texels = texels;
+            texture.owner.reset();
+        }
+        UnmapGeometry(scene.meshes, *scene.cacheMapping);
+        UnmapGeometry(scene.proxyMeshes, *scene.cacheMapping);
+        scene.cacheMapping.reset();
+    }
+
+    void WritePadding(std::ofstream& out, uint64_t& position, uint64_t alignment)
+    {
+        static const char zeros[CacheAlignment] = {};
+        uint64_t padding = ALIGN(alignment, position) - position;
+        out.write(zeros, static_cast<std::streamsize>(padding));
+        position += padding;
+    }
+
+
+    /**
+     * Creates an empty temporary file next to the cache file, named for this process and write. Several processes (e.g. distributed
+     * bake workers) can write the same cache, the file is created exclusively so each write has its own. Returns false if it fails.
+     */
+    bool CreateTemporaryFile(const std::string& filepath, std::string& temporary)
+    {
+        static std::atomic<uint32_t> counter(0);
+    #if defined(_WIN32) || defined(WIN32)
+        uint32_t process = static_cast<uint32_t>(GetCurrentProcessId());
+    #else
+        uint32_t process = static_cast<uint32_t>(getpid());
+    #endif
+        for (uint32_t attempt = 0; attempt < 16; attempt++)
+        {
+            temporary = filepath + "." + std::to_string(process) + "." + std::to_string(counter++) + ".tmp";
+        #if defined(_WIN32) || defined(WIN32)
+            HANDLE file = CreateFileA(temporary.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file != INVALID_HANDLE_VALUE)
             {
-                WriteLight(out, scene.lights[lightIndex]);
+                CloseHandle(file);
+                return true;
             }
-
-            // MeshInstances
-            numElements = static_cast<uint32_t>(scene.instances.size());
-            Write(out, &numElements);
-            for (uint32_t instanceIndex = 0; instanceIndex < numElements; instanceIndex++)
+            if (GetLastError() != ERROR_FILE_EXISTS) break;
+        #else
+            int file = open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0666);
+            if (file >= 0)
             {
-                WriteMeshInstance(out, scene.instances[instanceIndex]);
+                close(file);
+                return true;
             }
+            if (errno != EEXIST) break;
+        #endif
+        }
+        temporary.clear();
+        return false;
+    }
+
+    /**
+     * A scene cache file to write: its sections in memory and the arrays they reference.
+     */
+    struct Serialization
+    {
+        std::string filepath;
+        bool compressed = false;
+        Writer sections[static_cast<uint32_t>(ESection::Data)];
+        std::vector<Writer::Array> arrays;
+        std::vector<std::shared_ptr<const void>> shared;    // Texels, geometry pools, and copies of the scene's arrays the write reads
+
+        // Background writes
+        std::thread thread;
+        std::atomic<bool> done = { false };
+        bool written = false;
+        double milliseconds = 0.0;
+
+        ~Serialization()
+        {
+            if (thread.joinable()) thread.join();
+        }
+    };
+
+    /**
+     * Writes the scene's sections. The sections share the geometry pools with the scene, and copy the index buffers and opacity
+     * states. The meshes and proxy meshes must each share one geometry pool (see PackGeometry()).
+     */
+    void Prepare(const std::string& filepath, const Scenes::Scene& scene, Serialization& serialization)
+    {
+        serialization.filepath = filepath;
+        serialization.compressed = scene.cacheCompression;
+
+        Writer* sections = serialization.sections;
+        for (Writer& section : serialization.sections)
+        {
+            section.arrays = &serialization.arrays;
+            section.shared = &serialization.shared;
+        }
+
+        // Scene section
+        Writer& out = sections[static_cast<uint32_t>(ESection::Scene)];
+        Write(out, &scene.activeCamera);
+        Write(out, &scene.numMeshPrimitives);
+        Write(out, &scene.numTriangles);
+        Write(out, &scene.hasDirectionalLight);
+        Write(out, &scene.numPointLights);
+        Write(out, &scene.numSpotLights);
+        Write(out, &scene.numProxyTriangles);
+        Write(out, &scene.proxyRatio, sizeof(float));
+        Write(out, &scene.proxyMaxError, sizeof(float));
+        Write(out, &scene.opacityLevel, sizeof(int));
+        Write(out, &scene.boundingBox, sizeof(rtxgi::AABB));
+
+        uint32_t numRootNodes = static_cast<uint32_t>(scene.rootNodes.size());
+        Write(out, &numRootNodes);
+        Write(out, scene.rootNodes.data(), sizeof(int) * numRootNodes);
+
+        WriteElements(out, scene.nodes, WriteSceneNode);
+        WriteElements(out, scene.cameras, WriteCamera);
+        WriteElements(out, scene.lights, WriteLight);
+        WriteElements(out, scene.instances, WriteMeshInstance);
+        WriteElements(out, scene.materials, WriteMaterial);
+        WriteElements(out, scene.sources, WriteSource);
+
+        // Mesh, proxy mesh, and texture sections
+        std::vector<Section> records;
+        WriteRecords(sections[static_cast<uint32_t>(ESection::Meshes)], scene.meshes, WriteMesh, records);
+        WriteRecords(sections[static_cast<uint32_t>(ESection::Meshes)], scene.proxyMeshes, WriteMesh, records);
+        WriteRecords(sections[static_cast<uint32_t>(ESection::Textures)], scene.textures, WriteTexture, records);
+
+        // Contents section
+        Writer& contents = sections[static_cast<uint32_t>(ESection::Contents)];
+        uint32_t counts[3] = { static_cast<uint32_t>(scene.meshes.size()), static_cast<uint32_t>(scene.proxyMeshes.size()), static_cast<uint32_t>(scene.textures.size()) };
+        Write(contents, counts, sizeof(counts));
+        Write(contents, records.data(), sizeof(Section) * records.size());
+        WriteGeometryPool(contents, scene.meshes);
+        WriteGeometryPool(contents, scene.proxyMeshes);
+    }
+
+    /**
+     * Compresses and places the arrays, and writes the cache file to the filepath. Returns false if the file can't be written.
+     */
+    bool WriteFile(Serialization& serialization, const std::string& filepath)
+    {
+        std::vector<Writer::Array>& arrays = serialization.arrays;
+        const Writer* sections = serialization.sections;
+
+        // Compress the arrays and place them in the data section
+        if (serialization.compressed) EncodeArrays(arrays);
+        uint64_t arraysSize = PlaceArrays(arrays);
+
+        // Lay out the sections after the header and section table
+        Header header;
+        header.compressed = serialization.compressed ? 1 : 0;
+        Section table[static_cast<uint32_t>(ESection::Count)];
+        uint64_t position = sizeof(Header) + sizeof(table);
+        for (uint32_t sectionIndex = 0; sectionIndex < static_cast<uint32_t>(ESection::Data); sectionIndex++)
+        {
+            table[sectionIndex].offset = position;
+            table[sectionIndex].size = sections[sectionIndex].bytes.size();
+            position += table[sectionIndex].size;
+        }
+        table[static_cast<uint32_t>(ESection::Data)].offset = ALIGN(CacheAlignment, position);
+        table[static_cast<uint32_t>(ESection::Data)].size = arraysSize;
+
+        std::ofstream file;
+        file.open(filepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) return false;
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(table), sizeof(table));
+        for (uint32_t sectionIndex = 0; sectionIndex < static_cast<uint32_t>(ESection::Data); sectionIndex++)
+        {
+            file.write(reinterpret_cast<const char*>(sections[sectionIndex].bytes.data()), static_cast<std::streamsize>(sections[sectionIndex].bytes.size()));
+        }
+
+        // Data section
+        WritePadding(file, position, CacheAlignment);
+        uint64_t arraysPosition = 0;
+        for (const Writer::Array& array : arrays)
+        {
+            const uint8_t* data = (array.codec == ECodec::None) ? array.data : array.encoded.data();
+            uint64_t size = (array.codec == ECodec::None) ? array.rawSize : array.encoded.size();
+            if (size == 0) continue;
+
+            WritePadding(file, arraysPosition, CacheAlignment);
+            file.write(reinterpret_cast<const char*>(data), static_cast<std::streamsize>(size));
+            arraysPosition += size;
+        }
 
-            // Meshes
-            numElements = static_cast<uint32_t>(scene.meshes.size());
-            Write(out, &numElements);
-            for (uint32_t meshIndex = 0; meshIndex < numElements; meshIndex++)
+        bool written = file.good();
+        file.close();
+        return written;
+    }
+
+    /**
+     * Returns a reader of a record in the section, the reader is invalid if the record isn't in the section.
+     * The chunks of the record's compressed arrays are added to the chunks.
+     */
+    Reader GetRecordReader(const Reader& section, const Section& record, std::vector<Chunk>& chunks)
+    {
+        Reader in = section;
+        in.position = 0;
+        in.chunks = &chunks;
+        in.valid = (record.offset <= section.size) && (record.size <= (section.size - record.offset));
+        if (!in.valid) return in;
+
+        in.data = section.data + record.offset;
+        in.size = record.size;
+        return in;
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * Returns the 64-bit xxHash (XXH64) of the bytes. Four lanes consume 32-byte stripes, the tail is mixed in 8, 4, and 1 byte steps.
+     */
+    uint64_t Hash(const void* data, uint64_t size, uint64_t seed)
+    {
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+        const uint8_t* end = bytes + size;
+        uint64_t hash;
+        if (size >= 32)
+        {
+            uint64_t lanes[4] = { seed + HashPrime1 + HashPrime2, seed + HashPrime2, seed, seed - HashPrime1 };
+            for (; bytes + 32 <= end; bytes += 32)
             {
-                WriteMesh(out, scene.meshes[meshIndex]);
+                uint64_t values[4];
+                memcpy(values, bytes, sizeof(values));
+                for (uint32_t lane = 0; lane < 4; lane++) lanes[lane] = HashRound(lanes[lane], values[lane]);
             }
+            hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+            for (uint32_t lane = 0; lane < 4; lane++) hash = HashMerge(hash, lanes[lane]);
+        }
+        else
+        {
+            hash = seed + HashPrime5;
+        }
+        hash += size;
+
+        for (; bytes + 8 <= end; bytes += 8)
+        {
+            uint64_t value;
+            memcpy(&value, bytes, sizeof(uint64_t));
+            hash ^= HashRound(0, value);
+            hash = (RotateLeft(hash, 27) * HashPrime1) + HashPrime4;
+        }
+        if (bytes + 4 <= end)
+        {
+            uint32_t value;
+            memcpy(&value, bytes, sizeof(uint32_t));
+            hash ^= static_cast<uint64_t>(value) * HashPrime1;
+            hash = (RotateLeft(hash, 23) * HashPrime2) + HashPrime3;
+            bytes += 4;
+        }
+        for (; bytes < end; bytes++)
+        {
+            hash ^= (*bytes) * HashPrime5;
+            hash = RotateLeft(hash, 11) * HashPrime1;
+        }
 
-            // Materials
-            numElements = static_cast<uint32_t>(scene.materials.size());
-            Write(out, &numElements, sizeof(uint32_t));
-            for (uint32_t materialIndex = 0; materialIndex < numElements; materialIndex++)
+        // Avalanche
+        hash ^= hash >> 33;
+        hash *= HashPrime2;
+        hash ^= hash >> 29;
+        hash *= HashPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    /**
+     * Returns true if the scene's textures or geometry pools reference arrays in the mapping.
+     */
+    bool IsMapped(const Scenes::Scene& scene, const Mapping& mapping)
+    {
+        for (const Textures::Texture& texture : scene.textures)
+        {
+            if (InMapping(mapping, texture.texels)) return true;
+        }
+        for (const std::vector<Scenes::Mesh>* meshes : { &scene.meshes, &scene.proxyMeshes })
+        {
+            for (const Scenes::Mesh& mesh : *meshes)
             {
-                WriteMaterial(out, scene.materials[materialIndex]);
+                if (InMapping(mapping, mesh.vertices.data()) || InMapping(mapping, mesh.indices.data())) return true;
+                if (Quantization::IsCompact(mesh) && InMapping(mapping, Quantization::GetCompactVertices(mesh))) return true;
             }
+        }
+        return false;
+    }
+
+    /**
+     * Stats the source file and hashes its contents, unless its size and last write time didn't change.
+     */
+    bool UpdateSource(const std::string& directory, Scenes::SourceFile& source)
+    {
+        std::string filepath = directory + source.uri;
+        std::error_code error;
+        uint64_t size = static_cast<uint64_t>(std::filesystem::file_size(filepath, error));
+        if (error) return false;
+        int64_t time = static_cast<int64_t>(std::filesystem::last_write_time(filepath, error).time_since_epoch().count());
+        if (error) return false;
+        if (source.hash != 0 && source.size == size && source.time == time) return true;
+
+        // Empty files aren't mapped
+        std::shared_ptr<Mapping> mapping = Map(filepath);
+        if (!mapping && size > 0) return false;
+
+        source.size = mapping ? mapping->size : 0;
+        source.time = time;
+        source.hash = mapping ? Hash(mapping->data, mapping->size) : Hash(nullptr, 0);
+        return true;
+    }
+
+    /**
+     * Write the scene cache file to disk.
+     * The cache is written to a temporary file of its own (see CreateTemporaryFile()) that replaces the cache file once complete,
+     * so a mapped cache (of the scene being serialized) stays valid and an interrupted write doesn't leave a broken cache behind.
+     */
+    bool Serialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log)
+    {
+        log << "\n\tWriting scene cache file \'" + filepath + "\'...";
+
+        PackGeometry(scene.meshes);
+        PackGeometry(scene.proxyMeshes);
+
+        Serialization serialization;
+        Prepare(filepath, scene, serialization);
+
+        std::string temporary;
+        bool created = CreateTemporaryFile(filepath, temporary);
+        bool written = created && WriteFile(serialization, temporary);
 
-            // Textures
-            numElements = static_cast<uint32_t>(scene.textures.size());
-            Write(out, &numElements, sizeof(uint32_t));
-            for (uint32_t textureIndex = 0; textureIndex < numElements; textureIndex++)
+        std::error_code error;
+        if (written) std::filesystem::rename(temporary, filepath, error);
+        if (written && error && scene.cacheMapping)
+        {
+            // Windows doesn't replace files with mapped views, release the mapping (of the cache being replaced) and retry
+            Unmap(scene);
+            error.clear();
+            std::filesystem::rename(temporary, filepath, error);
+        }
+        if (!written || error)
+        {
+            if (created) std::filesystem::remove(temporary, error);
+            log << "\nFailed to write cache file \'" + filepath + "\'";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Write the scene cache file to disk on a background thread, like Serialize().
+     * The write shares the texels of the scene's textures (textures that own their texels now share them with the write)
+     * and the geometry pools, and copies the rest of the meshes (see Prepare()), so it never reads the scene: textures can
+     * be unloaded and meshes updated while it runs. Scenes::Cleanup() waits for the write.
+     */
+    void SerializeAsync(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log)
+    {
+        log << "\n\tWriting scene cache file \'" + filepath + "\' in the background";
+
+        // A write in progress writes the same file
+        scene.cacheWrite.reset();
+
+    #if defined(_WIN32) || defined(WIN32)
+        // Windows doesn't replace files with mapped views, copy the texels out of the mapping (of the cache being replaced)
+        if (scene.cacheMapping) Unmap(scene);
+    #endif
+
+        PackGeometry(scene.meshes);
+        PackGeometry(scene.proxyMeshes);
+
+        std::shared_ptr<Serialization> serialization = std::make_shared<Serialization>();
+        Prepare(filepath, scene, *serialization);
+        for (Textures::Texture& texture : scene.textures)
+        {
+            if (texture.texels == nullptr) continue;
+            if (!texture.owner) texture.owner = std::shared_ptr<uint8_t>(texture.texels, std::default_delete<uint8_t[]>());
+            serialization->shared.push_back(texture.owner);
+        }
+
+        Serialization& write = *serialization;
+        write.thread = std::thread([&write]()
+        {
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+            std::string temporary;
+            bool created = CreateTemporaryFile(write.filepath, temporary);
+            std::error_code error;
+            write.written = created && WriteFile(write, temporary);
+            if (write.written) std::filesystem::rename(temporary, write.filepath, error);
+            if (!write.written || error)
             {
-                WriteTexture(out, scene.textures[textureIndex]);
+                if (created) std::filesystem::remove(temporary, error);
+                write.written = false;
             }
 
-            out.close();
-            return true;
-        }
+            // The texels, geometry pools, and encoded arrays aren't needed anymore
+            std::vector<std::shared_ptr<const void>>().swap(write.shared);
+            std::vector<Writer::Array>().swap(write.arrays);
 
-        log << "\nFailed to write cache file \'" + filepath + "\'";
-        return false;
+            write.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            write.done = true;
+        });
+        scene.cacheWrite = serialization;
+    }
+
+    /**
+     * Logs the result of the scene's background cache write once it completes, and releases it.
+     * Returns true if the scene has no write in progress (anymore).
+     */
+    bool FinishSerialize(Scenes::Scene& scene, std::ofstream& log, bool wait)
+    {
+        if (!scene.cacheWrite) return true;
+        if (!wait && !scene.cacheWrite->done) return false;
+        if (scene.cacheWrite->thread.joinable()) scene.cacheWrite->thread.join();
+
+        const Serialization& write = *scene.cacheWrite;
+        if (write.written) log << "\n\tWrote scene cache file \'" << write.filepath << "\' in " << write.milliseconds << " ms\n";
+        else log << "\n\tFailed to write cache file \'" << write.filepath << "\'\n";
+        std::flush(log);
+
+        scene.cacheWrite.reset();
+        return true;
     }
 
     /**
      * Read the scene cache file from disk.
+     * Mesh and texture records, then compressed chunks, are decoded by numThreads threads (0: all hardware threads), including the calling thread.
      */
-    bool Deserialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log)
+    bool Deserialize(const std::string& filepath, Scenes::Scene& scene, std::ofstream& log, uint32_t numThreads)
     {
-        std::ifstream in;
-        in.open(filepath, std::ios::in | std::ios::binary);
-        if (in.is_open())
+        std::shared_ptr<Mapping> mapping = Map(filepath);
+        if (!mapping)
         {
-            in.seekg(0, std::ios::beg);
+            log << "\n\tWarning: no scene cache file exists!";
+            return false;
+        }
 
-            // Header
-            uint32_t cacheVersion;
-            Read(in, &cacheVersion, sizeof(uint32_t));
-            if(cacheVersion != SCENE_CACHE_VERSION)
-            {
-                log << "\n\tWarning: scene cache version '" << cacheVersion << "' does not match expected version '" << SCENE_CACHE_VERSION << "'";
-                log << "\n\tRebuilding scene cache...";
-                return false;
-            }
+        // Header
+        Header header;
+        if (mapping->size >= sizeof(uint32_t)) memcpy(&header.version, mapping->data, sizeof(uint32_t));
+        if (mapping->size < sizeof(Header) || header.version != SCENE_CACHE_VERSION)
+        {
+            log << "\n\tWarning: scene cache version '" << header.version << "' does not match expected version '" << SCENE_CACHE_VERSION << "'";
+            log << "\n\tRebuilding scene cache...";
+            return false;
+        }
+        memcpy(&header, mapping->data, sizeof(Header));
+
+        if (header.coordinateSystem != COORDINATE_SYSTEM)
+        {
+            log << "\n\tWarning: scene cache coordinate system '" << GetCoordinateSystemName(header.coordinateSystem);
+            log << "' does not match current coordinate system '" << GetCoordinateSystemName(COORDINATE_SYSTEM) << "'";
+            log << "\n\tRebuilding scene cache...";
+            return false;
+        }
+
+        // Section table
+        Section table[static_cast<uint32_t>(ESection::Count)];
+        bool valid = (header.numSections == static_cast<uint32_t>(ESection::Count)) && (mapping->size >= sizeof(Header) + sizeof(table));
+        if (valid) memcpy(table, mapping->data + sizeof(Header), sizeof(table));
+        for (uint32_t sectionIndex = 0; valid && sectionIndex < static_cast<uint32_t>(ESection::Count); sectionIndex++)
+        {
+            valid = (table[sectionIndex].offset <= mapping->size) && (table[sectionIndex].size <= (mapping->size - table[sectionIndex].offset));
+        }
 
-            uint32_t coordinateSystem;
-            Read(in, &coordinateSystem, sizeof(uint32_t));
-            if(coordinateSystem != COORDINATE_SYSTEM)
+        Reader sections[static_cast<uint32_t>(ESection::Data)];
+        for (uint32_t sectionIndex = 0; valid && sectionIndex < static_cast<uint32_t>(ESection::Data); sectionIndex++)
+        {
+            sections[sectionIndex].data = mapping->data + table[sectionIndex].offset;
+            sections[sectionIndex].size = table[sectionIndex].size;
+            sections[sectionIndex].arrays = mapping->data + table[static_cast<uint32_t>(ESection::Data)].offset;
+            sections[sectionIndex].arraysSize = table[static_cast<uint32_t>(ESection::Data)].size;
+            sections[sectionIndex].mapping = mapping;
+        }
+
+        // Contents
+        std::vector<Section> records;
+        uint32_t numMeshes = 0, numProxyMeshes = 0, numTextures = 0;
+        std::shared_ptr<Scenes::GeometryPool> meshPool = std::make_shared<Scenes::GeometryPool>();
+        std::shared_ptr<Scenes::GeometryPool> proxyPool = std::make_shared<Scenes::GeometryPool>();
+        std::vector<Chunk> poolChunks;
+        uint64_t meshIndexBytes = 0, proxyIndexBytes = 0;
+        if (valid)
+        {
+            Reader& in = sections[static_cast<uint32_t>(ESection::Contents)];
+            numMeshes = ReadCount(in, sizeof(Section));
+            numProxyMeshes = ReadCount(in, sizeof(Section));
+            numTextures = ReadCount(in, sizeof(Section));
+
+            records.resize(static_cast<size_t>(numMeshes) + numProxyMeshes + numTextures);
+            if (in.valid && (sizeof(Section) * records.size()) <= (in.size - in.position)) Read(in, records.data(), sizeof(Section) * records.size());
+            else in.valid = false;
+
+            // Geometry pools of the meshes and proxy meshes
+            in.chunks = &poolChunks;
+            meshIndexBytes = ReadGeometryPool(in, *meshPool);
+            proxyIndexBytes = ReadGeometryPool(in, *proxyPool);
+
+            valid = in.valid;
+        }
+
+        if (valid)
+        {
+            scene.meshes.resize(numMeshes);
+            scene.proxyMeshes.resize(numProxyMeshes);
+            scene.textures.resize(numTextures);
+
+            // Decode the largest records first to balance the threads
+            uint32_t numRecords = static_cast<uint32_t>(records.size());
+            std::vector<uint32_t> order(numRecords);
+            for (uint32_t recordIndex = 0; recordIndex < numRecords; recordIndex++) order[recordIndex] = recordIndex;
+            std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return records[a].size > records[b].size; });
+
+            numThreads = (numThreads == 0) ? std::max(std::thread::hardware_concurrency(), 1u) : numThreads;
+            uint32_t numRecordThreads = std::min(numThreads, std::max(numRecords, 1u));
+
+            std::vector<std::vector<Chunk>> threadChunks(numRecordThreads);
+            std::atomic<uint32_t> next(0);
+            std::atomic<bool> decoded(true);
+            auto decode = [&](uint32_t threadIndex)
             {
-                log << "\n\tWarning: scene cache coordinate system '" << GetCoordinateSystemName(coordinateSystem);
-                log << "' does not match current coordinate system '" << GetCoordinateSystemName(COORDINATE_SYSTEM) << "'";
-                log << "\n\tRebuilding scene cache...";
-                return false;
-            }
+                for (uint32_t index = next++; index < numRecords; index = next++)
+                {
+                    uint32_t recordIndex = order[index];
+                    Reader in;
+                    if (recordIndex < numMeshes)
+                    {
+                        in = GetRecordReader(sections[static_cast<uint32_t>(ESection::Meshes)], records[recordIndex], threadChunks[threadIndex]);
+                        if (in.valid) ReadMesh(in, meshPool, scene.meshes[recordIndex]);
+                    }
+                    else if (recordIndex < (numMeshes + numProxyMeshes))
+                    {
+                        in = GetRecordReader(sections[static_cast<uint32_t>(ESection::Meshes)], records[recordIndex], threadChunks[threadIndex]);
+                        if (in.valid) ReadMesh(in, proxyPool, scene.proxyMeshes[recordIndex - numMeshes]);
+                    }
+                    else
+                    {
+                        in = GetRecordReader(sections[static_cast<uint32_t>(ESection::Textures)], records[recordIndex], threadChunks[threadIndex]);
+                        if (in.valid) ReadTexture(in, scene.textures[recordIndex - numMeshes - numProxyMeshes]);
+                    }
+                    if (!in.valid || in.position != in.size) decoded = false;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for (uint32_t thread = 1; thread < numRecordThreads; thread++) threads.emplace_back(decode, thread);
 
+            // Scene section
+            Reader& in = sections[static_cast<uint32_t>(ESection::Scene)];
             Read(in, &scene.activeCamera);
             Read(in, &scene.numMeshPrimitives);
             Read(in, &scene.numTriangles);
             Read(in, &scene.hasDirectionalLight);
             Read(in, &scene.numPointLights);
             Read(in, &scene.numSpotLights);
-
+            Read(in, &scene.numProxyTriangles);
+            Read(in, &scene.proxyRatio, sizeof(float));
+            Read(in, &scene.proxyMaxError, sizeof(float));
+            Read(in, &scene.opacityLevel, sizeof(int));
             Read(in, &scene.boundingBox, sizeof(rtxgi::AABB));
 
-            uint32_t numElements = 0;
-
-            // Root Nodes
-            Read(in, &numElements);
-            if (numElements > 0)
+            uint32_t numRootNodes = ReadCount(in, sizeof(int));
+            scene.rootNodes.resize(numRootNodes);
+            if (numRootNodes > 0) Read(in, scene.rootNodes.data(), sizeof(int) * numRootNodes);
+
+            ReadElements(in, scene.nodes, ReadSceneNode);
+            ReadElements(in, scene.cameras, ReadCamera);
+            ReadElements(in, scene.lights, ReadLight);
+            ReadElements(in, scene.instances, ReadMeshInstance);
+            ReadElements(in, scene.materials, ReadMaterial);
+            ReadElements(in, scene.sources, ReadSource);
+
+            // Help decode the meshes and textures
+            decode(0);
+            for (std::thread& thread : threads) thread.join();
+            threads.clear();
+
+            // Locate the meshes' index buffers in the index arrays
+            std::vector<uint64_t> meshIndexOffsets, proxyIndexOffsets;
+            if (decoded)
             {
-                scene.rootNodes.resize(numElements);
-                Read(in, reinterpret_cast<char*>(scene.rootNodes.data()), sizeof(int) * numElements);
+                decoded = GetIndexBufferOffsets(scene.meshes, *meshPool, meshIndexBytes, meshIndexOffsets)
+                    && GetIndexBufferOffsets(scene.proxyMeshes, *proxyPool, proxyIndexBytes, proxyIndexOffsets);
             }
 
-            // Scene Nodes
-            Read(in, &numElements);
-            if (numElements > 0)
+            // Decompress the chunks of the compressed arrays, and copy the chunks of large uncompressed arrays
+            std::vector<Chunk> chunks = poolChunks;
+            for (std::vector<Chunk>& list : threadChunks) chunks.insert(chunks.end(), list.begin(), list.end());
+
+            uint32_t numChunks = static_cast<uint32_t>(chunks.size());
+            uint32_t numChunkThreads = std::min(numThreads, std::max(numChunks, 1u));
+            next = 0;
+            auto decompress = [&]()
             {
-                scene.nodes.resize(numElements);
-                for (uint32_t nodeIndex = 0; nodeIndex < numElements; nodeIndex++)
+                std::vector<uint8_t> scratch;
+                for (uint32_t index = next++; index < numChunks; index = next++)
                 {
-                    ReadSceneNode(in, scene.nodes[nodeIndex]);
+                    if (!DecodeChunk(chunks[index], scratch)) decoded = false;
                 }
-            }
+            };
 
-            // Cameras
-            Read(in, &numElements);
-            if (numElements > 0)
+            if (decoded)
             {
-                scene.cameras.resize(numElements);
-                for (uint32_t cameraIndex = 0; cameraIndex < numElements; cameraIndex++)
-                {
-                    ReadCamera(in, scene.cameras[cameraIndex]);
-                }
+                for (uint32_t thread = 1; thread < numChunkThreads; thread++) threads.emplace_back(decompress);
+                decompress();
+                for (std::thread& thread : threads) thread.join();
             }
 
-            // Lights
-            Read(in, &numElements);
-            if (numElements > 0)
+            valid = in.valid && decoded;
+            scene.cacheCompression = (header.compressed != 0);
+
+            if (valid)
             {
-                scene.lights.resize(numElements);
-                for (uint32_t lightIndex = 0; lightIndex < numElements; lightIndex++)
-                {
-                    ReadLight(in, scene.lights[lightIndex]);
-                }
+                valid = WidenIndices(scene.meshes, *meshPool, meshIndexOffsets, meshIndexBytes)
+                    && WidenIndices(scene.proxyMeshes, *proxyPool, proxyIndexOffsets, proxyIndexBytes);
             }
+        }
+
+        if (!valid)
+        {
+            // Discard the partially read scene (and the texels it decompressed)
+            Scenes::Cleanup(scene);
+            std::string name = scene.name;
+            scene = Scenes::Scene();
+            scene.name = name;
+
+            log << "\n\tWarning: scene cache file \'" << filepath << "\' is invalid";
+            log << "\n\tRebuilding scene cache...";
+            return false;
+        }
+
+        scene.cacheMapping = mapping;
+        return true;
+    }
 
-            // MeshInstances
-            Read(in, &numElements);
-            if (numElements > 0)
+    /**
+     * Returns true if the loaded cache has the scene's meshes and textures.
+     */
+    bool IsEqual(const Scenes::Scene& scene, const Scenes::Scene& cached)
+    {
+        bool equal = (cached.meshes.size() == scene.meshes.size()) && (cached.textures.size() == scene.textures.size());
+        for (size_t meshIndex = 0; equal && meshIndex < scene.meshes.size(); meshIndex++)
+        {
+            const Scenes::Mesh& mesh = scene.meshes[meshIndex];
+            equal = (cached.meshes[meshIndex].primitives.size() == mesh.primitives.size());
+            for (size_t primitiveIndex = 0; equal && primitiveIndex < mesh.primitives.size(); primitiveIndex++)
             {
-                scene.instances.resize(numElements);
-                for (uint32_t instanceIndex = 0; instanceIndex < numElements; instanceIndex++)
-                {
-                    ReadMeshInstance(in, scene.instances[instanceIndex]);
-                }
+                const Scenes::MeshPrimitive& a = mesh.primitives[primitiveIndex];
+                const Scenes::MeshPrimitive& b = cached.meshes[meshIndex].primitives[primitiveIndex];
+                equal = (a.vertices.size() == b.vertices.size()) && (a.indices.size() == b.indices.size()) && (a.opacityStates == b.opacityStates)
+                    && (a.indexFormat == b.indexFormat) && (a.indexByteOffset == b.indexByteOffset)
+                    && (memcmp(a.vertices.data(), b.vertices.data(), sizeof(Graphics::Vertex) * a.vertices.size()) == 0)
+                    && (memcmp(a.indices.data(), b.indices.data(), sizeof(uint32_t) * a.indices.size()) == 0);
+            }
+            if (equal && (Quantization::IsCompact(mesh) != Quantization::IsCompact(cached.meshes[meshIndex]))) equal = false;
+            if (equal && Quantization::IsCompact(mesh))
+            {
+                const Quantization::CompactVertex* a = Quantization::GetCompactVertices(mesh);
+                const Quantization::CompactVertex* b = Quantization::GetCompactVertices(cached.meshes[meshIndex]);
+                equal = (memcmp(a, b, sizeof(Quantization::CompactVertex) * mesh.vertices.size()) == 0);
             }
+        }
+        for (size_t textureIndex = 0; equal && textureIndex < scene.textures.size(); textureIndex++)
+        {
+            const Textures::Texture& a = scene.textures[textureIndex];
+            const Textures::Texture& b = cached.textures[textureIndex];
+            equal = (a.texelBytes == b.texelBytes) && (a.texelBytes == 0 || memcmp(a.texels, b.texels, a.texelBytes) == 0);
+        }
+        return equal;
+    }
+
+    uint32_t TouchBytes(const void* data, uint64_t size)
+    {
+        uint32_t sum = 0;
+        for (uint64_t offset = 0; offset < size; offset += 4096) sum += static_cast<const uint8_t*>(data)[offset];
+        return sum;
+    }
 
-            // Meshes
-            Read(in, &numElements);
-            if (numElements > 0)
+    /**
+     * Reads a byte of each page of the textures' texels and the meshes' geometry, which reads mapped arrays from the file
+     * (like the texture and geometry uploads).
+     */
+    uint32_t TouchArrays(const Scenes::Scene& scene)
+    {
+        uint32_t sum = 0;
+        for (const Textures::Texture& texture : scene.textures) sum += TouchBytes(texture.texels, texture.texelBytes);
+        for (const std::vector<Scenes::Mesh>* meshes : { &scene.meshes, &scene.proxyMeshes })
+        {
+            for (const Scenes::Mesh& mesh : *meshes)
             {
-                scene.meshes.resize(numElements);
-                for (uint32_t meshIndex = 0; meshIndex < numElements; meshIndex++)
-                {
-                    ReadMesh(in, scene.meshes[meshIndex]);
-                }
+                sum += TouchBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(Graphics::Vertex));
+                sum += TouchBytes(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+                if (Quantization::IsCompact(mesh)) sum += TouchBytes(Quantization::GetCompactVertices(mesh), mesh.vertices.size() * sizeof(Quantization::CompactVertex));
             }
+        }
+        return sum;
+    }
+
+    /**
+     * Removes the file from the page cache (when supported), so the next load reads it from the disk.
+     */
+    bool EvictFile(const std::string& filepath)
+    {
+    #if __linux__
+        int file = open(filepath.c_str(), O_RDONLY);
+        if (file < 0) return false;
+        fsync(file);    // Dirty pages aren't evicted
+        bool evicted = (posix_fadvise(file, 0, 0, POSIX_FADV_DONTNEED) == 0);
+        close(file);
+        return evicted;
+    #else
+        return false;
+    #endif
+    }
+
+    /**
+     * Writes the scene to temporary cache files, uncompressed and compressed, and measures loading them with 1 to all
+     * hardware threads from the page cache (warm) and, where the page cache can be cleared, from the disk (cold).
+     * Load times include reading the texels and geometry (mapped arrays are read from the file on first access).
+     * Checks the loaded meshes and textures against the scene and writes the results to the log.
+     */
+    bool Benchmark(Scenes::Scene& scene, std::ofstream& log)
+    {
+        std::error_code error;
+        std::filesystem::path directory = std::filesystem::temp_directory_path(error);
+        if (error)
+        {
+            log << "\n\tNo temporary directory for the scene cache!";
+            return false;
+        }
+        std::string filepath = (directory / "scene-cache-benchmark.cache").string();
+        std::ofstream cacheLog;    // Discards the cache messages
+
+        log << "\n\tScene: " << scene.meshes.size() << " meshes, " << scene.proxyMeshes.size() << " proxy meshes, " << scene.textures.size() << " textures";
+
+        uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        std::vector<uint32_t> threadCounts;
+        for (uint32_t numThreads = 1; numThreads < maxThreads; numThreads *= 2) threadCounts.push_back(numThreads);
+        threadCounts.push_back(maxThreads);
 
-            // Materials
-            Read(in, &numElements);
-            if (numElements > 0)
+        bool match = true;
+        bool compression = scene.cacheCompression;
+        volatile uint32_t touched = 0;
+        for (uint32_t compressed = 0; compressed < 2; compressed++)
+        {
+            scene.cacheCompression = (compressed == 1);
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            bool serialized = Serialize(filepath, scene, cacheLog);
+            double writeTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            if (!serialized)
             {
-                scene.materials.resize(numElements);
-                for (uint32_t materialIndex = 0; materialIndex < numElements; materialIndex++)
-                {
-                    ReadMaterial(in, scene.materials[materialIndex]);
-                }
+                match = false;
+                break;
             }
 
-            // Textures
-            Read(in, &numElements);
-            if (numElements > 0)
+            uint64_t fileSize = std::filesystem::file_size(filepath, error);
+            log << "\n\t" << (compressed ? "Compressed" : "Uncompressed") << " cache: " << (fileSize / (1024.0 * 1024.0)) << " MB, written in " << writeTime << " ms";
+
+            double baseTime = 0.0;
+            for (uint32_t numThreads : threadCounts)
             {
-                scene.textures.resize(numElements);
-                for (uint32_t textureIndex = 0; textureIndex < numElements; textureIndex++)
+                // Best of several loads (the file is in the page cache after the first load)
+                const uint32_t NumLoads = 4;
+                double bestTime = 0.0;
+                for (uint32_t load = 0; load < NumLoads; load++)
                 {
-                    ReadTexture(in, scene.textures[textureIndex]);
+                    Scenes::Scene cached;
+                    start = std::chrono::steady_clock::now();
+                    bool loaded = Deserialize(filepath, cached, cacheLog, numThreads);
+                    touched = touched + TouchArrays(cached);
+                    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                    if (load == 0 || time < bestTime) bestTime = time;
+
+                    // Check the loaded meshes and textures
+                    if (loaded && load == 0) loaded = IsEqual(scene, cached);
+                    match &= loaded;
+                    Scenes::Cleanup(cached);
                 }
+
+                if (numThreads == 1) baseTime = bestTime;
+                log << "\n\t\tWarm load: " << bestTime << " ms (" << numThreads << (numThreads == 1 ? " thread)" : " threads)");
+                if (numThreads > 1) log << ", " << (baseTime / bestTime) << "x";
             }
 
-            in.close();
-            return true;
-        }
-        else
-        {
-            log << "\n\tWarning: no scene cache file exists!";
+            // Cold loads read the file from the disk
+            if (EvictFile(filepath))
+            {
+                Scenes::Scene cached;
+                start = std::chrono::steady_clock::now();
+                match &= Deserialize(filepath, cached, cacheLog, maxThreads);
+                touched = touched + TouchArrays(cached);
+                double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                Scenes::Cleanup(cached);
+                log << "\n\t\tCold load: " << time << " ms (" << maxThreads << (maxThreads == 1 ? " thread)" : " threads)");
+            }
         }
-        return false;
+        scene.cacheCompression = compression;
+
+        std::filesystem::remove(filepath, error);
+        return match;
     }
 
 }
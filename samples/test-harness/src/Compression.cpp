@@ -0,0 +1,290 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Compression.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Compressed format: a list of sequences. Each sequence starts with a token byte: the number of literals in the high
+// 4 bits and the match length minus MinMatch in the low 4 bits, where 15 means more length bytes follow (each byte is
+// added to the length, bytes of 255 continue). The literals follow the token (and its literal length bytes), then the
+// match's 16-bit little endian offset back into the output and its match length bytes. The last sequence only has literals.
+
+namespace Compression
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static const uint64_t MinMatch = 4;
+    static const uint64_t MaxOffset = 65535;
+    static const uint64_t LastLiterals = 8;     // Matches end at least this many bytes before the end of the input
+    static const uint64_t MatchLimit = 16;      // Matches start at least this many bytes before the end of the input
+    static const uint32_t HashBits = 14;        // 16K hash table entries
+    static const uint64_t ShuffleTile = 64;     // Elements (un)shuffled together
+
+    inline uint32_t Load32(const uint8_t* bytes)
+    {
+        uint32_t value;
+        memcpy(&value, bytes, sizeof(uint32_t));
+        return value;
+    }
+
+    inline uint64_t Load64(const uint8_t* bytes)
+    {
+        uint64_t value;
+        memcpy(&value, bytes, sizeof(uint64_t));
+        return value;
+    }
+
+    inline uint32_t Hash(uint32_t value)
+    {
+        return (value * 2654435761u) >> (32 - HashBits);
+    }
+
+    inline uint32_t CountTrailingZeros(uint64_t value)
+    {
+    #if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+    #else
+        return static_cast<uint32_t>(__builtin_ctzll(value));
+    #endif
+    }
+
+    /**
+     * Returns the number of equal bytes at a and b, up to end (of a).
+     */
+    uint64_t GetMatchLength(const uint8_t* a, const uint8_t* b, const uint8_t* end)
+    {
+        const uint8_t* start = a;
+        while (a + sizeof(uint64_t) <= end)
+        {
+            uint64_t difference = Load64(a) ^ Load64(b);
+            if (difference != 0) return (a - start) + (CountTrailingZeros(difference) >> 3); // little endian: the first differing byte
+            a += sizeof(uint64_t);
+            b += sizeof(uint64_t);
+        }
+        while (a < end && *a == *b) { a++; b++; }
+        return a - start;
+    }
+
+    uint8_t* WriteLength(uint8_t* dst, uint64_t length)
+    {
+        for (; length >= 255; length -= 255) *dst++ = 255;
+        *dst++ = static_cast<uint8_t>(length);
+        return dst;
+    }
+
+    bool ReadLength(const uint8_t*& src, const uint8_t* end, uint64_t& length)
+    {
+        uint8_t byte;
+        do
+        {
+            if (src == end) return false;
+            byte = *src++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    /**
+     * Writes a sequence of literals followed by a match, or only literals when the match length is zero.
+     */
+    uint8_t* WriteSequence(uint8_t* dst, const uint8_t* literals, uint64_t numLiterals, uint64_t offset, uint64_t matchLength)
+    {
+        uint8_t* token = dst++;
+        *token = static_cast<uint8_t>((numLiterals < 15 ? numLiterals : 15) << 4);
+        if (numLiterals >= 15) dst = WriteLength(dst, numLiterals - 15);
+        if (numLiterals > 0) memcpy(dst, literals, numLiterals);
+        dst += numLiterals;
+
+        if (matchLength == 0) return dst;
+
+        *dst++ = static_cast<uint8_t>(offset & 0xFF);
+        *dst++ = static_cast<uint8_t>(offset >> 8);
+
+        uint64_t length = matchLength - MinMatch;
+        *token |= static_cast<uint8_t>(length < 15 ? length : 15);
+        if (length >= 15) dst = WriteLength(dst, length - 15);
+        return dst;
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    uint64_t GetMaxCompressedSize(uint64_t size)
+    {
+        return size + (size / 255) + 16;
+    }
+
+    uint64_t Compress(const uint8_t* src, uint64_t size, uint8_t* dst)
+    {
+        uint8_t* out = dst;
+        uint64_t anchor = 0;    // Start of the pending literals
+
+        if (size > MatchLimit)
+        {
+            // Position + 1 of the last input seen with each hash (0: none)
+            std::vector<uint64_t> table(1 << HashBits, 0);
+
+            const uint64_t limit = size - MatchLimit;
+            const uint8_t* end = src + size - LastLiterals;
+            uint64_t position = 0;
+            while (position < limit)
+            {
+                uint32_t value = Load32(src + position);
+                uint32_t hash = Hash(value);
+                uint64_t candidate = table[hash];
+                table[hash] = position + 1;
+
+                if (candidate == 0 || (position + 1 - candidate) > MaxOffset || Load32(src + candidate - 1) != value)
+                {
+                    // Skip ahead faster the longer no match is found (incompressible input)
+                    position += 1 + ((position - anchor) >> 6);
+                    continue;
+                }
+
+                // Extend the match backwards over the pending literals, then forwards
+                uint64_t match = candidate - 1;
+                while (position > anchor && match > 0 && src[position - 1] == src[match - 1])
+                {
+                    position--;
+                    match--;
+                }
+                uint64_t length = MinMatch + GetMatchLength(src + position + MinMatch, src + match + MinMatch, end);
+
+                out = WriteSequence(out, src + anchor, position - anchor, position - match, length);
+                position += length;
+                anchor = position;
+
+                // Hash a position inside the match, which finds the next match of repeating input sooner
+                if (position - 2 < limit) table[Hash(Load32(src + position - 2))] = position - 1;
+            }
+        }
+
+        out = WriteSequence(out, src + anchor, size - anchor, 0, 0);
+        return static_cast<uint64_t>(out - dst);
+    }
+
+    bool Decompress(const uint8_t* src, uint64_t compressedSize, uint8_t* dst, uint64_t size)
+    {
+        const uint8_t* in = src;
+        const uint8_t* inEnd = src + compressedSize;
+        uint8_t* out = dst;
+        uint8_t* outEnd = dst + size;
+
+        while (in < inEnd)
+        {
+            uint32_t token = *in++;
+
+            // Literals
+            uint64_t numLiterals = token >> 4;
+            if (numLiterals == 15 && !ReadLength(in, inEnd, numLiterals)) return false;
+            if (numLiterals > static_cast<uint64_t>(inEnd - in) || numLiterals > static_cast<uint64_t>(outEnd - out)) return false;
+
+            // Short literal runs copy 16 bytes when there's room (the extra bytes are overwritten by later output)
+            if (numLiterals <= 16 && (inEnd - in) >= 16 && (outEnd - out) >= 16) memcpy(out, in, 16);
+            else if (numLiterals > 0) memcpy(out, in, numLiterals);
+            in += numLiterals;
+            out += numLiterals;
+
+            // The last sequence has no match
+            if (in == inEnd) break;
+
+            // Match
+            if ((inEnd - in) < 2) return false;
+            uint64_t offset = static_cast<uint64_t>(in[0]) | (static_cast<uint64_t>(in[1]) << 8);
+            in += 2;
+            if (offset == 0 || offset > static_cast<uint64_t>(out - dst)) return false;
+
+            uint64_t length = (token & 15);
+            if (length == 15 && !ReadLength(in, inEnd, length)) return false;
+            length += MinMatch;
+            if (length > static_cast<uint64_t>(outEnd - out)) return false;
+
+            const uint8_t* match = out - offset;
+            if (static_cast<uint64_t>(outEnd - out) >= length + 8)
+            {
+                // Copy 8 bytes at a time from at least 8 bytes back (these copies may write up to 7 bytes past the match).
+                // Matches closer than 8 bytes repeat their offset bytes: copy whole repetitions up to 8 bytes one byte at
+                // a time, then copy from that many bytes back.
+                uint64_t period = offset;
+                uint64_t copied = 0;
+                if (offset < 8)
+                {
+                    period = offset * ((8 + offset - 1) / offset);
+                    for (; copied < period && copied < length; copied++) out[copied] = match[copied];
+                }
+                for (; copied < length; copied += 8) memcpy(out + copied, out + copied - period, 8);
+            }
+            else
+            {
+                // Overlapping copies repeat the last offset bytes
+                for (uint64_t index = 0; index < length; index++) out[index] = match[index];
+            }
+            out += length;
+        }
+        return (out == outEnd);
+    }
+
+    void Shuffle(const uint8_t* src, uint64_t size, uint32_t stride, uint8_t* dst)
+    {
+        // Tiles of elements keep the elements' bytes in the cache while they're spread over the planes
+        uint64_t count = (stride > 0) ? (size / stride) : 0;
+        for (uint64_t start = 0; start < count; start += ShuffleTile)
+        {
+            uint64_t end = std::min(count, start + ShuffleTile);
+            for (uint32_t byteIndex = 0; byteIndex < stride; byteIndex++)
+            {
+                const uint8_t* in = src + byteIndex;
+                uint8_t* out = dst + (byteIndex * count);
+                for (uint64_t index = start; index < end; index++) out[index] = in[index * stride];
+            }
+        }
+        memcpy(dst + (count * stride), src + (count * stride), size - (count * stride));
+    }
+
+    void Unshuffle(const uint8_t* src, uint64_t size, uint32_t stride, uint8_t* dst)
+    {
+        uint64_t count = (stride > 0) ? (size / stride) : 0;
+        for (uint64_t start = 0; start < count; start += ShuffleTile)
+        {
+            uint64_t end = std::min(count, start + ShuffleTile);
+            for (uint32_t byteIndex = 0; byteIndex < stride; byteIndex++)
+            {
+                const uint8_t* in = src + (byteIndex * count);
+                uint8_t* out = dst + byteIndex;
+                for (uint64_t index = start; index < end; index++) out[index * stride] = in[index];
+            }
+        }
+        memcpy(dst + (count * stride), src + (count * stride), size - (count * stride));
+    }
+
+    void DeltaEncode(uint32_t* values, uint64_t count)
+    {
+        for (uint64_t index = count; index > 1; index--) values[index - 1] -= values[index - 2];
+    }
+
+    void DeltaDecode(uint32_t* values, uint64_t count)
+    {
+        for (uint64_t index = 1; index < count; index++) values[index] += values[index - 1];
+    }
+
+}
@@ -270,6 +270,22 @@ namespace Configs
                 }
             }
 
+            if (tokens[3].compare("probeAdaptiveHysteresis") == 0)
+            {
+                if (tokens.size() == 5 && tokens[4].compare("enabled") == 0)
+                {
+                    Store(data, config.ddgi.volumes[volumeIndex].probeAdaptiveHysteresisEnabled); return true;
+                }
+                else if (tokens.size() == 5 && tokens[4].compare("min") == 0)
+                {
+                    Store(data, config.ddgi.volumes[volumeIndex].probeAdaptiveHysteresisMin); return true;
+                }
+                else if (tokens.size() == 5 && tokens[4].compare("threshold") == 0)
+                {
+                    Store(data, config.ddgi.volumes[volumeIndex].probeAdaptiveHysteresisThreshold); return true;
+                }
+            }
+
             if (tokens[3].compare("infiniteScrolling") == 0)
             {
                 if (tokens.size() == 5 && tokens[4].compare("enabled") == 0)
@@ -464,6 +480,11 @@ namespace Configs
             if (tokens[1].compare("screenshotPath") == 0) { config.scene.screenshotPath = data; return true; }
             if (tokens[1].compare("skyColor") == 0) { Store(data, config.scene.skyColor); return true; }
             if (tokens[1].compare("skyIntensity") == 0) { Store(data, config.scene.skyIntensity); return true; }
+            if (tokens[1].compare("proxyRatio") == 0) { Store(data, config.scene.proxyRatio); return true; }
+            if (tokens[1].compare("proxyMaxError") == 0) { Store(data, config.scene.proxyMaxError); return true; }
+            if (tokens[1].compare("opacityLevel") == 0) { Store(data, config.scene.opacityLevel); return true; }
+            if (tokens[1].compare("cacheCompression") == 0) { Store(data, config.scene.cacheCompression); return true; }
+            if (tokens[1].compare("compactVertices") == 0) { Store(data, config.scene.compactVertices); return true; }
         }
 
         // Lights
@@ -542,6 +563,12 @@ namespace Configs
         if (tokens[1].compare("vsync") == 0) { Store(data, config.app.vsync); return true; }
         if (tokens[1].compare("fullscreen") == 0) { Store(data, config.app.fullscreen); return true; }
         if (tokens[1].compare("showUI") == 0) { Store(data, config.app.showUI); return true; }
+        if (tokens[1].compare("benchmarkBVH") == 0) { Store(data, config.app.benchmarkBVH); return true; }
+        if (tokens[1].compare("benchmarkSamplers") == 0) { Store(data, config.app.benchmarkSamplers); return true; }
+        if (tokens[1].compare("benchmarkCaches") == 0) { Store(data, config.app.benchmarkCaches); return true; }
+        if (tokens[1].compare("benchmarkQuantization") == 0) { Store(data, config.app.benchmarkQuantization); return true; }
+        if (tokens[1].compare("benchmarkOptimize") == 0) { Store(data, config.app.benchmarkOptimize); return true; }
+        if (tokens[1].compare("benchmarkIndexBuffers") == 0) { Store(data, config.app.benchmarkIndexBuffers); return true; }
         if (tokens[1].compare("root") == 0)
         {
             std::filesystem::path configFilePath(config.app.filepath);
@@ -483,8 +483,8 @@ namespace Graphics
          */
         bool CreateIndexBuffer(Globals& d3d, const Scenes::Mesh& mesh, ID3D12Resource** device, ID3D12Resource** upload, D3D12_INDEX_BUFFER_VIEW& view)
         {
-            // Create the index buffer upload resource
-            UINT sizeInBytes = mesh.numIndices * sizeof(UINT);
+            // Create the index buffer upload resource (the opacity states follow the indices)
+            UINT sizeInBytes = IndexBuffers::GetSize(mesh) + (mesh.numOpacityStates * sizeof(UINT));
             BufferDesc desc = { sizeInBytes, 0, EHeapType::UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE };
             if (!CreateBuffer(d3d, desc, upload)) return false;
 
@@ -493,22 +493,22 @@ namespace Graphics
             if (!CreateBuffer(d3d, desc, device)) return false;
 
             // Initialize the index buffer view
-            view.Format = DXGI_FORMAT_R32_UINT;
-            view.SizeInBytes = sizeInBytes;
+            view.Format = DXGI_FORMAT_R32_UINT;     // The primitives' formats are in MeshPrimitive::indexFormat
+            view.SizeInBytes = IndexBuffers::GetSize(mesh);
             view.BufferLocation = (*device)->GetGPUVirtualAddress();
 
-            // Copy the index data of each mesh primitive to the upload buffer
+            // Write the mesh's indices (16 or 32-bit per primitive) to the upload buffer
             UINT8* pData = nullptr;
             D3D12_RANGE readRange = {};
             D3DCHECK((*upload)->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
+            IndexBuffers::Write(mesh, pData);
 
             for (UINT primitiveIndex = 0; primitiveIndex < static_cast<UINT>(mesh.primitives.size()); primitiveIndex++)
             {
-                // Get the mesh primitive and copy its indices to the upload buffer
+                // Copy the mesh primitive's opacity states to the upload buffer
                 const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                UINT size = static_cast<UINT>(primitive.indices.size()) * sizeof(UINT);
-                memcpy(pData + primitive.indexByteOffset, primitive.indices.data(), size);
+                UINT size = static_cast<UINT>(primitive.opacityStates.size()) * sizeof(UINT);
+                if (size > 0) memcpy(pData + primitive.opacityByteOffset, primitive.opacityStates.data(), size);
             }
             (*upload)->Unmap(0, nullptr);
 
@@ -534,9 +534,9 @@ namespace Graphics
          */
         bool CreateVertexBuffer(Globals& d3d, const Scenes::Mesh& mesh, ID3D12Resource** device, ID3D12Resource** upload, D3D12_VERTEX_BUFFER_VIEW& view)
         {
-            // Create the vertex buffer upload resource
-            UINT stride = sizeof(Vertex);
-            UINT sizeInBytes = mesh.numVertices * stride;
+            // Create the vertex buffer upload resource (see Quantization.h for the compact vertex format)
+            UINT stride = Quantization::GetVertexStride(mesh);
+            UINT sizeInBytes = static_cast<UINT>(Quantization::GetVertexBufferSize(mesh));
             BufferDesc desc = { sizeInBytes, 0, EHeapType::UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ, D3D12_RESOURCE_FLAG_NONE };
             if (!CreateBuffer(d3d, desc, upload)) return false;
 
@@ -549,19 +549,12 @@ namespace Graphics
             view.SizeInBytes = sizeInBytes;
             view.BufferLocation = (*device)->GetGPUVirtualAddress();
 
-            // Copy the vertex data of each mesh primitive to the upload buffer
+            // Copy the mesh's vertices (contiguous in its geometry pool) to the upload buffer
             UINT8* pData = nullptr;
             D3D12_RANGE readRange = {};
             D3DCHECK((*upload)->Map(0, &readRange, reinterpret_cast<void**>(&pData)));
 
-            for (UINT primitiveIndex = 0; primitiveIndex < static_cast<UINT>(mesh.primitives.size()); primitiveIndex++)
-            {
-                // Get the mesh primitive and copy its vertices to the upload buffer
-                const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                UINT size = static_cast<UINT>(primitive.vertices.size()) * stride;
-                memcpy(pData + primitive.vertexByteOffset, primitive.vertices.data(), size);
-            }
+            if (sizeInBytes > 0) Quantization::WriteVertexBuffer(mesh, pData);
             (*upload)->Unmap(0, nullptr);
 
             // Schedule a copy of the upload buffer to the device buffer
@@ -595,12 +588,22 @@ namespace Graphics
                 // Get the mesh primitive
                 const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
 
-                desc.Triangles.VertexBuffer.StartAddress = resources.sceneVBs[mesh.index]->GetGPUVirtualAddress() + primitive.vertexByteOffset;
+                desc.Triangles.VertexBuffer.StartAddress = resources.sceneVBs[mesh.index]->GetGPUVirtualAddress() + Quantization::GetVertexByteAddress(mesh, primitive);
                 desc.Triangles.VertexBuffer.StrideInBytes = resources.sceneVBViews[mesh.index].StrideInBytes;
                 desc.Triangles.VertexCount = static_cast<UINT>(primitive.vertices.size());
-                desc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+                if (Quantization::IsCompact(mesh))
+                {
+                    // Compact positions are dequantized by the transform at the start of the vertex buffer
+                    desc.Triangles.VertexFormat = DXGI_FORMAT_R16G16B16A16_SNORM;
+                    desc.Triangles.Transform3x4 = resources.sceneVBs[mesh.index]->GetGPUVirtualAddress();
+                }
+                else
+                {
+                    desc.Triangles.VertexFormat = DXGI_FORMAT_R32G32B32_FLOAT;
+                    desc.Triangles.Transform3x4 = 0;
+                }
                 desc.Triangles.IndexBuffer = resources.sceneIBs[mesh.index]->GetGPUVirtualAddress() + primitive.indexByteOffset;
-                desc.Triangles.IndexFormat = resources.sceneIBViews[mesh.index].Format;
+                desc.Triangles.IndexFormat = (primitive.indexFormat == INDEX_FORMAT_16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
                 desc.Triangles.IndexCount = static_cast<UINT>(primitive.indices.size());
                 desc.Flags = primitive.opaque ? D3D12_RAYTRACING_GEOMETRY_FLAG_OPAQUE : D3D12_RAYTRACING_GEOMETRY_FLAG_NONE;
 
@@ -1517,8 +1520,9 @@ namespace Graphics
 
                     GeometryData data;
                     data.materialIndex = primitive.material;
-                    data.indexByteAddress = primitive.indexByteOffset;
-                    data.vertexByteAddress = primitive.vertexByteOffset;
+                    data.indexByteAddress = primitive.indexByteOffset | primitive.indexFormat;
+                    data.vertexByteAddress = Quantization::GetVertexByteAddress(mesh, primitive) | Quantization::GetVertexFormat(mesh);
+                    data.opacityStates = primitive.opacityStates.empty() ? 0 : (primitive.opacityByteOffset | static_cast<UINT>(scene.opacityLevel + 1));
                     memcpy(geometryDataAddress, &data, sizeof(GeometryData));
 
                     geometryDataAddress += sizeof(GeometryData);
@@ -1653,7 +1657,7 @@ namespace Graphics
                 D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
                 srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
                 srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-                srvDesc.Buffer.NumElements = mesh.numIndices;
+                srvDesc.Buffer.NumElements = (IndexBuffers::GetSize(mesh) / sizeof(UINT)) + mesh.numOpacityStates;
                 srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
                 srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
@@ -1694,7 +1698,7 @@ namespace Graphics
                 D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
                 srvDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
                 srvDesc.Format = DXGI_FORMAT_R32_TYPELESS;
-                srvDesc.Buffer.NumElements = (sizeof(Vertex) * mesh.numVertices) / 4;
+                srvDesc.Buffer.NumElements = static_cast<UINT>(Quantization::GetVertexBufferSize(mesh) / 4);
                 srvDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_RAW;
                 srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
 
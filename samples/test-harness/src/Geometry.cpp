@@ -128,9 +128,14 @@ namespace Geometry
 
     void CreateSphere(uint32_t latitudes, uint32_t longitudes, Scenes::Mesh& mesh)
     {
+        std::vector<Graphics::Vertex> vertices = GetSphereVertices(latitudes, longitudes);
+        std::vector<uint32_t> indices = GetSphereIndices(latitudes, longitudes, static_cast<uint32_t>(vertices.size()));
+
+        // Copy the sphere to the mesh's geometry pool
         Scenes::MeshPrimitive& primitive = mesh.primitives.emplace_back();
-        primitive.vertices = GetSphereVertices(latitudes, longitudes);
-        primitive.indices = GetSphereIndices(latitudes, longitudes, static_cast<uint32_t>(primitive.vertices.size()));
+        primitive.vertices = { vertices.data(), vertices.size() };
+        primitive.indices = { indices.data(), indices.size() };
+        Scenes::AllocateGeometry(&mesh, 1);
 
         mesh.numVertices = static_cast<int>(primitive.vertices.size());
         mesh.numIndices = static_cast<int>(primitive.indices.size());
@@ -0,0 +1,175 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "IndexBuffers.h"
+#include "Scenes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace IndexBuffers
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static const uint32_t Max16BitIndex = 0xFFFE;       // 0xFFFF is the strip cut value
+
+    uint32_t ReadWord(const uint8_t* data, uint32_t address)
+    {
+        uint32_t word;
+        memcpy(&word, data + address, sizeof(uint32_t));
+        return word;
+    }
+
+    /**
+     * Loads a triangle's indices from an index buffer, like LoadIndices() in RayTracing.hlsl/glsl.
+     * The address is GeometryData::indexByteAddress, with the index format in the low bit.
+     */
+    void LoadIndices(const uint8_t* data, uint32_t address, uint32_t triangle, uint32_t indices[3])
+    {
+        if (address & Graphics::INDEX_FORMAT_16)
+        {
+            // Load the two aligned words that hold the 3 indices
+            address = (address & ~Graphics::INDEX_FORMAT_16) + (triangle * 6);
+            uint32_t words[2] = { ReadWord(data, address & ~3u), ReadWord(data, (address & ~3u) + 4) };
+            if (address & 2)
+            {
+                indices[0] = words[0] >> 16;
+                indices[1] = words[1] & 0xFFFF;
+                indices[2] = words[1] >> 16;
+            }
+            else
+            {
+                indices[0] = words[0] & 0xFFFF;
+                indices[1] = words[0] >> 16;
+                indices[2] = words[1] & 0xFFFF;
+            }
+            return;
+        }
+
+        address += triangle * 12;
+        for (uint32_t corner = 0; corner < 3; corner++) indices[corner] = ReadWord(data, address + (corner * 4));
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    uint32_t SelectFormat(const Scenes::MeshPrimitive& primitive)
+    {
+        if (std::any_of(primitive.indices.begin(), primitive.indices.end(), [](uint32_t index) { return index > Max16BitIndex; })) return Graphics::INDEX_FORMAT_32;
+        return Graphics::INDEX_FORMAT_16;
+    }
+
+    uint32_t GetStride(const Scenes::MeshPrimitive& primitive)
+    {
+        return (primitive.indexFormat == Graphics::INDEX_FORMAT_16) ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    uint32_t Layout(Scenes::Mesh& mesh)
+    {
+        uint32_t size = 0;
+        for (Scenes::MeshPrimitive& primitive : mesh.primitives)
+        {
+            primitive.indexByteOffset = size;
+            size += ALIGN(4, static_cast<uint32_t>(primitive.indices.size()) * GetStride(primitive));
+        }
+        return size;
+    }
+
+    uint32_t GetSize(const Scenes::Mesh& mesh)
+    {
+        uint32_t size = 0;
+        for (const Scenes::MeshPrimitive& primitive : mesh.primitives)
+        {
+            size += ALIGN(4, static_cast<uint32_t>(primitive.indices.size()) * GetStride(primitive));
+        }
+        return size;
+    }
+
+    void Write(const Scenes::Mesh& mesh, uint8_t* data)
+    {
+        for (const Scenes::MeshPrimitive& primitive : mesh.primitives)
+        {
+            uint8_t* indices = data + primitive.indexByteOffset;
+            uint32_t size = static_cast<uint32_t>(primitive.indices.size()) * GetStride(primitive);
+            if (primitive.indexFormat == Graphics::INDEX_FORMAT_16)
+            {
+                for (size_t index = 0; index < primitive.indices.size(); index++)
+                {
+                    uint16_t value = static_cast<uint16_t>(primitive.indices[index]);
+                    memcpy(indices + (index * sizeof(uint16_t)), &value, sizeof(uint16_t));
+                }
+            }
+            else if (size > 0)
+            {
+                memcpy(indices, primitive.indices.data(), size);
+            }
+            memset(indices + size, 0, ALIGN(4, size) - size);
+        }
+    }
+
+    void SelectFormats(Scenes::Mesh* meshes, size_t numMeshes)
+    {
+        for (size_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            for (Scenes::MeshPrimitive& primitive : meshes[meshIndex].primitives) primitive.indexFormat = SelectFormat(primitive);
+            Layout(meshes[meshIndex]);
+        }
+    }
+
+    void Validate(const Scenes::Mesh* meshes, size_t numMeshes, Stats& stats)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        std::vector<uint8_t> buffer;
+        for (size_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            const Scenes::Mesh& mesh = meshes[meshIndex];
+            buffer.assign(GetSize(mesh), 0);
+            Write(mesh, buffer.data());
+            stats.numBytes += buffer.size();
+            stats.num32BitBytes += mesh.indices.size() * sizeof(uint32_t);
+
+            for (const Scenes::MeshPrimitive& primitive : mesh.primitives)
+            {
+                stats.numPrimitives++;
+                if (primitive.indexFormat == Graphics::INDEX_FORMAT_16) stats.num16BitPrimitives++;
+
+                uint32_t address = primitive.indexByteOffset | primitive.indexFormat;
+                for (uint32_t triangle = 0; triangle < static_cast<uint32_t>(primitive.indices.size() / 3); triangle++)
+                {
+                    uint32_t indices[3];
+                    LoadIndices(buffer.data(), address, triangle, indices);
+                    if (memcmp(indices, primitive.indices.data() + (triangle * 3), sizeof(indices)) != 0) stats.numErrors++;
+                }
+            }
+        }
+
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log)
+    {
+        Stats stats;
+        Validate(scene.meshes.data(), scene.meshes.size(), stats);
+
+        log << "\n\t16-bit indices for " << stats.num16BitPrimitives << " of " << stats.numPrimitives << " mesh primitives, index buffers ";
+        log << (stats.numBytes / 1024) << "KB (" << (stats.num32BitBytes / 1024) << "KB with 32-bit indices), validated in " << (stats.seconds * 1000.0) << "ms";
+        if (stats.numErrors > 0) log << "\n\t" << stats.numErrors << " triangles don't load back from the index buffers";
+
+        return (stats.numErrors == 0);
+    }
+
+}
@@ -0,0 +1,390 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Opacity.h"
+#include "Samplers.h"
+#include "Scenes.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace Opacity
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static const uint32_t ChunkTriangles = 256;         // Triangles per work item
+    static const double   FootprintMargin = 1.0 / 64.0;  // Texels, absorbs the shaders' barycentric and texture coordinate round off
+    static const int64_t  MaxFootprintSize = 1 << 22;    // Texels, larger footprints (extreme texture tiling) are not tested
+
+    enum class ETexelClass : uint8_t
+    {
+        Transparent = 0,
+        Opaque,
+        Cutoff      // Within the margin of the alpha cutoff
+    };
+
+    /**
+     * The texels of a texture mip that are not opaque and not transparent, as prefix counts along each row.
+     */
+    struct Coverage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint16_t> notOpaque;        // (width + 1) counts per row
+        std::vector<uint16_t> notTransparent;
+
+        uint32_t Count(const std::vector<uint16_t>& counts, uint32_t row, uint32_t begin, uint32_t end) const
+        {
+            size_t offset = static_cast<size_t>(row) * (width + 1);
+            return counts[offset + end] - counts[offset + begin];
+        }
+    };
+
+    /**
+     * Builds the coverage of a texture mip with the texel classes of the alpha values.
+     * Returns false if the mip can't be read on the CPU.
+     */
+    bool GetCoverage(const Samplers::View& view, uint32_t mip, const ETexelClass classes[256], Coverage& coverage)
+    {
+        std::vector<uint8_t> texels;
+        if (!Samplers::LoadMip(view, mip, texels) || view.mips[mip].width >= UINT16_MAX) return false;
+
+        coverage.width = view.mips[mip].width;
+        coverage.height = view.mips[mip].height;
+        coverage.notOpaque.resize(static_cast<size_t>(coverage.width + 1) * coverage.height);
+        coverage.notTransparent.resize(coverage.notOpaque.size());
+
+        const uint8_t* texel = texels.data();
+        for (uint32_t y = 0; y < coverage.height; y++)
+        {
+            uint16_t* notOpaque = &coverage.notOpaque[static_cast<size_t>(y) * (coverage.width + 1)];
+            uint16_t* notTransparent = &coverage.notTransparent[static_cast<size_t>(y) * (coverage.width + 1)];
+            notOpaque[0] = notTransparent[0] = 0;
+            for (uint32_t x = 0; x < coverage.width; x++, texel += 4)
+            {
+                ETexelClass texelClass = classes[texel[3]];
+                notOpaque[x + 1] = notOpaque[x] + (texelClass != ETexelClass::Opaque);
+                notTransparent[x + 1] = notTransparent[x] + (texelClass != ETexelClass::Transparent);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Returns the horizontal extent of the triangle between two rows (false if it doesn't reach them).
+     */
+    bool ClipRows(const double x[3], const double y[3], double y0, double y1, double& xMin, double& xMax)
+    {
+        xMin = HUGE_VAL;
+        xMax = -HUGE_VAL;
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            if (y[i] >= y0 && y[i] <= y1)
+            {
+                xMin = std::min(xMin, x[i]);
+                xMax = std::max(xMax, x[i]);
+            }
+
+            // Edge crossings of the rows
+            uint32_t j = (i + 1) % 3;
+            for (double row : { y0, y1 })
+            {
+                if ((y[i] - row) * (y[j] - row) >= 0.0) continue;
+                double crossing = x[i] + ((row - y[i]) / (y[j] - y[i])) * (x[j] - x[i]);
+                xMin = std::min(xMin, crossing);
+                xMax = std::max(xMax, crossing);
+            }
+        }
+        return xMin <= xMax;
+    }
+
+    /**
+     * Rasterizes the UV triangle into the mip: tests the texels a bilinear sample inside the triangle can read.
+     * Returns the opacity state of the texels.
+     */
+    uint32_t ClassifyFootprint(const Coverage& coverage, const rtxgi::float2 uv[3], uint64_t& numTexels)
+    {
+        // Texel space, with texel centers at integer coordinates. Bilinear samples read the texels less than a texel away.
+        double x[3], y[3];
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            x[i] = ((double)uv[i].x * coverage.width) - 0.5;
+            y[i] = ((double)uv[i].y * coverage.height) - 0.5;
+            if (!std::isfinite(x[i]) || !std::isfinite(y[i])) return Graphics::OPACITY_STATE_UNKNOWN;
+        }
+
+        const double radius = 1.0 + FootprintMargin;
+        int64_t rowBegin = static_cast<int64_t>(std::ceil(std::min({ y[0], y[1], y[2] }) - radius));
+        int64_t rowEnd = static_cast<int64_t>(std::floor(std::max({ y[0], y[1], y[2] }) + radius));
+        if ((rowEnd - rowBegin) > MaxFootprintSize) return Graphics::OPACITY_STATE_UNKNOWN;
+
+        bool opaque = true;
+        bool transparent = true;
+        for (int64_t row = rowBegin; row <= rowEnd; row++)
+        {
+            // The texels of the row within the radius of the triangle
+            double xMin, xMax;
+            if (!ClipRows(x, y, (double)row - radius, (double)row + radius, xMin, xMax)) continue;
+
+            int64_t columnBegin = static_cast<int64_t>(std::ceil(xMin - radius));
+            int64_t columnEnd = static_cast<int64_t>(std::floor(xMax + radius)) + 1;
+            if ((columnEnd - columnBegin) > MaxFootprintSize) return Graphics::OPACITY_STATE_UNKNOWN;
+
+            // Wrap addressing
+            uint32_t texelRow = static_cast<uint32_t>(((row % coverage.height) + coverage.height) % coverage.height);
+            uint32_t begin = static_cast<uint32_t>(((columnBegin % coverage.width) + coverage.width) % coverage.width);
+            uint32_t length = static_cast<uint32_t>(std::min<int64_t>(columnEnd - columnBegin, coverage.width));
+            numTexels += length;
+
+            uint32_t notOpaque, notTransparent;
+            if (begin + length <= coverage.width)
+            {
+                notOpaque = coverage.Count(coverage.notOpaque, texelRow, begin, begin + length);
+                notTransparent = coverage.Count(coverage.notTransparent, texelRow, begin, begin + length);
+            }
+            else
+            {
+                uint32_t end = (begin + length) - coverage.width;
+                notOpaque = coverage.Count(coverage.notOpaque, texelRow, begin, coverage.width) + coverage.Count(coverage.notOpaque, texelRow, 0, end);
+                notTransparent = coverage.Count(coverage.notTransparent, texelRow, begin, coverage.width) + coverage.Count(coverage.notTransparent, texelRow, 0, end);
+            }
+
+            if (notOpaque > 0) opaque = false;
+            if (notTransparent > 0) transparent = false;
+            if (!opaque && !transparent) break;
+        }
+
+        if (opaque == transparent) return Graphics::OPACITY_STATE_UNKNOWN;
+        return opaque ? Graphics::OPACITY_STATE_OPAQUE : Graphics::OPACITY_STATE_TRANSPARENT;
+    }
+
+    /**
+     * A range of an alpha-tested mesh primitive's triangles.
+     */
+    struct WorkItem
+    {
+        Scenes::MeshPrimitive* primitive;
+        uint32_t firstTriangle;
+        uint32_t numTriangles;
+    };
+
+    /**
+     * Classifies the micro-triangles of a range of triangles against each mip's coverage.
+     */
+    void ClassifyTriangles(const WorkItem& item, const std::vector<Coverage>& coverages, uint32_t level, Stats& stats)
+    {
+        const uint32_t segments = 1 << level;
+        const float scale = 1.f / (float)segments;
+
+        Scenes::MeshPrimitive& primitive = *item.primitive;
+        for (uint32_t triangleIndex = item.firstTriangle; triangleIndex < (item.firstTriangle + item.numTriangles); triangleIndex++)
+        {
+            const rtxgi::float2& uv0 = primitive.vertices[primitive.indices[(triangleIndex * 3) + 0]].uv0;
+            const rtxgi::float2& uv1 = primitive.vertices[primitive.indices[(triangleIndex * 3) + 1]].uv0;
+            const rtxgi::float2& uv2 = primitive.vertices[primitive.indices[(triangleIndex * 3) + 2]].uv0;
+            auto GetUV = [&](uint32_t i, uint32_t j)
+            {
+                float u = (float)i * scale;
+                float v = (float)j * scale;
+                return rtxgi::float2{ uv0.x + (u * (uv1.x - uv0.x)) + (v * (uv2.x - uv0.x)), uv0.y + (u * (uv1.y - uv0.y)) + (v * (uv2.y - uv0.y)) };
+            };
+
+            // Micro-triangles in the order of GetMicroTriangle(): rows of increasing v, upright and inverted triangles alternating along u
+            uint32_t states = 0;
+            uint32_t microTriangle = 0;
+            for (uint32_t j = 0; j < segments; j++)
+            {
+                for (uint32_t i = 0; i < (segments - j); i++)
+                {
+                    for (uint32_t inverted = 0; inverted < ((i + j + 1 < segments) ? 2u : 1u); inverted++, microTriangle++)
+                    {
+                        rtxgi::float2 uv[3];
+                        if (inverted) { uv[0] = GetUV(i + 1, j); uv[1] = GetUV(i, j + 1); uv[2] = GetUV(i + 1, j + 1); }
+                        else { uv[0] = GetUV(i, j); uv[1] = GetUV(i + 1, j); uv[2] = GetUV(i, j + 1); }
+
+                        // The state of the micro-triangle is known only if it's the same in all the sampled mips
+                        uint32_t state = ClassifyFootprint(coverages[0], uv, stats.numTexels);
+                        for (size_t mip = 1; mip < coverages.size() && state != Graphics::OPACITY_STATE_UNKNOWN; mip++)
+                        {
+                            if (ClassifyFootprint(coverages[mip], uv, stats.numTexels) != state) state = Graphics::OPACITY_STATE_UNKNOWN;
+                        }
+
+                        if (state == Graphics::OPACITY_STATE_OPAQUE) stats.numOpaque++;
+                        else if (state == Graphics::OPACITY_STATE_TRANSPARENT) stats.numTransparent++;
+                        else stats.numUnknown++;
+                        states |= (state << (microTriangle * 2));
+                    }
+                }
+            }
+            primitive.opacityStates[triangleIndex] = states;
+        }
+        stats.numTriangles += item.numTriangles;
+    }
+
+    /**
+     * Classifies the triangles of the mesh primitives that use an alpha-tested material.
+     */
+    void ClassifyMaterial(const Scenes::Scene& scene, const Scenes::Material& material, std::vector<Scenes::MeshPrimitive*>& primitives, const Desc& desc, Stats& stats)
+    {
+        const Textures::Texture& texture = scene.textures[material.data.albedoTexIdx];
+
+        // Texel classes of the alpha values (the shaders ignore hits with (opacity * alpha) < alphaCutoff)
+        ETexelClass classes[256];
+        for (uint32_t value = 0; value < 256; value++)
+        {
+            float alpha = material.data.opacity * ((float)value / 255.f);
+            if (alpha >= (material.data.alphaCutoff + desc.alphaMargin)) classes[value] = ETexelClass::Opaque;
+            else if (alpha < (material.data.alphaCutoff - desc.alphaMargin)) classes[value] = ETexelClass::Transparent;
+            else classes[value] = ETexelClass::Cutoff;
+        }
+
+        // The mips the any-hit shaders sample: mip 0 (AHS_LOD0), and the mips around the GI lod (AHS_GI)
+        uint32_t numMips = std::max(texture.mips, 1u);
+        uint32_t giMip = std::min(static_cast<uint32_t>((float)numMips * 0.6667f), numMips - 1);
+        std::vector<uint32_t> mips = { 0, giMip, std::min(giMip + 1, numMips - 1) };
+        mips.erase(std::unique(mips.begin(), mips.end()), mips.end());
+
+        // BC7 mips are decoded
+        Samplers::View view;
+        bool readable = Samplers::CreateView(texture, view);
+        std::vector<Coverage> coverages(mips.size());
+        for (size_t mipIndex = 0; mipIndex < mips.size(); mipIndex++)
+        {
+            if (readable && GetCoverage(view, mips[mipIndex], classes, coverages[mipIndex])) continue;
+
+            // The texture can't be read, the primitives stay unclassified
+            for (const Scenes::MeshPrimitive* primitive : primitives) stats.numUnclassified += primitive->indices.size() / 3;
+            return;
+        }
+
+        std::vector<WorkItem> items;
+        for (Scenes::MeshPrimitive* primitive : primitives)
+        {
+            uint32_t numTriangles = static_cast<uint32_t>(primitive->indices.size() / 3);
+            primitive->opacityStates.resize(numTriangles);
+            for (uint32_t triangleIndex = 0; triangleIndex < numTriangles; triangleIndex += ChunkTriangles)
+            {
+                items.push_back({ primitive, triangleIndex, std::min(ChunkTriangles, numTriangles - triangleIndex) });
+            }
+        }
+
+        uint32_t numItems = static_cast<uint32_t>(items.size());
+        uint32_t numThreads = (desc.numThreads == 0) ? std::max(std::thread::hardware_concurrency(), 1u) : desc.numThreads;
+        numThreads = std::min(numThreads, std::max(numItems, 1u));
+
+        std::vector<Stats> threadStats(numThreads);
+        std::atomic<uint32_t> next(0);
+        auto classify = [&](uint32_t threadIndex)
+        {
+            for (uint32_t index = next++; index < numItems; index = next++)
+            {
+                ClassifyTriangles(items[index], coverages, desc.level, threadStats[threadIndex]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 1; thread < numThreads; thread++) threads.emplace_back(classify, thread);
+        classify(0);
+        for (std::thread& thread : threads) thread.join();
+
+        for (const Stats& threadStat : threadStats)
+        {
+            stats.numTriangles += threadStat.numTriangles;
+            stats.numOpaque += threadStat.numOpaque;
+            stats.numTransparent += threadStat.numTransparent;
+            stats.numUnknown += threadStat.numUnknown;
+            stats.numTexels += threadStat.numTexels;
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    uint32_t GetMicroTriangle(float u, float v, uint32_t level)
+    {
+        // Micro-triangle rows of increasing v, with upright and inverted micro-triangles alternating along u
+        const uint32_t segments = 1 << level;
+        u = std::max(u, 0.f) * (float)segments;
+        v = std::max(v, 0.f) * (float)segments;
+
+        uint32_t i = std::min(static_cast<uint32_t>(u), segments - 1);
+        uint32_t j = std::min(static_cast<uint32_t>(v), segments - 1 - i);
+        uint32_t microTriangle = (j * ((2 * segments) - j)) + (2 * i);
+        if ((i + j + 1) < segments && ((u - (float)i) + (v - (float)j)) > 1.f) microTriangle++;
+        return microTriangle;
+    }
+
+    void Classify(Scenes::Scene& scene, const Desc& desc, Stats& stats)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        Clear(scene);
+
+        Desc classifyDesc = desc;
+        classifyDesc.level = std::min(desc.level, MaxLevel);
+
+        // Gather the mesh primitives of each alpha-tested material (the shaders alpha-test masked materials with an albedo texture)
+        std::vector<std::vector<Scenes::MeshPrimitive*>> materialPrimitives(scene.materials.size());
+        for (Scenes::Mesh& mesh : scene.meshes)
+        {
+            for (Scenes::MeshPrimitive& primitive : mesh.primitives)
+            {
+                if (primitive.material < 0 || primitive.material >= static_cast<int>(scene.materials.size())) continue;
+
+                const Graphics::Material& material = scene.materials[primitive.material].data;
+                if (material.alphaMode != 2 || material.albedoTexIdx < 0 || material.albedoTexIdx >= static_cast<int>(scene.textures.size())) continue;
+                materialPrimitives[primitive.material].push_back(&primitive);
+            }
+        }
+
+        for (size_t materialIndex = 0; materialIndex < scene.materials.size(); materialIndex++)
+        {
+            if (materialPrimitives[materialIndex].empty()) continue;
+            ClassifyMaterial(scene, scene.materials[materialIndex], materialPrimitives[materialIndex], classifyDesc, stats);
+        }
+
+        // Store each mesh's opacity states after its indices
+        for (Scenes::Mesh& mesh : scene.meshes)
+        {
+            uint32_t opacityByteOffset = IndexBuffers::GetSize(mesh);
+            for (Scenes::MeshPrimitive& primitive : mesh.primitives)
+            {
+                primitive.opacityByteOffset = opacityByteOffset;
+                opacityByteOffset += static_cast<uint32_t>(primitive.opacityStates.size()) * sizeof(uint32_t);
+                mesh.numOpacityStates += static_cast<uint32_t>(primitive.opacityStates.size());
+            }
+        }
+        scene.opacityLevel = static_cast<int>(classifyDesc.level);
+
+        stats.seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    void Clear(Scenes::Scene& scene)
+    {
+        for (Scenes::Mesh& mesh : scene.meshes)
+        {
+            mesh.numOpacityStates = 0;
+            for (Scenes::MeshPrimitive& primitive : mesh.primitives)
+            {
+                primitive.opacityByteOffset = 0;
+                primitive.opacityStates.clear();
+            }
+        }
+        scene.opacityLevel = -1;
+    }
+
+}
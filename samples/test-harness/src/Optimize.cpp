@@ -0,0 +1,325 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Optimize.h"
+#include "Scenes.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace Optimize
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static_assert(sizeof(Graphics::Vertex) == 48, "Vertices are hashed as 12 words");
+
+    static const uint32_t Invalid = 0xFFFFFFFF;
+    static const uint32_t VertexCacheSize = 16;     // Entries of the simulated FIFO vertex cache
+    static const uint32_t LineSize = 64;            // Bytes
+    static const uint32_t NumSets = 64;             // Sets of the simulated L1 cache (NumSets * NumWays * LineSize = 32KB)
+    static const uint32_t NumWays = 8;
+    static const uint64_t IndexAddressBase = 1ull << 48;    // Index buffer addresses don't alias vertex buffer addresses
+
+    /**
+     * A set associative cache of lines with least recently used replacement.
+     */
+    struct LineCache
+    {
+        uint64_t lines[NumSets * NumWays];
+        uint64_t times[NumSets * NumWays];
+        uint64_t time = 0;
+
+        LineCache()
+        {
+            std::fill(lines, lines + (NumSets * NumWays), ~0ull);
+            std::fill(times, times + (NumSets * NumWays), 0ull);
+        }
+    };
+
+    /**
+     * Loads the bytes through the cache, returns the number of lines that missed.
+     */
+    uint32_t Load(LineCache& cache, uint64_t address, uint32_t size)
+    {
+        uint32_t numMisses = 0;
+        for (uint64_t line = address / LineSize; line <= (address + size - 1) / LineSize; line++)
+        {
+            uint64_t* lines = cache.lines + ((line % NumSets) * NumWays);
+            uint64_t* times = cache.times + ((line % NumSets) * NumWays);
+            uint32_t way = 0;
+            while (way < NumWays && lines[way] != line) way++;
+            if (way == NumWays)
+            {
+                // Replace the least recently used line of the set
+                way = static_cast<uint32_t>(std::min_element(times, times + NumWays) - times);
+                lines[way] = line;
+                numMisses++;
+            }
+            times[way] = ++cache.time;
+        }
+        return numMisses;
+    }
+
+    /**
+     * Spreads the low 10 bits of the value to every third bit.
+     */
+    uint32_t SpreadBits(uint32_t value)
+    {
+        value &= 0x3FF;
+        value = (value | (value << 16)) & 0x030000FF;
+        value = (value | (value << 8)) & 0x0300F00F;
+        value = (value | (value << 4)) & 0x030C30C3;
+        value = (value | (value << 2)) & 0x09249249;
+        return value;
+    }
+
+    uint64_t HashVertex(const Graphics::Vertex& vertex)
+    {
+        uint32_t words[12];
+        memcpy(words, &vertex, sizeof(words));
+
+        uint64_t hash = 0x9E3779B97F4A7C15ull;
+        for (uint32_t word : words)
+        {
+            hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+            hash ^= (hash >> 32);
+        }
+        return hash;
+    }
+
+    /**
+     * Returns true if the primitive's indices are whole triangles of its vertices.
+     */
+    bool IsValid(const Scenes::MeshPrimitive& primitive)
+    {
+        if (primitive.indices.empty() || (primitive.indices.size() % 3) != 0 || primitive.vertices.size() >= Invalid) return false;
+        uint32_t numVertices = static_cast<uint32_t>(primitive.vertices.size());
+        return std::all_of(primitive.indices.begin(), primitive.indices.end(), [numVertices](uint32_t index) { return index < numVertices; });
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    uint64_t WeldVertices(Scenes::MeshPrimitive& primitive)
+    {
+        uint32_t numVertices = static_cast<uint32_t>(primitive.vertices.size());
+
+        // Open addressing table of the unique vertices' indices, at most half full
+        uint32_t tableSize = 1;
+        while (tableSize < (numVertices * 2)) tableSize *= 2;
+        std::vector<uint32_t> table(tableSize, Invalid);
+
+        // Unique vertices are moved to the front in the order of their first occurrence
+        std::vector<uint32_t> remap(numVertices);
+        uint32_t numUnique = 0;
+        for (uint32_t vertexIndex = 0; vertexIndex < numVertices; vertexIndex++)
+        {
+            const Graphics::Vertex& vertex = primitive.vertices[vertexIndex];
+            uint32_t slot = static_cast<uint32_t>(HashVertex(vertex)) & (tableSize - 1);
+            while (table[slot] != Invalid && memcmp(&primitive.vertices[table[slot]], &vertex, sizeof(Graphics::Vertex)) != 0)
+            {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+
+            if (table[slot] == Invalid)
+            {
+                if (numUnique != vertexIndex) primitive.vertices[numUnique] = vertex;
+                table[slot] = numUnique++;
+            }
+            remap[vertexIndex] = table[slot];
+        }
+
+        for (uint32_t& index : primitive.indices) index = remap[index];
+        primitive.vertices.count = numUnique;
+        return numVertices - numUnique;
+    }
+
+    void ReorderTriangles(Scenes::MeshPrimitive& primitive, uint32_t cacheSize)
+    {
+        uint32_t numVertices = static_cast<uint32_t>(primitive.vertices.size());
+        uint64_t numTriangles = primitive.indices.size() / 3;
+        const uint32_t* indices = primitive.indices.data();
+
+        // The triangles of each vertex, and the number of them that aren't emitted yet (live)
+        std::vector<uint32_t> offsets(numVertices + 1, 0);
+        for (uint32_t index : primitive.indices) offsets[index + 1]++;
+        for (uint32_t vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) offsets[vertexIndex + 1] += offsets[vertexIndex];
+
+        std::vector<uint32_t> live(numVertices);
+        for (uint32_t vertexIndex = 0; vertexIndex < numVertices; vertexIndex++) live[vertexIndex] = offsets[vertexIndex + 1] - offsets[vertexIndex];
+
+        std::vector<uint32_t> triangles(primitive.indices.size());
+        std::vector<uint32_t> positions(offsets.begin(), offsets.end() - 1);
+        for (uint64_t index = 0; index < primitive.indices.size(); index++) triangles[positions[indices[index]]++] = static_cast<uint32_t>(index / 3);
+
+        // Vertices are in the cache while (time - cacheTimes[vertex]) <= cacheSize
+        std::vector<uint32_t> cacheTimes(numVertices, 0);
+        std::vector<uint8_t> emitted(numTriangles, 0);
+        std::vector<uint32_t> deadEnds;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(primitive.indices.size());
+        uint32_t time = cacheSize + 1;
+        uint32_t scan = 0;
+
+        // Returns the most recently used vertex with live triangles, or the next one in vertex order
+        auto SkipDeadEnd = [&]()
+        {
+            while (!deadEnds.empty())
+            {
+                uint32_t vertexIndex = deadEnds.back();
+                deadEnds.pop_back();
+                if (live[vertexIndex] > 0) return vertexIndex;
+            }
+            while (scan < numVertices && live[scan] == 0) scan++;
+            return (scan < numVertices) ? scan : Invalid;
+        };
+
+        uint32_t fanning = SkipDeadEnd();
+        while (fanning != Invalid)
+        {
+            // Emit the live triangles around the fanning vertex
+            candidates.clear();
+            for (uint32_t offset = offsets[fanning]; offset < offsets[fanning + 1]; offset++)
+            {
+                uint32_t triangle = triangles[offset];
+                if (emitted[triangle]) continue;
+                emitted[triangle] = 1;
+
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t vertexIndex = indices[(static_cast<uint64_t>(triangle) * 3) + corner];
+                    output.push_back(vertexIndex);
+                    deadEnds.push_back(vertexIndex);
+                    candidates.push_back(vertexIndex);
+                    live[vertexIndex]--;
+                    if ((time - cacheTimes[vertexIndex]) > cacheSize) cacheTimes[vertexIndex] = time++;
+                }
+            }
+
+            // Fan around the candidate that entered the cache earliest and stays in it while its live triangles are emitted
+            uint32_t next = Invalid;
+            int64_t bestPriority = -1;
+            for (uint32_t vertexIndex : candidates)
+            {
+                if (live[vertexIndex] == 0) continue;
+                int64_t priority = 0;
+                if ((time - cacheTimes[vertexIndex]) + (2 * live[vertexIndex]) <= cacheSize) priority = time - cacheTimes[vertexIndex];
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = vertexIndex;
+                }
+            }
+            fanning = (next != Invalid) ? next : SkipDeadEnd();
+        }
+
+        memcpy(primitive.indices.data(), output.data(), output.size() * sizeof(uint32_t));
+    }
+
+    uint64_t ReorderVertices(Scenes::MeshPrimitive& primitive)
+    {
+        uint32_t numVertices = static_cast<uint32_t>(primitive.vertices.size());
+        std::vector<uint32_t> remap(numVertices, Invalid);
+        std::vector<Graphics::Vertex> vertices;
+        vertices.reserve(numVertices);
+        for (uint32_t& index : primitive.indices)
+        {
+            if (remap[index] == Invalid)
+            {
+                remap[index] = static_cast<uint32_t>(vertices.size());
+                vertices.push_back(primitive.vertices[index]);
+            }
+            index = remap[index];
+        }
+
+        memcpy(primitive.vertices.data(), vertices.data(), vertices.size() * sizeof(Graphics::Vertex));
+        primitive.vertices.count = vertices.size();
+        return numVertices - vertices.size();
+    }
+
+    void SimulateFetches(const Scenes::MeshPrimitive& primitive, uint32_t vertexStride, FetchStats& stats)
+    {
+        uint64_t numTriangles = primitive.indices.size() / 3;
+        const uint32_t* indices = primitive.indices.data();
+
+        // Vertex cache misses in index order
+        uint32_t fifo[VertexCacheSize];
+        std::fill(fifo, fifo + VertexCacheSize, Invalid);
+        uint32_t fifoPosition = 0;
+        for (uint64_t index = 0; index < (numTriangles * 3); index++)
+        {
+            if (std::find(fifo, fifo + VertexCacheSize, indices[index]) != (fifo + VertexCacheSize)) continue;
+            fifo[fifoPosition] = indices[index];
+            fifoPosition = (fifoPosition + 1) % VertexCacheSize;
+            stats.numVertexMisses++;
+        }
+
+        // Hit order: the triangles sorted by the Morton code of their centroid in the primitive's bounding box
+        const rtxgi::AABB& box = primitive.boundingBox;
+        float scale[3];
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            float extent = box.max[axis] - box.min[axis];
+            scale[axis] = (extent > 0.f) ? (1023.f / extent) : 0.f;
+        }
+
+        std::vector<uint64_t> order(numTriangles);
+        for (uint64_t triangle = 0; triangle < numTriangles; triangle++)
+        {
+            uint32_t code = 0;
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                float centroid = 0.f;
+                for (uint32_t corner = 0; corner < 3; corner++) centroid += primitive.vertices[indices[(triangle * 3) + corner]].position[axis];
+                float cell = std::max(0.f, std::min(((centroid / 3.f) - box.min[axis]) * scale[axis], 1023.f));
+                code |= SpreadBits(static_cast<uint32_t>(cell)) << axis;
+            }
+            order[triangle] = (static_cast<uint64_t>(code) << 32) | triangle;
+        }
+        std::sort(order.begin(), order.end());
+
+        // Load each triangle's indices and vertices
+        LineCache cache;
+        for (uint64_t key : order)
+        {
+            uint64_t triangle = key & 0xFFFFFFFF;
+            stats.numLineMisses += Load(cache, IndexAddressBase + (triangle * 3 * sizeof(uint32_t)), 3 * sizeof(uint32_t));
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                stats.numLineMisses += Load(cache, static_cast<uint64_t>(indices[(triangle * 3) + corner]) * vertexStride, vertexStride);
+            }
+        }
+        stats.numTriangles += numTriangles;
+    }
+
+    void OptimizePrimitive(Scenes::MeshPrimitive& primitive, const Desc& desc, Stats& stats)
+    {
+        if (!IsValid(primitive)) return;
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        stats.numPrimitives++;
+        stats.numVertices += primitive.vertices.size();
+        if (desc.simulateFetches) SimulateFetches(primitive, sizeof(Graphics::Vertex), stats.before);
+
+        if (desc.weld) stats.numWelded += WeldVertices(primitive);
+        if (desc.reorderTriangles) ReorderTriangles(primitive, desc.cacheSize);
+        if (desc.reorderVertices) stats.numUnreferenced += ReorderVertices(primitive);
+
+        if (desc.simulateFetches) SimulateFetches(primitive, sizeof(Graphics::Vertex), stats.after);
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+}
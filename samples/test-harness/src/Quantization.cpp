@@ -0,0 +1,380 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Quantization.h"
+#include "Scenes.h"
+
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace Quantization
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static_assert(sizeof(CompactVertex) == 20, "The shaders load compact vertices with a 20 byte stride");
+
+    static const uint64_t ChunkVertices = 4096;         // Vertices per work item
+    static const float    SnormScale = 32767.f;
+    static const float    MaxHalf = 65504.f;            // Larger values convert to infinity
+    static const float    Degrees = 57.29577951f;
+
+    struct WorkItem
+    {
+        const Scenes::Mesh* mesh;
+        CompactVertex*      compactVertices;            // of the mesh
+        uint64_t            firstVertex;
+        uint64_t            numVertices;
+    };
+
+    struct Errors
+    {
+        uint64_t numSignErrors = 0;                     // Tangents with a different bitangent sign after decoding
+        float    maxPositionError = 0.f;                // Relative to the extent of the mesh bounding box
+        float    maxNormalError = 0.f;                  // Degrees
+        float    maxTangentError = 0.f;                 // Degrees
+        float    maxUVError = 0.f;                      // Relative to the magnitude of the texture coordinate (at least 1)
+    };
+
+    int16_t EncodeSnorm(float value)
+    {
+        return static_cast<int16_t>(std::round(std::max(-1.f, std::min(value, 1.f)) * SnormScale));
+    }
+
+    float DecodeSnorm(int16_t value)
+    {
+        return std::max(static_cast<float>(value) / SnormScale, -1.f);
+    }
+
+    uint32_t PackSnorm(int16_t x, int16_t y)
+    {
+        return static_cast<uint32_t>(static_cast<uint16_t>(x)) | (static_cast<uint32_t>(static_cast<uint16_t>(y)) << 16);
+    }
+
+    /**
+     * Decodes the octahedral coordinates, matches DecodeOctahedral() in the shaders.
+     */
+    rtxgi::float3 DecodeOctahedral(float x, float y)
+    {
+        rtxgi::float3 n = { x, y, 1.f - std::abs(x) - std::abs(y) };
+        float t = std::max(-n.z, 0.f);
+        n.x += (n.x >= 0.f) ? -t : t;
+        n.y += (n.y >= 0.f) ? -t : t;
+        float length = std::sqrt((n.x * n.x) + (n.y * n.y) + (n.z * n.z));
+        return { n.x / length, n.y / length, n.z / length };
+    }
+
+    /**
+     * Encodes the direction in octahedral coordinates. Of the 4 snorm values around the exact coordinates, the one that
+     * decodes closest to the direction is chosen.
+     */
+    uint32_t EncodeOctahedral(float x, float y, float z)
+    {
+        float l1 = std::abs(x) + std::abs(y) + std::abs(z);
+        if (l1 == 0.f) return 0;
+
+        float u = x / l1;
+        float v = y / l1;
+        if (z < 0.f)
+        {
+            // Fold the lower hemisphere over the diagonals
+            float fu = (1.f - std::abs(v)) * ((u >= 0.f) ? 1.f : -1.f);
+            float fv = (1.f - std::abs(u)) * ((v >= 0.f) ? 1.f : -1.f);
+            u = fu;
+            v = fv;
+        }
+
+        float length = std::sqrt((x * x) + (y * y) + (z * z));
+        float bestDot = -2.f;
+        uint32_t best = 0;
+        for (uint32_t candidate = 0; candidate < 4; candidate++)
+        {
+            float cu = (candidate & 1) ? std::ceil(u * SnormScale) : std::floor(u * SnormScale);
+            float cv = (candidate & 2) ? std::ceil(v * SnormScale) : std::floor(v * SnormScale);
+            int16_t qu = static_cast<int16_t>(std::max(-SnormScale, std::min(cu, SnormScale)));
+            int16_t qv = static_cast<int16_t>(std::max(-SnormScale, std::min(cv, SnormScale)));
+
+            rtxgi::float3 n = DecodeOctahedral(DecodeSnorm(qu), DecodeSnorm(qv));
+            float dot = ((n.x * x) + (n.y * y) + (n.z * z)) / length;
+            if (dot > bestDot)
+            {
+                bestDot = dot;
+                best = PackSnorm(qu, qv);
+            }
+        }
+        return best;
+    }
+
+    rtxgi::float3 DecodeOctahedral(uint32_t value)
+    {
+        return DecodeOctahedral(DecodeSnorm(static_cast<int16_t>(value & 0xFFFF)), DecodeSnorm(static_cast<int16_t>(value >> 16)));
+    }
+
+    /**
+     * Returns the angle (in degrees) between the direction and its decoded direction, 0 for zero directions.
+     * Computed from the cross and dot products, acos() of the dot product can't resolve angles below about 0.02 degrees in floats.
+     */
+    float GetAngle(const rtxgi::float3& direction, const rtxgi::float3& decoded)
+    {
+        if (direction.x == 0.f && direction.y == 0.f && direction.z == 0.f) return 0.f;
+        float cx = (direction.y * decoded.z) - (direction.z * decoded.y);
+        float cy = (direction.z * decoded.x) - (direction.x * decoded.z);
+        float cz = (direction.x * decoded.y) - (direction.y * decoded.x);
+        float dot = (direction.x * decoded.x) + (direction.y * decoded.y) + (direction.z * decoded.z);
+        return std::atan2(std::sqrt((cx * cx) + (cy * cy) + (cz * cz)), dot) * Degrees;
+    }
+
+    /**
+     * Encodes a range of a mesh's vertices.
+     */
+    void EncodeVertices(const WorkItem& item, Stats& stats)
+    {
+        const rtxgi::AABB& box = item.mesh->boundingBox;
+        for (uint64_t vertexIndex = item.firstVertex; vertexIndex < (item.firstVertex + item.numVertices); vertexIndex++)
+        {
+            Encode(item.mesh->vertices[vertexIndex], box, item.compactVertices[vertexIndex]);
+        }
+        stats.numVertices += item.numVertices;
+    }
+
+    /**
+     * Encodes the work items' vertices on numThreads threads (0: all hardware threads).
+     */
+    void EncodeItems(const std::vector<WorkItem>& items, uint32_t numThreads, Stats& stats)
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        uint32_t numItems = static_cast<uint32_t>(items.size());
+        if (numThreads == 0) numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+        numThreads = std::min(numThreads, std::max(numItems, 1u));
+
+        std::vector<Stats> threadStats(numThreads);
+        std::atomic<uint32_t> next(0);
+        auto encode = [&](uint32_t threadIndex)
+        {
+            for (uint32_t index = next++; index < numItems; index = next++)
+            {
+                EncodeVertices(items[index], threadStats[threadIndex]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 1; thread < numThreads; thread++) threads.emplace_back(encode, thread);
+        encode(0);
+        for (std::thread& thread : threads) thread.join();
+
+        for (const Stats& threadStat : threadStats) stats.numVertices += threadStat.numVertices;
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Measures the round trip errors of a range of a mesh's encoded vertices.
+     */
+    void MeasureVertices(const WorkItem& item, Errors& errors)
+    {
+        const rtxgi::AABB& box = item.mesh->boundingBox;
+        for (uint64_t vertexIndex = item.firstVertex; vertexIndex < (item.firstVertex + item.numVertices); vertexIndex++)
+        {
+            const Graphics::Vertex& vertex = item.mesh->vertices[vertexIndex];
+            Graphics::Vertex decoded;
+            Decode(item.compactVertices[vertexIndex], box, decoded);
+            for (uint32_t axis = 0; axis < 3; axis++)
+            {
+                float extent = box.max[axis] - box.min[axis];
+                if (extent > 0.f) errors.maxPositionError = std::max(errors.maxPositionError, std::abs(decoded.position[axis] - vertex.position[axis]) / extent);
+            }
+            errors.maxNormalError = std::max(errors.maxNormalError, GetAngle(vertex.normal, decoded.normal));
+            errors.maxTangentError = std::max(errors.maxTangentError, GetAngle({ vertex.tangent.x, vertex.tangent.y, vertex.tangent.z }, { decoded.tangent.x, decoded.tangent.y, decoded.tangent.z }));
+            if ((vertex.tangent.w < 0.f) != (decoded.tangent.w < 0.f)) errors.numSignErrors++;
+            for (uint32_t component = 0; component < 2; component++)
+            {
+                float value = vertex.uv0[component];
+                float error = std::abs(decoded.uv0[component] - value) / std::max(std::abs(value), 1.f);
+                errors.maxUVError = std::max(errors.maxUVError, error);
+            }
+        }
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    void GetDequantization(const rtxgi::AABB& boundingBox, float transform[12])
+    {
+        memset(transform, 0, sizeof(float) * 12);
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            transform[(axis * 4) + axis] = (boundingBox.max[axis] - boundingBox.min[axis]) * 0.5f;
+            transform[(axis * 4) + 3] = (boundingBox.max[axis] + boundingBox.min[axis]) * 0.5f;
+        }
+    }
+
+    void Encode(const Graphics::Vertex& vertex, const rtxgi::AABB& boundingBox, CompactVertex& compact)
+    {
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            float halfExtent = (boundingBox.max[axis] - boundingBox.min[axis]) * 0.5f;
+            float center = (boundingBox.max[axis] + boundingBox.min[axis]) * 0.5f;
+            compact.position[axis] = (halfExtent > 0.f) ? EncodeSnorm((vertex.position[axis] - center) / halfExtent) : 0;
+        }
+        compact.position[3] = (vertex.tangent.w < 0.f) ? -32767 : 32767;
+        compact.normal = EncodeOctahedral(vertex.normal.x, vertex.normal.y, vertex.normal.z);
+        compact.tangent = EncodeOctahedral(vertex.tangent.x, vertex.tangent.y, vertex.tangent.z);
+
+        float u = std::max(-MaxHalf, std::min(vertex.uv0.x, MaxHalf));
+        float v = std::max(-MaxHalf, std::min(vertex.uv0.y, MaxHalf));
+        compact.uv0 = static_cast<uint32_t>(DirectX::PackedVector::XMConvertFloatToHalf(u)) | (static_cast<uint32_t>(DirectX::PackedVector::XMConvertFloatToHalf(v)) << 16);
+    }
+
+    void Decode(const CompactVertex& compact, const rtxgi::AABB& boundingBox, Graphics::Vertex& vertex)
+    {
+        float transform[12];
+        GetDequantization(boundingBox, transform);
+        for (uint32_t axis = 0; axis < 3; axis++)
+        {
+            vertex.position[axis] = (transform[(axis * 4) + axis] * DecodeSnorm(compact.position[axis])) + transform[(axis * 4) + 3];
+        }
+        vertex.normal = DecodeOctahedral(compact.normal);
+        rtxgi::float3 tangent = DecodeOctahedral(compact.tangent);
+        vertex.tangent = { tangent.x, tangent.y, tangent.z, DecodeSnorm(compact.position[3]) };
+        vertex.uv0.x = DirectX::PackedVector::XMConvertHalfToFloat(static_cast<DirectX::PackedVector::HALF>(compact.uv0 & 0xFFFF));
+        vertex.uv0.y = DirectX::PackedVector::XMConvertHalfToFloat(static_cast<DirectX::PackedVector::HALF>(compact.uv0 >> 16));
+    }
+
+    void Encode(Scenes::Scene& scene, const Desc& desc, Stats& stats)
+    {
+        // Allocate the compact vertices of the geometry pools that aren't encoded yet, only the meshes of those pools are encoded.
+        // Meshes of an encoded pool keep their compact vertices (Scenes::AllocateGeometry() moves meshes to a pool without them).
+        std::vector<const Scenes::GeometryPool*> pools;
+        for (Scenes::Mesh& mesh : scene.meshes)
+        {
+            if (!mesh.pool || mesh.pool->compactVertices) continue;
+            mesh.pool->compactVertices.reset(new CompactVertex[mesh.pool->numVertices]());
+            pools.push_back(mesh.pool.get());
+        }
+
+        std::vector<WorkItem> items;
+        for (const Scenes::Mesh& mesh : scene.meshes)
+        {
+            if (!mesh.pool || std::find(pools.begin(), pools.end(), mesh.pool.get()) == pools.end()) continue;
+            CompactVertex* compactVertices = GetCompactVertices(mesh);
+            for (uint64_t vertexIndex = 0; vertexIndex < mesh.vertices.size(); vertexIndex += ChunkVertices)
+            {
+                items.push_back({ &mesh, compactVertices, vertexIndex, std::min<uint64_t>(ChunkVertices, mesh.vertices.size() - vertexIndex) });
+            }
+        }
+
+        EncodeItems(items, desc.numThreads, stats);
+    }
+
+    void Clear(Scenes::Scene& scene)
+    {
+        for (Scenes::Mesh& mesh : scene.meshes)
+        {
+            if (mesh.pool) mesh.pool->compactVertices.reset();
+        }
+    }
+
+    bool IsCompact(const Scenes::Mesh& mesh)
+    {
+        return (mesh.pool && mesh.pool->compactVertices);
+    }
+
+    CompactVertex* GetCompactVertices(const Scenes::Mesh& mesh)
+    {
+        return mesh.pool->compactVertices.get() + (mesh.vertices.data() - mesh.pool->vertices.get());
+    }
+
+    uint32_t GetVertexFormat(const Scenes::Mesh& mesh)
+    {
+        return IsCompact(mesh) ? Graphics::VERTEX_FORMAT_COMPACT : Graphics::VERTEX_FORMAT_FLOAT;
+    }
+
+    uint32_t GetVertexStride(const Scenes::Mesh& mesh)
+    {
+        return IsCompact(mesh) ? sizeof(CompactVertex) : sizeof(Graphics::Vertex);
+    }
+
+    uint64_t GetVertexBufferSize(const Scenes::Mesh& mesh)
+    {
+        if (IsCompact(mesh)) return DequantizationSize + (mesh.vertices.size() * sizeof(CompactVertex));
+        return mesh.vertices.size() * sizeof(Graphics::Vertex);
+    }
+
+    uint32_t GetVertexByteAddress(const Scenes::Mesh& mesh, const Scenes::MeshPrimitive& primitive)
+    {
+        if (!IsCompact(mesh)) return primitive.vertexByteOffset;
+        return DequantizationSize + static_cast<uint32_t>((primitive.vertexByteOffset / sizeof(Graphics::Vertex)) * sizeof(CompactVertex));
+    }
+
+    void WriteVertexBuffer(const Scenes::Mesh& mesh, uint8_t* data)
+    {
+        if (!IsCompact(mesh))
+        {
+            memcpy(data, mesh.vertices.data(), mesh.vertices.size() * sizeof(Graphics::Vertex));
+            return;
+        }
+
+        float transform[12];
+        GetDequantization(mesh.boundingBox, transform);
+        memcpy(data, transform, DequantizationSize);
+        memcpy(data + DequantizationSize, GetCompactVertices(mesh), mesh.vertices.size() * sizeof(CompactVertex));
+    }
+
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log)
+    {
+        // Round trip error bounds of the format: half a snorm16 step of the bounding box (with float rounding) for positions,
+        // the octahedral snorm16 grid for directions, and the half float precision for texture coordinates
+        const float maxPositionError = 1.f / SnormScale;
+        const float maxDirectionError = 0.02f;
+        const float maxUVError = 1.f / 1024.f;
+
+        // Encode into scratch compact vertices, the scene's geometry pools are left unchanged
+        std::vector<std::vector<CompactVertex>> compactVertices(scene.meshes.size());
+        std::vector<WorkItem> items;
+        for (size_t meshIndex = 0; meshIndex < scene.meshes.size(); meshIndex++)
+        {
+            const Scenes::Mesh& mesh = scene.meshes[meshIndex];
+            compactVertices[meshIndex].resize(mesh.vertices.size());
+            for (uint64_t vertexIndex = 0; vertexIndex < mesh.vertices.size(); vertexIndex += ChunkVertices)
+            {
+                items.push_back({ &mesh, compactVertices[meshIndex].data(), vertexIndex, std::min<uint64_t>(ChunkVertices, mesh.vertices.size() - vertexIndex) });
+            }
+        }
+
+        std::vector<uint32_t> threadCounts = { 1 };
+        if (std::thread::hardware_concurrency() > 1) threadCounts.push_back(std::thread::hardware_concurrency());
+        for (uint32_t threads : threadCounts)
+        {
+            Stats stats;
+            EncodeItems(items, threads, stats);
+            log << "\n\tEncoded " << stats.numVertices << " vertices with " << threads << " thread(s) in " << (stats.seconds * 1000.0) << "ms, ";
+            log << ((double)stats.numVertices / std::max(stats.seconds, 1e-9) / 1e6) << " M vertices/s";
+        }
+
+        Errors errors;
+        for (const WorkItem& item : items) MeasureVertices(item, errors);
+
+        log << "\n\tMax errors: " << errors.maxPositionError << " of the mesh extent (position), " << errors.maxNormalError << " degrees (normal), ";
+        log << errors.maxTangentError << " degrees (tangent), " << errors.maxUVError << " (uv0), " << errors.numSignErrors << " bitangent signs";
+
+        return (errors.maxPositionError <= maxPositionError) && (errors.maxNormalError <= maxDirectionError) && (errors.maxTangentError <= maxDirectionError)
+            && (errors.maxUVError <= maxUVError) && (errors.numSignErrors == 0);
+    }
+
+}
@@ -0,0 +1,693 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Samplers.h"
+#include "Scenes.h"
+
+#include <rtxgi/Math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+using namespace rtxgi;
+
+namespace Samplers
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    /**
+     * The block layout of a BC7 mode.
+     */
+    struct BC7Mode
+    {
+        uint8_t numSubsets;
+        uint8_t partitionBits;
+        uint8_t rotationBits;
+        uint8_t indexSelectionBits;
+        uint8_t colorBits;
+        uint8_t alphaBits;
+        uint8_t endpointPBits;          // One p-bit per endpoint
+        uint8_t sharedPBits;            // One p-bit per subset
+        uint8_t indexBits;
+        uint8_t indexBits2;             // Secondary index bits (0: no secondary indices)
+    };
+
+    static const BC7Mode BC7Modes[8] =
+    {
+        { 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+        { 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+        { 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+        { 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+        { 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+        { 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+        { 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+        { 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 },
+    };
+
+    // Subsets of the texels of the two subset partitions, 1 bit per texel
+    static const uint16_t BC7Partitions2[64] =
+    {
+        0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+        0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+        0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+        0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A,
+        0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+        0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C,
+        0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22,
+    };
+
+    // Subsets of the texels of the three subset partitions, 2 bits per texel
+    static const uint32_t BC7Partitions3[64] =
+    {
+        0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+        0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+        0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+        0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+        0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+        0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+        0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+        0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254,
+    };
+
+    // Anchor texel of the second subset of the two subset partitions (the first subset's anchor is texel 0)
+    static const uint8_t BC7Anchors2[64] =
+    {
+        15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+        15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        15, 15,  6,  8,  2,  8, 15, 15,  2,  8,  2,  2,  2, 15, 15,  6,
+         6,  2,  6,  8, 15, 15,  2,  2, 15, 15, 15, 15, 15,  2,  2, 15,
+    };
+
+    // Anchor texels of the second and third subsets of the three subset partitions
+    static const uint8_t BC7Anchors3[2][64] =
+    {
+        {
+             3,  3, 15, 15,  8,  3, 15, 15,  8,  8,  6,  6,  6,  5,  3,  3,
+             3,  3,  8, 15,  3,  3,  6, 10,  5,  8,  8,  6,  8,  5, 15, 15,
+             8, 15,  3,  5,  6, 10,  8, 15, 15,  3, 15,  5, 15, 15, 15, 15,
+             3, 15,  5,  5,  5,  8,  5, 10,  5, 10,  8, 13, 15, 12,  3,  3,
+        },
+        {
+            15,  8,  8,  3, 15, 15,  3,  8, 15, 15, 15, 15, 15, 15, 15,  8,
+            15,  8, 15,  3, 15,  8, 15,  8,  3, 15,  6, 10, 15, 15, 10,  8,
+            15,  3, 15, 10, 10,  8,  9, 10,  6, 15,  8, 15,  3,  6,  6,  8,
+            15,  3, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,  3, 15, 15,  8,
+        },
+    };
+
+    // Interpolation weights of 2, 3, and 4 bit indices
+    static const uint8_t BC7Weights2[4] = { 0, 21, 43, 64 };
+    static const uint8_t BC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+    static const uint8_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    const uint8_t* GetBC7Weights(uint32_t indexBits)
+    {
+        if (indexBits == 2) return BC7Weights2;
+        if (indexBits == 3) return BC7Weights3;
+        return BC7Weights4;
+    }
+
+    /**
+     * Reads the bits of a 128-bit block, from the least significant bit of its first byte.
+     */
+    struct BlockReader
+    {
+        uint64_t low;
+        uint64_t high;
+        uint32_t position = 0;
+
+        explicit BlockReader(const uint8_t* block)
+        {
+            memcpy(&low, block, sizeof(uint64_t));
+            memcpy(&high, block + sizeof(uint64_t), sizeof(uint64_t));
+        }
+
+        uint32_t Read(uint32_t numBits)
+        {
+            uint64_t bits;
+            if (position >= 64) bits = high >> (position - 64);
+            else if ((position + numBits) <= 64) bits = low >> position;
+            else bits = (low >> position) | (high << (64 - position));
+            position += numBits;
+            return static_cast<uint32_t>(bits) & ((1u << numBits) - 1);
+        }
+    };
+
+    /**
+     * Expands an endpoint component of the given precision to 8 bits (replicating its high bits).
+     */
+    uint8_t Unquantize(uint32_t value, uint32_t numBits)
+    {
+        value <<= (8 - numBits);
+        return static_cast<uint8_t>(value | (value >> numBits));
+    }
+
+    uint8_t Interpolate(uint8_t e0, uint8_t e1, uint32_t weight)
+    {
+        return static_cast<uint8_t>((((64 - weight) * e0) + (weight * e1) + 32) >> 6);
+    }
+
+    int64_t Wrap(int64_t coordinate, uint32_t size)
+    {
+        int64_t wrapped = coordinate % static_cast<int64_t>(size);
+        return (wrapped < 0) ? wrapped + size : wrapped;
+    }
+
+    /**
+     * Copies the RGBA8 texel at wrapped coordinates of a mip, decoding (and caching) its BC7 block.
+     */
+    void LoadTexel(const View& view, const Mip& mip, uint32_t x, uint32_t y, BlockCache& cache, uint8_t texel[4])
+    {
+        if (view.format == Textures::ETextureFormat::UNCOMPRESSED)
+        {
+            memcpy(texel, view.texels + mip.offset + (static_cast<uint64_t>(y) * mip.rowPitch) + (static_cast<uint64_t>(x) * 4), 4);
+            return;
+        }
+
+        uint32_t blockX = x >> 2;
+        uint32_t blockY = y >> 2;
+        const uint8_t* block = view.texels + mip.offset + (static_cast<uint64_t>(blockY) * mip.rowPitch) + (static_cast<uint64_t>(blockX) * 16);
+
+        uint32_t entry = (blockX & 15) | ((blockY & 15) << 4);
+        if (cache.blocks[entry] == block)
+        {
+            cache.numHits++;
+        }
+        else
+        {
+            DecodeBC7Block(block, cache.texels[entry]);
+            cache.blocks[entry] = block;
+            cache.numMisses++;
+        }
+        memcpy(texel, cache.texels[entry][((y & 3) * 4) + (x & 3)], 4);
+    }
+
+    float4 Lerp(const float4& a, const float4& b, float t)
+    {
+        return { a.x + ((b.x - a.x) * t), a.y + ((b.y - a.y) * t), a.z + ((b.z - a.z) * t), a.w + ((b.w - a.w) * t) };
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Benchmark Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    struct Random
+    {
+        uint32_t state;
+
+        explicit Random(uint32_t seed) : state(seed * 747796405u + 2891336453u) {}
+
+        float Next()
+        {
+            state = (state * 1664525u) + 1013904223u;
+            return (float)(state >> 8) * (1.f / 16777216.f);
+        }
+
+        float Next(float min, float max) { return min + ((max - min) * Next()); }
+    };
+
+    enum class EBenchmarkFilter
+    {
+        Bilinear = 0,       // Mip 0
+        Trilinear,          // Between mips 1 and 2
+        RayCone,            // Texture coordinate differentials of probe ray cones, then trilinear
+        Count
+    };
+
+    /**
+     * Samples the texture with the filter and returns the samples per second (millions).
+     * Coherent samples step through the texture a texel at a time along its rows, incoherent samples are random.
+     */
+    double Measure(const View& view, EBenchmarkFilter filter, bool coherent, uint32_t numSamples, BlockCache& cache, float& sum)
+    {
+        const Mip& mip = view.mips[0];
+        const float2 texelSize = { 1.f / (float)mip.width, 1.f / (float)mip.height };
+
+        // Probe ray cones on a triangle spanning the texture, 2 units wide (hits 1 to 8 units away)
+        const float3 positions[3] = { { -1.f, -1.f, 0.f }, { 1.f, -1.f, 0.f }, { -1.f, 1.f, 0.f } };
+        const float2 uvs[3] = { { 0.f, 0.f }, { 1.f, 0.f }, { 0.f, 1.f } };
+        const float spread = GetConeSpreadAngle(256);
+
+        Random random(7);
+        auto start = std::chrono::high_resolution_clock::now();
+        for (uint32_t index = 0; index < numSamples; index++)
+        {
+            float2 uv;
+            if (coherent)
+            {
+                uint64_t texel = index % (static_cast<uint64_t>(mip.width) * mip.height);
+                uv = { ((float)(texel % mip.width) + 0.25f) * texelSize.x, ((float)(texel / mip.width) + 0.25f) * texelSize.y };
+            }
+            else
+            {
+                uv = { random.Next(), random.Next() };
+            }
+
+            float4 sample;
+            if (filter == EBenchmarkFilter::Bilinear)
+            {
+                sample = SampleBilinear(view, 0, uv, cache);
+            }
+            else if (filter == EBenchmarkFilter::Trilinear)
+            {
+                sample = SampleLevel(view, uv, 1.5f, cache);
+            }
+            else
+            {
+                float3 hitPoint = { (uv.x * 2.f) - 1.f, (uv.y * 2.f) - 1.f, 0.f };
+                float3 origin = { hitPoint.x * 0.5f, hitPoint.y * 0.5f, 1.f + (7.f * (float)(index & 255) / 255.f) };
+                float3 direction = hitPoint - origin;
+                float hitT = sqrtf(Dot(direction, direction));
+                direction = direction * (1.f / hitT);
+
+                float2 dUVdx, dUVdy;
+                ComputeUV0Differentials(positions, uvs, direction, hitT, spread, dUVdx, dUVdy);
+                sample = SampleGrad(view, uv, dUVdx, dUVdy, cache);
+            }
+            sum += sample.x + sample.w;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        return (double)numSamples / std::max(seconds, 1e-9) * 1e-6;
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    bool CreateView(const Textures::Texture& texture, View& view)
+    {
+        view = View();
+        if (texture.texels == nullptr || texture.width == 0 || texture.height == 0) return false;
+
+        view.format = texture.format;
+        view.texels = texture.texels;
+        if (texture.format == Textures::ETextureFormat::UNCOMPRESSED)
+        {
+            // Tightly packed RGBA8 rows, without mips
+            if (texture.stride != 4) return false;
+
+            Mip mip;
+            mip.width = texture.width;
+            mip.height = texture.height;
+            mip.rowPitch = texture.width * 4;
+            if ((static_cast<uint64_t>(mip.rowPitch) * mip.height) > texture.texelBytes) return false;
+            view.mips.push_back(mip);
+            return true;
+        }
+
+        if (texture.format != Textures::ETextureFormat::BC7 || texture.stride != 1) return false;
+
+        // Block rows are 256 byte aligned and mips are 512 byte aligned. The last mip of a mip chain is stored as a single block.
+        uint32_t numMips = std::max(texture.mips, 1u);
+        uint64_t offset = 0;
+        for (uint32_t mipIndex = 0; mipIndex < numMips; mipIndex++)
+        {
+            Mip mip;
+            mip.width = std::max(texture.width >> mipIndex, 1u);
+            mip.height = std::max(texture.height >> mipIndex, 1u);
+
+            uint32_t blocksWide = (mip.width + 3) / 4;
+            uint32_t blocksHigh = (mip.height + 3) / 4;
+            mip.rowPitch = blocksWide * 16;
+            mip.offset = offset;
+
+            uint64_t size;
+            if (numMips > 1 && (mipIndex + 1) == numMips)
+            {
+                // A truncated mip chain's last mip has more blocks than were stored, it isn't sampled
+                if (blocksWide > 1 || blocksHigh > 1) break;
+                size = 16;
+            }
+            else
+            {
+                size = Textures::GetBC7TextureSizeInBytes(blocksWide * 4, blocksHigh * 4);
+                mip.rowPitch = (mip.rowPitch + 255) & ~255u;
+            }
+            if ((offset + size) > texture.texelBytes) break;
+
+            view.mips.push_back(mip);
+            offset += size;
+        }
+        return !view.mips.empty();
+    }
+
+    void DecodeBC7Block(const uint8_t* block, uint8_t texels[16][4])
+    {
+        // The mode is the position of the first byte's lowest set bit, blocks without a mode are reserved and decode to zeros
+        uint32_t mode = 0;
+        while (mode < 8 && ((block[0] >> mode) & 1) == 0) mode++;
+        if (mode == 8)
+        {
+            memset(texels, 0, 16 * 4);
+            return;
+        }
+
+        const BC7Mode& info = BC7Modes[mode];
+        BlockReader reader(block);
+        reader.position = mode + 1;
+
+        uint32_t partition = reader.Read(info.partitionBits);
+        uint32_t rotation = reader.Read(info.rotationBits);
+        uint32_t indexSelection = reader.Read(info.indexSelectionBits);
+
+        // Endpoints: all the endpoints of each color channel, then the alpha channel's
+        uint32_t numEndpoints = info.numSubsets * 2;
+        uint32_t endpoints[6][4] = {};
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            for (uint32_t endpoint = 0; endpoint < numEndpoints; endpoint++) endpoints[endpoint][channel] = reader.Read(info.colorBits);
+        }
+        if (info.alphaBits > 0)
+        {
+            for (uint32_t endpoint = 0; endpoint < numEndpoints; endpoint++) endpoints[endpoint][3] = reader.Read(info.alphaBits);
+        }
+
+        // P-bits are the least significant bit of each channel of their endpoints
+        uint32_t colorBits = info.colorBits;
+        uint32_t alphaBits = info.alphaBits;
+        if (info.endpointPBits || info.sharedPBits)
+        {
+            uint32_t pBits[6];
+            if (info.endpointPBits)
+            {
+                for (uint32_t endpoint = 0; endpoint < numEndpoints; endpoint++) pBits[endpoint] = reader.Read(1);
+            }
+            else
+            {
+                for (uint32_t subset = 0; subset < info.numSubsets; subset++) pBits[subset * 2] = pBits[(subset * 2) + 1] = reader.Read(1);
+            }
+
+            for (uint32_t endpoint = 0; endpoint < numEndpoints; endpoint++)
+            {
+                for (uint32_t channel = 0; channel < 4; channel++) endpoints[endpoint][channel] = (endpoints[endpoint][channel] << 1) | pBits[endpoint];
+            }
+            colorBits++;
+            if (alphaBits > 0) alphaBits++;
+        }
+
+        uint8_t colors[6][4];
+        for (uint32_t endpoint = 0; endpoint < numEndpoints; endpoint++)
+        {
+            for (uint32_t channel = 0; channel < 3; channel++) colors[endpoint][channel] = Unquantize(endpoints[endpoint][channel], colorBits);
+            colors[endpoint][3] = (alphaBits > 0) ? Unquantize(endpoints[endpoint][3], alphaBits) : 255;
+        }
+
+        // Subset of each texel
+        uint8_t subsets[16];
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            if (info.numSubsets == 1) subsets[texel] = 0;
+            else if (info.numSubsets == 2) subsets[texel] = (BC7Partitions2[partition] >> texel) & 1;
+            else subsets[texel] = (BC7Partitions3[partition] >> (texel * 2)) & 3;
+        }
+
+        // Indices, the anchor texel of each subset has one less bit
+        uint8_t indices[16];
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            bool anchor = (texel == 0);
+            if (info.numSubsets == 2) anchor |= (texel == BC7Anchors2[partition]);
+            else if (info.numSubsets == 3) anchor |= (texel == BC7Anchors3[0][partition]) || (texel == BC7Anchors3[1][partition]);
+            indices[texel] = static_cast<uint8_t>(reader.Read(info.indexBits - (anchor ? 1 : 0)));
+        }
+
+        uint8_t indices2[16];
+        if (info.indexBits2 > 0)
+        {
+            for (uint32_t texel = 0; texel < 16; texel++) indices2[texel] = static_cast<uint8_t>(reader.Read(info.indexBits2 - ((texel == 0) ? 1 : 0)));
+        }
+
+        // Color and alpha use their own indices when the block has secondary indices, the index selection bit swaps them
+        const uint8_t* colorIndices = indices;
+        const uint8_t* alphaIndices = indices;
+        uint32_t colorIndexBits = info.indexBits;
+        uint32_t alphaIndexBits = info.indexBits;
+        if (info.indexBits2 > 0)
+        {
+            alphaIndices = indices2;
+            alphaIndexBits = info.indexBits2;
+            if (indexSelection)
+            {
+                std::swap(colorIndices, alphaIndices);
+                std::swap(colorIndexBits, alphaIndexBits);
+            }
+        }
+        const uint8_t* colorWeights = GetBC7Weights(colorIndexBits);
+        const uint8_t* alphaWeights = GetBC7Weights(alphaIndexBits);
+
+        for (uint32_t texel = 0; texel < 16; texel++)
+        {
+            const uint8_t* e0 = colors[subsets[texel] * 2];
+            const uint8_t* e1 = colors[(subsets[texel] * 2) + 1];
+            uint32_t colorWeight = colorWeights[colorIndices[texel]];
+            uint32_t alphaWeight = alphaWeights[alphaIndices[texel]];
+
+            uint8_t* rgba = texels[texel];
+            rgba[0] = Interpolate(e0[0], e1[0], colorWeight);
+            rgba[1] = Interpolate(e0[1], e1[1], colorWeight);
+            rgba[2] = Interpolate(e0[2], e1[2], colorWeight);
+            rgba[3] = Interpolate(e0[3], e1[3], alphaWeight);
+
+            // Rotation swaps alpha with one of the color channels
+            if (rotation > 0) std::swap(rgba[rotation - 1], rgba[3]);
+        }
+    }
+
+    bool LoadMip(const View& view, uint32_t mip, std::vector<uint8_t>& texels)
+    {
+        if (mip >= view.mips.size()) return false;
+
+        const Mip& level = view.mips[mip];
+        size_t rowSize = static_cast<size_t>(level.width) * 4;
+        texels.resize(rowSize * level.height);
+
+        if (view.format == Textures::ETextureFormat::UNCOMPRESSED)
+        {
+            for (uint32_t y = 0; y < level.height; y++) memcpy(&texels[y * rowSize], view.texels + level.offset + (static_cast<uint64_t>(y) * level.rowPitch), rowSize);
+            return true;
+        }
+
+        // Decode block after block, copying the texels inside the mip
+        uint8_t block[16][4];
+        for (uint32_t blockY = 0; blockY < ((level.height + 3) / 4); blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < ((level.width + 3) / 4); blockX++)
+            {
+                DecodeBC7Block(view.texels + level.offset + (static_cast<uint64_t>(blockY) * level.rowPitch) + (static_cast<uint64_t>(blockX) * 16), block);
+
+                uint32_t width = std::min(4u, level.width - (blockX * 4));
+                uint32_t height = std::min(4u, level.height - (blockY * 4));
+                for (uint32_t row = 0; row < height; row++)
+                {
+                    memcpy(&texels[(((blockY * 4) + row) * rowSize) + (blockX * 16)], block[row * 4], width * 4);
+                }
+            }
+        }
+        return true;
+    }
+
+    float4 Load(const View& view, uint32_t mip, int64_t x, int64_t y, BlockCache& cache)
+    {
+        const Mip& level = view.mips[mip];
+
+        uint8_t texel[4];
+        LoadTexel(view, level, static_cast<uint32_t>(Wrap(x, level.width)), static_cast<uint32_t>(Wrap(y, level.height)), cache, texel);
+        return { texel[0] / 255.f, texel[1] / 255.f, texel[2] / 255.f, texel[3] / 255.f };
+    }
+
+    float4 SampleBilinear(const View& view, uint32_t mip, const float2& uv, BlockCache& cache)
+    {
+        const Mip& level = view.mips[mip];
+
+        // Texel space, with texel centers at integer coordinates
+        float x = (uv.x * (float)level.width) - 0.5f;
+        float y = (uv.y * (float)level.height) - 0.5f;
+        if (!std::isfinite(x) || !std::isfinite(y)) return { 0.f, 0.f, 0.f, 0.f };
+
+        float x0 = floorf(x);
+        float y0 = floorf(y);
+        float wx = x - x0;
+        float wy = y - y0;
+
+        // Wrap addressing
+        uint32_t left = static_cast<uint32_t>(Wrap(static_cast<int64_t>(x0), level.width));
+        uint32_t top = static_cast<uint32_t>(Wrap(static_cast<int64_t>(y0), level.height));
+        uint32_t right = ((left + 1) == level.width) ? 0 : left + 1;
+        uint32_t bottom = ((top + 1) == level.height) ? 0 : top + 1;
+
+        uint8_t texels[4][4];
+        LoadTexel(view, level, left, top, cache, texels[0]);
+        LoadTexel(view, level, right, top, cache, texels[1]);
+        LoadTexel(view, level, left, bottom, cache, texels[2]);
+        LoadTexel(view, level, right, bottom, cache, texels[3]);
+
+        float weights[4] = { (1.f - wx) * (1.f - wy), wx * (1.f - wy), (1.f - wx) * wy, wx * wy };
+        float result[4];
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            float value = (texels[0][channel] * weights[0]) + (texels[1][channel] * weights[1]) + (texels[2][channel] * weights[2]) + (texels[3][channel] * weights[3]);
+            result[channel] = value * (1.f / 255.f);
+        }
+        return { result[0], result[1], result[2], result[3] };
+    }
+
+    float4 SampleLevel(const View& view, const float2& uv, float lod, BlockCache& cache)
+    {
+        float maxLod = (float)(view.mips.size() - 1);
+        lod = std::min(std::max(lod, 0.f), maxLod);     // NaN lods sample mip 0
+
+        uint32_t mip = static_cast<uint32_t>(lod);
+        float t = lod - (float)mip;
+        float4 sample = SampleBilinear(view, mip, uv, cache);
+        if (t > 0.f) sample = Lerp(sample, SampleBilinear(view, mip + 1, uv, cache), t);
+        return sample;
+    }
+
+    float ComputeLod(const View& view, const float2& dUVdx, const float2& dUVdy)
+    {
+        const Mip& mip = view.mips[0];
+        float2 dx = { dUVdx.x * (float)mip.width, dUVdx.y * (float)mip.height };
+        float2 dy = { dUVdy.x * (float)mip.width, dUVdy.y * (float)mip.height };
+
+        float lengthSquared = std::max((dx.x * dx.x) + (dx.y * dx.y), (dy.x * dy.x) + (dy.y * dy.y));
+        if (!(lengthSquared > 0.f)) return 0.f;
+        return 0.5f * log2f(lengthSquared);
+    }
+
+    float4 SampleGrad(const View& view, const float2& uv, const float2& dUVdx, const float2& dUVdy, BlockCache& cache)
+    {
+        return SampleLevel(view, uv, ComputeLod(view, dUVdx, dUVdy), cache);
+    }
+
+    float GetConeSpreadAngle(uint32_t numRays)
+    {
+        // The angle of a cone with the solid angle of one ray
+        return sqrtf((4.f * RTXGI_PI) / (float)std::max(numRays, 1u));
+    }
+
+    void ComputeUV0Differentials(const float3 positions[3], const float2 uvs[3], const float3& rayDirection, float hitT, float coneSpreadAngle, float2& dUVdx, float2& dUVdy)
+    {
+        // Ray direction differentials: the cone's spread along two directions perpendicular to the ray (instead of a camera pixel's)
+        float3 up = (fabsf(rayDirection.y) < 0.999f) ? float3{ 0.f, 1.f, 0.f } : float3{ 1.f, 0.f, 0.f };
+        float3 right = Normalize(Cross(rayDirection, up));
+        up = Cross(right, rayDirection);
+        float3 dDdx = right * coneSpreadAngle;
+        float3 dDdy = up * coneSpreadAngle;
+
+        // Triangle edges and face normal
+        float3 edge01 = positions[1] - positions[0];
+        float3 edge02 = positions[2] - positions[0];
+        float3 faceNormal = Cross(edge01, edge02);
+
+        // Propagate the ray differential to the hit point (Igehy equations 10 and 12), the origin differentials are zero
+        float3 dOdx = dDdx * hitT;
+        float3 dOdy = dDdy * hitT;
+        float rcpDN = 1.f / Dot(rayDirection, faceNormal);
+        dOdx = dOdx + (rayDirection * (-Dot(dOdx, faceNormal) * rcpDN));
+        dOdy = dOdy + (rayDirection * (-Dot(dOdy, faceNormal) * rcpDN));
+
+        // Barycentric differentials (Igehy "Normal-Interpolated Triangles")
+        float3 Nu = Cross(edge02, faceNormal);
+        float3 Nv = Cross(edge01, faceNormal);
+        float3 Lu = Nu * (1.f / Dot(Nu, edge01));
+        float3 Lv = Nv * (1.f / Dot(Nv, edge02));
+        float2 dBarydx = { Dot(Lu, dOdx), Dot(Lv, dOdx) };
+        float2 dBarydy = { Dot(Lu, dOdy), Dot(Lv, dOdy) };
+
+        // Texture coordinate differentials
+        float2 delta1 = uvs[1] - uvs[0];
+        float2 delta2 = uvs[2] - uvs[0];
+        dUVdx = { (dBarydx.x * delta1.x) + (dBarydx.y * delta2.x), (dBarydx.x * delta1.y) + (dBarydx.y * delta2.y) };
+        dUVdy = { (dBarydy.x * delta1.x) + (dBarydy.y * delta2.x), (dBarydy.x * delta1.y) + (dBarydy.y * delta2.y) };
+    }
+
+    bool Benchmark(const Scenes::Scene& scene, std::ofstream& log)
+    {
+        const uint32_t numSamples = 1 << 20;
+        const uint32_t numValidationTexels = 256;
+        const char* formatNames[2] = { "RGBA8", "BC7" };
+        const char* filterNames[static_cast<uint32_t>(EBenchmarkFilter::Count)] = { "bilinear", "trilinear", "ray cone" };
+
+        // Check bilinear samples at texel centers against texel loads, in every mip of every texture
+        BlockCache cache;
+        Random random(1);
+        uint32_t numViews[2] = { 0, 0 };
+        uint32_t numMismatches = 0;
+        uint32_t numChecks = 0;
+        std::vector<View> views(scene.textures.size());
+        for (size_t textureIndex = 0; textureIndex < scene.textures.size(); textureIndex++)
+        {
+            View& view = views[textureIndex];
+            if (!CreateView(scene.textures[textureIndex], view)) continue;
+            numViews[static_cast<uint32_t>(view.format)]++;
+
+            for (uint32_t mip = 0; mip < (uint32_t)view.mips.size(); mip++)
+            {
+                const Mip& level = view.mips[mip];
+                for (uint32_t index = 0; index < numValidationTexels; index++, numChecks++)
+                {
+                    int64_t x = static_cast<int64_t>(random.Next() * (float)level.width);
+                    int64_t y = static_cast<int64_t>(random.Next() * (float)level.height);
+                    float2 uv = { ((float)x + 0.5f) / (float)level.width, ((float)y + 0.5f) / (float)level.height };
+
+                    float4 texel = Load(view, mip, x, y, cache);
+                    float4 sample = SampleBilinear(view, mip, uv, cache);
+                    float difference = std::max(std::max(fabsf(texel.x - sample.x), fabsf(texel.y - sample.y)), std::max(fabsf(texel.z - sample.z), fabsf(texel.w - sample.w)));
+                    if (difference > 1e-3f) numMismatches++;
+                }
+            }
+        }
+
+        log << "\n\tCPU samplers: " << numViews[0] << " " << formatNames[0] << " textures, " << numViews[1] << " " << formatNames[1] << " textures";
+        log << "\n\tTexel center check: " << numMismatches << " of " << numChecks << " samples differ";
+
+        // Measure on the largest texture of each format, single threaded
+        float sum = 0.f;
+        for (uint32_t format = 0; format < 2; format++)
+        {
+            const View* view = nullptr;
+            uint64_t numTexels = 0;
+            for (const View& candidate : views)
+            {
+                if (candidate.mips.empty() || static_cast<uint32_t>(candidate.format) != format) continue;
+                uint64_t candidateTexels = static_cast<uint64_t>(candidate.mips[0].width) * candidate.mips[0].height;
+                if (candidateTexels > numTexels) { view = &candidate; numTexels = candidateTexels; }
+            }
+            if (view == nullptr) continue;
+
+            log << "\n\t" << formatNames[format] << " " << view->mips[0].width << "x" << view->mips[0].height << ", " << view->mips.size() << " mips:";
+            for (uint32_t filter = 0; filter < static_cast<uint32_t>(EBenchmarkFilter::Count); filter++)
+            {
+                log << "\n\t\t" << filterNames[filter] << ":";
+                for (bool coherent : { true, false })
+                {
+                    cache = BlockCache();
+                    double rate = Measure(*view, static_cast<EBenchmarkFilter>(filter), coherent, numSamples, cache, sum);
+                    log << " " << rate << " Msamples/s " << (coherent ? "coherent" : "incoherent");
+                    if (format == static_cast<uint32_t>(Textures::ETextureFormat::BC7))
+                    {
+                        log << " (" << (100.0 * cache.numHits / std::max(cache.numHits + cache.numMisses, (uint64_t)1)) << "% block cache hits)";
+                    }
+                    if (coherent) log << ",";
+                }
+            }
+        }
+        if (!std::isfinite(sum)) log << "\n\tNon-finite samples!";
+
+        return (numMismatches == 0);
+    }
+
+}
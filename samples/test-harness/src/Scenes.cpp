@@ -9,7 +9,10 @@
 */
 
 #include "Caches.h"
+#include "Opacity.h"
+#include "Optimize.h"
 #include "Scenes.h"
+#include "Simplify.h"
 #include "UI.h"
 
 #define TINYGLTF_IMPLEMENTATION
@@ -18,7 +21,11 @@
 #define TINYGLTF_NO_STB_IMAGE_WRITE
 #include <tiny_gltf.h>
 
+#include <atomic>
+#include <chrono>
 #include <regex>
+#include <thread>
+#include <unordered_map>
 #include <math.h>
 
 using namespace DirectX;
@@ -255,10 +262,23 @@ namespace Scenes
         }
     }
 
+    /**
+     * Returns the content hash of the scene source file with the uri, 0 if the scene has no such source.
+     */
+    uint64_t GetSourceHash(const Scene& scene, const std::string& uri)
+    {
+        for (const SourceFile& source : scene.sources)
+        {
+            if (source.uri == uri) return source.hash;
+        }
+        return 0;
+    }
+
     /**
      * Parse glTF textures and load the images.
+     * Textures of the cached scene with the content hash of the image are reused, instead of loading (and compressing) the image again.
      */
-    bool ParseGLFTextures(const tinygltf::Model& gltfData, const Configs::Config& config, Scene& scene)
+    bool ParseGLFTextures(const tinygltf::Model& gltfData, const Configs::Config& config, Scene& cached, Scene& scene, uint32_t& numReused)
     {
         for (uint32_t textureIndex = 0; textureIndex < static_cast<uint32_t>(gltfData.textures.size()); textureIndex++)
         {
@@ -278,14 +298,34 @@ namespace Scenes
 
             // Construct the texture image filepath
             texture.filepath = config.app.root + config.scene.path + ParseURI(gltfImage.uri);
+            texture.hash = GetSourceHash(scene, ParseURI(gltfImage.uri));
 
-            // Load the texture from disk
-            if (!Textures::Load(texture)) return false;
+            // Reuse the cached texture of the image (the cached scene releases its texels)
+            std::vector<Textures::Texture>::iterator reused = cached.textures.end();
+            if (texture.hash != 0)
+            {
+                reused = std::find_if(cached.textures.begin(), cached.textures.end(), [&](const Textures::Texture& t) { return t.hash == texture.hash; });
+            }
 
-        #if defined(WIN32) && defined(__x86_64__) || defined(_M_X64)
-            // Generate mipmaps and compress the texture (Windows only)
-            if(!Textures::MipmapAndCompress(texture)) return false;
-        #endif
+            if (reused != cached.textures.end())
+            {
+                Textures::Texture image = *reused;
+                *reused = Textures::Texture();
+                image.name = texture.name;
+                image.filepath = texture.filepath;
+                texture = image;
+                numReused++;
+            }
+            else
+            {
+                // Load the texture from disk
+                if (!Textures::Load(texture)) return false;
+
+            #if defined(WIN32) && defined(__x86_64__) || defined(_M_X64)
+                // Generate mipmaps and compress the texture (Windows only)
+                if(!Textures::MipmapAndCompress(texture)) return false;
+            #endif
+            }
 
             // Add the texture to the scene
             scene.textures.push_back(texture);
@@ -293,32 +333,263 @@ namespace Scenes
         return true;
     }
 
+    /**
+     * Returns the content hash of a glTF mesh: its name, its primitives' materials (and their alpha modes), and the layout and data of their accessors.
+     */
+    uint64_t HashGLTFMesh(const tinygltf::Model& gltfData, const tinygltf::Mesh& gltfMesh, const Scene& scene)
+    {
+        uint64_t hash = Caches::Hash(gltfMesh.name.data(), gltfMesh.name.size());
+        for (const tinygltf::Primitive& p : gltfMesh.primitives)
+        {
+            int material = (p.material == -1) ? 0 : p.material;
+            int values[2] = { material, scene.materials[material].data.alphaMode };
+            hash = Caches::Hash(values, sizeof(values), hash);
+
+            const char* attributes[] = { "POSITION", "NORMAL", "TANGENT", "TEXCOORD_0" };
+            int accessors[] = { p.indices, -1, -1, -1, -1 };
+            for (uint32_t attributeIndex = 0; attributeIndex < 4; attributeIndex++)
+            {
+                if (p.attributes.count(attributes[attributeIndex]) > 0) accessors[attributeIndex + 1] = p.attributes.at(attributes[attributeIndex]);
+            }
+
+            for (int accessorIndex : accessors)
+            {
+                hash = Caches::Hash(&accessorIndex, sizeof(int), hash);
+                if (accessorIndex < 0 || accessorIndex >= static_cast<int>(gltfData.accessors.size())) continue;
+
+                const tinygltf::Accessor& accessor = gltfData.accessors[accessorIndex];
+                uint64_t layout[3] = { static_cast<uint64_t>(accessor.componentType), static_cast<uint64_t>(accessor.type), static_cast<uint64_t>(accessor.count) };
+                hash = Caches::Hash(layout, sizeof(layout), hash);
+                if (accessor.bufferView < 0 || accessor.bufferView >= static_cast<int>(gltfData.bufferViews.size())) continue;
+
+                // The accessor's elements, as read by ParseGLTFMeshes()
+                const tinygltf::BufferView& bufferView = gltfData.bufferViews[accessor.bufferView];
+                if (bufferView.buffer < 0 || bufferView.buffer >= static_cast<int>(gltfData.buffers.size())) continue;
+                const std::vector<unsigned char>& data = gltfData.buffers[bufferView.buffer].data;
+
+                uint64_t elementSize = static_cast<uint64_t>(tinygltf::GetComponentSizeInBytes(accessor.componentType) * tinygltf::GetNumComponentsInType(accessor.type));
+                uint64_t stride = static_cast<uint64_t>(std::max(accessor.ByteStride(bufferView), 0));
+                uint64_t offset = std::min(static_cast<uint64_t>(bufferView.byteOffset + accessor.byteOffset), static_cast<uint64_t>(data.size()));
+                uint64_t span = (accessor.count > 0) ? ((static_cast<uint64_t>(accessor.count) - 1) * stride) + elementSize : 0;
+                uint64_t size = std::min(span, static_cast<uint64_t>(data.size()) - offset);
+                hash = Caches::Hash(data.data() + offset, size, hash);
+            }
+        }
+        return hash;
+    }
+
+    /**
+     * Returns the index of the glTF primitive's accessor of the attribute, -1 if the primitive doesn't have the attribute.
+     */
+    int GetGLTFAttribute(const tinygltf::Primitive& p, const char* attribute)
+    {
+        std::map<std::string, int>::const_iterator it = p.attributes.find(attribute);
+        return (it == p.attributes.end()) ? -1 : it->second;
+    }
+
+    /**
+     * Returns the address of the glTF accessor's first element and the distance between its elements (which are interleaved
+     * with other accessors' elements or tightly packed), null if the accessor doesn't exist.
+     */
+    const uint8_t* GetGLTFAccessorData(const tinygltf::Model& gltfData, int accessorIndex, size_t& byteStride)
+    {
+        if (accessorIndex < 0) return nullptr;
+
+        const tinygltf::Accessor& accessor = gltfData.accessors[accessorIndex];
+        const tinygltf::BufferView& bufferView = gltfData.bufferViews[accessor.bufferView];
+        byteStride = static_cast<size_t>(accessor.ByteStride(bufferView));
+        return gltfData.buffers[bufferView.buffer].data.data() + bufferView.byteOffset + accessor.byteOffset;
+    }
+
+    /**
+     * Converts a glTF vector (right hand, y-up) to the chosen coordinate system. The w component is unchanged.
+     */
+    inline XMVECTOR ConvertGLTFVector(FXMVECTOR v)
+    {
+    #if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT
+        // Invert the z-coordinate to convert from right hand to left hand
+        return XMVectorMultiply(v, g_XMNegateZ);
+    #elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP
+        // Convert to left hand, z-up (unreal): (-z, x, y)
+        return XMVectorMultiply(XMVectorSwizzle<2, 0, 1, 3>(v), g_XMNegateX);
+    #elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT_Z_UP
+        // Convert to right hand, z-up: (x, -z, y)
+        return XMVectorMultiply(XMVectorSwizzle<0, 2, 1, 3>(v), g_XMNegateY);
+    #else
+        return v;
+    #endif
+    }
+
+    /**
+     * Converts the glTF vectors of 3 or 4 floats (srcStride bytes apart) to the chosen coordinate system and stores them in the vertices,
+     * at the offset of the vertex member. Positions also update the bounds.
+     */
+    template<uint32_t NumComponents, bool Bounds>
+    void ConvertGLTFVectors(const uint8_t* src, size_t srcStride, size_t count, Graphics::Vertex* vertices, size_t offset, XMVECTOR& min, XMVECTOR& max)
+    {
+        uint8_t* dst = reinterpret_cast<uint8_t*>(vertices) + offset;
+        for (size_t index = 0; index < count; index++, src += srcStride, dst += sizeof(Graphics::Vertex))
+        {
+            if (NumComponents == 3)
+            {
+                XMVECTOR v = ConvertGLTFVector(XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(src)));
+                XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(dst), v);
+                if (Bounds)
+                {
+                    min = XMVectorMin(min, v);
+                    max = XMVectorMax(max, v);
+                }
+            }
+            else
+            {
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(dst), ConvertGLTFVector(XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(src))));
+            }
+        }
+    }
+
+    /**
+     * Reads the vertices, indices, and bounding box of a glTF mesh primitive into its views of the geometry pool.
+     * Each attribute is converted in a separate pass over the vertices, without per vertex branches.
+     */
+    void ParseGLTFPrimitive(const tinygltf::Model& gltfData, const tinygltf::Primitive& p, MeshPrimitive& mp)
+    {
+        size_t numVertices = mp.vertices.size();
+        size_t positionStride = 0, normalStride = 0, tangentStride = 0, uv0Stride = 0, stride = 0;
+        const uint8_t* positions = GetGLTFAccessorData(gltfData, GetGLTFAttribute(p, "POSITION"), positionStride);
+        const uint8_t* normals = GetGLTFAccessorData(gltfData, GetGLTFAttribute(p, "NORMAL"), normalStride);
+        const uint8_t* tangents = GetGLTFAccessorData(gltfData, GetGLTFAttribute(p, "TANGENT"), tangentStride);
+        const uint8_t* uv0s = GetGLTFAccessorData(gltfData, GetGLTFAttribute(p, "TEXCOORD_0"), uv0Stride);
+
+        // The pool isn't initialized, zero the attributes the primitive doesn't have
+        if (!normals || !tangents || !uv0s) memset(mp.vertices.data(), 0, numVertices * sizeof(Graphics::Vertex));
+
+        // Vertex positions, updating the mesh primitive's bounding box
+        XMVECTOR min = XMVectorReplicate(FLT_MAX);
+        XMVECTOR max = XMVectorReplicate(-FLT_MAX);
+        ConvertGLTFVectors<3, true>(positions, positionStride, numVertices, mp.vertices.data(), offsetof(Graphics::Vertex, position), min, max);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&mp.boundingBox.min), min);
+        XMStoreFloat3(reinterpret_cast<XMFLOAT3*>(&mp.boundingBox.max), max);
+
+        // Vertex normals
+        if (normals) ConvertGLTFVectors<3, false>(normals, normalStride, numVertices, mp.vertices.data(), offsetof(Graphics::Vertex, normal), min, max);
+
+        // Vertex tangents (w stores the bitangent direction)
+        if (tangents) ConvertGLTFVectors<4, false>(tangents, tangentStride, numVertices, mp.vertices.data(), offsetof(Graphics::Vertex, tangent), min, max);
+
+        // Vertex texture coordinates
+        if (uv0s)
+        {
+            for (size_t vertexIndex = 0; vertexIndex < numVertices; vertexIndex++, uv0s += uv0Stride)
+            {
+                memcpy(&mp.vertices[vertexIndex].uv0, uv0s, sizeof(float) * 2);
+            }
+        }
+
+        // Get the index data
+        // Indices can be either unsigned char, unsigned short, or unsigned long
+        // Converting to full precision for easy use on GPU
+        const uint8_t* indices = GetGLTFAccessorData(gltfData, p.indices, stride);
+        size_t numIndices = mp.indices.size();
+        if (stride == 1)
+        {
+            for (size_t i = 0; i < numIndices; i++) mp.indices[i] = indices[i];
+        }
+        else if (stride == 2)
+        {
+            for (size_t i = 0; i < numIndices; i++)
+            {
+                uint16_t index;
+                memcpy(&index, indices + (i * 2), sizeof(uint16_t));
+                mp.indices[i] = index;
+            }
+        }
+        else
+        {
+            memcpy(mp.indices.data(), indices, numIndices * sizeof(uint32_t));
+        }
+    }
+
     /**
      * Parse the glTF meshes.
+     * Meshes of the cached scene with the content hash of the glTF mesh (see HashGLTFMesh()) are reused, with their proxy meshes.
+     * The meshes are laid out in order first, then their primitives are read and optimized (see Optimize.h) in parallel (largest first).
      */
-    void ParseGLTFMeshes(const tinygltf::Model& gltfData, Scene& scene)
+    void ParseGLTFMeshes(const tinygltf::Model& gltfData, Scene& cached, Scene& scene, uint32_t& numReused, const Optimize::Desc& desc, Optimize::Stats& stats)
     {
         // Note: GTLF 2.0's default coordinate system is Right Handed, Y-Up
         // https://github.com/KhronosGroup/glTF/tree/master/specification/2.0#coordinate-system-and-units
         // Meshes are converted from this coordinate system to the chosen coordinate system.
 
+        // Cached meshes by content hash
+        std::unordered_map<uint64_t, uint32_t> cachedMeshes;
+        for (uint32_t meshIndex = 0; meshIndex < static_cast<uint32_t>(cached.meshes.size()); meshIndex++)
+        {
+            if (cached.meshes[meshIndex].hash != 0) cachedMeshes.emplace(cached.meshes[meshIndex].hash, meshIndex);
+        }
+
+        // Proxies of the meshes that aren't reused are simplified later (see UpdateProxyMeshes())
+        bool cachedProxies = !cached.proxyMeshes.empty() && (cached.proxyMeshes.size() == cached.meshes.size());
+        if (cachedProxies)
+        {
+            scene.proxyRatio = cached.proxyRatio;
+            scene.proxyMaxError = cached.proxyMaxError;
+            scene.proxyMeshes.resize(gltfData.meshes.size());
+        }
+
+        std::vector<uint32_t> parsedMeshes;
         uint32_t geometryIndex = 0;
         for (uint32_t meshIndex = 0; meshIndex < static_cast<uint32_t>(gltfData.meshes.size()); meshIndex++)
         {
             const tinygltf::Mesh& gltfMesh = gltfData.meshes[meshIndex];
+            uint64_t hash = HashGLTFMesh(gltfData, gltfMesh, scene);
+
+            std::unordered_map<uint64_t, uint32_t>::iterator reused = cachedMeshes.find(hash);
+            if (reused != cachedMeshes.end())
+            {
+                // Reuse the cached mesh and its proxy (the cached scene keeps empty meshes)
+                Mesh mesh = std::move(cached.meshes[reused->second]);
+                cached.meshes[reused->second] = Mesh();
+
+                mesh.index = static_cast<int>(scene.meshes.size());
+                mesh.name = gltfMesh.name;
+                if (mesh.name.compare("") == 0) mesh.name = "Mesh_" + std::to_string(meshIndex);
+
+                for (MeshPrimitive& mp : mesh.primitives)
+                {
+                    mp.index = geometryIndex++;
+
+                    // Count the triangles like the primitives parsed below
+                    scene.numTriangles += static_cast<uint32_t>(mp.indices.size()) / 3;
+                }
+
+                if (cachedProxies)
+                {
+                    Mesh& proxy = scene.proxyMeshes[mesh.index];
+                    proxy = std::move(cached.proxyMeshes[reused->second]);
+                    cached.proxyMeshes[reused->second] = Mesh();
+
+                    proxy.index = mesh.index;
+                    proxy.name = mesh.name;
+                    scene.numProxyTriangles += proxy.numIndices / 3;
+                    for (size_t primitiveIndex = 0; primitiveIndex < std::min(proxy.primitives.size(), mesh.primitives.size()); primitiveIndex++)
+                    {
+                        proxy.primitives[primitiveIndex].index = mesh.primitives[primitiveIndex].index;
+                    }
+                }
+
+                cachedMeshes.erase(reused);
+                scene.meshes.push_back(std::move(mesh));
+                numReused++;
+                continue;
+            }
 
             Mesh mesh;
             mesh.name = gltfMesh.name;
+            mesh.hash = hash;
             mesh.numVertices = 0;
             mesh.numIndices = 0;
             if (mesh.name.compare("") == 0) mesh.name = "Mesh_" + std::to_string(meshIndex);
 
-            // Initialize the mesh bounding box
-            mesh.boundingBox.min = { FLT_MAX, FLT_MAX, FLT_MAX };
-            mesh.boundingBox.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
-
-            uint32_t vertexByteOffset = 0;
-            uint32_t indexByteOffset = 0;
             for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(gltfMesh.primitives.size()); primitiveIndex++)
             {
                 // Get a reference to the mesh primitive
@@ -327,12 +598,6 @@ namespace Scenes
                 MeshPrimitive mp;
                 mp.index = geometryIndex;
                 mp.material = p.material;
-                mp.vertexByteOffset = vertexByteOffset;
-                mp.indexByteOffset = indexByteOffset;
-
-                // Initialize the mesh primitive bounding box
-                mp.boundingBox.min = { FLT_MAX, FLT_MAX, FLT_MAX };
-                mp.boundingBox.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
 
                 // Set the mesh primitive's material to the default material if one is not assigned or if no materials exist in the GLTF
                 if (mp.material == -1) mp.material = 0;
@@ -342,228 +607,104 @@ namespace Scenes
                 const Material& mat = scene.materials[mp.material];
                 if (mat.data.alphaMode != 0) mp.opaque = false;
 
-                // Get data indices
-                int indicesIndex = p.indices;
-                int positionIndex = -1;
-                int normalIndex = -1;
-                int tangentIndex = -1;
-                int uv0Index = -1;
+                // Size the primitive's views of the geometry pool (which sets their byte offsets), the vertices and indices are read below
+                mp.vertices.count = gltfData.accessors[GetGLTFAttribute(p, "POSITION")].count;
+                mp.indices.count = gltfData.accessors[p.indices].count;
 
-                if (p.attributes.count("POSITION") > 0)
-                {
-                    positionIndex = p.attributes.at("POSITION");
-                }
-
-                if (p.attributes.count("NORMAL") > 0)
-                {
-                    normalIndex = p.attributes.at("NORMAL");
-                }
-
-                if (p.attributes.count("TANGENT"))
-                {
-                    tangentIndex = p.attributes.at("TANGENT");
-                }
-
-                if (p.attributes.count("TEXCOORD_0") > 0)
-                {
-                    uv0Index = p.attributes.at("TEXCOORD_0");
-                }
-
-                // Vertex positions
-                const tinygltf::Accessor& positionAccessor = gltfData.accessors[positionIndex];
-                const tinygltf::BufferView& positionBufferView = gltfData.bufferViews[positionAccessor.bufferView];
-                const tinygltf::Buffer& positionBuffer = gltfData.buffers[positionBufferView.buffer];
-                const uint8_t* positionBufferAddress = positionBuffer.data.data();
-                int positionStride = tinygltf::GetComponentSizeInBytes(positionAccessor.componentType) * tinygltf::GetNumComponentsInType(positionAccessor.type);
-                assert(positionStride == 12);
-
-                // Vertex indices
-                const tinygltf::Accessor& indexAccessor = gltfData.accessors[indicesIndex];
-                const tinygltf::BufferView& indexBufferView = gltfData.bufferViews[indexAccessor.bufferView];
-                const tinygltf::Buffer& indexBuffer = gltfData.buffers[indexBufferView.buffer];
-                const uint8_t* indexBufferAddress = indexBuffer.data.data();
-                int indexStride = tinygltf::GetComponentSizeInBytes(indexAccessor.componentType) * tinygltf::GetNumComponentsInType(indexAccessor.type);
-                mp.indices.resize(indexAccessor.count);
-
-                // Vertex normals
-                tinygltf::Accessor normalAccessor;
-                tinygltf::BufferView normalBufferView;
-                const uint8_t* normalBufferAddress = nullptr;
-                int normalStride = -1;
-                if (normalIndex > -1)
-                {
-                    normalAccessor = gltfData.accessors[normalIndex];
-                    normalBufferView = gltfData.bufferViews[normalAccessor.bufferView];
-                    normalStride = tinygltf::GetComponentSizeInBytes(normalAccessor.componentType) * tinygltf::GetNumComponentsInType(normalAccessor.type);
-                    assert(normalStride == 12);
-
-                    const tinygltf::Buffer& normalBuffer = gltfData.buffers[normalBufferView.buffer];
-                    normalBufferAddress = normalBuffer.data.data();
-                }
-
-                // Vertex tangents
-                tinygltf::Accessor tangentAccessor;
-                tinygltf::BufferView tangentBufferView;
-                const uint8_t* tangentBufferAddress = nullptr;
-                int tangentStride = -1;
-                if (tangentIndex > -1)
-                {
-                    tangentAccessor = gltfData.accessors[tangentIndex];
-                    tangentBufferView = gltfData.bufferViews[tangentAccessor.bufferView];
-                    tangentStride = tinygltf::GetComponentSizeInBytes(tangentAccessor.componentType) * tinygltf::GetNumComponentsInType(tangentAccessor.type);
-                    assert(tangentStride == 16);
-
-                    const tinygltf::Buffer& tangentBuffer = gltfData.buffers[tangentBufferView.buffer];
-                    tangentBufferAddress = tangentBuffer.data.data();
-                }
-
-                // Vertex texture coordinates
-                tinygltf::Accessor uv0Accessor;
-                tinygltf::BufferView uv0BufferView;
-                const uint8_t* uv0BufferAddress = nullptr;
-                int uv0Stride = -1;
-                if (uv0Index > -1)
-                {
-                    uv0Accessor = gltfData.accessors[uv0Index];
-                    uv0BufferView = gltfData.bufferViews[uv0Accessor.bufferView];
-                    uv0Stride = tinygltf::GetComponentSizeInBytes(uv0Accessor.componentType) * tinygltf::GetNumComponentsInType(uv0Accessor.type);
-                    assert(uv0Stride == 8);
-
-                    const tinygltf::Buffer& uv0Buffer = gltfData.buffers[uv0BufferView.buffer];
-                    uv0BufferAddress = uv0Buffer.data.data();
-                }
-
-                // Get the vertex data
-                for (uint32_t vertexIndex = 0; vertexIndex < static_cast<uint32_t>(positionAccessor.count); vertexIndex++)
-                {
-                    Graphics::Vertex v;
-
-                    const uint8_t* address = positionBufferAddress + positionBufferView.byteOffset + positionAccessor.byteOffset + (vertexIndex * positionStride);
-                    memcpy(&v.position, address, positionStride);
-
-                #if (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT) || (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP)
-                    // Invert z-coordinate to convert from right hand to left hand
-                    v.position.z *= -1.f;
-                #endif
-
-                #if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP
-                    // Convert to left hand, z-up (unreal)
-                    v.position = { v.position.z, v.position.x, v.position.y };
-                #elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT_Z_UP
-                    // Convert to right hand, z-up
-                    v.position = { v.position.x, -v.position.z, v.position.y };
-                #endif
+                // Add the mesh primitive
+                mesh.primitives.push_back(std::move(mp));
 
-                    if (normalIndex > -1)
-                    {
-                        address = normalBufferAddress + normalBufferView.byteOffset + normalAccessor.byteOffset + (vertexIndex * normalStride);
-                        memcpy(&v.normal, address, normalStride);
-
-                    #if (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT) || (COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP)
-                        // Invert the z-coordinate to convert from right hand to left hand
-                        v.normal.z *= -1.f;
-                    #endif
-
-                    #if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP
-                        // Convert to left hand, z-up (unreal)
-                        v.normal = { v.normal.z, v.normal.x, v.normal.y };
-                    #elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT_Z_UP
-                        // Convert to right hand, z-up
-                        v.normal = { v.normal.x, -v.normal.z, v.normal.y };
-                    #endif
-                    }
+                geometryIndex++;
+            }
 
-                    if (tangentIndex > -1)
-                    {
-                        address = tangentBufferAddress + tangentBufferView.byteOffset + tangentAccessor.byteOffset + (vertexIndex * tangentStride);
-                        memcpy(&v.tangent, address, tangentStride);
-
-                    #if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT || COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP
-                        // Invert the z-coordinate to convert from right hand to left hand
-                        v.tangent.z *= -1.f;
-                    #endif
-
-                    #if COORDINATE_SYSTEM == COORDINATE_SYSTEM_LEFT_Z_UP
-                        // Convert to left hand, z-up (unreal)
-                        v.tangent = { v.tangent.z, v.tangent.x, v.tangent.y, v.tangent.w };
-                    #elif COORDINATE_SYSTEM == COORDINATE_SYSTEM_RIGHT_Z_UP
-                        // Convert to right hand, z-up
-                        v.tangent = { v.tangent.x, -v.tangent.z, v.tangent.y, v.tangent.w };
-                    #endif
-                    }
+            mesh.index = static_cast<int>(scene.meshes.size());
+            parsedMeshes.push_back(static_cast<uint32_t>(scene.meshes.size()));
+            scene.meshes.push_back(std::move(mesh));
+        }
 
-                    if (uv0Index > -1)
-                    {
-                        address = uv0BufferAddress + uv0BufferView.byteOffset + uv0Accessor.byteOffset + (vertexIndex * uv0Stride);
-                        memcpy(&v.uv0, address, uv0Stride);
-                    }
+        scene.numMeshPrimitives = geometryIndex;
 
-                    // Update the mesh primitive's bounding box
-                    mp.boundingBox.min = rtxgi::Min(mp.boundingBox.min, v.position);
-                    mp.boundingBox.max = rtxgi::Max(mp.boundingBox.max, v.position);
+        // Allocate the scene's geometry pool, copying the reused meshes' vertices and indices from the cached pool
+        AllocateGeometry(scene.meshes.data(), scene.meshes.size());
 
-                    mp.vertices.push_back(v);
-                    mesh.numVertices++;
-                }
+        // Read the primitives of the parsed meshes, largest first so a large primitive doesn't start last
+        std::vector<std::pair<MeshPrimitive*, const tinygltf::Primitive*>> primitives;
+        for (uint32_t meshIndex : parsedMeshes)
+        {
+            Mesh& mesh = scene.meshes[meshIndex];
+            const tinygltf::Mesh& gltfMesh = gltfData.meshes[meshIndex];
+            for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
+            {
+                primitives.emplace_back(&mesh.primitives[primitiveIndex], &gltfMesh.primitives[primitiveIndex]);
+            }
+        }
+        std::stable_sort(primitives.begin(), primitives.end(), [](const std::pair<MeshPrimitive*, const tinygltf::Primitive*>& a, const std::pair<MeshPrimitive*, const tinygltf::Primitive*>& b)
+        {
+            return (a.first->vertices.size() + a.first->indices.size()) > (b.first->vertices.size() + b.first->indices.size());
+        });
+
+        uint32_t numPrimitives = static_cast<uint32_t>(primitives.size());
+        uint32_t numThreads = std::min(std::max(std::thread::hardware_concurrency(), 1u), std::max(numPrimitives, 1u));
+        std::atomic<uint32_t> next(0);
+        std::vector<Optimize::Stats> threadStats(numThreads);
+        auto parse = [&](uint32_t thread)
+        {
+            for (uint32_t index = next++; index < numPrimitives; index = next++)
+            {
+                ParseGLTFPrimitive(gltfData, *primitives[index].second, *primitives[index].first);
+                Optimize::OptimizePrimitive(*primitives[index].first, desc, threadStats[thread]);
+                primitives[index].first->indexFormat = IndexBuffers::SelectFormat(*primitives[index].first);
+            }
+        };
 
-                // Get the index data
-                // Indices can be either unsigned char, unsigned short, or unsigned long
-                // Converting to full precision for easy use on GPU
-                const uint8_t* baseAddress = indexBufferAddress + indexBufferView.byteOffset + indexAccessor.byteOffset;
-                if (indexStride == 1)
-                {
-                    std::vector<uint8_t> quarter;
-                    quarter.resize(indexAccessor.count);
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 1; thread < numThreads; thread++) threads.emplace_back(parse, thread);
+        parse(0);
+        for (std::thread& thread : threads) thread.join();
 
-                    memcpy(quarter.data(), baseAddress, (indexAccessor.count * indexStride));
+        uint64_t numRemoved = 0;
+        for (const Optimize::Stats& threadStat : threadStats)
+        {
+            stats.numPrimitives += threadStat.numPrimitives;
+            stats.numVertices += threadStat.numVertices;
+            stats.numWelded += threadStat.numWelded;
+            stats.numUnreferenced += threadStat.numUnreferenced;
+            stats.before.numTriangles += threadStat.before.numTriangles;
+            stats.before.numVertexMisses += threadStat.before.numVertexMisses;
+            stats.before.numLineMisses += threadStat.before.numLineMisses;
+            stats.after.numTriangles += threadStat.after.numTriangles;
+            stats.after.numVertexMisses += threadStat.after.numVertexMisses;
+            stats.after.numLineMisses += threadStat.after.numLineMisses;
+            stats.seconds += threadStat.seconds;
+            numRemoved += threadStat.numWelded + threadStat.numUnreferenced;
+        }
 
-                    // Convert quarter precision indices to full precision
-                    for (size_t i = 0; i < indexAccessor.count; i++)
-                    {
-                        mp.indices[i] = quarter[i];
-                    }
-                }
-                else if (indexStride == 2)
-                {
-                    std::vector<uint16_t> half;
-                    half.resize(indexAccessor.count);
+        // Pack the pool when the optimization removed vertices
+        if (numRemoved > 0) AllocateGeometry(scene.meshes.data(), scene.meshes.size());
 
-                    memcpy(half.data(), baseAddress, (indexAccessor.count * indexStride));
+        // Accumulate the mesh counts and bounding boxes in order, and lay out the index buffers with the selected formats
+        for (uint32_t meshIndex : parsedMeshes)
+        {
+            Mesh& mesh = scene.meshes[meshIndex];
+            IndexBuffers::Layout(mesh);
 
-                    // Convert half precision indices to full precision
-                    for (size_t i = 0; i < indexAccessor.count; i++)
-                    {
-                        mp.indices[i] = half[i];
-                    }
-                }
-                else
-                {
-                    memcpy(mp.indices.data(), baseAddress, (indexAccessor.count * indexStride));
-                }
+            // Initialize the mesh bounding box
+            mesh.boundingBox.min = { FLT_MAX, FLT_MAX, FLT_MAX };
+            mesh.boundingBox.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
 
-                // Update byte offsets
-                vertexByteOffset += static_cast<uint32_t>(mp.vertices.size()) * sizeof(Graphics::Vertex);
-                indexByteOffset += static_cast<uint32_t>(mp.indices.size()) * sizeof(UINT);
+            for (const MeshPrimitive& mp : mesh.primitives)
+            {
+                mesh.numVertices += static_cast<uint32_t>(mp.vertices.size());
 
                 // Increment the triangle count
-                mesh.numIndices += static_cast<int>(indexAccessor.count);
-                scene.numTriangles += mesh.numIndices / 3;
+                mesh.numIndices += static_cast<uint32_t>(mp.indices.size());
+                scene.numTriangles += static_cast<uint32_t>(mp.indices.size()) / 3;
 
                 // Update the mesh's bounding box
                 mesh.boundingBox.min = rtxgi::Min(mesh.boundingBox.min, mp.boundingBox.min);
                 mesh.boundingBox.max = rtxgi::Max(mesh.boundingBox.max, mp.boundingBox.max);
-
-                // Add the mesh primitive
-                mesh.primitives.push_back(mp);
-
-                geometryIndex++;
             }
-
-            mesh.index = static_cast<int>(scene.meshes.size());
-            scene.meshes.push_back(mesh);
         }
-
-        scene.numMeshPrimitives = geometryIndex;
     }
 
     /**
@@ -621,10 +762,65 @@ namespace Scenes
         }
     }
 
+    /**
+     * Sets the scene's sources: the glTF file and the files of its buffers and images.
+     * Sources of the cached scene with the same size and write time aren't hashed again.
+     */
+    void UpdateSources(const tinygltf::Model& gltfData, const Configs::Config& config, const Scene& cached, Scene& scene)
+    {
+        std::vector<std::string> uris = { config.scene.file };
+        for (const tinygltf::Buffer& buffer : gltfData.buffers) uris.push_back(ParseURI(buffer.uri));
+        for (const tinygltf::Image& image : gltfData.images) uris.push_back(ParseURI(image.uri));
+
+        std::string directory = config.app.root + config.scene.path;
+        for (const std::string& uri : uris)
+        {
+            // Skip embedded data and files of several buffers or images
+            if (uri.empty() || uri.compare(0, 5, "data:") == 0) continue;
+            if (std::any_of(scene.sources.begin(), scene.sources.end(), [&](const SourceFile& source) { return source.uri == uri; })) continue;
+
+            SourceFile source;
+            source.uri = uri;
+            std::vector<SourceFile>::const_iterator previous = std::find_if(cached.sources.begin(), cached.sources.end(), [&](const SourceFile& s) { return s.uri == uri; });
+            if (previous != cached.sources.end()) source = *previous;
+
+            if (Caches::UpdateSource(directory, source)) scene.sources.push_back(source);
+        }
+    }
+
+    /**
+     * Checks the scene's sources for changes, returns true if the contents of a source changed.
+     * Sources that don't exist are ignored (caches can be used without their sources). Sets touched if a source has a new
+     * write time (or size) but the same contents.
+     */
+    bool HaveSourcesChanged(const Configs::Config& config, Scene& scene, bool& touched, std::ofstream& log)
+    {
+        bool changed = false;
+        std::string directory = config.app.root + config.scene.path;
+        for (SourceFile& source : scene.sources)
+        {
+            SourceFile current = source;
+            if (!Caches::UpdateSource(directory, current)) continue;
+
+            if (current.hash != source.hash)
+            {
+                log << "\n\tScene source \'" << source.uri << "\' changed";
+                changed = true;
+            }
+            else if (current.time != source.time || current.size != source.size)
+            {
+                touched = true;
+            }
+            source = current;
+        }
+        return changed;
+    }
+
     /**
      * Parse the various data of a GLTF file.
+     * Textures and meshes of the cached scene (empty: no cache) are reused when their content hashes match (see Scene::sources).
      */
-    bool ParseGLTF(const tinygltf::Model& gltfData, const Configs::Config& config, const bool binary, Scene& scene, std::ofstream& log)
+    bool ParseGLTF(const tinygltf::Model& gltfData, const Configs::Config& config, const bool binary, Scene& cached, Scene& scene, std::ofstream& log)
     {
         if (binary && gltfData.textures.size() > 0)
         {
@@ -651,11 +847,38 @@ namespace Scenes
         // Parse Materials
         ParseGLTFMaterials(gltfData, scene);
 
+        // Hash the source files
+        UpdateSources(gltfData, config, cached, scene);
+
         // Parse and Load Textures
-        if (!ParseGLFTextures(gltfData, config, scene)) return false;
+        uint32_t numReusedTextures = 0;
+        if (!ParseGLFTextures(gltfData, config, cached, scene, numReusedTextures)) return false;
 
         // Parse Meshes
-        ParseGLTFMeshes(gltfData, scene);
+        uint32_t numReusedMeshes = 0;
+        Optimize::Desc optimizeDesc;
+        optimizeDesc.simulateFetches = config.app.benchmarkOptimize;
+        Optimize::Stats stats;
+        ParseGLTFMeshes(gltfData, cached, scene, numReusedMeshes, optimizeDesc, stats);
+
+        if (stats.numPrimitives > 0)
+        {
+            log << "\n\tOptimized " << stats.numPrimitives << " mesh primitives: " << stats.numVertices << " vertices to ";
+            log << (stats.numVertices - stats.numWelded - stats.numUnreferenced) << " (" << stats.numWelded << " welded, " << stats.numUnreferenced << " unused), ";
+            if (optimizeDesc.simulateFetches)
+            {
+                double numTriangles = (double)std::max(stats.before.numTriangles, (uint64_t)1);
+                log << "vertex cache misses per triangle " << ((double)stats.before.numVertexMisses / numTriangles) << " to " << ((double)stats.after.numVertexMisses / numTriangles) << ", ";
+                log << "fetched lines per triangle " << ((double)stats.before.numLineMisses / numTriangles) << " to " << ((double)stats.after.numLineMisses / numTriangles) << ", ";
+            }
+            log << "in " << (stats.seconds * 1000.0) << "ms";
+        }
+
+        if (!cached.meshes.empty() || !cached.textures.empty())
+        {
+            log << "\n\tReused " << numReusedTextures << " of " << scene.textures.size() << " textures and ";
+            log << numReusedMeshes << " of " << scene.meshes.size() << " meshes of the scene cache";
+        }
 
         // Update the scene's bounding boxes, based on the instance transforms
         UpdateSceneBoundingBoxes(scene);
@@ -663,6 +886,100 @@ namespace Scenes
         return true;
     }
 
+    /**
+     * Simplifies the scene's meshes into proxy meshes for probe ray tracing, or removes the proxies when the config has none.
+     * Returns true if the proxies changed.
+     */
+    bool UpdateProxyMeshes(const Configs::Config& config, Scene& scene, std::ofstream& log)
+    {
+        if (config.scene.proxyRatio <= 0.f)
+        {
+            if (scene.proxyMeshes.empty()) return false;
+            scene.proxyRatio = scene.proxyMaxError = 0.f;
+            scene.numProxyTriangles = 0;
+            scene.proxyMeshes.clear();
+            return true;
+        }
+
+        // Proxies of the cache are reused when they were simplified with the same settings, missing proxies are simplified
+        if (scene.proxyRatio != config.scene.proxyRatio || scene.proxyMaxError != config.scene.proxyMaxError) scene.proxyMeshes.clear();
+        if (!scene.proxyMeshes.empty() && std::all_of(scene.proxyMeshes.begin(), scene.proxyMeshes.end(), [](const Mesh& proxy) { return proxy.index >= 0; })) return false;
+
+        log << "\n\tSimplifying proxy meshes...";
+        Simplify::Desc desc;
+        desc.targetRatio = config.scene.proxyRatio;
+        desc.maxError = config.scene.proxyMaxError;
+
+        Simplify::Stats stats;
+        Simplify::CreateProxies(scene, desc, stats);
+        scene.proxyRatio = config.scene.proxyRatio;
+        scene.proxyMaxError = config.scene.proxyMaxError;
+
+        log << "done. " << stats.numTriangles << " triangles to " << stats.numProxyTriangles << " (";
+        log << (100.0 * (double)stats.numProxyTriangles / (double)std::max(stats.numTriangles, (uint64_t)1)) << "%) in " << (stats.seconds * 1000.0) << "ms, ";
+        log << ((double)stats.numTriangles / std::max(stats.seconds, 1e-9) / 1e6) << " M triangles/s";
+        return true;
+    }
+
+    /**
+     * Classifies the opacity of the scene's alpha-tested triangles, or removes the opacity states when the config has none.
+     * Returns true if the opacity states changed.
+     */
+    bool UpdateOpacityStates(const Configs::Config& config, Scene& scene, std::ofstream& log)
+    {
+        if (config.scene.opacityLevel < 0)
+        {
+            if (scene.opacityLevel < 0) return false;
+            Opacity::Clear(scene);
+            return true;
+        }
+
+        // Opacity states of the cache are reused when they were classified at the same level
+        int level = std::min(config.scene.opacityLevel, static_cast<int>(Opacity::MaxLevel));
+        if (scene.opacityLevel == level) return false;
+
+        log << "\n\tClassifying alpha-tested triangle opacity...";
+        Opacity::Desc desc;
+        desc.level = static_cast<uint32_t>(level);
+
+        Opacity::Stats stats;
+        Opacity::Classify(scene, desc, stats);
+
+        uint64_t numMicroTriangles = std::max(stats.numOpaque + stats.numTransparent + stats.numUnknown, (uint64_t)1);
+        log << "done. " << stats.numTriangles << " triangles (" << stats.numUnclassified << " with unreadable textures), ";
+        log << (100.0 * (double)stats.numOpaque / (double)numMicroTriangles) << "% opaque, ";
+        log << (100.0 * (double)stats.numTransparent / (double)numMicroTriangles) << "% transparent, ";
+        log << (100.0 * (double)stats.numUnknown / (double)numMicroTriangles) << "% unknown in " << (stats.seconds * 1000.0) << "ms, ";
+        log << ((double)stats.numTriangles / std::max(stats.seconds, 1e-9) / 1e6) << " M triangles/s, ";
+        log << ((double)stats.numTexels / std::max(stats.seconds, 1e-9) / 1e6) << " M texels/s";
+        return true;
+    }
+
+    /**
+     * Encodes the compact vertices of the scene's meshes, or removes them when the config doesn't use them.
+     * Returns true if the compact vertices changed.
+     */
+    bool UpdateCompactVertices(const Configs::Config& config, Scene& scene, std::ofstream& log)
+    {
+        if (!config.scene.compactVertices)
+        {
+            if (std::none_of(scene.meshes.begin(), scene.meshes.end(), [](const Mesh& mesh) { return Quantization::IsCompact(mesh); })) return false;
+            Quantization::Clear(scene);
+            return true;
+        }
+
+        // Compact vertices of the cache are reused, the meshes of pools without them are encoded (formats are tracked per geometry pool)
+        if (std::none_of(scene.meshes.begin(), scene.meshes.end(), [](const Mesh& mesh) { return mesh.pool && !Quantization::IsCompact(mesh); })) return false;
+
+        log << "\n\tEncoding compact vertices...";
+        Quantization::Desc desc;
+        Quantization::Stats stats;
+        Quantization::Encode(scene, desc, stats);
+
+        log << "done. " << stats.numVertices << " vertices in " << (stats.seconds * 1000.0) << "ms";
+        return true;
+    }
+
     /**
      * Adds config specific cameras and lights.
      */
@@ -720,14 +1037,14 @@ namespace Scenes
         scene.firstSpotLight = scene.hasDirectionalLight;
         for (lightIndex = 0; lightIndex < scene.numSpotLights; lightIndex++)
         {
-            scene.lights[scene.hasDirectionalLight] = spotLights[lightIndex];
+            scene.lights[scene.firstSpotLight + lightIndex] = spotLights[lightIndex];
         }
 
         scene.numPointLights = static_cast<uint32_t>(pointLights.size());
         scene.firstPointLight = scene.hasDirectionalLight + scene.numSpotLights;
         for (lightIndex = 0; lightIndex < scene.numPointLights; lightIndex++)
         {
-            scene.lights[(scene.hasDirectionalLight + scene.numSpotLights)] = pointLights[lightIndex];
+            scene.lights[scene.firstPointLight + lightIndex] = pointLights[lightIndex];
         }
 
         // Add scene cameras from config file
@@ -789,13 +1106,37 @@ namespace Scenes
 
         // Load the scene cache file, if it exists
         std::string sceneCache = config.app.root + config.scene.path + cacheName + ".cache";
+        Scene cached;
         if (Caches::Deserialize(sceneCache, scene, log))
         {
-            ParseConfigCamerasLights(config, scene);
-            return true;
+            bool touched = false;
+            if (!HaveSourcesChanged(config, scene, touched, log))
+            {
+                // Update the cache when the proxy, opacity, or vertex format settings changed (or to store the new write times of the sources)
+                bool changed = UpdateProxyMeshes(config, scene, log);
+                changed |= UpdateOpacityStates(config, scene, log);
+                changed |= UpdateCompactVertices(config, scene, log);
+                if (scene.cacheCompression != config.scene.cacheCompression)
+                {
+                    scene.cacheCompression = config.scene.cacheCompression;
+                    changed = true;
+                }
+                changed |= touched;
+                if (changed) Caches::SerializeAsync(sceneCache, scene, log);
+
+                ParseConfigCamerasLights(config, scene);
+                return true;
+            }
+
+            // Rebuild the scene from its sources, reusing the cache's textures and meshes that didn't change
+            log << "\n\tRebuilding scene cache...";
+            cached = std::move(scene);
+            scene = Scene();
+            scene.name = config.scene.name;
         }
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-        // Load the scene GLTF (no cache file exists or the existing cache file is invalid)
+        // Load the scene GLTF (no cache file exists, the existing cache file is invalid, or its sources changed)
         tinygltf::Model gltfData;
         tinygltf::TinyGLTF gltfLoader;
         std::string err, warn, filepath;
@@ -824,10 +1165,26 @@ namespace Scenes
         }
 
         // Parse the GLTF data
-        CHECK(ParseGLTF(gltfData, config, binary, scene, log), "parse scene file!\n", log);
+        bool parsed = ParseGLTF(gltfData, config, binary, cached, scene, log);
+
+        // Release the cached textures and meshes that weren't reused, reused textures and proxy meshes may reference the cache mapping
+        if (cached.cacheMapping && Caches::IsMapped(scene, *cached.cacheMapping)) scene.cacheMapping = cached.cacheMapping;
+        Cleanup(cached);
+        CHECK(parsed, "parse scene file!\n", log);
+
+        // Simplify the probe ray tracing proxy meshes (stored in the cache)
+        UpdateProxyMeshes(config, scene, log);
+
+        // Classify the opacity of the alpha-tested triangles (stored in the cache)
+        UpdateOpacityStates(config, scene, log);
+
+        // Encode the compact vertices (stored in the cache)
+        UpdateCompactVertices(config, scene, log);
 
         // Serialize the scene and store a cache file to speed up future loads
-        if (!Caches::Serialize(sceneCache, scene, log)) return false;
+        scene.cacheCompression = config.scene.cacheCompression;
+        Caches::SerializeAsync(sceneCache, scene, log);
+        log << "\n\tScene built in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms";
 
         // Add config specific cameras and lights
         ParseConfigCamerasLights(config, scene);
@@ -921,16 +1278,116 @@ namespace Scenes
         camera.data.forward = { cameraForward.x, cameraForward.y, cameraForward.z };
     }
 
+    /**
+     * Set a mesh instance's transform and update its bounding box. Edited instances are marked dirty and keep the
+     * bounding box they had before their first change, until the edits are cleared (e.g. for incremental probe updates).
+     */
+    void SetInstanceTransform(Scene& scene, uint32_t instanceIndex, const float transform[3][4])
+    {
+        MeshInstance& instance = scene.instances[instanceIndex];
+        if (!instance.dirty)
+        {
+            instance.previousBoundingBox = instance.boundingBox;
+            instance.dirty = true;
+        }
+        memcpy(instance.transform, transform, sizeof(instance.transform));
+
+        // Transform all of the mesh bounding box corners (rotated instances don't map min and max to corners of the new box)
+        const Mesh& mesh = scene.meshes[instance.meshIndex];
+        instance.boundingBox.min = { FLT_MAX, FLT_MAX, FLT_MAX };
+        instance.boundingBox.max = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+        for (uint32_t cornerIndex = 0; cornerIndex < 8; cornerIndex++)
+        {
+            rtxgi::float3 corner;
+            corner.x = (cornerIndex & 1) ? mesh.boundingBox.max.x : mesh.boundingBox.min.x;
+            corner.y = (cornerIndex & 2) ? mesh.boundingBox.max.y : mesh.boundingBox.min.y;
+            corner.z = (cornerIndex & 4) ? mesh.boundingBox.max.z : mesh.boundingBox.min.z;
+
+            rtxgi::float3 position;
+            position.x = (transform[0][0] * corner.x) + (transform[0][1] * corner.y) + (transform[0][2] * corner.z) + transform[0][3];
+            position.y = (transform[1][0] * corner.x) + (transform[1][1] * corner.y) + (transform[1][2] * corner.z) + transform[1][3];
+            position.z = (transform[2][0] * corner.x) + (transform[2][1] * corner.y) + (transform[2][2] * corner.z) + transform[2][3];
+
+            instance.boundingBox.min = rtxgi::Min(instance.boundingBox.min, position);
+            instance.boundingBox.max = rtxgi::Max(instance.boundingBox.max, position);
+        }
+
+        scene.boundingBox.min = rtxgi::Min(scene.boundingBox.min, instance.boundingBox.min);
+        scene.boundingBox.max = rtxgi::Max(scene.boundingBox.max, instance.boundingBox.max);
+    }
+
+    /**
+     * Clear the dirty state of all mesh instances, once their edits have been processed.
+     */
+    void ClearInstanceEdits(Scene& scene)
+    {
+        for (MeshInstance& instance : scene.instances) instance.dirty = false;
+    }
+
     /**
      * Releases memory used by the scene.
      */
     void Cleanup(Scene& scene)
     {
+        // Wait for the background write of the scene cache
+        scene.cacheWrite.reset();
+
         // Release texture memory
         for (size_t textureIndex = 0; textureIndex < scene.textures.size(); textureIndex++)
         {
             Textures::Unload(scene.textures[textureIndex]);
         }
+
+        // Release the scene cache file mapping (after the textures that reference it)
+        scene.cacheMapping.reset();
+    }
+
+    /**
+     * Allocates a geometry pool for the meshes and points the meshes and primitives at their ranges of it.
+     */
+    void AllocateGeometry(Mesh* meshes, size_t numMeshes)
+    {
+        std::shared_ptr<GeometryPool> pool = std::make_shared<GeometryPool>();
+        for (size_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            for (const MeshPrimitive& mp : meshes[meshIndex].primitives)
+            {
+                pool->numVertices += mp.vertices.size();
+                pool->numIndices += mp.indices.size();
+            }
+        }
+
+        // The pool isn't initialized, the primitives' vertices and indices are copied or written later
+        pool->vertices.reset(new Graphics::Vertex[pool->numVertices]);
+        pool->indices.reset(new uint32_t[pool->numIndices]);
+
+        Graphics::Vertex* vertices = pool->vertices.get();
+        uint32_t* indices = pool->indices.get();
+        for (size_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            Mesh& mesh = meshes[meshIndex];
+            mesh.vertices.elements = vertices;
+            mesh.indices.elements = indices;
+            for (MeshPrimitive& mp : mesh.primitives)
+            {
+                if (mp.vertices.data() && !mp.vertices.empty()) memcpy(vertices, mp.vertices.data(), mp.vertices.size() * sizeof(Graphics::Vertex));
+                if (mp.indices.data() && !mp.indices.empty()) memcpy(indices, mp.indices.data(), mp.indices.size() * sizeof(uint32_t));
+
+                // Byte offset in the mesh's vertex buffer
+                mp.vertexByteOffset = static_cast<uint32_t>((vertices - mesh.vertices.data()) * sizeof(Graphics::Vertex));
+
+                mp.vertices.elements = vertices;
+                mp.indices.elements = indices;
+                vertices += mp.vertices.size();
+                indices += mp.indices.size();
+            }
+            mesh.vertices.count = static_cast<size_t>(vertices - mesh.vertices.data());
+            mesh.indices.count = static_cast<size_t>(indices - mesh.indices.data());
+            IndexBuffers::Layout(mesh);
+
+            // Releases the mesh's previous pool (once the meshes that share it are copied)
+            mesh.pool = pool;
+        }
     }
 
 }
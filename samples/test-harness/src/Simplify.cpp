@@ -0,0 +1,534 @@
+/*
+* Copyright (c) 2019-2023, NVIDIA CORPORATION.  All rights reserved.
+*
+* NVIDIA CORPORATION and its licensors retain all intellectual property
+* and proprietary rights in and to this software, related documentation
+* and any modifications thereto.  Any use, reproduction, disclosure or
+* distribution of this software and related documentation without an express
+* license agreement from NVIDIA CORPORATION is strictly prohibited.
+*/
+
+#include "Simplify.h"
+#include "Scenes.h"
+
+#include <rtxgi/Math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+namespace Simplify
+{
+
+    //----------------------------------------------------------------------------------------------------------
+    // Private Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    static const uint32_t Invalid = 0xFFFFFFFF;
+    static const double   BorderWeight = 10.0;        // Weight of the planes through boundary edges, relative to triangle planes
+    static const double   MinNormalCosine = 0.25;     // Collapses that turn a triangle by more than ~75 degrees are rejected
+
+    enum class EVertexKind : uint8_t
+    {
+        Manifold = 0,   // Collapses onto any neighbor
+        Border,         // On one open boundary, collapses along it
+        Locked          // Seam, non-manifold, or on several boundaries, never collapses
+    };
+
+    struct Vector
+    {
+        double x, y, z;
+    };
+
+    inline Vector Sub(const Vector& a, const Vector& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+    inline Vector Cross(const Vector& a, const Vector& b) { return { (a.y * b.z) - (a.z * b.y), (a.z * b.x) - (a.x * b.z), (a.x * b.y) - (a.y * b.x) }; }
+    inline double Dot(const Vector& a, const Vector& b) { return (a.x * b.x) + (a.y * b.y) + (a.z * b.z); }
+    inline double Length(const Vector& a) { return std::sqrt(Dot(a, a)); }
+
+    /**
+     * A symmetric quadric: the weighted sum of squared distances to a set of planes.
+     */
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+        double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+        double c = 0.0;
+        double weight = 0.0;
+
+        // Adds the plane dot(normal, p) + d = 0 (normal must be normalized)
+        void AddPlane(const Vector& normal, double d, double w)
+        {
+            a00 += w * normal.x * normal.x; a01 += w * normal.x * normal.y; a02 += w * normal.x * normal.z;
+            a11 += w * normal.y * normal.y; a12 += w * normal.y * normal.z; a22 += w * normal.z * normal.z;
+            b0 += w * normal.x * d; b1 += w * normal.y * d; b2 += w * normal.z * d;
+            c += w * d * d;
+            weight += w;
+        }
+
+        void Add(const Quadric& q)
+        {
+            a00 += q.a00; a01 += q.a01; a02 += q.a02; a11 += q.a11; a12 += q.a12; a22 += q.a22;
+            b0 += q.b0; b1 += q.b1; b2 += q.b2;
+            c += q.c;
+            weight += q.weight;
+        }
+
+        // Returns the weighted mean squared distance of the point to the planes
+        double Evaluate(const Vector& p) const
+        {
+            double error = (a00 * p.x * p.x) + (a11 * p.y * p.y) + (a22 * p.z * p.z)
+                + 2.0 * ((a01 * p.x * p.y) + (a02 * p.x * p.z) + (a12 * p.y * p.z))
+                + 2.0 * ((b0 * p.x) + (b1 * p.y) + (b2 * p.z))
+                + c;
+            return (weight > 0.0) ? std::max(error, 0.0) / weight : 0.0;
+        }
+    };
+
+    struct Collapse
+    {
+        uint32_t from;      // Position (welded vertex) index of the removed vertex
+        uint32_t to;
+        double   error;
+    };
+
+    inline uint64_t GetEdgeKey(uint32_t a, uint32_t b)
+    {
+        return ((uint64_t)a << 32) | (uint64_t)b;
+    }
+
+    /**
+     * Groups equal items (by the comparison function) and returns the index of each item's group representative (its first item).
+     */
+    template<typename Less, typename Equal>
+    void GetRepresentatives(uint32_t count, Less less, Equal equal, std::vector<uint32_t>& representatives)
+    {
+        std::vector<uint32_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), less);
+
+        representatives.resize(count);
+        for (uint32_t index = 0; index < count; index++)
+        {
+            uint32_t item = order[index];
+            if (index > 0 && equal(order[index - 1], item)) representatives[item] = representatives[order[index - 1]];
+            else representatives[item] = item;
+        }
+    }
+
+    /**
+     * Simplifies a mesh primitive. The maximum error is in world units (of the mesh's local space).
+     * The proxy's vertices and indices are stored in the proxy vertices and indices, its views have their counts.
+     */
+    void SimplifyPrimitive(const Scenes::MeshPrimitive& primitive, float targetRatio, double maxError, Scenes::MeshPrimitive& proxy,
+        std::vector<Graphics::Vertex>& proxyVertices, std::vector<uint32_t>& proxyIndices)
+    {
+        const Scenes::PoolView<Graphics::Vertex>& vertices = primitive.vertices;
+        uint32_t numVertices = (uint32_t)vertices.size();
+
+        // Weld vertices with equal attributes, then vertices with equal positions (seam vertices have several attribute vertices)
+        std::vector<uint32_t> attributeVertex;
+        GetRepresentatives(numVertices,
+            [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a], &vertices[b], sizeof(Graphics::Vertex)) < 0; },
+            [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a], &vertices[b], sizeof(Graphics::Vertex)) == 0; },
+            attributeVertex);
+
+        std::vector<uint32_t> positionVertex;
+        GetRepresentatives(numVertices,
+            [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a].position, &vertices[b].position, sizeof(rtxgi::float3)) < 0; },
+            [&](uint32_t a, uint32_t b) { return memcmp(&vertices[a].position, &vertices[b].position, sizeof(rtxgi::float3)) == 0; },
+            positionVertex);
+
+        std::vector<Vector> positions(numVertices);
+        for (uint32_t vertex = 0; vertex < numVertices; vertex++) positions[vertex] = { vertices[vertex].position.x, vertices[vertex].position.y, vertices[vertex].position.z };
+
+        // Triangles reference attribute vertices, degenerate triangles are dropped
+        std::vector<uint32_t> indices;
+        indices.reserve(primitive.indices.size());
+        for (size_t index = 0; index + 2 < primitive.indices.size(); index += 3)
+        {
+            uint32_t a = attributeVertex[primitive.indices[index + 0]];
+            uint32_t b = attributeVertex[primitive.indices[index + 1]];
+            uint32_t c = attributeVertex[primitive.indices[index + 2]];
+            Vector normal = Cross(Sub(positions[b], positions[a]), Sub(positions[c], positions[a]));
+            if (Dot(normal, normal) == 0.0) continue;
+
+            indices.insert(indices.end(), { a, b, c });
+        }
+        uint32_t numTriangles = (uint32_t)indices.size() / 3;
+        uint32_t targetTriangles = (uint32_t)std::ceil((double)numTriangles * (double)targetRatio);
+        std::vector<uint8_t> removed(numTriangles, 0);
+
+        // Directed position edges (by triangle winding) and their number of triangles
+        std::unordered_map<uint64_t, uint32_t> positionEdges;
+        auto getEdges = [&]()
+        {
+            positionEdges.clear();
+            for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+            {
+                if (removed[triangle]) continue;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t a = indices[(triangle * 3) + corner];
+                    uint32_t b = indices[(triangle * 3) + ((corner + 1) % 3)];
+                    positionEdges[GetEdgeKey(positionVertex[a], positionVertex[b])]++;
+                }
+            }
+        };
+        auto getCount = [](const std::unordered_map<uint64_t, uint32_t>& edges, uint64_t key)
+        {
+            auto edge = edges.find(key);
+            return (edge == edges.end()) ? 0u : edge->second;
+        };
+
+        // Triangle planes (weighted by area) and planes through the boundary edges (perpendicular to their triangles)
+        std::vector<Quadric> quadrics(numVertices);
+        getEdges();
+        for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+        {
+            const uint32_t* corners = &indices[triangle * 3];
+            Vector p0 = positions[corners[0]];
+            Vector normal = Cross(Sub(positions[corners[1]], p0), Sub(positions[corners[2]], p0));
+            double length = Length(normal);
+            normal = { normal.x / length, normal.y / length, normal.z / length };
+
+            Quadric quadric;
+            quadric.AddPlane(normal, -Dot(normal, p0), length * 0.5);
+            for (uint32_t corner = 0; corner < 3; corner++) quadrics[positionVertex[corners[corner]]].Add(quadric);
+
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t a = positionVertex[corners[corner]];
+                uint32_t b = positionVertex[corners[(corner + 1) % 3]];
+                if (getCount(positionEdges, GetEdgeKey(b, a)) != 0) continue;
+
+                Vector edge = Sub(positions[b], positions[a]);
+                Vector planeNormal = Cross(edge, normal);
+                double planeLength = Length(planeNormal);
+                if (planeLength == 0.0) continue;
+                planeNormal = { planeNormal.x / planeLength, planeNormal.y / planeLength, planeNormal.z / planeLength };
+
+                Quadric border;
+                border.AddPlane(planeNormal, -Dot(planeNormal, positions[a]), Dot(edge, edge) * BorderWeight);
+                quadrics[a].Add(border);
+                quadrics[b].Add(border);
+            }
+        }
+
+        // Collapse passes: find each vertex's cheapest collapse, then apply them in order of error,
+        // skipping collapses of vertices whose neighborhoods already changed in the pass
+        double maxSquaredError = maxError * maxError;
+        uint32_t numRemaining = numTriangles;
+        std::vector<EVertexKind> kinds(numVertices);
+        std::vector<uint32_t> borderNext(numVertices), borderPrevious(numVertices), attribute(numVertices);
+        std::vector<uint32_t> triangleOffsets(numVertices + 1), vertexTriangles;
+        std::vector<uint8_t> changed(numVertices);
+        std::vector<Collapse> collapses;
+        while (numRemaining > targetTriangles)
+        {
+            getEdges();
+
+            // Classify the vertices (only position representatives are used)
+            std::fill(kinds.begin(), kinds.end(), EVertexKind::Manifold);
+            std::fill(borderNext.begin(), borderNext.end(), Invalid);
+            std::fill(borderPrevious.begin(), borderPrevious.end(), Invalid);
+            std::fill(attribute.begin(), attribute.end(), Invalid);
+            std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+            for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+            {
+                if (removed[triangle]) continue;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t a = indices[(triangle * 3) + corner];
+                    uint32_t b = indices[(triangle * 3) + ((corner + 1) % 3)];
+                    uint32_t pa = positionVertex[a];
+                    uint32_t pb = positionVertex[b];
+                    triangleOffsets[pa + 1]++;
+
+                    // Seams: the position has more than one attribute vertex
+                    if (attribute[pa] == Invalid) attribute[pa] = a;
+                    else if (attribute[pa] != a) kinds[pa] = EVertexKind::Locked;
+
+                    uint32_t count = getCount(positionEdges, GetEdgeKey(pa, pb));
+                    uint32_t twins = getCount(positionEdges, GetEdgeKey(pb, pa));
+                    if (count > 1 || twins > 1)
+                    {
+                        // Non-manifold edge
+                        kinds[pa] = kinds[pb] = EVertexKind::Locked;
+                    }
+                    else if (twins == 0)
+                    {
+                        // Open boundary edge, vertices on more than one boundary are locked
+                        if (borderNext[pa] != Invalid || borderPrevious[pb] != Invalid) kinds[pa] = kinds[pb] = EVertexKind::Locked;
+                        borderNext[pa] = pb;
+                        borderPrevious[pb] = pa;
+                    }
+                }
+            }
+            for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+            {
+                if (kinds[vertex] == EVertexKind::Locked) continue;
+                bool next = (borderNext[vertex] != Invalid);
+                bool previous = (borderPrevious[vertex] != Invalid);
+                if (next && previous) kinds[vertex] = EVertexKind::Border;
+                else if (next || previous) kinds[vertex] = EVertexKind::Locked;
+            }
+
+            // Triangles of each vertex
+            for (uint32_t vertex = 0; vertex < numVertices; vertex++) triangleOffsets[vertex + 1] += triangleOffsets[vertex];
+            vertexTriangles.resize(triangleOffsets[numVertices]);
+            std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+            for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+            {
+                if (removed[triangle]) continue;
+                for (uint32_t corner = 0; corner < 3; corner++) vertexTriangles[fill[positionVertex[indices[(triangle * 3) + corner]]]++] = triangle;
+            }
+
+            // Find the cheapest collapse of each vertex
+            collapses.clear();
+            for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+            {
+                if (positionVertex[vertex] != vertex || kinds[vertex] == EVertexKind::Locked || triangleOffsets[vertex] == triangleOffsets[vertex + 1]) continue;
+
+                Collapse best = { vertex, Invalid, maxSquaredError };
+                auto consider = [&](uint32_t to)
+                {
+                    double error = quadrics[vertex].Evaluate(positions[to]);
+                    if (error <= best.error && (best.to == Invalid || error < best.error || to < best.to)) best = { vertex, to, error };
+                };
+
+                if (kinds[vertex] == EVertexKind::Border)
+                {
+                    consider(borderNext[vertex]);
+                    consider(borderPrevious[vertex]);
+                }
+                else
+                {
+                    for (uint32_t index = triangleOffsets[vertex]; index < triangleOffsets[vertex + 1]; index++)
+                    {
+                        const uint32_t* corners = &indices[vertexTriangles[index] * 3];
+                        for (uint32_t corner = 0; corner < 3; corner++)
+                        {
+                            uint32_t to = positionVertex[corners[corner]];
+                            if (to != vertex) consider(to);
+                        }
+                    }
+                }
+                if (best.to != Invalid) collapses.push_back(best);
+            }
+            if (collapses.empty()) break;
+
+            std::stable_sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.error < b.error; });
+
+            // Apply the collapses
+            uint32_t numCollapses = 0;
+            std::fill(changed.begin(), changed.end(), 0);
+            for (const Collapse& collapse : collapses)
+            {
+                if (numRemaining <= targetTriangles) break;
+
+                uint32_t from = collapse.from;
+                uint32_t to = collapse.to;
+                if (changed[from] || changed[to]) continue;
+
+                // The attribute vertex of the target on the collapsed edge, and rejects collapses that flip or fold triangles
+                uint32_t toAttribute = Invalid;
+                bool valid = true;
+                for (uint32_t index = triangleOffsets[from]; index < triangleOffsets[from + 1] && valid; index++)
+                {
+                    uint32_t triangle = vertexTriangles[index];
+                    const uint32_t* corners = &indices[triangle * 3];
+
+                    uint32_t fromCorner = Invalid;
+                    bool hasTarget = false;
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                    {
+                        if (positionVertex[corners[corner]] == from) fromCorner = corner;
+                        else if (positionVertex[corners[corner]] == to)
+                        {
+                            hasTarget = true;
+                            toAttribute = corners[corner];
+                        }
+                    }
+                    if (hasTarget) continue;
+
+                    Vector p0 = positions[corners[(fromCorner + 1) % 3]];
+                    Vector p1 = positions[corners[(fromCorner + 2) % 3]];
+                    Vector before = Cross(Sub(p0, positions[corners[fromCorner]]), Sub(p1, positions[corners[fromCorner]]));
+                    Vector after = Cross(Sub(p0, positions[to]), Sub(p1, positions[to]));
+                    valid = (Dot(before, after) > MinNormalCosine * Length(before) * Length(after));
+                }
+                if (!valid || toAttribute == Invalid) continue;
+
+                // Remove the triangles of the collapsed edge and move the vertex's other triangles to the target
+                for (uint32_t index = triangleOffsets[from]; index < triangleOffsets[from + 1]; index++)
+                {
+                    uint32_t triangle = vertexTriangles[index];
+                    uint32_t* corners = &indices[triangle * 3];
+                    bool hasTarget = false;
+                    for (uint32_t corner = 0; corner < 3; corner++) hasTarget |= (positionVertex[corners[corner]] == to);
+
+                    if (hasTarget)
+                    {
+                        removed[triangle] = 1;
+                        numRemaining--;
+                        continue;
+                    }
+                    for (uint32_t corner = 0; corner < 3; corner++)
+                    {
+                        if (positionVertex[corners[corner]] == from) corners[corner] = toAttribute;
+                    }
+                }
+
+                // The neighborhoods of both vertices changed: their neighbors' collapses wait for the next pass
+                for (uint32_t vertex : { from, to })
+                {
+                    for (uint32_t index = triangleOffsets[vertex]; index < triangleOffsets[vertex + 1]; index++)
+                    {
+                        const uint32_t* corners = &indices[vertexTriangles[index] * 3];
+                        for (uint32_t corner = 0; corner < 3; corner++) changed[positionVertex[corners[corner]]] = 1;
+                    }
+                }
+                changed[from] = changed[to] = 1;
+
+                quadrics[to].Add(quadrics[from]);
+                numCollapses++;
+            }
+            if (numCollapses == 0) break;
+        }
+
+        // Store the remaining triangles and the vertices they use (in their original order)
+        proxy = Scenes::MeshPrimitive();
+        proxy.index = primitive.index;
+        proxy.material = primitive.material;
+        proxy.opaque = primitive.opaque;
+        proxy.doubleSided = primitive.doubleSided;
+        proxy.boundingBox = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+        std::vector<uint32_t> remap(numVertices, Invalid);
+        for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+        {
+            if (removed[triangle]) continue;
+            for (uint32_t corner = 0; corner < 3; corner++) remap[indices[(triangle * 3) + corner]] = 0;
+        }
+        for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+        {
+            if (remap[vertex] == Invalid) continue;
+            remap[vertex] = (uint32_t)proxyVertices.size();
+            proxyVertices.push_back(vertices[vertex]);
+            proxy.boundingBox.min = rtxgi::Min(proxy.boundingBox.min, vertices[vertex].position);
+            proxy.boundingBox.max = rtxgi::Max(proxy.boundingBox.max, vertices[vertex].position);
+        }
+
+        proxyIndices.reserve((size_t)numRemaining * 3);
+        for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+        {
+            if (removed[triangle]) continue;
+            for (uint32_t corner = 0; corner < 3; corner++) proxyIndices.push_back(remap[indices[(triangle * 3) + corner]]);
+        }
+        proxy.vertices.count = proxyVertices.size();
+        proxy.indices.count = proxyIndices.size();
+    }
+
+    //----------------------------------------------------------------------------------------------------------
+    // Public Functions
+    //----------------------------------------------------------------------------------------------------------
+
+    void SimplifyMesh(const Scenes::Mesh& mesh, const Desc& desc, Scenes::Mesh& proxy)
+    {
+        proxy = Scenes::Mesh();
+        proxy.index = mesh.index;
+        proxy.name = mesh.name;
+        proxy.boundingBox = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+        // The error limit is relative to the size of the whole mesh
+        rtxgi::AABB bounds = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+        for (const Scenes::MeshPrimitive& primitive : mesh.primitives)
+        {
+            for (const Graphics::Vertex& vertex : primitive.vertices)
+            {
+                bounds.min = rtxgi::Min(bounds.min, vertex.position);
+                bounds.max = rtxgi::Max(bounds.max, vertex.position);
+            }
+        }
+        double maxError = 0.0;
+        if (bounds.min.x <= bounds.max.x) maxError = (double)desc.maxError * Length(Sub({ bounds.max.x, bounds.max.y, bounds.max.z }, { bounds.min.x, bounds.min.y, bounds.min.z }));
+
+        std::vector<std::vector<Graphics::Vertex>> vertices(mesh.primitives.size());
+        std::vector<std::vector<uint32_t>> indices(mesh.primitives.size());
+        proxy.primitives.resize(mesh.primitives.size());
+        for (size_t primitiveIndex = 0; primitiveIndex < mesh.primitives.size(); primitiveIndex++)
+        {
+            Scenes::MeshPrimitive& primitive = proxy.primitives[primitiveIndex];
+            SimplifyPrimitive(mesh.primitives[primitiveIndex], desc.targetRatio, maxError, primitive, vertices[primitiveIndex], indices[primitiveIndex]);
+            primitive.vertices.elements = vertices[primitiveIndex].data();
+            primitive.indices.elements = indices[primitiveIndex].data();
+            primitive.indexFormat = IndexBuffers::SelectFormat(primitive);
+
+            proxy.numVertices += static_cast<uint32_t>(primitive.vertices.size());
+            proxy.numIndices += static_cast<uint32_t>(primitive.indices.size());
+            if (primitive.vertices.empty()) continue;
+
+            proxy.boundingBox.min = rtxgi::Min(proxy.boundingBox.min, primitive.boundingBox.min);
+            proxy.boundingBox.max = rtxgi::Max(proxy.boundingBox.max, primitive.boundingBox.max);
+        }
+
+        // Copy the proxy's vertices and indices to its geometry pool (which sets the byte offsets)
+        Scenes::AllocateGeometry(&proxy, 1);
+    }
+
+    void CreateProxies(Scenes::Scene& scene, const Desc& desc, Stats& stats)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        // Meshes that have a proxy (e.g. reused from the scene cache) aren't simplified again
+        uint32_t numMeshes = static_cast<uint32_t>(scene.meshes.size());
+        scene.proxyMeshes.resize(numMeshes);
+
+        std::vector<uint32_t> order;
+        for (uint32_t meshIndex = 0; meshIndex < numMeshes; meshIndex++)
+        {
+            if (scene.proxyMeshes[meshIndex].index < 0) order.push_back(meshIndex);
+        }
+        uint32_t numSimplified = static_cast<uint32_t>(order.size());
+
+        // Largest meshes first, so a large mesh doesn't start last
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return scene.meshes[a].numIndices > scene.meshes[b].numIndices; });
+
+        uint32_t numThreads = (desc.numThreads == 0) ? std::max(std::thread::hardware_concurrency(), 1u) : desc.numThreads;
+        numThreads = std::min(numThreads, std::max(numSimplified, 1u));
+
+        std::atomic<uint32_t> next(0);
+        auto simplify = [&]()
+        {
+            for (uint32_t index = next++; index < numSimplified; index = next++)
+            {
+                SimplifyMesh(scene.meshes[order[index]], desc, scene.proxyMeshes[order[index]]);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 1; thread < numThreads; thread++) threads.emplace_back(simplify);
+        simplify();
+        for (std::thread& thread : threads) thread.join();
+
+        for (uint32_t meshIndex : order)
+        {
+            for (const Scenes::MeshPrimitive& primitive : scene.meshes[meshIndex].primitives) stats.numTriangles += primitive.indices.size() / 3;
+            stats.numProxyTriangles += scene.proxyMeshes[meshIndex].numIndices / 3;
+        }
+
+        // Move the proxies (simplified and reused) to one geometry pool
+        if (numSimplified > 0) Scenes::AllocateGeometry(scene.proxyMeshes.data(), scene.proxyMeshes.size());
+
+        scene.numProxyTriangles = 0;
+        for (const Scenes::Mesh& proxy : scene.proxyMeshes) scene.numProxyTriangles += proxy.numIndices / 3;
+        stats.seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+}
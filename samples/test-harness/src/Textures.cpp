@@ -351,7 +351,7 @@ namespace Textures
      */
     void Unload(Texture& texture)
     {
-        delete[] texture.texels;
+        if (!texture.owner) delete[] texture.texels;
         texture = {};
     }
 
@@ -966,6 +966,33 @@ namespace Graphics
                         }
                     }
 
+                    // Probe Adaptive Hysteresis options
+                    {
+                        Configs::DDGIVolume& volumeConfig = config.ddgi.volumes[config.ddgi.selectedVolume];
+                        if (ImGui::Checkbox("Probe Adaptive Hysteresis", &volumeConfig.probeAdaptiveHysteresisEnabled))
+                        {
+                            volume->SetProbeAdaptiveHysteresisEnabled(volumeConfig.probeAdaptiveHysteresisEnabled);
+                        }
+                        ImGui::SameLine(); AddQuestionMark("Adaptive hysteresis lowers a probe's irradiance hysteresis (down to the minimum) while its texels keep changing and raises it back to the probe hysteresis once they settle.");
+
+                        if (volumeConfig.probeAdaptiveHysteresisEnabled)
+                        {
+                            ImGui::Indent(20.f);
+
+                            if (AddSlider(volumeConfig.probeAdaptiveHysteresisMin, 0.f, 1.f, 0.01f, "##volumeProbeAdaptiveHysteresisMin", "Minimum Hysteresis", "Hysteresis of probes that changed in their latest update."))
+                            {
+                                volume->SetProbeAdaptiveHysteresisMin(volumeConfig.probeAdaptiveHysteresisMin);
+                            }
+
+                            if (AddSlider(volumeConfig.probeAdaptiveHysteresisThreshold, 0.f, 1.f, 0.001f, "##volumeProbeAdaptiveHysteresisThreshold", "Change Threshold", "Coefficient of variation of a probe update above which the probe is considered changed."))
+                            {
+                                volume->SetProbeAdaptiveHysteresisThreshold(volumeConfig.probeAdaptiveHysteresisThreshold);
+                            }
+
+                            ImGui::Unindent(20.f);
+                        }
+                    }
+
                     // Infinite Scrolling options
                     {
                         bool type = (volume->GetMovementType() == EDDGIVolumeMovementType::Scrolling);
@@ -944,8 +944,8 @@ namespace Graphics
          */
         bool CreateIndexBuffer(Globals& vk, const Scenes::Mesh& mesh, VkBuffer* ib, VkDeviceMemory* ibMemory, VkBuffer* ibUpload, VkDeviceMemory* ibUploadMemory)
         {
-            // Create the index buffer upload resource
-            uint32_t sizeInBytes = mesh.numIndices * sizeof(uint32_t);
+            // Create the index buffer upload resource (the opacity states follow the indices)
+            uint32_t sizeInBytes = IndexBuffers::GetSize(mesh) + (mesh.numOpacityStates * sizeof(uint32_t));
             BufferDesc desc = { sizeInBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
             if (!CreateBuffer(vk, desc, ibUpload, ibUploadMemory)) return false;
 
@@ -954,17 +954,17 @@ namespace Graphics
             desc.memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
             if (!CreateBuffer(vk, desc, ib, ibMemory)) return false;
 
-            // Copy the index data of each mesh primitive to the upload buffer
+            // Write the mesh's indices (16 or 32-bit per primitive) to the upload buffer
             uint8_t* pData = nullptr;
             VKCHECK(vkMapMemory(vk.device, *ibUploadMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&pData)));
+            IndexBuffers::Write(mesh, pData);
 
             for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(mesh.primitives.size()); primitiveIndex++)
             {
-                // Get the mesh primitive and copy its indices to the upload buffer
+                // Copy the mesh primitive's opacity states to the upload buffer
                 const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                uint32_t size = static_cast<uint32_t>(primitive.indices.size()) * sizeof(uint32_t);
-                memcpy(pData + primitive.indexByteOffset, primitive.indices.data(), size);
+                uint32_t size = static_cast<uint32_t>(primitive.opacityStates.size()) * sizeof(uint32_t);
+                if (size > 0) memcpy(pData + primitive.opacityByteOffset, primitive.opacityStates.data(), size);
             }
             vkUnmapMemory(vk.device, *ibUploadMemory);
 
@@ -981,8 +981,8 @@ namespace Graphics
          * Copy the index data to the upload buffer and schedule a copy to the device buffer.
          */
         bool CreateIndexBufferBindless(Globals& vk, const Scenes::Mesh& mesh, VkBuffer* ib, VkDeviceMemory* ibMemory, VkBuffer* ibUpload, VkDeviceMemory* ibUploadMemory, uint32_t& ibHandle) {
-            // Create the index buffer upload resource
-            uint32_t sizeInBytes = mesh.numIndices * sizeof(uint32_t);
+            // Create the index buffer upload resource (the opacity states follow the indices)
+            uint32_t sizeInBytes = IndexBuffers::GetSize(mesh) + (mesh.numOpacityStates * sizeof(uint32_t));
             BufferDesc desc = { sizeInBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
             if (!CreateBuffer(vk, desc, ibUpload, ibUploadMemory)) return false;
 
@@ -991,17 +991,17 @@ namespace Graphics
             desc.memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
             if (!CreateBufferBindless(vk, desc, ib, ibMemory, ibHandle)) return false;
 
-            // Copy the index data of each mesh primitive to the upload buffer
+            // Write the mesh's indices (16 or 32-bit per primitive) to the upload buffer
             uint8_t* pData = nullptr;
             VKCHECK(vkMapMemory(vk.device, *ibUploadMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&pData)));
+            IndexBuffers::Write(mesh, pData);
 
             for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(mesh.primitives.size()); primitiveIndex++)
             {
-                // Get the mesh primitive and copy its indices to the upload buffer
+                // Copy the mesh primitive's opacity states to the upload buffer
                 const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                uint32_t size = static_cast<uint32_t>(primitive.indices.size()) * sizeof(uint32_t);
-                memcpy(pData + primitive.indexByteOffset, primitive.indices.data(), size);
+                uint32_t size = static_cast<uint32_t>(primitive.opacityStates.size()) * sizeof(uint32_t);
+                if (size > 0) memcpy(pData + primitive.opacityByteOffset, primitive.opacityStates.data(), size);
             }
             vkUnmapMemory(vk.device, *ibUploadMemory);
 
@@ -1019,9 +1019,8 @@ namespace Graphics
          */
         bool CreateVertexBuffer(Globals& vk, const Scenes::Mesh& mesh, VkBuffer* vb, VkDeviceMemory* vbMemory, VkBuffer* vbUpload, VkDeviceMemory* vbUploadMemory)
         {
-            // Create the vertex buffer upload resource
-            uint32_t stride = sizeof(Vertex);
-            uint32_t sizeInBytes = mesh.numVertices * stride;
+            // Create the vertex buffer upload resource (see Quantization.h for the compact vertex format)
+            uint32_t sizeInBytes = static_cast<uint32_t>(Quantization::GetVertexBufferSize(mesh));
             BufferDesc desc = { sizeInBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
             if (!CreateBuffer(vk, desc, vbUpload, vbUploadMemory)) return false;
 
@@ -1030,18 +1029,11 @@ namespace Graphics
             desc.memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
             if (!CreateBuffer(vk, desc, vb, vbMemory)) return false;
 
-            // Copy the vertex data of each mesh primitive to the upload
+            // Copy the mesh's vertices (contiguous in its geometry pool) to the upload buffer
             uint8_t* pData = nullptr;
             VKCHECK(vkMapMemory(vk.device, *vbUploadMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&pData)));
 
-            for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(mesh.primitives.size()); primitiveIndex++)
-            {
-                // Get the mesh primitive and copy its vertices to the upload buffer
-                const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                uint32_t size = static_cast<uint32_t>(primitive.vertices.size()) * stride;
-                memcpy(pData + primitive.vertexByteOffset, primitive.vertices.data(), size);
-            }
+            if (sizeInBytes > 0) Quantization::WriteVertexBuffer(mesh, pData);
             vkUnmapMemory(vk.device, *vbUploadMemory);
 
             // Schedule a copy of the upload buffer to the device buffer
@@ -1057,9 +1049,8 @@ namespace Graphics
          * Copy the vertex data to the upload buffer and schedule a copy to the device buffer.
          */
         bool CreateVertexBufferBindless(Globals& vk, const Scenes::Mesh& mesh, VkBuffer* vb, VkDeviceMemory* vbMemory, VkBuffer* vbUpload, VkDeviceMemory* vbUploadMemory, uint32_t& vbHandle) {
-            // Create the vertex buffer upload resource
-            uint32_t stride = sizeof(Vertex);
-            uint32_t sizeInBytes = mesh.numVertices * stride;
+            // Create the vertex buffer upload resource (see Quantization.h for the compact vertex format)
+            uint32_t sizeInBytes = static_cast<uint32_t>(Quantization::GetVertexBufferSize(mesh));
             BufferDesc desc = { sizeInBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT };
             if (!CreateBuffer(vk, desc, vbUpload, vbUploadMemory)) return false;
 
@@ -1068,18 +1059,11 @@ namespace Graphics
             desc.memoryPropertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
             if (!CreateBufferBindless(vk, desc, vb, vbMemory, vbHandle)) return false;
 
-            // Copy the vertex data of each mesh primitive to the upload
+            // Copy the mesh's vertices (contiguous in its geometry pool) to the upload buffer
             uint8_t* pData = nullptr;
             VKCHECK(vkMapMemory(vk.device, *vbUploadMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&pData)));
 
-            for (uint32_t primitiveIndex = 0; primitiveIndex < static_cast<uint32_t>(mesh.primitives.size()); primitiveIndex++)
-            {
-                // Get the mesh primitive and copy its vertices to the upload buffer
-                const Scenes::MeshPrimitive& primitive = mesh.primitives[primitiveIndex];
-
-                uint32_t size = static_cast<uint32_t>(primitive.vertices.size()) * stride;
-                memcpy(pData + primitive.vertexByteOffset, primitive.vertices.data(), size);
-            }
+            if (sizeInBytes > 0) Quantization::WriteVertexBuffer(mesh, pData);
             vkUnmapMemory(vk.device, *vbUploadMemory);
 
             // Schedule a copy of the upload buffer to the device buffer
@@ -1114,12 +1098,22 @@ namespace Graphics
                 desc.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
                 desc.geometry.triangles.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
 
-                desc.geometry.triangles.vertexData = VkDeviceOrHostAddressConstKHR{ GetBufferDeviceAddress(vk.device, resources.sceneVBs[mesh.index]) + primitive.vertexByteOffset };
-                desc.geometry.triangles.vertexStride = sizeof(Vertex);
+                VkDeviceAddress vbAddress = GetBufferDeviceAddress(vk.device, resources.sceneVBs[mesh.index]);
+                desc.geometry.triangles.vertexData = VkDeviceOrHostAddressConstKHR{ vbAddress + Quantization::GetVertexByteAddress(mesh, primitive) };
+                desc.geometry.triangles.vertexStride = Quantization::GetVertexStride(mesh);
                 desc.geometry.triangles.maxVertex = static_cast<uint32_t>(primitive.vertices.size());
-                desc.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+                if (Quantization::IsCompact(mesh))
+                {
+                    // Compact positions are dequantized by the transform at the start of the vertex buffer
+                    desc.geometry.triangles.vertexFormat = VK_FORMAT_R16G16B16A16_SNORM;
+                    desc.geometry.triangles.transformData = VkDeviceOrHostAddressConstKHR{ vbAddress };
+                }
+                else
+                {
+                    desc.geometry.triangles.vertexFormat = VK_FORMAT_R32G32B32_SFLOAT;
+                }
                 desc.geometry.triangles.indexData = VkDeviceOrHostAddressConstKHR{ GetBufferDeviceAddress(vk.device, resources.sceneIBs[mesh.index]) + primitive.indexByteOffset };
-                desc.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+                desc.geometry.triangles.indexType = (primitive.indexFormat == INDEX_FORMAT_16) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
                 desc.flags = primitive.opaque ? VK_GEOMETRY_OPAQUE_BIT_KHR : 0;
 
                 uint32_t primitiveCount = static_cast<uint32_t>(primitive.indices.size() / 3);
@@ -2046,8 +2040,9 @@ namespace Graphics
 
                     GeometryData data;
                     data.materialIndex = primitive.material;
-                    data.indexByteAddress = primitive.indexByteOffset;
-                    data.vertexByteAddress = primitive.vertexByteOffset;
+                    data.indexByteAddress = primitive.indexByteOffset | primitive.indexFormat;
+                    data.vertexByteAddress = Quantization::GetVertexByteAddress(mesh, primitive) | Quantization::GetVertexFormat(mesh);
+                    data.opacityStates = primitive.opacityStates.empty() ? 0 : (primitive.opacityByteOffset | static_cast<uint32_t>(scene.opacityLevel + 1));
                     memcpy(geometryDataAddress, &data, sizeof(GeometryData));
 
                     geometryDataAddress += sizeof(GeometryData);
@@ -449,6 +449,9 @@ namespace Graphics
                 volumeDesc.probeMinFrontfaceDistance = config.probeMinFrontfaceDistance;
                 volumeDesc.probeClassificationEnabled = config.probeClassificationEnabled;
                 volumeDesc.probeVariabilityEnabled = config.probeVariabilityEnabled;
+                volumeDesc.probeAdaptiveHysteresisEnabled = config.probeAdaptiveHysteresisEnabled;
+                volumeDesc.probeAdaptiveHysteresisMin = config.probeAdaptiveHysteresisMin;
+                volumeDesc.probeAdaptiveHysteresisThreshold = config.probeAdaptiveHysteresisThreshold;
 
                 if (config.infiniteScrollingEnabled) volumeDesc.movementType = EDDGIVolumeMovementType::Scrolling;
                 else volumeDesc.movementType = EDDGIVolumeMovementType::Default;
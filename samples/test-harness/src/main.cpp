@@ -17,6 +17,14 @@
 #include "UI.h"
 #include "Window.h"
 #include "Benchmark.h"
+#include "Samplers.h"
+#include "Caches.h"
+#include "Quantization.h"
+#include "IndexBuffers.h"
+
+#ifdef CPU_BVH
+#include "BVH.h"
+#endif
 
 #include "graphics/PathTracing.h"
 #include "graphics/GBuffer.h"
@@ -172,6 +180,48 @@ int Run(const std::vector<std::string>& arguments)
     }
     log << "done.\n";
 
+#ifdef CPU_BVH
+    // Benchmark the CPU scene BVH
+    if (config.app.benchmarkBVH)
+    {
+        log << "Benchmarking the CPU scene BVH...";
+        if (!BVH::Benchmark(scene, log)) log << "\tCPU BVH hits differ from the reference traversal!\n";
+        log << "done.\n";
+    }
+#endif
+
+    // Benchmark the CPU texture samplers
+    if (config.app.benchmarkSamplers)
+    {
+        log << "Benchmarking the CPU texture samplers...";
+        if (!Samplers::Benchmark(scene, log)) log << "\tCPU texture samples differ from texel loads!\n";
+        log << "done.\n";
+    }
+
+    // Benchmark loading the scene cache
+    if (config.app.benchmarkCaches)
+    {
+        log << "Benchmarking the scene cache...";
+        if (!Caches::Benchmark(scene, log)) log << "\tScene cache loads differ from the scene!\n";
+        log << "done.\n";
+    }
+
+    // Benchmark the compact vertex format
+    if (config.app.benchmarkQuantization)
+    {
+        log << "Benchmarking the compact vertex format...";
+        if (!Quantization::Benchmark(scene, log)) log << "\tCompact vertices exceed the format's round trip error bounds!\n";
+        log << "done.\n";
+    }
+
+    // Validate the index buffers
+    if (config.app.benchmarkIndexBuffers)
+    {
+        log << "Validating the index buffers...";
+        if (!IndexBuffers::Benchmark(scene, log)) log << "\tIndex buffer triangles differ from the mesh primitives!\n";
+        log << "done.\n";
+    }
+
     // Initialize the graphics system
     log << "Initializing graphics...";
     if (!Graphics::Initialize(config, scene, gfx, gfxResources, log))
@@ -230,6 +280,9 @@ int Run(const std::vector<std::string>& arguments)
         if (!Graphics::WaitForPrevGPUFrame(gfx)) { log << "GPU took too long to complete, device removed!"; break; }
         CPU_TIMESTAMP_ENDANDRESOLVE(waitStat);
 
+        // Log the completion of the scene cache's background write
+        Caches::FinishSerialize(scene, log);
+
         // Move to the next frame and reset the frame's command list
         CPU_TIMESTAMP_BEGIN(resetStat);
         if (!Graphics::MoveToNextFrame(gfx)) break;
@@ -416,6 +469,9 @@ int Run(const std::vector<std::string>& arguments)
 
     log << "Shutting down and cleaning up...\n";
 
+    // Wait for the scene cache's background write
+    Caches::FinishSerialize(scene, log, true);
+
     perf.Cleanup();
 
     Graphics::UI::Cleanup();